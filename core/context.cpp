@@ -346,9 +346,64 @@ mluOpGetAtomicsMode(mluOpHandle_t handle, mluOpAtomicsMode_t *atomics_mode) {
   return MLUOP_STATUS_SUCCESS;
 }
 
+mluOpStatus_t MLUOP_WIN_API mluOpSetWorkspaceArenaMode(
+    mluOpHandle_t handle, mluOpWorkspaceArenaMode_t mode) {
+  PARAM_CHECK("[mluOpSetWorkspaceArenaMode]", handle != NULL);
+  PARAM_CHECK("[mluOpSetWorkspaceArenaMode]",
+              mode == MLUOP_WORKSPACE_ARENA_DISABLED ||
+                  mode == MLUOP_WORKSPACE_ARENA_ENABLED);
+
+  if (mode == MLUOP_WORKSPACE_ARENA_DISABLED) {
+    handle->workspace_arena.reset();
+  } else if (handle->workspace_arena == nullptr) {
+    std::unique_ptr<mluop::WorkspaceAllocator> allocator =
+        mluop::createDeviceWorkspaceAllocator(handle);
+    if (allocator != nullptr) {
+      handle->workspace_arena.reset(new (std::nothrow) mluop::WorkspaceArena(
+          std::move(allocator)));
+    }
+    if (handle->workspace_arena == nullptr) {
+      LOG(ERROR) << "[mluOpSetWorkspaceArenaMode] Failed to create the "
+                    "workspace arena.";
+      return MLUOP_STATUS_ALLOC_FAILED;
+    }
+  }
+
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpTrimWorkspaceArena(mluOpHandle_t handle,
+                                                    size_t retain_size) {
+  PARAM_CHECK("[mluOpTrimWorkspaceArena]", handle != NULL);
+
+  if (handle->workspace_arena != nullptr) {
+    handle->workspace_arena->trim(retain_size);
+  }
+
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpGetWorkspaceArenaStats(
+    mluOpHandle_t handle, mluOpWorkspaceArenaStats_t *stats) {
+  PARAM_CHECK("[mluOpGetWorkspaceArenaStats]", handle != NULL);
+  PARAM_CHECK("[mluOpGetWorkspaceArenaStats]", stats != NULL);
+
+  if (handle->workspace_arena != nullptr) {
+    *stats = handle->workspace_arena->stats();
+  } else {
+    memset(stats, 0, sizeof(mluOpWorkspaceArenaStats_t));
+  }
+
+  return MLUOP_STATUS_SUCCESS;
+}
+
 mluOpStatus_t MLUOP_WIN_API mluOpDestroy(mluOpHandle_t handle) {
   PARAM_CHECK("[mluOpDestroy]", handle != NULL);
 
+  // release the arena and the staging buffers while the queue of the handle
+  // is still valid.
+  handle->workspace_arena.reset();
+  handle->host_staging.reset();
   delete handle;
 
   return MLUOP_STATUS_SUCCESS;
@@ -358,6 +413,11 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetQueue(mluOpHandle_t handle,
                                           cnrtQueue_t queue) {
   PARAM_CHECK("[mluOpSetQueue]", handle != NULL);
 
+  // kernels on the old queue may still use the arena buffer, which would be
+  // handed out to kernels on the new queue.
+  if (handle->workspace_arena != nullptr && handle->queue != queue) {
+    handle->workspace_arena->synchronize();
+  }
   // note, queue could be NULL
   handle->queue = queue;
 
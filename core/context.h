@@ -23,10 +23,13 @@
 #ifndef CORE_CONTEXT_H_
 #define CORE_CONTEXT_H_
 
+#include <memory>
 #include <string>
 #include "mlu_op.h"
 #include "cn_api.h"
 #include "core/logging.h"
+#include "core/host_staging.h"
+#include "core/workspace_arena.h"
 
 #define CONTEXT_DEVICENAME_BUFFER_SIZE 64
 #define CONTEXT_DEVICENAME_LEAST_SIZE 6
@@ -92,6 +95,10 @@ struct mluOpContext {
   double memory_band_width;            // the memory bandwidth in GB/s
   mluOpQuantizeRoundMode_t round_mode;
   mluOpAtomicsMode_t atomics_mode;
+  // null unless enabled by mluOpSetWorkspaceArenaMode.
+  std::unique_ptr<mluop::WorkspaceArena> workspace_arena;
+  // null until an operator uploads a table with it.
+  std::unique_ptr<mluop::HostStaging> host_staging;
   int32_t getJobNum(cnrtFunctionType_t function_type) {
     switch (function_type) {
       default:
@@ -0,0 +1,93 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "core/host_staging.h"
+#include "core/logging.h"
+
+namespace mluop {
+
+HostStaging::~HostStaging() {
+  for (Slot &slot : slots_) {
+    wait(&slot);
+    if (slot.notifier != nullptr) {
+      cnrtNotifierDestroy(slot.notifier);
+    }
+    if (slot.ptr != nullptr) {
+      cnrtFreeHost(slot.ptr);
+    }
+  }
+}
+
+bool HostStaging::wait(Slot *slot) {
+  if (!slot->pending) {
+    return true;
+  }
+  if (cnrtSuccess != cnrtWaitNotifier(slot->notifier)) {
+    LOG(ERROR) << "[HostStaging] cnrtWaitNotifier failed.";
+    return false;
+  }
+  slot->pending = false;
+  return true;
+}
+
+void *HostStaging::acquire(size_t size) {
+  last_ = (last_ + 1) % kSlots;
+  Slot &slot = slots_[last_];
+  if (!wait(&slot)) {
+    return nullptr;
+  }
+  if (size > slot.capacity) {
+    if (slot.ptr != nullptr) {
+      cnrtFreeHost(slot.ptr);
+      slot.ptr = nullptr;
+      slot.capacity = 0;
+    }
+    if (cnrtSuccess != cnrtHostMalloc(&slot.ptr, size)) {
+      LOG(ERROR) << "[HostStaging] cnrtHostMalloc " << size
+                 << " bytes failed.";
+      slot.ptr = nullptr;
+      return nullptr;
+    }
+    slot.capacity = size;
+  }
+  return slot.ptr;
+}
+
+bool HostStaging::enqueued(cnrtQueue_t queue) {
+  Slot &slot = slots_[last_];
+  if (slot.notifier == nullptr &&
+      cnrtSuccess != cnrtNotifierCreate(&slot.notifier)) {
+    slot.notifier = nullptr;
+  }
+  if (slot.notifier != nullptr &&
+      cnrtSuccess == cnrtPlaceNotifier(slot.notifier, queue)) {
+    slot.pending = true;
+    return true;
+  }
+  if (cnrtSuccess != cnrtQueueSync(queue)) {
+    LOG(ERROR) << "[HostStaging] cnrtQueueSync failed.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace mluop
@@ -0,0 +1,76 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef CORE_HOST_STAGING_H_
+#define CORE_HOST_STAGING_H_
+
+#include <cstddef>
+#include "cnrt.h"
+
+namespace mluop {
+
+/**
+ * @brief Pinned host buffers for the small tables an operator uploads into
+ * its workspace with cnrtMemcpyAsync on the queue of the handle.
+ *
+ * Such a copy only runs after the kernels enqueued before it, so the host
+ * must not rewrite its source until then. The buffers are used in turn and
+ * a notifier placed after the copies from a buffer tells when it is free
+ * again: the host only waits when kSlots earlier uploads are still pending.
+ *
+ * Like the handle itself, it is not thread-safe.
+ */
+class HostStaging {
+ public:
+  static constexpr int kSlots = 2;
+
+  HostStaging() = default;
+  HostStaging(const HostStaging &) = delete;
+  HostStaging &operator=(const HostStaging &) = delete;
+  ~HostStaging();
+
+  // Returns a buffer of at least `size` bytes that no pending copy reads
+  // any more, nullptr on failure.
+  void *acquire(size_t size);
+
+  // Called after the copies from the last acquired buffer were enqueued on
+  // `queue`. If no notifier can be placed, the queue is synchronized
+  // instead. Returns false if that fails too.
+  bool enqueued(cnrtQueue_t queue);
+
+ private:
+  struct Slot {
+    void *ptr = nullptr;
+    size_t capacity = 0;
+    cnrtNotifier_t notifier = nullptr;
+    bool pending = false;
+  };
+
+  static bool wait(Slot *slot);
+
+  Slot slots_[kSlots];
+  int last_ = kSlots - 1;
+};
+
+}  // namespace mluop
+
+#endif  // CORE_HOST_STAGING_H_
@@ -394,8 +394,11 @@ static inline mluOpStatus_t mluOpSetTensorDescriptorZeroDim(
     desc->dim = 0;
     desc->total_element_num = 1;
     desc->total_tensor_size = mluop::getSizeOfDataType(desc->dtype);
+    desc->updateSignature();
     return MLUOP_STATUS_SUCCESS;
   } else {
+    // the caller has already set dtype and layout
+    desc->updateSignature();
     LOG(ERROR)
         << "[mluOpSetTensorDescriptorDim]: Currently, the dim can be set to 0"
         << " only when the pointer mode of desc is MLUOP_POINTER_MODE_HOST. "
@@ -413,14 +416,17 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptor(
   PARAM_CHECK("[mluOpSetTensorDescriptor]", layout >= 0);
   PARAM_CHECK("[mluOpSetTensorDescriptor]", dtype >= 0);
 
+  if (dimNb != 0) {
+    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimNb > 0);
+    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimSize != NULL);
+  }
+
   desc->dtype = dtype;
   desc->layout = layout;
 
   if (dimNb == 0) {
     return mluOpSetTensorDescriptorZeroDim(desc);
   } else {
-    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimNb > 0);
-    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimSize != NULL);
     return mluOpSetTensorDescriptorDim(desc, dimNb, dimSize);
   }
 }
@@ -432,15 +438,17 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptor_v2(
   PARAM_CHECK("[mluOpSetTensorDescriptor]", layout >= 0);
   PARAM_CHECK("[mluOpSetTensorDescriptor]", dtype >= 0);
 
+  if (dimNb != 0) {
+    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimNb > 0);
+    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimSize != NULL);
+  }
+
   desc->dtype = dtype;
   desc->layout = layout;
 
   if (dimNb == 0) {
     return mluOpSetTensorDescriptorZeroDim(desc);
   } else {
-    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimNb > 0);
-    PARAM_CHECK("[mluOpSetTensorDescriptor]", dimSize != NULL);
-
     return mluOpSetTensorDescriptorDim_v2(desc, dimNb, dimSize);
   }
 }
@@ -486,6 +494,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorDim(
   desc->total_element_num = stride_base;
   desc->total_tensor_size =
       desc->total_element_num * mluop::getSizeOfDataType(desc->dtype);
+  desc->updateSignature();
   // judge int overflow situation
   if (MLUOP_PREDICT_FALSE(is_overflow)) {
     std::stringstream tensor_info;
@@ -522,6 +531,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorDim_v2(
   desc->total_element_num = stride_base;
   desc->total_tensor_size =
       desc->total_element_num * mluop::getSizeOfDataType(desc->dtype);
+  desc->updateSignature();
   // judge int overflow situation
   if (MLUOP_PREDICT_FALSE(is_overflow)) {
     std::stringstream tensor_info;
@@ -578,6 +588,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetGroupTensorDescriptors(
     group_desc[i][0]->total_tensor_size =
         group_desc[i][0]->total_element_num *
         mluop::getSizeOfDataType(group_dtype[i]);
+    group_desc[i][0]->updateSignature();
 
     // compute new iterator for next loop.
     group_dimSize_iterator += group_dimNb[i];
@@ -623,6 +634,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetGroupTensorDescriptors_v2(
     group_desc[i][0]->total_tensor_size =
         group_desc[i][0]->total_element_num *
         mluop::getSizeOfDataType(group_dtype[i]);
+    group_desc[i][0]->updateSignature();
 
     // compute new iterator for next loop.
     group_dimSize_iterator += group_dimNb[i];
@@ -656,6 +668,7 @@ mluOpResetTensorDescriptor(mluOpTensorDescriptor_t desc) {
   desc->position = 0;
   desc->scale = 1.0f;
   desc->offset = 0;
+  desc->updateSignature();
 
   return MLUOP_STATUS_SUCCESS;
 }
@@ -668,16 +681,18 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorEx(
   PARAM_CHECK("[mluOpSetTensorDescriptorEx]", layout >= 0);
   PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dtype >= 0);
 
+  if (dimNb != 0) {
+    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimSize != NULL);
+    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimStride != NULL);
+    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimNb > 0);
+  }
+
   desc->dtype = dtype;
   desc->layout = layout;
 
   if (dimNb == 0) {
     return mluOpSetTensorDescriptorZeroDim(desc);
   } else {
-    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimSize != NULL);
-    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimStride != NULL);
-    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimNb > 0);
-
     mluOpSetTensorDescriptorDimBase(desc, dimNb);
     std::copy(dimSize, dimSize + dimNb, desc->dims);
     std::copy(dimStride, dimStride + dimNb, desc->strides);
@@ -689,6 +704,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorEx(
     }
     desc->total_tensor_size =
         desc->total_element_num * mluop::getSizeOfDataType(dtype);
+    desc->updateSignature();
 
     return MLUOP_STATUS_SUCCESS;
   }
@@ -702,15 +718,17 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorEx_v2(
   PARAM_CHECK("[mluOpSetTensorDescriptorEx]", layout >= 0);
   PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dtype >= 0);
 
+  if MLUOP_PREDICT_TRUE (dimNb != 0) {
+    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimSize != NULL);
+    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimStride != NULL);
+  }
+
   desc->dtype = dtype;
   desc->layout = layout;
 
   if MLUOP_PREDICT_FALSE (dimNb == 0) {
     return mluOpSetTensorDescriptorZeroDim(desc);
   } else {
-    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimSize != NULL);
-    PARAM_CHECK("[mluOpSetTensorDescriptorEx]", dimStride != NULL);
-
     mluOpSetTensorDescriptorDimBase(desc, dimNb);
     memcpy(desc->dims, dimSize, dimNb * sizeof(int64_t));
     memcpy(desc->strides, dimStride, dimNb * sizeof(int64_t));
@@ -722,6 +740,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorEx_v2(
     }
     desc->total_tensor_size =
         desc->total_element_num * mluop::getSizeOfDataType(dtype);
+    desc->updateSignature();
 
     return MLUOP_STATUS_SUCCESS;
   }
@@ -732,6 +751,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorOnchipDataType(
   PARAM_CHECK("[mluOpSetTensorDescriptorOnchipDataType]", desc != NULL);
 
   desc->onchip_dtype = onchip_dtype;
+  desc->updateSignature();
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -740,6 +760,7 @@ mluOpSetTensorDescriptorPosition(mluOpTensorDescriptor_t desc, int position) {
   PARAM_CHECK("[mluOpSetTensorDescriptorPosition]", desc != NULL);
 
   desc->position = position;
+  desc->updateSignature();
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -749,6 +770,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorPositionAndScale(
 
   desc->position = position;
   desc->scale = scale;
+  desc->updateSignature();
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -759,6 +781,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorPositionScaleAndOffset(
   desc->position = position;
   desc->scale = scale;
   desc->offset = offset;
+  desc->updateSignature();
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -768,6 +791,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSetTensorDescriptorPointerMode(
   PARAM_CHECK("[mluOpSetTensorDescriptorPointerMode]", pointer_mode >= 0);
 
   desc->pointer_mode = pointer_mode;
+  desc->updateSignature();
   return MLUOP_STATUS_SUCCESS;
 }
 
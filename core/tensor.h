@@ -40,7 +40,7 @@
 
 struct alignas(64) mluOpTensorStruct {
   /** default constructor */
-  mluOpTensorStruct() = default;
+  mluOpTensorStruct() { updateSignature(); }
 
   /** copy constructor */
   mluOpTensorStruct(mluOpTensorStruct const &other) { *this = other; }
@@ -92,6 +92,9 @@ struct alignas(64) mluOpTensorStruct {
     scales = other.scales;
     offsets = other.offsets;
 
+    signature_cache = other.signature_cache;
+    shape_signature_cache = other.shape_signature_cache;
+
     return *this;
   }
 
@@ -107,6 +110,19 @@ struct alignas(64) mluOpTensorStruct {
   inline bool isSameDims(const mluOpTensorStruct *other) const;
   inline bool isCpuScalar() const;
 
+  /* Signatures are 64-bit hashes kept on the descriptor. signature() covers
+   * dtype, layout, onchip dtype, pointer mode, dims, strides and quantization
+   * parameters, shapeSignature() covers only dim, dims and strides. They are
+   * recomputed by the mluOpSetTensorDescriptor* family, so reading them never
+   * writes the descriptor; code changing the fields directly must call
+   * updateSignature(). Equal signatures do not guarantee equal descriptors,
+   * use isSameDescriptor() / isSameShapeAndStrides() for that. */
+  inline void updateSignature();
+  inline uint64_t signature() const;
+  inline uint64_t shapeSignature() const;
+  inline bool isSameShapeAndStrides(const mluOpTensorStruct &other) const;
+  inline bool isSameDescriptor(const mluOpTensorStruct &other) const;
+
   /* Try to pack and align the struct */
   /*  ------------------- 64 Bytes - 1 -------------------*/
   int64_t normal_dims[MLUOP_DIM_MAX];
@@ -135,6 +151,10 @@ struct alignas(64) mluOpTensorStruct {
   std::vector<int> positions;
   std::vector<float> scales;
   std::vector<int> offsets;
+
+  /* signatures of the fields above, see updateSignature() */
+  uint64_t signature_cache = 0;
+  uint64_t shape_signature_cache = 0;
 };
 
 // dim_set(rnn)     [layer_num, direction, cap_of_cell]
@@ -491,6 +511,83 @@ inline bool mluOpTensorStruct::isSameDims(
   return isSameDims(*other);
 }
 
+namespace mluop {
+// 64-bit mixing of splitmix64, used to build descriptor signatures.
+inline uint64_t hashMix(uint64_t seed, uint64_t value) {
+  uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) +
+                       (seed >> 2));
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+}  // namespace mluop
+
+inline void mluOpTensorStruct::updateSignature() {
+  uint64_t shape = mluop::hashMix(0, static_cast<uint64_t>(dim));
+  for (int i = 0; i < dim; ++i) {
+    shape = mluop::hashMix(shape, static_cast<uint64_t>(dims[i]));
+    shape = mluop::hashMix(shape, static_cast<uint64_t>(strides[i]));
+  }
+  uint64_t sig = shape;
+  sig = mluop::hashMix(sig, static_cast<uint64_t>(dtype));
+  sig = mluop::hashMix(sig, static_cast<uint64_t>(onchip_dtype));
+  sig = mluop::hashMix(sig, static_cast<uint64_t>(layout));
+  sig = mluop::hashMix(sig, static_cast<uint64_t>(pointer_mode));
+  uint32_t scale_bits = 0;
+  memcpy(&scale_bits, &scale, sizeof(scale_bits));
+  sig = mluop::hashMix(sig, static_cast<uint32_t>(position));
+  sig = mluop::hashMix(sig, scale_bits);
+  sig = mluop::hashMix(sig, static_cast<uint32_t>(offset));
+  for (size_t i = 0; i < positions.size(); ++i) {
+    sig = mluop::hashMix(sig, static_cast<uint32_t>(positions[i]));
+  }
+  for (size_t i = 0; i < scales.size(); ++i) {
+    memcpy(&scale_bits, &scales[i], sizeof(scale_bits));
+    sig = mluop::hashMix(sig, scale_bits);
+  }
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    sig = mluop::hashMix(sig, static_cast<uint32_t>(offsets[i]));
+  }
+  shape_signature_cache = shape;
+  signature_cache = sig;
+}
+
+inline uint64_t mluOpTensorStruct::signature() const {
+  return signature_cache;
+}
+
+inline uint64_t mluOpTensorStruct::shapeSignature() const {
+  return shape_signature_cache;
+}
+
+inline bool mluOpTensorStruct::isSameShapeAndStrides(
+    const mluOpTensorStruct &other) const {
+  if (this == &other) {
+    return true;
+  }
+  if (shapeSignature() != other.shapeSignature() || dim != other.dim) {
+    return false;
+  }
+  return 0 == memcmp(dims, other.dims, dim * sizeof(*dims)) &&
+         0 == memcmp(strides, other.strides, dim * sizeof(*strides));
+}
+
+inline bool mluOpTensorStruct::isSameDescriptor(
+    const mluOpTensorStruct &other) const {
+  if (this == &other) {
+    return true;
+  }
+  if (signature() != other.signature()) {
+    return false;
+  }
+  return isSameShapeAndStrides(other) && dtype == other.dtype &&
+         onchip_dtype == other.onchip_dtype && layout == other.layout &&
+         pointer_mode == other.pointer_mode && position == other.position &&
+         0 == memcmp(&scale, &other.scale, sizeof(scale)) &&
+         offset == other.offset && positions == other.positions &&
+         scales == other.scales && offsets == other.offsets;
+}
+
 inline bool mluOpTensorStruct::isCpuScalar() const {
   if (dim == 0 && pointer_mode == MLUOP_POINTER_MODE_HOST &&
       total_element_num == 1) {
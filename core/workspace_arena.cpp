@@ -0,0 +1,96 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "core/workspace_arena.h"
+#include "core/context.h"
+#include "core/logging.h"
+
+namespace mluop {
+
+namespace {
+class DeviceWorkspaceAllocator : public WorkspaceAllocator {
+ public:
+  explicit DeviceWorkspaceAllocator(mluOpHandle_t handle) : handle_(handle) {}
+
+  void *allocate(size_t size) override {
+    void *ptr = nullptr;
+    if (cnrtSuccess != cnrtMalloc(&ptr, size)) {
+      LOG(ERROR) << "[WorkspaceArena] cnrtMalloc " << size
+                 << " bytes failed.";
+      return nullptr;
+    }
+    VLOG(5) << "[WorkspaceArena] grow to " << size << " bytes.";
+    return ptr;
+  }
+
+  void deallocate(void *ptr) override {
+    if (cnrtSuccess != cnrtFree(ptr)) {
+      LOG(ERROR) << "[WorkspaceArena] cnrtFree failed.";
+    }
+  }
+
+  void synchronize() override {
+    if (cnrtSuccess != cnrtQueueSync(handle_->queue)) {
+      LOG(ERROR) << "[WorkspaceArena] cnrtQueueSync failed.";
+    }
+  }
+
+ private:
+  mluOpHandle_t handle_;
+};
+}  // namespace
+
+std::unique_ptr<WorkspaceAllocator> createDeviceWorkspaceAllocator(
+    mluOpHandle_t handle) {
+  return std::unique_ptr<WorkspaceAllocator>(
+      new (std::nothrow) DeviceWorkspaceAllocator(handle));
+}
+
+mluOpStatus_t resolveWorkspace(
+    mluOpHandle_t handle, const std::string &api, void **workspace,
+    size_t *workspace_size,
+    const std::function<mluOpStatus_t(size_t *)> &get_size) {
+  if (*workspace != nullptr || handle->workspace_arena == nullptr) {
+    return MLUOP_STATUS_SUCCESS;
+  }
+  size_t required_size = 0;
+  mluOpStatus_t status = get_size(&required_size);
+  if (status != MLUOP_STATUS_SUCCESS) {
+    return status;
+  }
+  if (required_size == 0) {
+    return MLUOP_STATUS_SUCCESS;
+  }
+  void *buffer = handle->workspace_arena->acquire(required_size);
+  if (buffer == nullptr) {
+    LOG(ERROR) << api << " Failed to allocate " << required_size
+               << " bytes of workspace from the workspace arena.";
+    return MLUOP_STATUS_ALLOC_FAILED;
+  }
+  VLOG(5) << api << " Use " << required_size
+          << " bytes of workspace from the workspace arena.";
+  *workspace = buffer;
+  *workspace_size = required_size;
+  return MLUOP_STATUS_SUCCESS;
+}
+
+}  // namespace mluop
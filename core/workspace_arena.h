@@ -0,0 +1,173 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef CORE_WORKSPACE_ARENA_H_
+#define CORE_WORKSPACE_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include "mlu_op.h"
+
+namespace mluop {
+
+/**
+ * @brief Backing allocator of a WorkspaceArena.
+ *
+ * The arena only does bookkeeping, the real memory comes from here. The
+ * device implementation wraps cnrtMalloc/cnrtFree and synchronizes the queue
+ * of the handle, tests plug in a host allocator to check the bookkeeping
+ * without a device.
+ */
+class WorkspaceAllocator {
+ public:
+  virtual ~WorkspaceAllocator() = default;
+  // returns nullptr on failure.
+  virtual void *allocate(size_t size) = 0;
+  virtual void deallocate(void *ptr) = 0;
+  // Waits until all the work enqueued before this call has finished, so a
+  // buffer that may still be read or written by queued kernels can be freed.
+  virtual void synchronize() = 0;
+};
+
+/**
+ * @brief Growable workspace attached to a handle.
+ *
+ * All the kernels of a handle are launched on the same queue, so a single
+ * buffer can be handed out to consecutive calls without any synchronization
+ * (stream-ordered reuse). The buffer only grows: its capacity is the
+ * high-water mark of the requested sizes rounded up to kGranularity, until
+ * trim() is called explicitly. Before an old buffer is released the queue is
+ * synchronized, because kernels launched by previous calls may still use it.
+ *
+ * Like the handle itself, the arena is not thread-safe.
+ */
+class WorkspaceArena {
+ public:
+  static constexpr size_t kGranularity = 1 << 20;  // 1 MiB
+
+  explicit WorkspaceArena(std::unique_ptr<WorkspaceAllocator> allocator)
+      : allocator_(std::move(allocator)) {}
+  WorkspaceArena(const WorkspaceArena &) = delete;
+  WorkspaceArena &operator=(const WorkspaceArena &) = delete;
+  ~WorkspaceArena() { release(); }
+
+  // Returns a buffer of at least `size` bytes, nullptr if allocation failed.
+  // The buffer stays valid until the next acquire() that needs to grow,
+  // trim() or the destruction of the arena.
+  void *acquire(size_t size) {
+    stats_.request_count++;
+    if (size > stats_.high_water_mark) {
+      stats_.high_water_mark = size;
+    }
+    if (size == 0) {
+      return buffer_;
+    }
+    if (size <= capacity_) {
+      return buffer_;
+    }
+    const size_t new_capacity = roundUp(size);
+    release();
+    buffer_ = allocator_->allocate(new_capacity);
+    if (buffer_ == nullptr) {
+      return nullptr;
+    }
+    capacity_ = new_capacity;
+    stats_.growth_count++;
+    return buffer_;
+  }
+
+  // Shrinks the arena so that it keeps at most `retain_bytes`, passing 0
+  // frees the whole buffer. The high-water mark is kept.
+  void trim(size_t retain_bytes) {
+    stats_.trim_count++;
+    if (capacity_ > retain_bytes) {
+      release();
+      if (retain_bytes > 0) {
+        const size_t new_capacity = roundUp(retain_bytes);
+        buffer_ = allocator_->allocate(new_capacity);
+        capacity_ = buffer_ == nullptr ? 0 : new_capacity;
+      }
+    }
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  mluOpWorkspaceArenaStats_t stats() const {
+    mluOpWorkspaceArenaStats_t stats = stats_;
+    stats.capacity = capacity_;
+    return stats;
+  }
+
+  // Synchronizes the queue the arena is used on, called before the handle
+  // switches to another queue.
+  void synchronize() {
+    if (buffer_ != nullptr) {
+      allocator_->synchronize();
+    }
+  }
+
+ private:
+  static size_t roundUp(size_t size) {
+    return (size + kGranularity - 1) / kGranularity * kGranularity;
+  }
+
+  void release() {
+    if (buffer_ != nullptr) {
+      allocator_->synchronize();
+      allocator_->deallocate(buffer_);
+      buffer_ = nullptr;
+    }
+    capacity_ = 0;
+  }
+
+  std::unique_ptr<WorkspaceAllocator> allocator_;
+  void *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  mluOpWorkspaceArenaStats_t stats_ = {0, 0, 0, 0, 0};
+};
+
+// Creates the cnrtMalloc based allocator whose synchronize() waits on the
+// queue currently set on `handle`, nullptr if it can not be allocated.
+std::unique_ptr<WorkspaceAllocator> createDeviceWorkspaceAllocator(
+    mluOpHandle_t handle);
+
+/**
+ * @brief Resolves the workspace of an operator call.
+ *
+ * If the caller passed a null \p workspace and the arena of \p handle is
+ * enabled, \p get_size is called to query the workspace size of the call and
+ * \p workspace and \p workspace_size are replaced by a buffer of the arena.
+ * Otherwise both are left untouched, so the usual null-pointer checks of the
+ * operator still apply.
+ */
+mluOpStatus_t resolveWorkspace(
+    mluOpHandle_t handle, const std::string &api, void **workspace,
+    size_t *workspace_size,
+    const std::function<mluOpStatus_t(size_t *)> &get_size);
+
+}  // namespace mluop
+
+#endif  // CORE_WORKSPACE_ARENA_H_
@@ -22,11 +22,17 @@
  *************************************************************************/
 #include "kernels/adam_w/adam_w.h"
 
+#include <limits>
+#include <vector>
+
 #include "core/gen_case.h"
+#include "core/host_staging.h"
 #include "core/logging.h"
 #include "core/runtime/device.h"
 #include "core/type.h"
 #include "core/tool.h"
+#include "core/workspace_arena.h"
+#include "kernels/adam_w/adam_w_foreach.h"
 
 mluOpStatus_t MLUOP_WIN_API
 mluOpCreateAdamWDescriptor(mluOpAdamWDescriptor_t *adamw_desc) {
@@ -278,3 +284,146 @@ mluOpAdamW(mluOpHandle_t handle, const mluOpAdamWDescriptor_t adamw_desc,
   GEN_CASE_END();
   return MLUOP_STATUS_SUCCESS;
 }
+
+mluOpStatus_t MLUOP_WIN_API mluOpGetAdamWForeachWorkspaceSize(
+    mluOpHandle_t handle, const int tensor_num, const size_t sizes[],
+    size_t *workspace_size) {
+  PARAM_CHECK("[mluOpGetAdamWForeachWorkspaceSize]", handle != nullptr);
+  PARAM_CHECK("[mluOpGetAdamWForeachWorkspaceSize]", tensor_num >= 0);
+  PARAM_CHECK("[mluOpGetAdamWForeachWorkspaceSize]",
+              tensor_num == 0 || sizes != nullptr);
+  PARAM_CHECK("[mluOpGetAdamWForeachWorkspaceSize]",
+              workspace_size != nullptr);
+  *workspace_size =
+      mluop::countAdamWChunks(tensor_num, sizes) * sizeof(AdamWChunk);
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpAdamWForeach(
+    mluOpHandle_t handle, mluOpAdamWDescriptor_t adamw_desc,
+    const int tensor_num, void *const params[], void *const params_h[],
+    void *const momentums[], void *const velocities[], void *const grads[],
+    const size_t sizes[], void *workspace, size_t workspace_size,
+    const float lr, const float beta1, const float beta2, const float bias1,
+    const float bias2, const float epsilon) {
+  PARAM_CHECK("[mluOpAdamWForeach]", handle != nullptr);
+  PARAM_CHECK("[mluOpAdamWForeach]", adamw_desc != nullptr);
+  PARAM_CHECK("[mluOpAdamWForeach]", tensor_num >= 0);
+  PARAM_CHECK_LE("[mluOpAdamWForeach]", beta1, 1.0);
+  PARAM_CHECK_GE("[mluOpAdamWForeach]", beta1, 0.0);
+  PARAM_CHECK_LE("[mluOpAdamWForeach]", beta2, 1.0);
+  PARAM_CHECK_GE("[mluOpAdamWForeach]", beta2, 0.0);
+  PARAM_CHECK_GE("[mluOpAdamWForeach]", handle->arch, MLUOP_MLU590);
+  PARAM_CHECK("[mluOpAdamWForeach]", epsilon > 0);
+  if (tensor_num == 0) {
+    VLOG(5) << "[mluOpAdamWForeach] Skip zero tensor.";
+    return MLUOP_STATUS_SUCCESS;
+  }
+  PARAM_CHECK("[mluOpAdamWForeach]", params != nullptr || params_h != nullptr);
+  PARAM_CHECK("[mluOpAdamWForeach]", momentums != nullptr);
+  PARAM_CHECK("[mluOpAdamWForeach]", velocities != nullptr);
+  PARAM_CHECK("[mluOpAdamWForeach]", grads != nullptr);
+  PARAM_CHECK("[mluOpAdamWForeach]", sizes != nullptr);
+
+  size_t total_num = 0;
+  for (int i = 0; i < tensor_num; ++i) {
+    if (sizes[i] == 0) {
+      continue;
+    }
+    if (sizes[i] >= LARGE_TENSOR_NUM) {
+      LOG(ERROR) << "[mluOpAdamWForeach] The size of tensor " << i << " is "
+                 << sizes[i] << ", which exceeds the limit of "
+                 << LARGE_TENSOR_NUM << " elements.";
+      return MLUOP_STATUS_NOT_SUPPORTED;
+    }
+    if ((params != nullptr && params[i] == nullptr) ||
+        (params_h != nullptr && params_h[i] == nullptr) ||
+        momentums[i] == nullptr || velocities[i] == nullptr ||
+        grads[i] == nullptr) {
+      LOG(ERROR) << "[mluOpAdamWForeach] The pointers of tensor " << i
+                 << " should not be nullptr.";
+      return MLUOP_STATUS_BAD_PARAM;
+    }
+    total_num += sizes[i];
+  }
+  if (total_num == 0) {
+    VLOG(5) << "[mluOpAdamWForeach] Skip zero element tensors.";
+    return MLUOP_STATUS_SUCCESS;
+  }
+
+  mluOpStatus_t arena_status = mluop::resolveWorkspace(
+      handle, "[mluOpAdamWForeach]", &workspace, &workspace_size,
+      [&](size_t *size) {
+        return mluOpGetAdamWForeachWorkspaceSize(handle, tensor_num, sizes,
+                                                 size);
+      });
+  if (arena_status != MLUOP_STATUS_SUCCESS) {
+    return arena_status;
+  }
+  const std::vector<mluop::AdamWChunkRef> refs =
+      mluop::planAdamWChunks(tensor_num, sizes);
+  PARAM_CHECK("[mluOpAdamWForeach]", workspace != nullptr);
+  PARAM_CHECK_GE("[mluOpAdamWForeach]", workspace_size,
+                 refs.size() * sizeof(AdamWChunk));
+  if (refs.size() > (size_t)std::numeric_limits<int>::max()) {
+    LOG(ERROR) << "[mluOpAdamWForeach] Too many chunks: " << refs.size();
+    return MLUOP_STATUS_NOT_SUPPORTED;
+  }
+
+  // the launch table holds the device addresses of every chunk, so a
+  // single launch covers the whole list. It is uploaded on the queue, after
+  // the kernels that may still read the workspace.
+  if (handle->host_staging == nullptr) {
+    handle->host_staging.reset(new (std::nothrow) mluop::HostStaging());
+  }
+  const size_t table_bytes = refs.size() * sizeof(AdamWChunk);
+  AdamWChunk *table =
+      handle->host_staging == nullptr
+          ? nullptr
+          : (AdamWChunk *)handle->host_staging->acquire(table_bytes);
+  if (table == nullptr) {
+    LOG(ERROR) << "[mluOpAdamWForeach] Failed to allocate " << table_bytes
+               << " bytes of host memory for the launch table.";
+    return MLUOP_STATUS_ALLOC_FAILED;
+  }
+  for (size_t i = 0; i < refs.size(); ++i) {
+    const mluop::AdamWChunkRef &ref = refs[i];
+    AdamWChunk &chunk = table[i];
+    chunk.param =
+        params == nullptr ? nullptr : (float *)params[ref.tensor] + ref.offset;
+    chunk.param_h = params_h == nullptr
+                        ? nullptr
+                        : (void *)((uint16_t *)params_h[ref.tensor] +
+                                   ref.offset);
+    chunk.grad = (void *)((uint16_t *)grads[ref.tensor] + ref.offset);
+    chunk.momentum = (float *)momentums[ref.tensor] + ref.offset;
+    chunk.velocity = (float *)velocities[ref.tensor] + ref.offset;
+    chunk.num = ref.num;
+  }
+  if (cnrtSuccess != cnrtMemcpyAsync(workspace, table, table_bytes,
+                                     handle->queue, cnrtMemcpyHostToDev) ||
+      !handle->host_staging->enqueued(handle->queue)) {
+    LOG(ERROR) << "[mluOpAdamWForeach] Failed to copy the launch table.";
+    return MLUOP_STATUS_EXECUTION_FAILED;
+  }
+
+  cnrtDim3_t k_dim;
+  cnrtFunctionType_t k_type = cnrtFuncTypeUnion1;
+  k_dim.x = mluop::runtime::getCoreNumOfEachUnionCapability(handle);
+  k_dim.y = mluop::runtime::getClusterLimitCapability(handle);
+  k_dim.z = 1;
+  // as for mluOpAdamW, a small step uses 1 cluster
+  size_t small_case_thread = 2048;
+  if (total_num <= small_case_thread) k_dim.y = 1;
+  VLOG(5) << "Launch Kernel KernelApplyAdamWForeach<<<Union"
+          << k_type / CORE_DIM << ", " << k_dim.x << ", " << k_dim.y << ", "
+          << k_dim.z << ">>> over " << refs.size() << " chunks of "
+          << tensor_num << " tensors.";
+  CHECK_RETURN("[mluOpAdamWForeach]",
+               KernelApplyAdamWForeach(
+                   k_dim, k_type, handle->queue, workspace, (int)refs.size(),
+                   lr, beta1, beta2, bias1, bias2, epsilon,
+                   adamw_desc->weight_decay, adamw_desc->grad_scale,
+                   adamw_desc->use_nesterov, MLUOP_DTYPE_BFLOAT16));
+  return MLUOP_STATUS_SUCCESS;
+}
@@ -40,4 +40,23 @@ mluOpStatus_t MLUOP_WIN_API KernelApplyAdamW(
     float bias1, float bias2, float epsilon, float weight_decay, float scale,
     bool use_nesterov, size_t size, mluOpDataType_t k_data_type);
 
+// An entry of the mluOpAdamWForeach launch table as the kernel reads it:
+// the device addresses of one mluop::AdamWChunkRef. param or param_h is
+// nullptr when the step has no such tensors.
+struct AdamWChunk {
+  float *param;
+  void *param_h;
+  void *grad;
+  float *momentum;
+  float *velocity;
+  size_t num;
+};
+
+mluOpStatus_t MLUOP_WIN_API KernelApplyAdamWForeach(
+    const cnrtDim3_t k_dim, const cnrtFunctionType_t k_type,
+    const cnrtQueue_t queue, const void *table, int chunk_num, float lr,
+    float beta1, float beta2, float bias1, float bias2, float epsilon,
+    float weight_decay, float scale, bool use_nesterov,
+    mluOpDataType_t k_data_type);
+
 #endif  // KERNELS_ADAMW_ADAMW_H_
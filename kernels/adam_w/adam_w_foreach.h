@@ -0,0 +1,81 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_ADAMW_ADAMW_FOREACH_H_
+#define KERNELS_ADAMW_ADAMW_FOREACH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace mluop {
+
+// Elements of one entry of the mluOpAdamWForeach launch table. Every
+// tensor is cut at multiples of it, so the entries keep the alignment of
+// their tensors and, but for the tails, have the same cost.
+constexpr size_t kAdamWChunkNum = 64 * 1024;
+
+/**
+ * @brief A run of elements of one tensor of a foreach AdamW step:
+ * elements [offset, offset + num) of tensor number \p tensor.
+ */
+struct AdamWChunkRef {
+  int32_t tensor;
+  size_t offset;
+  size_t num;
+};
+
+// Number of entries planAdamWChunks() gives for the tensor sizes.
+inline size_t countAdamWChunks(const int tensor_num, const size_t *sizes,
+                               const size_t chunk_num = kAdamWChunkNum) {
+  size_t count = 0;
+  for (int i = 0; i < tensor_num; ++i) {
+    count += (sizes[i] + chunk_num - 1) / chunk_num;
+  }
+  return count;
+}
+
+/**
+ * @brief Cuts a list of tensors of \p sizes elements into the launch table
+ * of a foreach AdamW step, in tensor order. Empty tensors have no entry.
+ *
+ * The device kernel and the CPU reference both walk this table, one entry
+ * per task at a time, so the cost of a step depends on the number of
+ * elements and not on the number of tensors.
+ */
+inline std::vector<AdamWChunkRef> planAdamWChunks(
+    const int tensor_num, const size_t *sizes,
+    const size_t chunk_num = kAdamWChunkNum) {
+  std::vector<AdamWChunkRef> table;
+  table.reserve(countAdamWChunks(tensor_num, sizes, chunk_num));
+  for (int i = 0; i < tensor_num; ++i) {
+    for (size_t offset = 0; offset < sizes[i]; offset += chunk_num) {
+      const size_t rest = sizes[i] - offset;
+      table.push_back({i, offset, rest < chunk_num ? rest : chunk_num});
+    }
+  }
+  return table;
+}
+
+}  // namespace mluop
+
+#endif  // KERNELS_ADAMW_ADAMW_FOREACH_H_
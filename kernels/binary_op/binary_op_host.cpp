@@ -241,7 +241,12 @@ mluOpStatus_t binaryOpParamSameShapeCheck(
   PARAM_CHECK_EQ("[" + op_name + "]", input1_desc->dim, input2_desc->dim);
   PARAM_CHECK_EQ("[" + op_name + "]", input1_desc->dim, output_desc->dim);
 
-  // check shape
+  // check shape, descriptors with the same cached shape signature are
+  // accepted without the per-dim comparison.
+  if (input1_desc->isSameShapeAndStrides(*input2_desc) &&
+      input1_desc->isSameShapeAndStrides(*output_desc)) {
+    return MLUOP_STATUS_SUCCESS;
+  }
   for (int i = 0; i < input1_desc->dim; i++) {
     if (input1_desc->dims[i] != input2_desc->dims[i]) {
       LOG(ERROR) << op_name << ":The shape of input1 should be equal to input2"
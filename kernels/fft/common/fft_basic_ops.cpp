@@ -364,6 +364,7 @@ mluOpStatus_t fftQuantMatMul(mluOpHandle_t handle, int m, int k, int n,
     CALL_CNNL(cnnlMatMulAlgoDestroy(matmul_algo));
   } else {
     c_desc->onchip_dtype = MLUOP_DTYPE_FLOAT;
+    c_desc->updateSignature();
     cnnlMatMulDescriptor_t matmul_desc;
     cnnlMatMulAlgo_t matmul_algo;
     cnnlMatMulHeuristicResult_t heuristic_result;
@@ -466,6 +467,7 @@ mluOpStatus_t fftGetBatchMatMulBcastWorkspaceSize(
                                        c_dims);
   INTERNAL_CHECK(api, status == MLUOP_STATUS_SUCCESS);
   c_desc->onchip_dtype = MLUOP_DTYPE_FLOAT;
+  c_desc->updateSignature();
 
   DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle,
                                     cnnl_handle);  // convert to cnnl_handle
@@ -560,6 +562,7 @@ mluOpStatus_t fftBatchMatMulBcast(
                                        c_dims);
   INTERNAL_CHECK(api, status == MLUOP_STATUS_SUCCESS);
   c_desc->onchip_dtype = MLUOP_DTYPE_FLOAT;
+  c_desc->updateSignature();
 
   DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle,
                                     cnnl_handle);  // convert to cnnl_handle
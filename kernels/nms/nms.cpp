@@ -20,6 +20,7 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
+#include "core/workspace_arena.h"
 #include "kernels/utils/cnnl_helper.h"
 
 mluOpStatus_t MLUOP_WIN_API
@@ -92,6 +93,15 @@ mluOpNms(mluOpHandle_t handle, const mluOpNmsDescriptor_t nms_desc,
   PARAM_CHECK("mluOpNms", boxes != NULL);
   PARAM_CHECK("mluOpNms", output != NULL);
   PARAM_CHECK("mluOpNms", output_size != NULL);
+  mluOpStatus_t arena_status = mluop::resolveWorkspace(
+      handle, "[mluOpNms]", &workspace, &workspace_size,
+      [&](size_t *size) {
+        return mluOpGetNmsWorkspaceSize(handle, boxes_desc, confidence_desc,
+                                        size);
+      });
+  if (arena_status != MLUOP_STATUS_SUCCESS) {
+    return arena_status;
+  }
   DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
   DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(boxes_desc, cnnl_boxes_desc);
   DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(output_desc, cnnl_output_desc);
@@ -27,6 +27,7 @@
 #include "core/logging.h"
 #include "core/mlu_env.h"
 #include "core/tensor.h"
+#include "core/workspace_arena.h"
 #include "kernels/sparse_conv/get_indice_pairs/get_indice_pairs_structs.h"
 #include "kernels/sparse_conv/get_indice_pairs/normal_get_indice_pairs.h"
 #include "mlu_op.h"
@@ -204,6 +205,16 @@ static mluOpStatus_t internalGetIndicePairs(
     PARAM_CHECK(interface_name, indice_pairs != NULL);
     PARAM_CHECK(interface_name, out_indices != NULL);
     PARAM_CHECK(interface_name, indice_num != NULL);
+    mluOpStatus_t arena_status = mluop::resolveWorkspace(
+        handle, interface_name, &workspace, &workspace_size,
+        [&](size_t *size) {
+          return mluOpGetIndicePairsWorkspaceSize(
+              handle, sparse_conv_desc, indices_desc, indice_pairs_desc,
+              out_indices_desc, indice_num_desc, size);
+        });
+    if (arena_status != MLUOP_STATUS_SUCCESS) {
+      return arena_status;
+    }
     if (workspace_size != 0) {
       PARAM_CHECK(interface_name, workspace != NULL);
     }
@@ -65,6 +65,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSqrt(mluOpHandle_t handle,
   if (x_desc->dtype == MLUOP_DTYPE_INT32 &&
       y_desc->dtype == MLUOP_DTYPE_FLOAT) {
     x_desc->dtype = MLUOP_DTYPE_FLOAT;
+    x_desc->updateSignature();
     x_dtype_transform = true;
   }
 
@@ -84,6 +85,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpSqrt(mluOpHandle_t handle,
   // correct the input's type
   if (x_dtype_transform) {
     x_desc->dtype = MLUOP_DTYPE_INT32;
+    x_desc->updateSignature();
   }
 
   if (param_check != MLUOP_STATUS_SUCCESS) {
@@ -93,6 +93,9 @@ bool strideCaseWithNotConsistentDense(int tensor_num, ...) {
         // ignore scalar
         continue;
       }
+      if (this_tensor->isSameShapeAndStrides(*first_stride_tensor)) {
+        continue;
+      }
       if (this_tensor->dim != first_dim) {
         va_end(ap);
         return true;
@@ -0,0 +1,213 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "core/context.h"
+#include "core/logging.h"
+#include "core/tensor.h"
+#include "core/type.h"
+#include "kernels/voxelization/voxelization.h"
+
+#define VOXEL_MAP_CNRT_CHECK(api, call)                       \
+  if (cnrtSuccess != (call)) {                                \
+    LOG(ERROR) << api << " Failed to access the MLU memory."; \
+    return MLUOP_STATUS_EXECUTION_FAILED;                     \
+  }
+
+mluOpStatus_t MLUOP_WIN_API
+mluOpCreateVoxelMapDescriptor(mluOpVoxelMapDescriptor_t *voxel_map_desc) {
+  PARAM_CHECK("[mluOpCreateVoxelMapDescriptor]", voxel_map_desc != NULL);
+  *voxel_map_desc = new (std::nothrow) mluOpVoxelMapStruct();
+  if (*voxel_map_desc == NULL) {
+    return MLUOP_STATUS_ALLOC_FAILED;
+  }
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpSetVoxelMapDescriptor(
+    mluOpVoxelMapDescriptor_t voxel_map_desc, const float *voxel_size,
+    const float *coors_range, const int32_t max_points,
+    const int32_t max_voxels, const int32_t num_features) {
+  const std::string api = "[mluOpSetVoxelMapDescriptor]";
+  PARAM_CHECK(api, voxel_map_desc != NULL);
+  PARAM_CHECK(api, voxel_size != NULL);
+  PARAM_CHECK(api, coors_range != NULL);
+  PARAM_CHECK(api, max_points > 0);
+  PARAM_CHECK(api, max_voxels > 0);
+  PARAM_CHECK(api, num_features >= 3);
+  for (int i = 0; i < 3; ++i) {
+    PARAM_CHECK(api, voxel_size[i] > 0);
+    PARAM_CHECK(api, coors_range[i + 3] > coors_range[i]);
+  }
+  mluop::VoxelGrid grid;
+  grid.set(voxel_size, coors_range);
+  voxel_map_desc->map.reset(grid, max_points, max_voxels, num_features);
+  voxel_map_desc->is_set = true;
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API
+mluOpDestroyVoxelMapDescriptor(mluOpVoxelMapDescriptor_t voxel_map_desc) {
+  PARAM_CHECK("[mluOpDestroyVoxelMapDescriptor]", voxel_map_desc != NULL);
+  delete voxel_map_desc;
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpVoxelMapAppend(
+    mluOpHandle_t handle, mluOpVoxelMapDescriptor_t voxel_map_desc,
+    const mluOpTensorDescriptor_t points_desc, const void *points,
+    const int64_t timestamp) {
+  const std::string api = "[mluOpVoxelMapAppend]";
+  PARAM_CHECK(api, handle != NULL);
+  PARAM_CHECK(api, voxel_map_desc != NULL);
+  PARAM_CHECK(api, voxel_map_desc->is_set);
+  PARAM_CHECK(api, points_desc != NULL);
+  // params points: [num_points, num_features]
+  PARAM_CHECK_EQ(api, points_desc->dim, 2);
+  PARAM_CHECK_EQ(api, points_desc->dims[1],
+                 voxel_map_desc->map.numFeatures());
+  PARAM_CHECK(api, points_desc->dtype == MLUOP_DTYPE_FLOAT);
+  STRIDE_TENSOR_CHECK(api, points_desc, "points_desc must be contiguous");
+
+  const size_t num_points = points_desc->dims[0];
+  std::vector<float> &host_points = voxel_map_desc->points;
+  host_points.resize(mluOpGetTensorElementNum(points_desc));
+  if (num_points > 0) {
+    PARAM_CHECK(api, points != NULL);
+    VOXEL_MAP_CNRT_CHECK(api, cnrtQueueSync(handle->queue));
+    VOXEL_MAP_CNRT_CHECK(
+        api, cnrtMemcpy(host_points.data(), const_cast<void *>(points),
+                        host_points.size() * sizeof(float),
+                        cnrtMemcpyDevToHost));
+  }
+  if (!voxel_map_desc->map.append(host_points.data(), num_points, timestamp)) {
+    LOG(ERROR) << api << " The timestamp " << timestamp
+               << " is older than the last appended sweep.";
+    return MLUOP_STATUS_BAD_PARAM;
+  }
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API
+mluOpVoxelMapEvict(mluOpVoxelMapDescriptor_t voxel_map_desc,
+                   const int64_t min_timestamp) {
+  PARAM_CHECK("[mluOpVoxelMapEvict]", voxel_map_desc != NULL);
+  PARAM_CHECK("[mluOpVoxelMapEvict]", voxel_map_desc->is_set);
+  voxel_map_desc->map.evict(min_timestamp);
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpGetVoxelMapChangedVoxels(
+    mluOpHandle_t handle, mluOpVoxelMapDescriptor_t voxel_map_desc,
+    const mluOpTensorDescriptor_t voxel_ids_desc, void *voxel_ids,
+    const mluOpTensorDescriptor_t voxels_desc, void *voxels,
+    const mluOpTensorDescriptor_t coors_desc, void *coors,
+    const mluOpTensorDescriptor_t num_points_per_voxel_desc,
+    void *num_points_per_voxel, int32_t *changed_num) {
+  const std::string api = "[mluOpGetVoxelMapChangedVoxels]";
+  PARAM_CHECK(api, handle != NULL);
+  PARAM_CHECK(api, voxel_map_desc != NULL);
+  PARAM_CHECK(api, voxel_map_desc->is_set);
+  PARAM_CHECK(api, voxel_ids_desc != NULL);
+  PARAM_CHECK(api, voxels_desc != NULL);
+  PARAM_CHECK(api, coors_desc != NULL);
+  PARAM_CHECK(api, num_points_per_voxel_desc != NULL);
+  PARAM_CHECK(api, changed_num != NULL);
+
+  mluop::VoxelMap &map = voxel_map_desc->map;
+  const int32_t max_voxels = map.maxVoxels();
+  const int32_t max_points = map.maxPoints();
+  const int32_t num_features = map.numFeatures();
+  // params voxel_ids: [max_voxels]
+  PARAM_CHECK_EQ(api, voxel_ids_desc->dim, 1);
+  PARAM_CHECK_EQ(api, voxel_ids_desc->dims[0], max_voxels);
+  // params voxels: [max_voxels, max_points, num_features]
+  PARAM_CHECK_EQ(api, voxels_desc->dim, 3);
+  PARAM_CHECK_EQ(api, voxels_desc->dims[0], max_voxels);
+  PARAM_CHECK_EQ(api, voxels_desc->dims[1], max_points);
+  PARAM_CHECK_EQ(api, voxels_desc->dims[2], num_features);
+  // params coors: [max_voxels, 3]
+  PARAM_CHECK_EQ(api, coors_desc->dim, 2);
+  PARAM_CHECK_EQ(api, coors_desc->dims[0], max_voxels);
+  PARAM_CHECK_EQ(api, coors_desc->dims[1], 3);
+  // params num_points_per_voxel: [max_voxels]
+  PARAM_CHECK_EQ(api, num_points_per_voxel_desc->dim, 1);
+  PARAM_CHECK_EQ(api, num_points_per_voxel_desc->dims[0], max_voxels);
+  PARAM_CHECK(api, voxel_ids_desc->dtype == MLUOP_DTYPE_INT32);
+  PARAM_CHECK(api, voxels_desc->dtype == MLUOP_DTYPE_FLOAT);
+  PARAM_CHECK(api, coors_desc->dtype == MLUOP_DTYPE_INT32);
+  PARAM_CHECK(api, num_points_per_voxel_desc->dtype == MLUOP_DTYPE_INT32);
+  STRIDE_TENSOR_CHECK(api, voxel_ids_desc,
+                      "voxel_ids_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(api, voxels_desc, "voxels_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(api, coors_desc, "coors_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(api, num_points_per_voxel_desc,
+                      "num_points_per_voxel_desc must be contiguous");
+
+  // report the slots in ascending order so that the output does not depend
+  // on the order the voxels were touched in.
+  std::vector<int32_t> ids = map.changedSlots();
+  std::sort(ids.begin(), ids.end());
+  const int32_t num = static_cast<int32_t>(ids.size());
+  // the outputs may be NULL when no voxel changed, and are left untouched
+  // on BAD_PARAM.
+  if (num > 0) {
+    PARAM_CHECK(api, voxel_ids != NULL);
+    PARAM_CHECK(api, voxels != NULL);
+    PARAM_CHECK(api, coors != NULL);
+    PARAM_CHECK(api, num_points_per_voxel != NULL);
+  }
+  *changed_num = num;
+  if (num == 0) return MLUOP_STATUS_SUCCESS;
+
+  const size_t voxel_stride = (size_t)max_points * num_features;
+  std::vector<float> &host_voxels = voxel_map_desc->voxels;
+  std::vector<int32_t> &host_coors = voxel_map_desc->coors;
+  std::vector<int32_t> &host_num = voxel_map_desc->num_points_per_voxel;
+  host_voxels.assign(num * voxel_stride, 0.0f);
+  host_coors.assign(num * 3, -1);
+  host_num.resize(num);
+  for (int32_t i = 0; i < num; ++i) {
+    host_num[i] = map.readSlot(ids[i], host_coors.data() + i * 3,
+                               host_voxels.data() + i * voxel_stride);
+  }
+
+  // the outputs may still be used by kernels enqueued before this call.
+  VOXEL_MAP_CNRT_CHECK(api, cnrtQueueSync(handle->queue));
+  VOXEL_MAP_CNRT_CHECK(api, cnrtMemcpy(voxel_ids, ids.data(),
+                                       num * sizeof(int32_t),
+                                       cnrtMemcpyHostToDev));
+  VOXEL_MAP_CNRT_CHECK(api, cnrtMemcpy(voxels, host_voxels.data(),
+                                       host_voxels.size() * sizeof(float),
+                                       cnrtMemcpyHostToDev));
+  VOXEL_MAP_CNRT_CHECK(api, cnrtMemcpy(coors, host_coors.data(),
+                                       host_coors.size() * sizeof(int32_t),
+                                       cnrtMemcpyHostToDev));
+  VOXEL_MAP_CNRT_CHECK(api, cnrtMemcpy(num_points_per_voxel, host_num.data(),
+                                       num * sizeof(int32_t),
+                                       cnrtMemcpyHostToDev));
+  map.clearChanges();
+  return MLUOP_STATUS_SUCCESS;
+}
@@ -0,0 +1,381 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_VOXELIZATION_VOXEL_MAP_H
+#define KERNELS_VOXELIZATION_VOXEL_MAP_H
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace mluop {
+
+/**
+ * @brief Regular voxel grid of the hard voxelization.
+ *
+ * coorOf() follows the arithmetic of mluOpVoxelization exactly, so a point
+ * falls into the same voxel on the host and on the device.
+ */
+struct VoxelGrid {
+  float voxel_size[3] = {1.0f, 1.0f, 1.0f};
+  float coors_min[3] = {0.0f, 0.0f, 0.0f};
+  int32_t grid[3] = {0, 0, 0};  // x, y, z
+
+  // voxel_size: [x, y, z], coors_range: [x_min, y_min, z_min, x_max, y_max,
+  // z_max].
+  void set(const float *voxel_size_xyz, const float *coors_range) {
+    for (int i = 0; i < 3; ++i) {
+      voxel_size[i] = voxel_size_xyz[i];
+      coors_min[i] = coors_range[i];
+      grid[i] = round((coors_range[i + 3] - coors_range[i]) / voxel_size[i]);
+    }
+  }
+
+  // Writes the voxel coordinate of the point as (z, y, x). Returns false if
+  // the point is outside of the grid.
+  bool coorOf(const float *point, int32_t *coor) const {
+    for (int i = 0; i < 3; ++i) {
+      int32_t c = floorf((point[i] - coors_min[i]) / voxel_size[i]);
+      if (c < 0 || c >= grid[i]) return false;
+      coor[2 - i] = c;
+    }
+    return true;
+  }
+
+  uint64_t pack(const int32_t *coor) const {
+    return ((uint64_t)coor[0] * grid[1] + coor[1]) * grid[0] + coor[2];
+  }
+};
+
+struct VoxelKeyHash {
+  size_t operator()(uint64_t key) const {
+    // splitmix64 finalizer, neighbouring voxels differ in the low bits only.
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return static_cast<size_t>(key);
+  }
+};
+
+/**
+ * @brief Deterministic hard voxelization with one hash lookup per point.
+ *
+ * Produces the same result as mluOpVoxelization with deterministic = true:
+ * voxels are numbered in the order of their first point, a voxel keeps its
+ * first max_points points, and points of new voxels are dropped once
+ * max_voxels voxels exist. Only the used entries of voxels, coors and
+ * num_points_per_voxel are written. IntT is the type of the integer outputs.
+ */
+template <typename IntT>
+void hardVoxelize(const VoxelGrid &grid, const float *points,
+                  const size_t num_points, const size_t num_features,
+                  const int32_t max_points, const int32_t max_voxels,
+                  float *voxels, IntT *coors, IntT *num_points_per_voxel,
+                  IntT *voxel_num) {
+  struct Slot {
+    int32_t voxel_idx;
+    int32_t num;
+  };
+  std::unordered_map<uint64_t, Slot, VoxelKeyHash> slots;
+  slots.reserve(std::min<size_t>(num_points, 1 << 20));
+  int32_t voxel_count = 0;
+  for (size_t i = 0; i < num_points; ++i) {
+    const float *point = points + i * num_features;
+    int32_t coor[3];
+    if (!grid.coorOf(point, coor)) continue;
+    auto it = slots.emplace(grid.pack(coor), Slot{-1, 0}).first;
+    Slot &slot = it->second;
+    if (slot.num >= max_points) continue;
+    if (slot.num++ == 0) {
+      if (voxel_count >= max_voxels) continue;
+      slot.voxel_idx = voxel_count++;
+      for (int k = 0; k < 3; ++k) {
+        coors[slot.voxel_idx * 3 + k] = coor[k];
+      }
+    }
+    if (slot.voxel_idx < 0) continue;
+    std::copy(point, point + num_features,
+              voxels + ((size_t)slot.voxel_idx * max_points + slot.num - 1) *
+                           num_features);
+    num_points_per_voxel[slot.voxel_idx] = slot.num;
+  }
+  *voxel_num = voxel_count;
+}
+
+/**
+ * @brief Voxel map kept across lidar sweeps.
+ *
+ * Every sweep is appended with a timestamp and evicted again once it is
+ * older than the window of the caller, so only the voxels touched by the
+ * new and the dropped sweeps are visited per frame instead of the whole
+ * point cloud.
+ *
+ * A voxel lives in a fixed slot in [0, max_voxels) from its first point
+ * until its last point is evicted. Its content is the first max_points of
+ * its retained points in arrival order, the same as a full hard
+ * voxelization of the retained points would give. Coordinates showing up
+ * while all the slots are used wait for a free slot and get it in the order
+ * they appeared.
+ *
+ * The slots whose content changed are collected until clearChanges(); a
+ * changed slot with zero points has been released.
+ */
+class VoxelMap {
+ public:
+  void reset(const VoxelGrid &grid, const int32_t max_points,
+             const int32_t max_voxels, const int32_t num_features) {
+    grid_ = grid;
+    max_points_ = max_points;
+    max_voxels_ = max_voxels;
+    num_features_ = num_features;
+    voxels_.clear();
+    free_voxels_.clear();
+    index_.clear();
+    slot_voxel_.assign(max_voxels, -1);
+    slot_changed_.assign(max_voxels, 0);
+    free_slots_.clear();
+    for (int32_t s = max_voxels - 1; s >= 0; --s) free_slots_.push_back(s);
+    waiting_.clear();
+    sweeps_.clear();
+    changed_.clear();
+    point_num_ = 0;
+  }
+
+  // Appends one sweep. Timestamps must not decrease from one sweep to the
+  // next. Returns false without changing the map otherwise.
+  bool append(const float *points, const size_t num_points,
+              const int64_t timestamp) {
+    if (!sweeps_.empty() && timestamp < sweeps_.back().timestamp) {
+      return false;
+    }
+    if (max_points_ <= 0 || max_voxels_ <= 0) return true;
+    sweeps_.push_back({timestamp, {}});
+    std::vector<int32_t> &touched = sweeps_.back().voxels;
+    for (size_t i = 0; i < num_points; ++i) {
+      const float *point = points + i * num_features_;
+      int32_t coor[3];
+      if (!grid_.coorOf(point, coor)) continue;
+      const uint64_t key = grid_.pack(coor);
+      auto it = index_.find(key);
+      int32_t id;
+      if (it == index_.end()) {
+        id = newVoxel(key, coor);
+        index_.emplace(key, id);
+        if (!assignSlot(id)) waiting_.push_back({id, voxels_[id].serial});
+      } else {
+        id = it->second;
+      }
+      Voxel &voxel = voxels_[id];
+      if (voxel.size() == 0 || voxel.timestamps.back() != timestamp) {
+        touched.push_back(id);
+      }
+      voxel.points.insert(voxel.points.end(), point, point + num_features_);
+      voxel.timestamps.push_back(timestamp);
+      point_num_++;
+      if (voxel.slot >= 0 && voxel.size() <= max_points_) {
+        markChanged(voxel.slot);
+      }
+    }
+    return true;
+  }
+
+  // Drops every point with a timestamp less than min_timestamp.
+  void evict(const int64_t min_timestamp) {
+    bool released = false;
+    while (!sweeps_.empty() && sweeps_.front().timestamp < min_timestamp) {
+      for (int32_t id : sweeps_.front().voxels) {
+        released |= evictVoxel(id, min_timestamp);
+      }
+      sweeps_.pop_front();
+    }
+    if (!released) return;
+    while (!waiting_.empty() && !free_slots_.empty()) {
+      const Waiting waiting = waiting_.front();
+      waiting_.pop_front();
+      // the voxel may have been evicted while waiting.
+      if (voxels_[waiting.id].serial == waiting.serial) {
+        assignSlot(waiting.id);
+      }
+    }
+  }
+
+  const std::vector<int32_t> &changedSlots() const { return changed_; }
+
+  void clearChanges() {
+    for (int32_t slot : changed_) slot_changed_[slot] = 0;
+    changed_.clear();
+  }
+
+  // The number of points in the slot, at most max_points.
+  int32_t slotPointNum(const int32_t slot) const {
+    const int32_t id = slot_voxel_[slot];
+    return id < 0 ? 0 : std::min(voxels_[id].size(), max_points_);
+  }
+
+  // Copies the coordinate (z, y, x) and the points of the slot, returns the
+  // number of points. Nothing is written for a free slot.
+  template <typename IntT>
+  int32_t readSlot(const int32_t slot, IntT *coor, float *points) const {
+    const int32_t id = slot_voxel_[slot];
+    if (id < 0) return 0;
+    const Voxel &voxel = voxels_[id];
+    for (int k = 0; k < 3; ++k) coor[k] = voxel.coor[k];
+    const int32_t num = std::min(voxel.size(), max_points_);
+    const float *begin = voxel.points.data() + voxel.begin * num_features_;
+    std::copy(begin, begin + (size_t)num * num_features_, points);
+    return num;
+  }
+
+  int32_t maxVoxels() const { return max_voxels_; }
+  int32_t maxPoints() const { return max_points_; }
+  int32_t numFeatures() const { return num_features_; }
+  // The number of voxels holding a slot.
+  int32_t voxelNum() const {
+    return max_voxels_ - static_cast<int32_t>(free_slots_.size());
+  }
+  // The number of retained points inside the grid.
+  size_t pointNum() const { return point_num_; }
+
+ private:
+  struct Voxel {
+    int32_t coor[3];
+    uint64_t key = 0;
+    uint64_t serial = 0;
+    int32_t slot = -1;
+    bool alive = false;
+    // points and timestamps before `begin` have been evicted already.
+    int32_t begin = 0;
+    std::vector<float> points;
+    std::vector<int64_t> timestamps;
+    int32_t size() const {
+      return static_cast<int32_t>(timestamps.size()) - begin;
+    }
+  };
+
+  struct Sweep {
+    int64_t timestamp;
+    std::vector<int32_t> voxels;  // voxels which received points
+  };
+
+  struct Waiting {
+    int32_t id;
+    uint64_t serial;
+  };
+
+  int32_t newVoxel(const uint64_t key, const int32_t *coor) {
+    int32_t id;
+    if (!free_voxels_.empty()) {
+      id = free_voxels_.back();
+      free_voxels_.pop_back();
+    } else {
+      id = static_cast<int32_t>(voxels_.size());
+      voxels_.emplace_back();
+    }
+    Voxel &voxel = voxels_[id];
+    for (int k = 0; k < 3; ++k) voxel.coor[k] = coor[k];
+    voxel.key = key;
+    voxel.serial = ++serial_;
+    voxel.slot = -1;
+    voxel.alive = true;
+    voxel.begin = 0;
+    voxel.points.clear();
+    voxel.timestamps.clear();
+    return id;
+  }
+
+  bool assignSlot(const int32_t id) {
+    if (free_slots_.empty()) return false;
+    const int32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    voxels_[id].slot = slot;
+    slot_voxel_[slot] = id;
+    markChanged(slot);
+    return true;
+  }
+
+  // Returns true if a slot has been released.
+  bool evictVoxel(const int32_t id, const int64_t min_timestamp) {
+    Voxel &voxel = voxels_[id];
+    if (!voxel.alive) return false;
+    const int32_t total = static_cast<int32_t>(voxel.timestamps.size());
+    int32_t end = voxel.begin;
+    while (end < total && voxel.timestamps[end] < min_timestamp) ++end;
+    if (end == voxel.begin) return false;
+    const int32_t visible = std::min(voxel.size(), max_points_);
+    point_num_ -= end - voxel.begin;
+    voxel.begin = end;
+    if (voxel.slot >= 0 && visible > 0) markChanged(voxel.slot);
+    if (voxel.size() > 0) {
+      if (voxel.begin * 2 > total) {
+        voxel.points.erase(
+            voxel.points.begin(),
+            voxel.points.begin() + (size_t)voxel.begin * num_features_);
+        voxel.timestamps.erase(voxel.timestamps.begin(),
+                               voxel.timestamps.begin() + voxel.begin);
+        voxel.begin = 0;
+      }
+      return false;
+    }
+    index_.erase(voxel.key);
+    voxel.alive = false;
+    voxel.serial = 0;
+    voxel.points = std::vector<float>();
+    voxel.timestamps = std::vector<int64_t>();
+    free_voxels_.push_back(id);
+    if (voxel.slot < 0) return false;
+    slot_voxel_[voxel.slot] = -1;
+    free_slots_.push_back(voxel.slot);
+    voxel.slot = -1;
+    return true;
+  }
+
+  void markChanged(const int32_t slot) {
+    if (slot_changed_[slot]) return;
+    slot_changed_[slot] = 1;
+    changed_.push_back(slot);
+  }
+
+  VoxelGrid grid_;
+  int32_t max_points_ = 0;
+  int32_t max_voxels_ = 0;
+  int32_t num_features_ = 0;
+  std::vector<Voxel> voxels_;
+  std::vector<int32_t> free_voxels_;
+  std::unordered_map<uint64_t, int32_t, VoxelKeyHash> index_;
+  std::vector<int32_t> slot_voxel_;
+  std::vector<uint8_t> slot_changed_;
+  std::vector<int32_t> free_slots_;
+  std::deque<Waiting> waiting_;
+  std::deque<Sweep> sweeps_;
+  std::vector<int32_t> changed_;
+  size_t point_num_ = 0;
+  uint64_t serial_ = 0;
+};
+
+}  // namespace mluop
+
+#endif  // KERNELS_VOXELIZATION_VOXEL_MAP_H
@@ -30,6 +30,7 @@
 #include "core/runtime/device.h"
 #include "core/tensor.h"
 #include "core/type.h"
+#include "core/workspace_arena.h"
 #include "kernels/utils/cnnl_helper.h"
 
 static void policyFuncDefault(const mluOpHandle_t handle,
@@ -250,6 +251,17 @@ mluOpStatus_t MLUOP_WIN_API mluOpVoxelization(
   }
 
   // check workspace
+  mluOpStatus_t arena_status = mluop::resolveWorkspace(
+      handle, "[mluOpVoxelization]", &workspace, &workspace_size,
+      [&](size_t *size) {
+        return mluOpGetVoxelizationWorkspaceSize(
+            handle, points_desc, voxel_size_desc, coors_range_desc, max_points,
+            max_voxels, NDim, deterministic, voxels_desc, coors_desc,
+            num_points_per_voxel_desc, voxel_num_desc, size);
+      });
+  if (arena_status != MLUOP_STATUS_SUCCESS) {
+    return arena_status;
+  }
   if (workspace_size > 0) {
     PARAM_CHECK("[mluOpVoxelization]", workspace != NULL);
   }
@@ -23,8 +23,21 @@
 #ifndef KERNELS_VOXELIZATION_VOXELIZATION_H
 #define KERNELS_VOXELIZATION_VOXELIZATION_H
 
+#include <vector>
+
+#include "kernels/voxelization/voxel_map.h"
 #include "mlu_op.h"
 
+struct mluOpVoxelMapStruct {
+  bool is_set = false;
+  mluop::VoxelMap map;
+  // host staging buffers reused between calls.
+  std::vector<float> points;
+  std::vector<float> voxels;
+  std::vector<int32_t> coors;
+  std::vector<int32_t> num_points_per_voxel;
+};
+
 mluOpStatus_t MLUOP_WIN_API KernelDynamicVoxelize(
     cnrtDim3_t k_dim, cnrtFunctionType_t k_type, cnrtQueue_t queue,
     const void *points, const void *voxel_size, const void *coors_range,
@@ -24,6 +24,7 @@
 #define KERNELS_YOLO_BOX_YOLO_BOX_H
 
 #include "mlu_op.h"
+#include "kernels/yolo_box/yolo_box_nms_plan.h"
 
 mluOpStatus_t MLUOP_WIN_API KernelYoloBox(
     cnrtDim3_t k_dim, cnrtFunctionType_t k_type, cnrtQueue_t queue,
@@ -33,4 +34,15 @@ mluOpStatus_t MLUOP_WIN_API KernelYoloBox(
     const float iou_aware_factor, const int n_in, const int anchor_s,
     const int c_in, const int h_in, const int w_in, void *boxes, void *scores);
 
+mluOpStatus_t MLUOP_WIN_API KernelYoloBoxNms(
+    cnrtDim3_t k_dim, cnrtFunctionType_t k_type, cnrtQueue_t queue,
+    const void *x, const void *img_size, const void *anchors,
+    const int class_num, const float conf_thresh, const int downsample_ratio,
+    const bool clip_bbox, const float scale, const bool iou_aware,
+    const float iou_aware_factor, const float score_thresh, const int top_k,
+    const float iou_threshold, const int n_in, const int anchor_s,
+    const int c_in, const int h_in, const int w_in, const int max_output,
+    const mluop::YoloBoxNmsPlan &plan, void *workspace, void *boxes,
+    void *scores, void *num);
+
 #endif  // KERNELS_YOLO_BOX_YOLO_BOX_H
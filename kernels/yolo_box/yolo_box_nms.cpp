@@ -0,0 +1,290 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "yolo_box.h"
+
+#include <string>
+
+#include "core/context.h"
+#include "core/gen_case.h"
+#include "core/logging.h"
+#include "core/runtime/device.h"
+#include "core/tensor.h"
+#include "core/type.h"
+#include "core/workspace_arena.h"
+
+#define MAX_CLASS_NUM_ARCH_200 1534
+#define MAX_CLASS_NUM_ARCH_300 2558
+
+// One task per (image, class) pair, up to one per core.
+static uint32_t yoloBoxNmsTaskDim(const mluOpHandle_t handle,
+                                  const int64_t pair_num) {
+  uint32_t cluster_num = mluop::runtime::getClusterLimitCapability(handle);
+  uint32_t core_num_per_cluster =
+      mluop::runtime::getCoreNumOfEachUnionCapability(handle);
+  uint32_t core_max = cluster_num * core_num_per_cluster;
+  return (int64_t)core_max > pair_num ? (uint32_t)pair_num : core_max;
+}
+
+static mluOpStatus_t yoloBoxNmsPlan(const std::string &op_name,
+                                    const mluOpHandle_t handle,
+                                    const int64_t pair_num,
+                                    const int anchor_s, const int top_k,
+                                    const int max_output,
+                                    mluop::YoloBoxNmsPlan *plan) {
+  const uint32_t task_dim = yoloBoxNmsTaskDim(handle, pair_num);
+  if (!mluop::planYoloBoxNms(handle->nram_size, task_dim, anchor_s, top_k,
+                             max_output, plan)) {
+    LOG(ERROR) << op_name << " The " << max_output
+               << " kept boxes of a class do not fit in the NRAM of a core.";
+    return MLUOP_STATUS_NOT_SUPPORTED;
+  }
+  return MLUOP_STATUS_SUCCESS;
+}
+
+static mluOpStatus_t yoloBoxNmsParamCheck(
+    const std::string &op_name, const mluOpHandle_t handle,
+    const mluOpTensorDescriptor_t x_desc,
+    const mluOpTensorDescriptor_t img_size_desc,
+    const mluOpTensorDescriptor_t anchors_desc,
+    const mluOpTensorDescriptor_t boxes_desc,
+    const mluOpTensorDescriptor_t scores_desc,
+    const mluOpTensorDescriptor_t num_desc, const int class_num,
+    const bool iou_aware, const float iou_aware_factor, const int top_k,
+    const float iou_threshold) {
+  PARAM_CHECK(op_name, handle != NULL);
+  PARAM_CHECK(op_name, x_desc != NULL);
+  PARAM_CHECK(op_name, img_size_desc != NULL);
+  PARAM_CHECK(op_name, anchors_desc != NULL);
+  PARAM_CHECK(op_name, boxes_desc != NULL);
+  PARAM_CHECK(op_name, scores_desc != NULL);
+  PARAM_CHECK(op_name, num_desc != NULL);
+
+  // check shape
+  PARAM_CHECK(op_name, x_desc->dim == 4);
+  PARAM_CHECK(op_name, img_size_desc->dim == 2);
+  PARAM_CHECK(op_name, anchors_desc->dim == 1);
+  PARAM_CHECK(op_name, boxes_desc->dim == 4);
+  PARAM_CHECK(op_name, scores_desc->dim == 3);
+  PARAM_CHECK(op_name, num_desc->dim == 2);
+
+  // check data type
+  PARAM_CHECK(op_name, x_desc->dtype == MLUOP_DTYPE_FLOAT);
+  PARAM_CHECK(op_name, img_size_desc->dtype == MLUOP_DTYPE_INT32);
+  PARAM_CHECK(op_name, anchors_desc->dtype == MLUOP_DTYPE_INT32);
+  PARAM_CHECK(op_name, boxes_desc->dtype == MLUOP_DTYPE_FLOAT);
+  PARAM_CHECK(op_name, scores_desc->dtype == MLUOP_DTYPE_FLOAT);
+  PARAM_CHECK(op_name, num_desc->dtype == MLUOP_DTYPE_INT32);
+
+  // check param except tensor
+  if (iou_aware) {
+    if (iou_aware_factor < 0 || iou_aware_factor > 1) {
+      LOG(ERROR) << op_name << " iou_aware_factor should be"
+                 << " between [0, 1].";
+      return MLUOP_STATUS_BAD_PARAM;
+    }
+  }
+  PARAM_CHECK(op_name, top_k >= 0);
+  PARAM_CHECK_GE(op_name, iou_threshold, 0.0);
+  PARAM_CHECK_LE(op_name, iou_threshold, 1.0);
+
+  // check dim
+  const int anchors_num = anchors_desc->dims[0] / 2;
+  std::string anchors_num_str = "anchors_num = anchors_desc->dims[0] / 2.";
+  PARAM_CHECK(op_name, (anchors_desc->dims[0] % 2 == 0));
+  PARAM_CHECK_V2(op_name, anchors_num > 0, << anchors_num_str);
+  PARAM_CHECK(op_name, class_num > 0);
+  const int class_num_thresh = handle->arch >= MLUOP_MLU370
+                                   ? MAX_CLASS_NUM_ARCH_300
+                                   : MAX_CLASS_NUM_ARCH_200;
+  PARAM_CHECK(op_name, class_num <= class_num_thresh);
+
+  const int dim_c =
+      iou_aware ? anchors_num * (6 + class_num) : anchors_num * (5 + class_num);
+  PARAM_CHECK(op_name, (x_desc->dims[1] == dim_c));
+  PARAM_CHECK(op_name, (x_desc->dims[0] == img_size_desc->dims[0]));
+  PARAM_CHECK(op_name, (img_size_desc->dims[1] == 2));
+  PARAM_CHECK(op_name, (boxes_desc->dims[0] == x_desc->dims[0]));
+  PARAM_CHECK(op_name, (boxes_desc->dims[1] == class_num));
+  PARAM_CHECK(op_name, (boxes_desc->dims[3] == 4));
+  PARAM_CHECK(op_name, (scores_desc->dims[0] == x_desc->dims[0]));
+  PARAM_CHECK(op_name, (scores_desc->dims[1] == class_num));
+  PARAM_CHECK(op_name, (scores_desc->dims[2] == boxes_desc->dims[2]));
+  PARAM_CHECK(op_name, (num_desc->dims[0] == x_desc->dims[0]));
+  PARAM_CHECK(op_name, (num_desc->dims[1] == class_num));
+
+  // large tensor
+  if ((mluOpGetTensorElementNum(x_desc) >= LARGE_TENSOR_NUM) ||
+      (mluOpGetTensorElementNum(boxes_desc) >= LARGE_TENSOR_NUM)) {
+    LOG(ERROR) << op_name << " Overflow max tensor num."
+               << " Currently, MLU-OPS supports tensor num smaller than 2^31.";
+    return MLUOP_STATUS_NOT_SUPPORTED;
+  }
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpGetYoloBoxNmsWorkspaceSize(
+    mluOpHandle_t handle, const mluOpTensorDescriptor_t x_desc,
+    const mluOpTensorDescriptor_t anchors_desc,
+    const mluOpTensorDescriptor_t boxes_desc, const int class_num,
+    const int top_k, size_t *workspace_size) {
+  const std::string op_name = "[mluOpGetYoloBoxNmsWorkspaceSize]";
+  PARAM_CHECK(op_name, handle != NULL);
+  PARAM_CHECK(op_name, x_desc != NULL);
+  PARAM_CHECK(op_name, anchors_desc != NULL);
+  PARAM_CHECK(op_name, boxes_desc != NULL);
+  PARAM_CHECK(op_name, workspace_size != NULL);
+  PARAM_CHECK(op_name, x_desc->dim == 4);
+  PARAM_CHECK(op_name, anchors_desc->dim == 1);
+  PARAM_CHECK(op_name, boxes_desc->dim == 4);
+  PARAM_CHECK(op_name, class_num > 0);
+  PARAM_CHECK(op_name, top_k >= 0);
+  *workspace_size = 0;
+  // boxes may be empty (max_output is 0), mluOpYoloBoxNms still plans the
+  // top_k heap then.
+  if (mluOpGetTensorElementNum(x_desc) == 0) {
+    return MLUOP_STATUS_SUCCESS;
+  }
+  mluop::YoloBoxNmsPlan plan;
+  CHECK_RETURN(op_name,
+               yoloBoxNmsPlan(op_name, handle,
+                              (int64_t)x_desc->dims[0] * class_num,
+                              anchors_desc->dims[0] / 2, top_k,
+                              boxes_desc->dims[2], &plan));
+  *workspace_size = plan.workspace_size;
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API mluOpYoloBoxNms(
+    mluOpHandle_t handle, const mluOpTensorDescriptor_t x_desc, const void *x,
+    const mluOpTensorDescriptor_t img_size_desc, const void *img_size,
+    const mluOpTensorDescriptor_t anchors_desc, const void *anchors,
+    const int class_num, const float conf_thresh, const int downsample_ratio,
+    const bool clip_bbox, const float scale, const bool iou_aware,
+    const float iou_aware_factor, const float score_thresh, const int top_k,
+    const float iou_threshold, void *workspace, size_t workspace_size,
+    const mluOpTensorDescriptor_t boxes_desc, void *boxes,
+    const mluOpTensorDescriptor_t scores_desc, void *scores,
+    const mluOpTensorDescriptor_t num_desc, void *num) {
+  const std::string op_name = "[mluOpYoloBoxNms]";
+  mluOpStatus_t param_check = yoloBoxNmsParamCheck(
+      op_name, handle, x_desc, img_size_desc, anchors_desc, boxes_desc,
+      scores_desc, num_desc, class_num, iou_aware, iou_aware_factor, top_k,
+      iou_threshold);
+  if (param_check != MLUOP_STATUS_SUCCESS) {
+    return param_check;
+  }
+
+  STRIDE_TENSOR_CHECK(op_name + ":", x_desc, "x_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(op_name + ":", img_size_desc,
+                      "img_size_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(op_name + ":", anchors_desc,
+                      "anchors_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(op_name + ":", boxes_desc,
+                      "boxes_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(op_name + ":", scores_desc,
+                      "scores_desc must be contiguous");
+  STRIDE_TENSOR_CHECK(op_name + ":", num_desc, "num_desc must be contiguous");
+
+  // check zero element
+  if (mluOpGetTensorElementNum(x_desc) == 0) {
+    VLOG(5) << op_name << " Input skip zero element tensor.";
+    return MLUOP_STATUS_SUCCESS;
+  }
+  PARAM_CHECK(op_name, x != NULL);
+  PARAM_CHECK(op_name, img_size != NULL);
+  PARAM_CHECK(op_name, anchors != NULL);
+  PARAM_CHECK(op_name, num != NULL);
+  const int max_output = boxes_desc->dims[2];
+  if (max_output > 0) {
+    PARAM_CHECK(op_name, boxes != NULL);
+    PARAM_CHECK(op_name, scores != NULL);
+  }
+
+  const int n_in = x_desc->dims[0];
+  const int c_in = x_desc->dims[1];
+  const int h_in = x_desc->dims[2];
+  const int w_in = x_desc->dims[3];
+  const int anchor_s = anchors_desc->dims[0] / 2;
+  const int64_t pair_num = (int64_t)n_in * class_num;
+
+  mluop::YoloBoxNmsPlan plan;
+  CHECK_RETURN(op_name, yoloBoxNmsPlan(op_name, handle, pair_num, anchor_s,
+                                       top_k, max_output, &plan));
+  mluOpStatus_t arena_status = mluop::resolveWorkspace(
+      handle, op_name, &workspace, &workspace_size, [&](size_t *size) {
+        return mluOpGetYoloBoxNmsWorkspaceSize(handle, x_desc, anchors_desc,
+                                               boxes_desc, class_num, top_k,
+                                               size);
+      });
+  if (arena_status != MLUOP_STATUS_SUCCESS) {
+    return arena_status;
+  }
+  if (plan.workspace_size > 0) {
+    PARAM_CHECK(op_name, workspace != NULL);
+    PARAM_CHECK_GE(op_name, workspace_size, plan.workspace_size);
+  }
+
+  if (MLUOP_GEN_CASE_ON_NEW) {
+    GEN_CASE_START("yolo_box_nms", "YOLO_BOX_NMS");
+    GEN_CASE_HANDLE(handle);
+    GEN_CASE_DATA(true, "x", x, x_desc, 10, 0);
+    GEN_CASE_DATA(true, "img_size", img_size, img_size_desc, 1000, 100);
+    GEN_CASE_DATA(true, "anchors", anchors, anchors_desc, 10, 1);
+    GEN_CASE_DATA(false, "boxes", boxes, boxes_desc, 0, 0);
+    GEN_CASE_DATA(false, "scores", scores, scores_desc, 0, 0);
+    GEN_CASE_DATA(false, "num", num, num_desc, 0, 0);
+    GEN_CASE_OP_PARAM_SINGLE(0, "yolo_box", "class_num", class_num);
+    GEN_CASE_OP_PARAM_SINGLE(1, "yolo_box", "conf_thresh", conf_thresh);
+    GEN_CASE_OP_PARAM_SINGLE(2, "yolo_box", "downsample_ratio",
+                             downsample_ratio);
+    GEN_CASE_OP_PARAM_SINGLE(3, "yolo_box", "clip_bbox", clip_bbox);
+    GEN_CASE_OP_PARAM_SINGLE(4, "yolo_box", "scale_x_y", scale);
+    GEN_CASE_OP_PARAM_SINGLE(5, "yolo_box", "iou_aware", iou_aware);
+    GEN_CASE_OP_PARAM_SINGLE(6, "yolo_box", "iou_aware_factor",
+                             iou_aware_factor);
+    GEN_CASE_OP_PARAM_SINGLE(0, "nms", "max_output_boxes", top_k);
+    GEN_CASE_OP_PARAM_SINGLE(1, "nms", "iou_threshold", iou_threshold);
+    GEN_CASE_OP_PARAM_SINGLE(2, "nms", "confidence_threshold", score_thresh);
+    GEN_CASE_TEST_PARAM_NEW(true, true, false, 0.003, 0.003, 0);
+  }
+
+  cnrtDim3_t k_dim;
+  k_dim.x = yoloBoxNmsTaskDim(handle, pair_num);
+  k_dim.y = 1;
+  k_dim.z = 1;
+  cnrtFunctionType_t k_type = cnrtFuncTypeBlock;
+  VLOG(5) << op_name << " launch kernel policyFunc[" << k_dim.x << ", "
+          << k_dim.y << ", " << k_dim.z << "], deal_num " << plan.deal_num
+          << ", heap in " << (plan.heap_in_nram ? "NRAM" : "workspace")
+          << ".";
+  CHECK_RETURN(op_name,
+               KernelYoloBoxNms(k_dim, k_type, handle->queue, x, img_size,
+                                anchors, class_num, conf_thresh,
+                                downsample_ratio, clip_bbox, scale, iou_aware,
+                                iou_aware_factor, score_thresh, top_k,
+                                iou_threshold, n_in, anchor_s, c_in, h_in,
+                                w_in, max_output, plan, workspace, boxes,
+                                scores, num));
+  GEN_CASE_END();
+  return MLUOP_STATUS_SUCCESS;
+}
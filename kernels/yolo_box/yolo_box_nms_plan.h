@@ -0,0 +1,110 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_YOLO_BOX_YOLO_BOX_NMS_PLAN_H_
+#define KERNELS_YOLO_BOX_YOLO_BOX_NMS_PLAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mluop {
+
+// NRAM arrays of deal_num floats used by mluOpYoloBoxNms: the scan of the
+// scores needs obj, cls, iou and a mask, the decode of the candidates the
+// four box logits, grid x/y and anchor w/h.
+constexpr int kYoloBoxNmsChunkArrays = 8;
+// deal_num is a multiple of it, and at least it.
+constexpr int kYoloBoxNmsDealAlign = 64;
+// Larger chunks do not shorten the scan further.
+constexpr int kYoloBoxNmsMaxDeal = 16 * 1024;
+constexpr size_t kYoloBoxNmsNramAlign = 128;
+
+// An entry of the top_k heap of a task: the score of a box and the index
+// of the box in [anchor_s, h * w].
+struct YoloBoxNmsCandidate {
+  float score;
+  int32_t index;
+};
+
+/**
+ * @brief Layout of one task of mluOpYoloBoxNms, which handles an (image,
+ * class) pair at a time.
+ *
+ * NRAM holds, in this order, the anchors and image size, the kept boxes
+ * and scores (max_output of each), the heap of top_k candidates if it
+ * fits, and kYoloBoxNmsChunkArrays arrays of deal_num floats. Otherwise
+ * every task keeps its heap in its own slot of the workspace.
+ */
+struct YoloBoxNmsPlan {
+  size_t param_offset = 0;
+  size_t kept_offset = 0;
+  size_t heap_offset = 0;  // if heap_in_nram
+  size_t heap_bytes = 0;   // also the stride of the workspace slots
+  size_t chunk_offset = 0;
+  int32_t deal_num = 0;
+  bool heap_in_nram = true;
+  size_t workspace_size = 0;
+};
+
+inline size_t alignYoloBoxNms(size_t bytes) {
+  return (bytes + kYoloBoxNmsNramAlign - 1) / kYoloBoxNmsNramAlign *
+         kYoloBoxNmsNramAlign;
+}
+
+/**
+ * @brief Plans the NRAM of a task and the workspace of mluOpYoloBoxNms for
+ * nram_size bytes of NRAM per core and task_dim tasks. Returns false if
+ * the kept boxes and the smallest chunks do not fit.
+ */
+inline bool planYoloBoxNms(const size_t nram_size, const int32_t task_dim,
+                           const int32_t anchor_s, const int32_t top_k,
+                           const int32_t max_output, YoloBoxNmsPlan *plan) {
+  const size_t chunk_bytes = kYoloBoxNmsChunkArrays * sizeof(float);
+  const size_t min_chunk = kYoloBoxNmsDealAlign * chunk_bytes;
+  const size_t heap_bytes =
+      alignYoloBoxNms((size_t)top_k * sizeof(YoloBoxNmsCandidate));
+  plan->param_offset = 0;
+  plan->kept_offset =
+      alignYoloBoxNms((size_t)(2 * anchor_s + 2) * sizeof(int32_t));
+  plan->heap_offset =
+      plan->kept_offset +
+      alignYoloBoxNms((size_t)max_output * 5 * sizeof(float));
+  if (plan->heap_offset + min_chunk > nram_size) return false;
+  plan->heap_bytes = heap_bytes;
+  plan->heap_in_nram = plan->heap_offset + heap_bytes + min_chunk <= nram_size;
+  plan->chunk_offset = plan->heap_offset;
+  plan->workspace_size = 0;
+  if (plan->heap_in_nram) {
+    plan->chunk_offset += heap_bytes;
+  } else {
+    plan->workspace_size = (size_t)task_dim * heap_bytes;
+  }
+  size_t deal = (nram_size - plan->chunk_offset) / chunk_bytes;
+  deal = deal / kYoloBoxNmsDealAlign * kYoloBoxNmsDealAlign;
+  plan->deal_num = static_cast<int32_t>(
+      deal < (size_t)kYoloBoxNmsMaxDeal ? deal : kYoloBoxNmsMaxDeal);
+  return true;
+}
+
+}  // namespace mluop
+
+#endif  // KERNELS_YOLO_BOX_YOLO_BOX_NMS_PLAN_H_
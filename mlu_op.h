@@ -220,6 +220,33 @@ typedef enum {
   /*!< The atomics is allowed to cumulate results. */
 } mluOpAtomicsMode_t;
 
+/*!
+ * @brief Describes whether the workspace arena of a handle is used.
+ */
+typedef enum {
+  MLUOP_WORKSPACE_ARENA_DISABLED = 0,
+  /*!< The workspace arena is disabled and the workspace must be provided by the caller. */
+  MLUOP_WORKSPACE_ARENA_ENABLED = 1,
+  /*!< The workspace arena is enabled, and the operators that support it allocate their
+   *   workspace from the arena when \b workspace is NULL. */
+} mluOpWorkspaceArenaMode_t;
+
+/*!
+ * @brief Describes the statistics of the workspace arena of a handle.
+ */
+typedef struct {
+  size_t capacity;
+  /*!< The size in bytes of the MLU memory currently held by the arena. */
+  size_t high_water_mark;
+  /*!< The largest workspace size in bytes requested since the arena was created. */
+  uint64_t request_count;
+  /*!< The number of workspace requests served by the arena. */
+  uint64_t growth_count;
+  /*!< The number of times the arena reallocated a larger buffer. */
+  uint64_t trim_count;
+  /*!< The number of calls to ::mluOpTrimWorkspaceArena. */
+} mluOpWorkspaceArenaStats_t;
+
 /*!
  * @brief Describes the rounding modes of quantization conversion.
  */
@@ -874,6 +901,129 @@ mluOpSetAtomicsMode(mluOpHandle_t handle, mluOpAtomicsMode_t atomics_mode);
 mluOpStatus_t MLUOP_WIN_API
 mluOpGetAtomicsMode(mluOpHandle_t handle, mluOpAtomicsMode_t *atomics_mode);
 
+// Group: Runtime Management
+/*!
+ * @brief Enables or disables the workspace arena of a specific MLU-OPS context. When the arena
+ * is enabled, the operators that support it allocate their workspace from a buffer held by
+ * \b handle if the \b workspace passed by the caller is NULL, so ::mluOpGetNmsWorkspaceSize,
+ * ::mluOpGetVoxelizationWorkspaceSize, ::mluOpGetIndicePairsWorkspaceSize and the MLU memory
+ * allocation are not needed before each call.
+ *
+ * @param[in] handle
+ * Pointer to a Cambricon MLU-OPS context that is used to manage MLU devices and queues. For
+ * detailed information, see ::mluOpHandle_t.
+ * @param[in] mode
+ * The workspace arena mode. See ::mluOpWorkspaceArenaMode_t.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM, ::MLUOP_STATUS_ALLOC_FAILED
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - None.
+ *
+ * @par Note
+ * - The arena is disabled by default.
+ * - The arena buffer is reused by consecutive calls in the queue order of \b handle. It only
+ *   grows to the largest workspace requested, and the memory is kept until
+ *   ::mluOpTrimWorkspaceArena or ::mluOpDestroy is called, or the arena is disabled.
+ * - Growing, trimming or disabling the arena, and calling ::mluOpSetQueue while the arena holds
+ *   memory, synchronize the queue of \b handle.
+ * - Operators supporting the arena: ::mluOpNms, ::mluOpVoxelization, ::mluOpGetIndicePairs.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpSetWorkspaceArenaMode(mluOpHandle_t handle, mluOpWorkspaceArenaMode_t mode);
+
+// Group: Runtime Management
+/*!
+ * @brief Releases the MLU memory held by the workspace arena of a specific MLU-OPS context,
+ * keeping at most \b retain_size bytes.
+ *
+ * @param[in] handle
+ * Pointer to a Cambricon MLU-OPS context that is used to manage MLU devices and queues. For
+ * detailed information, see ::mluOpHandle_t.
+ * @param[in] retain_size
+ * The maximum size in bytes of the memory kept by the arena. Pass 0 to release all the memory.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - None.
+ *
+ * @par Note
+ * - This function synchronizes the queue of \b handle if memory is released.
+ * - This function does nothing if the arena is disabled.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpTrimWorkspaceArena(mluOpHandle_t handle, size_t retain_size);
+
+// Group: Runtime Management
+/*!
+ * @brief Retrieves the statistics of the workspace arena of a specific MLU-OPS context.
+ *
+ * @param[in] handle
+ * Pointer to a Cambricon MLU-OPS context that is used to manage MLU devices and queues. For
+ * detailed information, see ::mluOpHandle_t.
+ * @param[out] stats
+ * The statistics of the arena. See ::mluOpWorkspaceArenaStats_t.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - None.
+ *
+ * @par Note
+ * - All the fields of \b stats are zero if the arena is disabled.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpGetWorkspaceArenaStats(mluOpHandle_t handle, mluOpWorkspaceArenaStats_t *stats);
+
 /******************************************************************************
  * MLU-OPS Data Structure: Descriptor
  * The struct represent node, weight and the AI network layer
@@ -1193,6 +1343,17 @@ typedef struct cnnlDCNStruct *mluOpDCNDescriptor_t;
  */
 typedef struct mluOpCarafeStruct *mluOpCarafeDescriptor_t;
 
+/*!
+ * The descriptor of the streaming voxelization that holds the voxel map kept between
+ * lidar sweeps, including the voxel grid, the maximum number of points in a voxel,
+ * the maximum number of voxels, and the points of the sweeps not evicted yet.
+ *
+ * You need to call ::mluOpCreateVoxelMapDescriptor to create a descriptor, and call
+ * ::mluOpSetVoxelMapDescriptor to set the voxel grid to the descriptor. Also, you need
+ * to destroy the descriptor at the end with ::mluOpDestroyVoxelMapDescriptor.
+ */
+typedef struct mluOpVoxelMapStruct *mluOpVoxelMapDescriptor_t;
+
 // Group: Tensor
 /*!
  * @brief Creates a tensor descriptor pointed by \b desc that holds the dimensions, data type,
@@ -6077,6 +6238,312 @@ mluOpVoxelization(mluOpHandle_t handle,
                   const mluOpTensorDescriptor_t voxel_num_desc,
                   void *voxel_num);
 
+// Group: Voxelization
+/*!
+ * @brief Creates a descriptor pointed by \b voxel_map_desc for the streaming voxelization,
+ * which keeps the voxels of several lidar sweeps between calls.
+ *
+ * @param[out] voxel_map_desc
+ * A host pointer to the voxel map descriptor. For detailed information,
+ * see ::mluOpVoxelMapDescriptor_t.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM, ::MLUOP_STATUS_ALLOC_FAILED
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - After calling this function, you can call ::mluOpSetVoxelMapDescriptor to set the
+ *   voxel grid to the descriptor.
+ * - You need to call ::mluOpDestroyVoxelMapDescriptor to destroy the descriptor.
+ *
+ * @par Note
+ * - None.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpCreateVoxelMapDescriptor(mluOpVoxelMapDescriptor_t *voxel_map_desc);
+
+// Group: Voxelization
+/*!
+ * @brief Initializes the voxel map descriptor \b voxel_map_desc that was previously created
+ * with ::mluOpCreateVoxelMapDescriptor. All the points appended before are dropped.
+ *
+ * @param[in] voxel_map_desc
+ * The voxel map descriptor. For detailed information, see ::mluOpVoxelMapDescriptor_t.
+ * @param[in] voxel_size
+ * A host pointer to three float values, the size of a voxel in x, y and z.
+ * @param[in] coors_range
+ * A host pointer to six float values, the range of the voxel grid as
+ * [x_min, y_min, z_min, x_max, y_max, z_max].
+ * @param[in] max_points
+ * The maximum number of points reported for a voxel.
+ * @param[in] max_voxels
+ * The maximum number of voxels, which is also the number of voxel slots.
+ * @param[in] num_features
+ * The number of features of a point. The first three features are x, y and z.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - \b max_points and \b max_voxels must be greater than 0.
+ * - \b num_features must be greater than or equal to 3.
+ * - The values of \b voxel_size must be greater than 0, and the maximum of
+ *   \b coors_range must be greater than the minimum in each dimension.
+ *
+ * @par API Dependency
+ * - Before calling this function, ::mluOpCreateVoxelMapDescriptor should be called.
+ *
+ * @par Note
+ * - The voxel of a point is computed in the same way as ::mluOpVoxelization.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpSetVoxelMapDescriptor(mluOpVoxelMapDescriptor_t voxel_map_desc,
+                           const float *voxel_size,
+                           const float *coors_range,
+                           const int32_t max_points,
+                           const int32_t max_voxels,
+                           const int32_t num_features);
+
+// Group: Voxelization
+/*!
+ * @brief Destroys a voxel map descriptor \b voxel_map_desc that was previously created by
+ * ::mluOpCreateVoxelMapDescriptor, and releases the points it holds.
+ *
+ * @param[in] voxel_map_desc
+ * The voxel map descriptor to be destroyed. For detailed information,
+ * see ::mluOpVoxelMapDescriptor_t.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - None.
+ *
+ * @par Note
+ * - None.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpDestroyVoxelMapDescriptor(mluOpVoxelMapDescriptor_t voxel_map_desc);
+
+// Group: Voxelization
+/*!
+ * @brief Appends the lidar sweep \b points with the time stamp \b timestamp to the voxel
+ * map \b voxel_map_desc. Only the voxels receiving points are updated, the other voxels of
+ * the map are kept as they are.
+ *
+ * A voxel takes a free slot in [0, max_voxels) with its first point and keeps it until its
+ * last point is evicted. The content of a voxel is the first \b max_points of its retained
+ * points in arrival order, which is what ::mluOpVoxelization gives for the retained points.
+ * A voxel created when all the slots are used holds its points without a slot, and gets a
+ * slot when one is released, in the order the voxels were created.
+ *
+ * @param[in] handle
+ * Handle to a Cambricon MLU-OPS context that is used to manage MLU devices and
+ * queues. For detailed information, see ::mluOpHandle_t.
+ * @param[in] voxel_map_desc
+ * The voxel map descriptor. For detailed information, see ::mluOpVoxelMapDescriptor_t.
+ * @param[in] points_desc
+ * The descriptor of the tensor \b points. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] points
+ * Pointer to the MLU memory that stores the points of the sweep.
+ * @param[in] timestamp
+ * The time stamp of the sweep. It must not be less than the time stamp of the previous
+ * sweep appended to the map.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM, ::MLUOP_STATUS_NOT_SUPPORTED,
+ *   ::MLUOP_STATUS_EXECUTION_FAILED
+ *
+ * @par Data Type
+ * - points: float
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - The shape of \b points must be [num_points, num_features], where num_features is the
+ *   value set by ::mluOpSetVoxelMapDescriptor.
+ *
+ * @par API Dependency
+ * - Before calling this function, ::mluOpSetVoxelMapDescriptor should be called.
+ *
+ * @par Note
+ * - The points are copied to the host and the voxel map is kept on the host. This function
+ *   synchronizes the queue of \b handle.
+ * - Points outside of the voxel grid are ignored.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpVoxelMapAppend(mluOpHandle_t handle,
+                    mluOpVoxelMapDescriptor_t voxel_map_desc,
+                    const mluOpTensorDescriptor_t points_desc,
+                    const void *points,
+                    const int64_t timestamp);
+
+// Group: Voxelization
+/*!
+ * @brief Evicts all the points of the voxel map \b voxel_map_desc whose time stamp is less
+ * than \b min_timestamp. The slots of the voxels left without points are released.
+ *
+ * @param[in] voxel_map_desc
+ * The voxel map descriptor. For detailed information, see ::mluOpVoxelMapDescriptor_t.
+ * @param[in] min_timestamp
+ * The smallest time stamp of the points kept in the map.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - Before calling this function, ::mluOpSetVoxelMapDescriptor should be called.
+ *
+ * @par Note
+ * - Only the voxels which received points from the evicted sweeps are visited.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpVoxelMapEvict(mluOpVoxelMapDescriptor_t voxel_map_desc, const int64_t min_timestamp);
+
+// Group: Voxelization
+/*!
+ * @brief Retrieves the voxel slots of \b voxel_map_desc that changed since the previous
+ * call of this function, and their current content.
+ *
+ * The first \b changed_num entries of the outputs are written, ordered by slot. A slot
+ * with zero points in \b num_points_per_voxel has been released, and its coordinate
+ * in \b coors is -1.
+ *
+ * @param[in] handle
+ * Handle to a Cambricon MLU-OPS context that is used to manage MLU devices and
+ * queues. For detailed information, see ::mluOpHandle_t.
+ * @param[in] voxel_map_desc
+ * The voxel map descriptor. For detailed information, see ::mluOpVoxelMapDescriptor_t.
+ * @param[in] voxel_ids_desc
+ * The descriptor of the tensor \b voxel_ids. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[out] voxel_ids
+ * Pointer to the MLU memory that stores the slots of the changed voxels.
+ * @param[in] voxels_desc
+ * The descriptor of the tensor \b voxels. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[out] voxels
+ * Pointer to the MLU memory that stores the points of the changed voxels. The unused
+ * points of a voxel are filled with 0.
+ * @param[in] coors_desc
+ * The descriptor of the tensor \b coors. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[out] coors
+ * Pointer to the MLU memory that stores the voxel coordinates (z, y, x) of the changed
+ * voxels.
+ * @param[in] num_points_per_voxel_desc
+ * The descriptor of the tensor \b num_points_per_voxel. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[out] num_points_per_voxel
+ * Pointer to the MLU memory that stores the number of points of the changed voxels.
+ * @param[out] changed_num
+ * A host pointer to the number of changed voxels.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM, ::MLUOP_STATUS_NOT_SUPPORTED,
+ *   ::MLUOP_STATUS_EXECUTION_FAILED
+ *
+ * @par Data Type
+ * - voxels: float
+ * - voxel_ids, coors, num_points_per_voxel: int
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - The shape of \b voxel_ids and \b num_points_per_voxel must be [max_voxels].
+ * - The shape of \b voxels must be [max_voxels, max_points, num_features].
+ * - The shape of \b coors must be [max_voxels, 3].
+ *
+ * @par API Dependency
+ * - Before calling this function, ::mluOpSetVoxelMapDescriptor should be called.
+ *
+ * @par Note
+ * - This function synchronizes the queue of \b handle.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpGetVoxelMapChangedVoxels(mluOpHandle_t handle,
+                              mluOpVoxelMapDescriptor_t voxel_map_desc,
+                              const mluOpTensorDescriptor_t voxel_ids_desc,
+                              void *voxel_ids,
+                              const mluOpTensorDescriptor_t voxels_desc,
+                              void *voxels,
+                              const mluOpTensorDescriptor_t coors_desc,
+                              void *coors,
+                              const mluOpTensorDescriptor_t num_points_per_voxel_desc,
+                              void *num_points_per_voxel,
+                              int32_t *changed_num);
+
 // Group: YoloBox
 /*!
  * @brief Computes bounding box information from the backbone output of the
@@ -6189,6 +6656,192 @@ mluOpYoloBox(mluOpHandle_t handle,
              const mluOpTensorDescriptor_t scores_desc,
              void *scores);
 
+// Group: YoloBox
+/*!
+ * @brief Returns in \b workspace_size the size of the MLU memory that is used
+ * as an extra workspace in the ::mluOpYoloBoxNms operation.
+ *
+ * @param[in] handle
+ * Handle to a Cambricon MLU-OPS context that is used to manage MLU devices and
+ * queues in the yolo_box_nms operation. For detailed information, see
+ * ::mluOpHandle_t.
+ * @param[in] x_desc
+ * The descriptor of the tensor \b x. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] anchors_desc
+ * The descriptor of the tensor \b anchors. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] boxes_desc
+ * The descriptor of the tensor \b boxes. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] class_num
+ * The number of classes.
+ * @param[in] top_k
+ * The number of candidates per class kept before NMS.
+ * @param[out] workspace_size
+ * Pointer to the returned size of the extra workspace in bytes.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM,
+ *   ::MLUOP_STATUS_NOT_SUPPORTED
+ *
+ * @par Note
+ * - The workspace is zero unless the \b top_k candidates of a class do not fit
+ *   in the NRAM of a core next to the kept boxes, in which case every core keeps
+ *   them in its own slot of the workspace.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpGetYoloBoxNmsWorkspaceSize(mluOpHandle_t handle,
+                                const mluOpTensorDescriptor_t x_desc,
+                                const mluOpTensorDescriptor_t anchors_desc,
+                                const mluOpTensorDescriptor_t boxes_desc,
+                                const int class_num,
+                                const int top_k,
+                                size_t *workspace_size);
+
+// Group: YoloBox
+/*!
+ * @brief Decodes the backbone output of the detected network as ::mluOpYoloBox
+ * does and runs the per-class score threshold, top-k and NMS on the decoded
+ * boxes in the same pass, so that only the kept boxes are written.
+ *
+ * A box is a candidate of class c if its confidence is at least \b conf_thresh
+ * and its score of class c is greater than \b score_thresh. The \b top_k best
+ * candidates of every image and class are decoded and suppressed greedily, a
+ * candidate being dropped if its IoU with a kept box is greater than
+ * \b iou_threshold, until \b max_output boxes are kept.
+ *
+ * @param[in] handle
+ * Handle to a Cambricon MLU-OPS context that is used to manage MLU devices and
+ * queues in the yolo_box_nms operation. For detailed information, see
+ * ::mluOpHandle_t.
+ * @param[in] x_desc
+ * The descriptor of the tensor \b x. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] x
+ * Pointer to the MLU memory that stores the input tensor.
+ * @param[in] img_size_desc
+ * The descriptor of the tensor \b img_size. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] img_size
+ * Pointer to the MLU memory that stores the input tensor.
+ * @param[in] anchors_desc
+ * The descriptor of the tensor \b anchors. For detailed information, see
+ * ::mluOpTensorDescriptor_t.
+ * @param[in] anchors
+ * Pointer to the MLU memory that stores the input tensor.
+ * @param[in] class_num
+ * The number of classes.
+ * @param[in] conf_thresh
+ * The detection boxes with the confidence score below the threshold should be ignored.
+ * @param[in] downsample_ratio
+ * The downsample ratio from network input to yolo_box operation input.
+ * @param[in] clip_bbox
+ * If the value is True, the bounding box is clipped in img_size boundary.
+ * @param[in] scale
+ * The scaling coefficient of the coordinate of the center point of the decoded bounding box.
+ * @param[in] iou_aware
+ * If the value is True, the parameter iou_aware_factor is used.
+ * @param[in] iou_aware_factor
+ * The IOU aware factor, the default value is 0.5.
+ * @param[in] score_thresh
+ * The boxes whose class score is not greater than the threshold are ignored.
+ * @param[in] top_k
+ * The number of candidates per image and class kept before NMS.
+ * @param[in] iou_threshold
+ * The IoU threshold above which a box is suppressed by a kept box.
+ * @param[in] workspace
+ * Pointer to the MLU memory that is used as an extra workspace for the
+ * yolo_box_nms operation.
+ * @param[in] workspace_size
+ * The size of the extra workspace in bytes that needs to be used in
+ * the yolo_box_nms operation. You can get the size of the workspace with
+ * the ::mluOpGetYoloBoxNmsWorkspaceSize function.
+ * @param[in] boxes_desc
+ * The descriptor of the tensor \b boxes, [N, class_num, max_output, 4]. For
+ * detailed information, see ::mluOpTensorDescriptor_t.
+ * @param[out] boxes
+ * Pointer to the MLU memory that stores the kept boxes as (x0, y0, x1, y1).
+ * @param[in] scores_desc
+ * The descriptor of the tensor \b scores, [N, class_num, max_output]. For
+ * detailed information, see ::mluOpTensorDescriptor_t.
+ * @param[out] scores
+ * Pointer to the MLU memory that stores the scores of the kept boxes.
+ * @param[in] num_desc
+ * The descriptor of the tensor \b num, [N, class_num]. For detailed
+ * information, see ::mluOpTensorDescriptor_t.
+ * @param[out] num
+ * Pointer to the MLU memory that stores the number of kept boxes.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM,
+ *   ::MLUOP_STATUS_NOT_SUPPORTED, ::MLUOP_STATUS_EXECUTION_FAILED
+ *
+ * @par Data Type
+ * - The supported data types of input and output tensors are as follows:
+ *   - input x tensor: float
+ *   - input img_size and anchors tensors: int
+ *   - output boxes and scores tensors: float
+ *   - output num tensor: int
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - The limitations of x, img_size and anchors tensors and \b class_num are the
+ *   same as ::mluOpYoloBox.
+ * - The first dimension of boxes, scores and num tensors must be equal to the
+ *   first dimension of x tensor, and the second one must be equal to \b class_num.
+ * - The third dimension of scores tensor must be equal to the third dimension
+ *   of boxes tensor, max_output, and the fourth dimension of boxes tensor must be
+ *   equal to 4.
+ * - The \b max_output kept boxes of a class must fit in the NRAM of a core.
+ *
+ * @par API Dependency
+ * - Call ::mluOpGetYoloBoxNmsWorkspaceSize to get the workspace size.
+ *
+ * @par Note
+ * - The kept boxes of a class are ordered by score, descending, and by box index
+ *   on ties. The unused slots of \b boxes and \b scores are set to zero.
+ * - When the \b iou_aware is true, the \b iou_aware_factor should be between [0, 1].
+ * - The \b iou_threshold should be between [0, 1].
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - https://github.com/PaddlePaddle/Paddle/blob/release/2.3/python/paddle/vision/ops.py
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpYoloBoxNms(mluOpHandle_t handle,
+                const mluOpTensorDescriptor_t x_desc,
+                const void *x,
+                const mluOpTensorDescriptor_t img_size_desc,
+                const void *img_size,
+                const mluOpTensorDescriptor_t anchors_desc,
+                const void *anchors,
+                const int class_num,
+                const float conf_thresh,
+                const int downsample_ratio,
+                const bool clip_bbox,
+                const float scale,
+                const bool iou_aware,
+                const float iou_aware_factor,
+                const float score_thresh,
+                const int top_k,
+                const float iou_threshold,
+                void *workspace,
+                size_t workspace_size,
+                const mluOpTensorDescriptor_t boxes_desc,
+                void *boxes,
+                const mluOpTensorDescriptor_t scores_desc,
+                void *scores,
+                const mluOpTensorDescriptor_t num_desc,
+                void *num);
+
 // Group: VoxelPooling
 /*!
  * @brief Adds the eigenvalues of all the channels on the same x and y coordinates,
@@ -8957,6 +9610,148 @@ mluOpAdamW(mluOpHandle_t handle,
            const float bias2,
            const float epsilon);
 
+// Group: AdamW
+/*!
+ * @brief Returns in \p workspace_size the size of the MLU memory that is used as an extra
+ * workspace to hold the launch table of ::mluOpAdamWForeach.
+ *
+ * @param[in] handle
+ * Handle to a Cambricon MLU-OPS context that is used to manage MLU devices
+ * and queues in the AdamW operation. For detailed information,
+ * see ::mluOpHandle_t.
+ * @param[in] tensor_num
+ * The number of parameter tensors updated by ::mluOpAdamWForeach.
+ * @param[in] sizes
+ * Pointer to the host memory that stores the element number of each parameter tensor.
+ * @param[out] workspace_size
+ * Pointer to the host memory that returns the size of the extra workspace in bytes.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - This function must be called before ::mluOpAdamWForeach with the same \p sizes.
+ *
+ * @par Note
+ * - The workspace grows with the number of 64K-element chunks in the list, not with
+ *   the number of elements.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpGetAdamWForeachWorkspaceSize(mluOpHandle_t handle,
+                                  const int tensor_num,
+                                  const size_t sizes[],
+                                  size_t *workspace_size);
+
+// Group: AdamW
+/*!
+ * @brief Updates a list of parameter tensors by using AdamW in a single kernel launch.
+ * Every tensor of the list is updated as ::mluOpAdamW updates a single tensor.
+ *
+ * @param[in] handle
+ * Handle to a Cambricon MLU-OPS context that is used to manage MLU devices
+ * and queues in the AdamW operation. For detailed information,
+ * see ::mluOpHandle_t.
+ * @param[in] adamw_desc
+ * A host pointer to the AdamW descriptor that holds information about the AdamW operation.
+ * @param[in] tensor_num
+ * The number of parameter tensors in the list.
+ * @param[in] params
+ * Pointer to the host array of \p tensor_num MLU pointers to the param tensors.
+ * It can be NULL when \p params_h is not NULL.
+ * @param[in] params_h
+ * Pointer to the host array of \p tensor_num MLU pointers to the param_h tensors.
+ * It can be NULL when \p params is not NULL.
+ * @param[in] momentums
+ * Pointer to the host array of \p tensor_num MLU pointers to the momentum tensors.
+ * @param[in] velocities
+ * Pointer to the host array of \p tensor_num MLU pointers to the velocity tensors.
+ * @param[in] grads
+ * Pointer to the host array of \p tensor_num MLU pointers to the grad tensors.
+ * @param[in] sizes
+ * Pointer to the host array that stores the element number of each parameter tensor.
+ * @param[in] workspace
+ * Pointer to the MLU memory that is used as an extra workspace for the launch table.
+ * @param[in] workspace_size
+ * The size of the extra workspace in bytes.
+ * @param[in] lr
+ * A scalar of lr factor that is used for AdamW.
+ * @param[in] beta1
+ * A scalar of beta1 factor that is used for AdamW.
+ * @param[in] beta2
+ * A scalar of beta2 factor that is used for AdamW.
+ * @param[in] bias1
+ * A scalar of bias1 factor that is used for AdamW.
+ * @param[in] bias2
+ * A scalar of bias2 factor that is used for AdamW.
+ * @param[in] epsilon
+ * A scalar of epsilon factor that is used for AdamW.
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM, ::MLUOP_STATUS_ARCH_MISMATCH,
+ *   ::MLUOP_STATUS_NOT_SUPPORTED, ::MLUOP_STATUS_EXECUTION_FAILED
+ *
+ * @par Data Type
+ * - The supported data types of the tensors in the lists are as follows:
+ *   - param tensor: float
+ *   - param_h tensor: bfloat16
+ *   - momentum tensor: float
+ *   - velocity tensor: float
+ *   - grad tensor: bfloat16
+ *
+ * @par Data Layout
+ * - All the tensors in the lists are contiguous arrays.
+ *
+ * @par Scale Limitation
+ * - The element number of each tensor must be less than 2^31.
+ *
+ * @par API Dependency
+ * - Before calling this function, you need to call ::mluOpGetAdamWForeachWorkspaceSize
+ *   to get the extra space size needed in AdamWForeach operation.
+ *
+ * @par Note
+ * - The tensors are cut into 64K-element chunks and the chunk table is copied to
+ *   \p workspace on the queue of \p handle.
+ * - When \p workspace is NULL, the workspace arena of \p handle is used.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - https://github.com/OpenBMB/BMTrain/blob/6abcf772aa1e120192f7656e55c4adbcde53c886/csrc/cuda/adam_cuda.cu
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpAdamWForeach(mluOpHandle_t handle,
+                  mluOpAdamWDescriptor_t adamw_desc,
+                  const int tensor_num,
+                  void *const params[],
+                  void *const params_h[],
+                  void *const momentums[],
+                  void *const velocities[],
+                  void *const grads[],
+                  const size_t sizes[],
+                  void *workspace,
+                  size_t workspace_size,
+                  const float lr,
+                  const float beta1,
+                  const float beta2,
+                  const float bias1,
+                  const float bias2,
+                  const float epsilon);
+
 // Group: AdamW
 /*!
  * @brief Creates a descriptor pointed by \p adamw_desc for AdamW operation.
@@ -40,6 +40,7 @@
 #include "core/tensor.h"
 #include "check_tools.h"
 #include "math_half.h"
+#include "random_data.h"
 
 // failed tests in GoogleTest will have RUN_ALL_TEST() return 1, so to
 // distinguish it from mluOp, choose a different exit code
@@ -99,6 +100,9 @@ void arrayCastHalfToInt8or16HalfUp(void *dst, int16_t *src, int pos, size_t num,
 bool getEnv(const std::string &env, bool default_ret);
 int getEnvInt(const std::string &env, int default_ret);
 size_t proc_usage_peak();
+// peak resident set size (VmHWM) in bytes, and reset it to the current rss.
+size_t proc_rss_peak();
+void proc_rss_peak_reset();
 std::unordered_map<std::string, std::vector<std::string>> readFileByLine(
     const std::string &file);
 
@@ -110,6 +114,23 @@ int float_mult(int in_a, int in_b, int float_16or32, int round_mode,
 int float_add(int in_a, int in_b, int float_16or32, int round_mode,
               int add_or_sub, int ieee754);
 
+// half/float mult and add of two regular numbers (no inf, nan or zero)
+int float_mult_regular(int in_a, int in_b, int float_16or32, int round_mode,
+                       int &up, int &down);
+int float_add_regular(int in_a, int in_b, int float_16or32, int round_mode,
+                      int add_or_sub, int &up, int &down);
+
+// float_mult and float_add over arrays, dst[i] is bit-exact with the scalar
+// function on in_a[i] and in_b[i], and dst may be in_a or in_b. float
+// (float_16or32 = 1) follows the rules of half, with the float inf, nan and
+// max.
+void float_mult_batch(const int *in_a, const int *in_b, int *dst, size_t num,
+                      int float_16or32, int round_mode, int ieee754,
+                      bool use_simd = true);
+void float_add_batch(const int *in_a, const int *in_b, int *dst, size_t num,
+                     int float_16or32, int round_mode, int add_or_sub,
+                     int ieee754, bool use_simd = true);
+
 bool hasRamdomBound(const RandomData *random_param);
 
 // force fix to float
@@ -138,24 +159,29 @@ void cvtHalfToFixed(const float *src, FixedType *dst, const size_t num,
                     const int offset = 0) {
   const float max = pow(2, sizeof(FixedType) * 8 - 1) + (-1);
   const float min = pow(2, sizeof(FixedType) * 8 - 1) * (-1);
+  std::vector<int> res(num), operand(num);
   for (size_t i = 0; i < num; ++i) {
-    int16_t res = float_mult(cvtFloatToHalf(src[i]), cvtFloatToHalf(scale), 0,
-                             ROUND_MODE_NEAREST_EVEN, 1);
-    // use 10 because half exponend width only 5 bit
-    int pos_tmp = position >= 0 ? 10 : -10;
-    float tmp = powf(2, -pos_tmp);
-    int16_t tmp_half = cvtFloatToHalf(tmp);
-    int16_t offset_half = cvtFloatToHalf(offset);
-    for (int cycle = 0; cycle < position / pos_tmp; ++cycle) {
-      res = float_mult(res, tmp_half, 0, ROUND_MODE_NEAREST_EVEN, 1);
-    }
-    if (position % pos_tmp) {
-      tmp = pow(2, -(position % pos_tmp));
-      int16_t tmp_half = cvtFloatToHalf(tmp);
-      res = float_mult(res, tmp_half, 0, ROUND_MODE_NEAREST_EVEN, 1);
-    }
-    res = float_add(res, offset_half, 0, ROUND_MODE_NEAREST_EVEN, 0, 1);
-    float res1 = cvtHalfToFloat(res);
+    res[i] = cvtFloatToHalf(src[i]);
+  }
+  auto mult = [&](float value) {
+    std::fill(operand.begin(), operand.end(), cvtFloatToHalf(value));
+    float_mult_batch(res.data(), operand.data(), res.data(), num, 0,
+                     ROUND_MODE_NEAREST_EVEN, 1);
+  };
+  mult(scale);
+  // use 10 because half exponend width only 5 bit
+  int pos_tmp = position >= 0 ? 10 : -10;
+  for (int cycle = 0; cycle < position / pos_tmp; ++cycle) {
+    mult(powf(2, -pos_tmp));
+  }
+  if (position % pos_tmp) {
+    mult(pow(2, -(position % pos_tmp)));
+  }
+  std::fill(operand.begin(), operand.end(), cvtFloatToHalf(offset));
+  float_add_batch(res.data(), operand.data(), res.data(), num, 0,
+                  ROUND_MODE_NEAREST_EVEN, 0, 1);
+  for (size_t i = 0; i < num; ++i) {
+    float res1 = cvtHalfToFloat(static_cast<int16_t>(res[i]));
     if (res1 > max) {
       res1 = max;
     } else if (res1 < min) {
@@ -168,123 +194,19 @@ void cvtHalfToFixed(const float *src, FixedType *dst, const size_t num,
 template <typename T>
 void generateRandomData(T *data, size_t count, const RandomData *random_param,
                         DataType dtype) {
-  // round to int
-  // if convert_dtype == true, round(float) to int,
-  // else don't round, int is qint
-  bool convert_dtype =
-      random_param->has_convert_dtype() ? random_param->convert_dtype() : false;
-  int seed = 23;
-  if (random_param->has_seed()) {
-    seed = random_param->seed();
+  if (!RandomDataStream<T>::supportDtype(dtype)) {
+    LOG(ERROR) << "Generate random data failed. ";
+    throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                std::to_string(__LINE__));
   }
-  // generate random data
-  std::default_random_engine re(seed);  // re for random engine
-  bool is_lower_equal_upper = false;
-
-  if (random_param->distribution() == mluoptest::UNIFORM) {
-    T lower = 1.;
-    T upper = -1.;
-    if (random_param->has_lower_bound_double()) {
-      lower = (T)random_param->lower_bound_double();
-      upper = (T)random_param->upper_bound_double();
-    } else {
-      lower = (T)random_param->lower_bound();
-      upper = (T)random_param->upper_bound();
-    }
-    if (lower == upper) {
-      is_lower_equal_upper = true;
-      for (size_t i = 0; i < count; ++i) {
-        data[i] = lower;
-      }
-    } else {
-      // uniform_real_distribution is [lower, upper)
-      upper = std::nexttoward(upper, -std::numeric_limits<T>::infinity());
-      std::uniform_real_distribution<T> dis(lower, upper);
-      for (size_t i = 0; i < count; ++i) {
-        data[i] = dis(re);
-      }
-    }
-  } else if (random_param->distribution() == mluoptest::GAUSSIAN) {
-    T mu = 0;
-    T sigma = 1;
-    if (random_param->has_mu_double()) {
-      mu = (T)random_param->mu_double();
-      sigma = (T)random_param->sigma_double();
-    } else {
-      mu = (T)random_param->mu();
-      sigma = (T)random_param->sigma();
-    }
-    std::normal_distribution<T> dis(mu, sigma);
-    for (size_t i = 0; i < count; ++i) {
-      data[i] = dis(re);
-    }
-  }
-
-  // reset data by dtype
-  switch (dtype) {
-    case DTYPE_BFLOAT16:
-    case DTYPE_HALF:
-    case DTYPE_FLOAT:
-    case DTYPE_DOUBLE:
-    case DTYPE_COMPLEX_HALF:
-    case DTYPE_COMPLEX_FLOAT:
-      break;
-    case DTYPE_INT8:
-    case DTYPE_INT16: {
-      if (convert_dtype) {
-        // if convert_dtype == true, round(float) to int,
-        // else don't round, int is qint
-        for (size_t i = 0; i < count; ++i) {
-          int x = std::floor(data[i]);
-          data[i] = x;
-        }
-      }
-    }; break;
-    case DTYPE_UINT8:
-    case DTYPE_UINT16:
-    case DTYPE_UINT32: {
-      for (size_t i = 0; i < count; ++i) {
-        uint32_t x = std::floor(data[i]);
-        data[i] = x;
-      }
-    }; break;
-    case DTYPE_INT31:
-    case DTYPE_INT32: {
-      for (size_t i = 0; i < count; ++i) {
-        int x = std::floor(data[i]);
-        data[i] = x;
-      }
-    }; break;
-    case DTYPE_INT64: {
-      for (size_t i = 0; i < count; ++i) {
-        int64_t x = std::floor(data[i]);
-        data[i] = x;
-      }
-    }; break;
-    case DTYPE_UINT64: {
-      for (size_t i = 0; i < count; ++i) {
-        uint64_t x = std::floor(std::abs(data[i]));
-        data[i] = x;
-      }
-    }; break;
-    case DTYPE_BOOL: {
-      // bool with data other than 0/1 is allowed
-      if (!hasRamdomBound(random_param)) {
-        LOG(ERROR) << "Generate bool data should use uniform distribution.";
-        throw std::invalid_argument(std::string(__FILE__) + " +" +
-                                    std::to_string(__LINE__));
-      }
-      // XXX may need to check upper_bound_double/lower_bound_double or
-      // upper_bound/lower_bound range
-      for (size_t i = 0; i < count; ++i) {
-        data[i] = (int8_t)(int32_t)(data[i]);
-      }
-    }; break;
-    default:
-      LOG(ERROR) << "Generate random data failed. ";
-      throw std::invalid_argument(std::string(__FILE__) + " +" +
-                                  std::to_string(__LINE__));
+  if (dtype == DTYPE_BOOL && !hasRamdomBound(random_param)) {
+    LOG(ERROR) << "Generate bool data should use uniform distribution.";
+    throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                std::to_string(__LINE__));
   }
+  // XXX may need to check upper_bound_double/lower_bound_double or
+  // upper_bound/lower_bound range for bool
+  RandomDataStream<T>(random_param, dtype).fillParallel(data, count);
 }
 
 // check if string is number
@@ -0,0 +1,105 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_ADAMW_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_ADAMW_CPU_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+#include "kernels/adam_w/adam_w_foreach.h"
+
+namespace mluoptest {
+namespace adamw_cpu {
+
+// Scalars of one AdamW step, as passed to mluOpAdamW.
+struct Hyper {
+  float lr;
+  float beta1;
+  float beta2;
+  float bias1;
+  float bias2;
+  float epsilon;
+  float weight_decay;
+  float scale;
+};
+
+// Updates elements [begin, end) of one tensor. grad is unscaled in place;
+// param_h may be nullptr.
+inline void step(const Hyper &h, const float *param, const float *momentum,
+                 const float *velocity, float *grad, float *param_out,
+                 float *param_h_out, float *momentum_out,
+                 float *velocity_out, size_t begin, size_t end) {
+  // by value: the stores below could alias the fields of h
+  const Hyper c = h;
+  for (size_t i = begin; i < end; ++i) {
+    grad[i] = grad[i] / c.scale;
+    momentum_out[i] = momentum[i] + (grad[i] - momentum[i]) * (1 - c.beta1);
+    velocity_out[i] =
+        velocity[i] + (grad[i] * grad[i] - velocity[i]) * (1 - c.beta2);
+    param_out[i] = param[i] -
+                   c.lr * momentum_out[i] / c.bias1 /
+                       (std::sqrt(velocity_out[i] / c.bias2) + c.epsilon) -
+                   c.lr * c.weight_decay * param[i];
+    if (param_h_out != nullptr) param_h_out[i] = param_out[i];
+  }
+}
+
+// The tensors of a foreach step. Each entry points at tensor_num tensors;
+// param_h may be nullptr.
+struct TensorList {
+  const float *const *param;
+  const float *const *momentum;
+  const float *const *velocity;
+  float *const *grad;
+  float *const *param_out;
+  float *const *param_h_out;
+  float *const *momentum_out;
+  float *const *velocity_out;
+};
+
+// Applies one step to a list of tensors by walking the launch table of
+// mluOpAdamWForeach, one entry per task, so that thousands of small
+// tensors are spread over the threads like one large tensor.
+inline void foreach(const Hyper &h, const TensorList &t, int tensor_num,
+                    const size_t *sizes,
+                    size_t chunk_num = mluop::kAdamWChunkNum) {
+  const std::vector<mluop::AdamWChunkRef> table =
+      mluop::planAdamWChunks(tensor_num, sizes, chunk_num);
+  const int64_t entries = table.size();
+#pragma omp parallel for schedule(static)
+  for (int64_t k = 0; k < entries; ++k) {
+    const mluop::AdamWChunkRef &c = table[k];
+    const int i = c.tensor;
+    step(h, t.param[i], t.momentum[i], t.velocity[i], t.grad[i],
+         t.param_out[i],
+         t.param_h_out == nullptr ? nullptr : t.param_h_out[i],
+         t.momentum_out[i], t.velocity_out[i], c.offset, c.offset + c.num);
+  }
+}
+
+}  // namespace adamw_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_ADAMW_CPU_H_
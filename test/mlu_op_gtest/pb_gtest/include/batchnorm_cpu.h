@@ -0,0 +1,200 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BATCHNORM_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BATCHNORM_CPU_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace mluoptest {
+namespace batchnorm_cpu {
+
+// Rows (n * h * w positions of the channel-last data) reduced by one task.
+// The partials of the chunks are combined in chunk order, so the results
+// do not depend on the number of threads.
+constexpr int64_t kRowChunk = 1024;
+
+// Channels updated together by the inner loops.
+constexpr int kLanes = 8;
+
+// Chan et al.: folds the moments of another sample, its count, mean and
+// m2 (sum of squared deviations from the mean), into (count, mean, m2).
+inline void merge(double count_b, double mean_b, double m2_b, double *count,
+                  double *mean, double *m2) {
+  const double n = *count + count_b;
+  if (count_b == 0 || n == 0) return;
+  const double delta = mean_b - *mean;
+  *mean += delta * (count_b / n);
+  *m2 += m2_b + delta * delta * (*count * count_b / n);
+  *count = n;
+}
+
+// Per-channel mean and m2 of x, [rows, channels], in a single pass:
+// Welford's update over the rows of each chunk, merged over the chunks.
+// Unlike sum(x^2) - sum(x)^2 it does not cancel for a large mean.
+inline void moments(const float *x, int64_t rows, int channels, double *mean,
+                    double *m2) {
+  const int64_t chunks = (rows + kRowChunk - 1) / kRowChunk;
+  std::vector<double> partial(chunks * 2 * channels, 0.0);
+#pragma omp parallel for schedule(static)
+  for (int64_t k = 0; k < chunks; ++k) {
+    double *chunk_mean = partial.data() + k * 2 * channels;
+    double *chunk_m2 = chunk_mean + channels;
+    const int64_t begin = k * kRowChunk;
+    const int64_t end = std::min(rows, begin + kRowChunk);
+    for (int64_t r = begin; r < end; ++r) {
+      const float *xr = x + r * channels;
+      const double inv_count = 1.0 / (r - begin + 1);
+      int c = 0;
+      for (; c + kLanes <= channels; c += kLanes) {
+        double m[kLanes], s[kLanes];
+        for (int j = 0; j < kLanes; ++j) {
+          const double delta = xr[c + j] - chunk_mean[c + j];
+          m[j] = chunk_mean[c + j] + delta * inv_count;
+          s[j] = chunk_m2[c + j] + delta * (xr[c + j] - m[j]);
+        }
+        for (int j = 0; j < kLanes; ++j) {
+          chunk_mean[c + j] = m[j], chunk_m2[c + j] = s[j];
+        }
+      }
+      for (; c < channels; ++c) {
+        const double delta = xr[c] - chunk_mean[c];
+        chunk_mean[c] += delta * inv_count;
+        chunk_m2[c] += delta * (xr[c] - chunk_mean[c]);
+      }
+    }
+  }
+#pragma omp parallel for schedule(static)
+  for (int c = 0; c < channels; ++c) {
+    double count = 0;
+    mean[c] = 0, m2[c] = 0;
+    for (int64_t k = 0; k < chunks; ++k) {
+      const double *chunk_mean = partial.data() + k * 2 * channels;
+      merge(std::min(kRowChunk, rows - k * kRowChunk), chunk_mean[c],
+            chunk_mean[channels + c], &count, mean + c, m2 + c);
+    }
+  }
+}
+
+// The per-channel sums of the batchnorm backward reduction in one pass
+// over dy and x, [rows, channels]: sum(dy), sum(dy * xmu) and
+// sum(dy * xmu * invstd), with xmu = x - mean.
+inline void reduceBackward(const float *dy, const float *x, const float *mean,
+                           const float *invstd, int64_t rows, int channels,
+                           double *sum_dy, double *sum_dy_xmu,
+                           double *sum_dy_xhat) {
+  const int64_t chunks = (rows + kRowChunk - 1) / kRowChunk;
+  std::vector<double> partial(chunks * 3 * channels, 0.0);
+#pragma omp parallel for schedule(static)
+  for (int64_t k = 0; k < chunks; ++k) {
+    double *chunk_dy = partial.data() + k * 3 * channels;
+    double *chunk_dy_xmu = chunk_dy + channels;
+    double *chunk_dy_xhat = chunk_dy_xmu + channels;
+    const int64_t begin = k * kRowChunk;
+    const int64_t end = std::min(rows, begin + kRowChunk);
+    for (int64_t r = begin; r < end; ++r) {
+      const float *dyr = dy + r * channels, *xr = x + r * channels;
+      int c = 0;
+      for (; c + kLanes <= channels; c += kLanes) {
+        double a[kLanes], b[kLanes], h[kLanes];
+        for (int j = 0; j < kLanes; ++j) {
+          const float xmu = xr[c + j] - mean[c + j];
+          const float xhat = xmu * invstd[c + j];
+          a[j] = chunk_dy[c + j] + dyr[c + j];
+          b[j] = chunk_dy_xmu[c + j] + xmu * dyr[c + j];
+          h[j] = chunk_dy_xhat[c + j] + xhat * dyr[c + j];
+        }
+        for (int j = 0; j < kLanes; ++j) {
+          chunk_dy[c + j] = a[j], chunk_dy_xmu[c + j] = b[j];
+          chunk_dy_xhat[c + j] = h[j];
+        }
+      }
+      for (; c < channels; ++c) {
+        const float xmu = xr[c] - mean[c];
+        const float xhat = xmu * invstd[c];
+        chunk_dy[c] += dyr[c];
+        chunk_dy_xmu[c] += xmu * dyr[c];
+        chunk_dy_xhat[c] += xhat * dyr[c];
+      }
+    }
+  }
+#pragma omp parallel for schedule(static)
+  for (int c = 0; c < channels; ++c) {
+    sum_dy[c] = 0, sum_dy_xmu[c] = 0, sum_dy_xhat[c] = 0;
+    for (int64_t k = 0; k < chunks; ++k) {
+      const double *chunk_dy = partial.data() + k * 3 * channels;
+      sum_dy[c] += chunk_dy[c];
+      sum_dy_xmu[c] += chunk_dy[channels + c];
+      sum_dy_xhat[c] += chunk_dy[2 * channels + c];
+    }
+  }
+}
+
+// y = (x - mean) * invstd, then * weight + bias when both are given.
+inline void normalize(const float *x, const float *mean, const float *invstd,
+                      const float *weight, const float *bias, int64_t rows,
+                      int channels, float *y) {
+#pragma omp parallel for schedule(static)
+  for (int64_t r = 0; r < rows; ++r) {
+    const float *xr = x + r * channels;
+    float *yr = y + r * channels;
+    for (int c = 0; c < channels; ++c) {
+      yr[c] = (xr[c] - mean[c]) * invstd[c];
+    }
+    if (weight != nullptr && bias != nullptr) {
+      for (int c = 0; c < channels; ++c) yr[c] = yr[c] * weight[c] + bias[c];
+    }
+  }
+}
+
+// dx = (dy - mean_dy - (x - mean) * invstd^2 * mean_dy_xmu) * invstd,
+// times weight when it is given.
+inline void backwardElemt(const float *dy, const float *x, const float *mean,
+                          const float *invstd, const float *weight,
+                          const float *mean_dy, const float *mean_dy_xmu,
+                          int64_t rows, int channels, float *dx) {
+#pragma omp parallel for schedule(static)
+  for (int64_t r = 0; r < rows; ++r) {
+    const float *dyr = dy + r * channels, *xr = x + r * channels;
+    float *dxr = dx + r * channels;
+    if (weight == nullptr) {
+      for (int c = 0; c < channels; ++c) {
+        dxr[c] = (dyr[c] - mean_dy[c] -
+                  (xr[c] - mean[c]) * invstd[c] * invstd[c] * mean_dy_xmu[c]) *
+                 invstd[c];
+      }
+    } else {
+      for (int c = 0; c < channels; ++c) {
+        dxr[c] = (dyr[c] - mean_dy[c] -
+                  (xr[c] - mean[c]) * invstd[c] * invstd[c] * mean_dy_xmu[c]) *
+                 weight[c] * invstd[c];
+      }
+    }
+  }
+}
+
+}  // namespace batchnorm_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BATCHNORM_CPU_H_
@@ -0,0 +1,173 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BILINEAR_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BILINEAR_CPU_H_
+
+#include <math.h>
+#include <stdint.h>
+
+namespace mluoptest {
+namespace bilinear_cpu {
+
+// Channels handled by one task of a scatter-add loop. Tasks own disjoint
+// channel ranges, so they never write the same element and every element
+// sees its updates in the serial order.
+constexpr int kChannelBlock = 64;
+
+// Channels interpolated together by the inner loops.
+constexpr int kLanes = 8;
+
+// A sample point of a channel-last [h, w, c] map: the element offsets of
+// the top-left, top-right, bottom-left and bottom-right pixels, -1 for a
+// pixel outside the map, and their bilinear weights.
+struct Point {
+  int64_t offset[4];
+  float weight[4];
+};
+
+// roi_align rule (mmcv): a point more than one pixel outside the map is
+// empty and gives false, otherwise it is clamped into the map and all four
+// corners exist.
+inline bool alignedPoint(int height, int width, float y, float x,
+                         int64_t pixel_stride, Point *p) {
+  if (y < -1.0 || y > height || x < -1.0 || x > width) return false;
+  if (y <= 0) y = 0;
+  if (x <= 0) x = 0;
+  int y_low = (int)y, x_low = (int)x, y_high, x_high;
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = (float)y_low;
+  } else {
+    y_high = y_low + 1;
+  }
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = (float)x_low;
+  } else {
+    x_high = x_low + 1;
+  }
+  const float ly = y - y_low, lx = x - x_low;
+  const float hy = 1. - ly, hx = 1. - lx;
+  p->offset[0] = (static_cast<int64_t>(y_low) * width + x_low) * pixel_stride;
+  p->offset[1] = (static_cast<int64_t>(y_low) * width + x_high) * pixel_stride;
+  p->offset[2] = (static_cast<int64_t>(y_high) * width + x_low) * pixel_stride;
+  p->offset[3] =
+      (static_cast<int64_t>(y_high) * width + x_high) * pixel_stride;
+  p->weight[0] = hy * hx, p->weight[1] = hy * lx;
+  p->weight[2] = ly * hx, p->weight[3] = ly * lx;
+  return true;
+}
+
+// deformable conv rule: a point out of (-1, height) x (-1, width) is empty
+// and gives false, otherwise the corners outside the map read as zero.
+inline bool deformPoint(int height, int width, float y, float x,
+                        int64_t pixel_stride, Point *p) {
+  if (!(y > -1 && x > -1 && y < height && x < width)) return false;
+  const int y_low = floorf(y), x_low = floorf(x);
+  const int y_high = y_low + 1, x_high = x_low + 1;
+  const float ly = y - y_low, lx = x - x_low;
+  const float hy = 1 - ly, hx = 1 - lx;
+  auto offset = [&](int py, int px) -> int64_t {
+    if (py < 0 || px < 0 || py > height - 1 || px > width - 1) return -1;
+    return (static_cast<int64_t>(py) * width + px) * pixel_stride;
+  };
+  p->offset[0] = offset(y_low, x_low);
+  p->offset[1] = offset(y_low, x_high);
+  p->offset[2] = offset(y_high, x_low);
+  p->offset[3] = offset(y_high, x_high);
+  p->weight[0] = hy * hx, p->weight[1] = hy * lx;
+  p->weight[2] = ly * hx, p->weight[3] = ly * lx;
+  return true;
+}
+
+// Calls op(c, w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4) for every channel, in
+// the order of the per-element code so that the sums are bit exact. A
+// missing corner reads as zero.
+template <typename Op>
+inline void interpolate(const float *data, const Point &p, int channels,
+                        Op op) {
+  const float w1 = p.weight[0], w2 = p.weight[1];
+  const float w3 = p.weight[2], w4 = p.weight[3];
+  if (p.offset[0] >= 0 && p.offset[1] >= 0 && p.offset[2] >= 0 &&
+      p.offset[3] >= 0) {
+    const float *v1 = data + p.offset[0], *v2 = data + p.offset[1];
+    const float *v3 = data + p.offset[2], *v4 = data + p.offset[3];
+    int c = 0;
+    // fixed-width blocks, which the compiler vectorizes without aliasing
+    // checks
+    for (; c + kLanes <= channels; c += kLanes) {
+      float v[kLanes];
+      for (int j = 0; j < kLanes; ++j) {
+        v[j] = w1 * v1[c + j] + w2 * v2[c + j] + w3 * v3[c + j] +
+               w4 * v4[c + j];
+      }
+      for (int j = 0; j < kLanes; ++j) op(c + j, v[j]);
+    }
+    for (; c < channels; ++c) {
+      op(c, w1 * v1[c] + w2 * v2[c] + w3 * v3[c] + w4 * v4[c]);
+    }
+    return;
+  }
+  auto at = [&](int corner, int c) {
+    return p.offset[corner] >= 0 ? data[p.offset[corner] + c] : 0.0f;
+  };
+  for (int c = 0; c < channels; ++c) {
+    op(c, w1 * at(0, c) + w2 * at(1, c) + w3 * at(2, c) + w4 * at(3, c));
+  }
+}
+
+// out[c] = w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4.
+inline void sample(const float *data, const Point &p, int channels,
+                   float *out) {
+  interpolate(data, p, channels, [out](int c, float v) { out[c] = v; });
+}
+
+// out[c] += (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4) * scale.
+inline void accumulate(const float *data, const Point &p, float scale,
+                       int channels, float *out) {
+  interpolate(data, p, channels,
+              [out, scale](int c, float v) { out[c] += v * scale; });
+}
+
+// data[corner + c] += weight * grad[c] / divisor for the corners in the
+// map, corner by corner.
+inline void scatter(float *data, const Point &p, const float *grad,
+                    float divisor, int channels) {
+  for (int corner = 0; corner < 4; ++corner) {
+    if (p.offset[corner] < 0) continue;
+    float *dst = data + p.offset[corner];
+    const float w = p.weight[corner];
+    int c = 0;
+    for (; c + kLanes <= channels; c += kLanes) {
+      float g[kLanes];
+      for (int j = 0; j < kLanes; ++j) g[j] = w * grad[c + j] / divisor;
+      for (int j = 0; j < kLanes; ++j) dst[c + j] += g[j];
+    }
+    for (; c < channels; ++c) dst[c] += w * grad[c] / divisor;
+  }
+}
+
+}  // namespace bilinear_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BILINEAR_CPU_H_
@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CASE_ADMISSION_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CASE_ADMISSION_H_
+
+#include <stddef.h>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <mutex>  // NOLINT
+#include "case_cost.h"
+
+namespace mluoptest {
+
+struct CaseMemory {
+  size_t host_bytes = 0;
+  size_t device_bytes = 0;
+};
+
+// peak memory of a case, from its header: on host the parsed case, the
+// data of every tensor and the float copies the baseline and evaluation
+// work on, on device every tensor and the workspace. strides and the
+// memory of the op itself are not counted, leave some headroom in the
+// budget. a case whose header could not be read only counts its file.
+CaseMemory estimateCaseMemory(const CaseHeader &header, size_t file_bytes);
+
+// admits cases as long as the estimated memory of the cases in flight fits
+// the budget, a budget of 0 is no limit. a case over the budget is still
+// admitted once nothing else is in flight, it runs alone instead of never.
+class MemoryAdmission {
+ public:
+  MemoryAdmission(size_t host_budget, size_t device_budget)
+      : budget_{host_budget, device_budget} {}
+
+  bool enabled() const {
+    return budget_.host_bytes > 0 || budget_.device_bytes > 0;
+  }
+  // admit the case if it fits now, never waits.
+  bool tryAdmit(const CaseMemory &memory);
+  // wait until the case fits, on_defer is called once before waiting.
+  void admit(const CaseMemory &memory, std::function<void()> on_defer);
+  // the case left, give its memory back.
+  void release(const CaseMemory &memory);
+
+  CaseMemory inFlight() const;
+  // the most memory in flight at the same time.
+  CaseMemory peak() const;
+
+ private:
+  bool fits(const CaseMemory &memory) const;
+  void take(const CaseMemory &memory);
+
+  const CaseMemory budget_;
+  CaseMemory in_flight_;
+  CaseMemory peak_;
+  size_t cases_ = 0;
+  mutable std::mutex mtx_;
+  std::condition_variable released_;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CASE_ADMISSION_H_
@@ -30,6 +30,7 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include "case_cost.h"
 #include "tools.h"
 #include "variable.h"
 #include "gtest/gtest.h"
@@ -60,6 +61,9 @@ class Collector {
   std::vector<std::string> list_by_case_list(std::string);
   std::vector<std::string> list_by_case_dir(std::string);
   std::vector<std::string> list_by_case_path(std::string);
+  // keep the cases of --shard_index, and put the long ones first so that
+  // no thread is left with a giant case at the end.
+  void schedule_by_cost(std::vector<std::string> &case_names);
 
   void assertPath(std::string &, caseType, std::string, int);
   bool path_exist = false;
@@ -0,0 +1,95 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CASE_COST_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CASE_COST_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "internal_perf.h"
+
+namespace mluoptest {
+
+struct CaseTensorHeader {
+  bool output = false;
+  size_t elements = 0;     // 0 if the tensor has no shape
+  size_t dtype_bytes = 0;  // 0 if the dtype is not set or unknown
+};
+
+// what a case needs, read from its header only: the inputs and outputs in
+// file order, and the workspace size recorded with the case (that of the
+// baseline device, the best guess before the op asks for its own).
+struct CaseHeader {
+  std::vector<CaseTensorHeader> tensors;
+  size_t workspace_size = 0;
+  size_t elementCount() const;
+};
+
+// a *.pb is walked with CodedInputStream and its values are skipped, a
+// *.prototxt is parsed whole, so those larger than kCaseHeaderScanBytes are
+// not read, their values already dominate the file size. so are *.pb over
+// the 2GB limit of CodedInputStream.
+constexpr size_t kCaseHeaderScanBytes = 1 << 20;
+bool readCaseHeader(const std::string &case_path, CaseHeader *header);
+
+// sum of the element counts of all inputs and outputs of a case.
+bool caseElementCount(const std::string &case_path, size_t *count);
+
+// size of a DataType by its name, e.g. 2 for "DTYPE_HALF", 0 if unknown.
+size_t dtypeNameBytes(const std::string &dtype);
+
+struct CaseCost {
+  std::string case_path;
+  size_t file_bytes = 0;
+  size_t elements = 0;
+  double estimate = 0.;  // from the file only, the same on every machine
+  double seconds = 0.;   // estimate scaled by, or replaced with, the history
+  bool history = false;  // seconds comes from the history
+};
+
+// the cost of every case. cases without history get a cost from their file
+// size and element count, scaled by the cases of the same list that have
+// history, so that both kinds are comparable.
+std::vector<CaseCost> estimateCaseCosts(
+    const std::vector<std::string> &case_paths, TestInternalInfo *history);
+
+// indices of the cases in longest-processing-time-first order, ties kept
+// in list order.
+std::vector<size_t> lptOrder(const std::vector<CaseCost> &costs);
+
+// indices (in list order) of the cases of shard shard_index. cases go to the
+// least loaded shard, longest estimate first, so that the shards get about
+// the same cost. only depends on the paths and estimates, never on the
+// listing order or the history, which differs from machine to machine.
+// salt rotates the shard that wins a tie, e.g. so that the single case of
+// every op does not always land on shard 0.
+std::vector<size_t> shardCases(const std::vector<CaseCost> &costs,
+                               int shard_index, int total_shards,
+                               uint64_t salt = 0);
+
+// FNV-1a, stable across platforms and runs, unlike std::hash.
+uint64_t stableHash(const std::string &str);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CASE_COST_H_
@@ -0,0 +1,128 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CASE_PIPELINE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CASE_PIPELINE_H_
+
+#include <stddef.h>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace mluoptest {
+
+// FIFO with a fixed capacity: push() waits while it is full, pop() waits
+// while it is empty and returns false once it is closed and drained.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+  void push(T item) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    not_full_.wait(lk, [this]() { return items_.size() < capacity_; });
+    items_.emplace_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  bool pop(T *item) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    not_empty_.wait(lk, [this]() { return !items_.empty() || closed_; });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> items_;
+  std::mutex mtx_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+struct PipelineStageStats {
+  std::string name;
+  size_t threads = 0;
+  size_t cases = 0;
+  double busy_s = 0;     // in the stage function, summed over threads
+  double starved_s = 0;  // waiting for a case from the previous stage
+  double blocked_s = 0;  // waiting for room in the next stage
+};
+
+// Cases [0, num) go through the stages in order. Each stage has its own
+// threads and a bounded queue in front of it, so cases in different stages
+// overlap, e.g. the parsing of one case with the cpu baseline of another.
+// At most max_in_flight cases are between the first and the last stage.
+//
+// A stage function gets the case index and must not throw, it is called
+// for every case, failed or not, and the caller keeps the per-case state.
+class CasePipeline {
+ public:
+  using StageFunc = std::function<void(size_t)>;
+
+  CasePipeline(size_t queue_capacity, size_t max_in_flight)
+      : queue_capacity_(queue_capacity), max_in_flight_(max_in_flight) {}
+
+  void addStage(const std::string &name, size_t threads, StageFunc func);
+  // called once at the start of every worker thread.
+  void setThreadInit(std::function<void()> init) { thread_init_ = init; }
+  // called with every case, in case order, before it enters the first stage.
+  // it may wait, e.g. for memory, as long as the cases already in flight
+  // can finish.
+  void setAdmit(StageFunc admit) { admit_ = admit; }
+
+  // Blocks until every case went through every stage.
+  void run(size_t num);
+
+  const std::vector<PipelineStageStats> &stats() const { return stats_; }
+  double wallSeconds() const { return wall_s_; }
+  // per-stage utilization table, busy / (threads * wall).
+  std::string report() const;
+
+ private:
+  size_t queue_capacity_;
+  size_t max_in_flight_;
+  std::function<void()> thread_init_ = nullptr;
+  StageFunc admit_ = nullptr;
+  std::vector<StageFunc> stages_;
+  std::vector<PipelineStageStats> stats_;
+  double wall_s_ = 0;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CASE_PIPELINE_H_
@@ -0,0 +1,304 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_DCN_CPU_ENGINE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_DCN_CPU_ENGINE_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace mluoptest {
+namespace dcn_cpu {
+
+// Row-major single precision GEMM, C = op(A) * op(B) + beta * C, where op(A)
+// is m x k and op(B) is k x n. A and B are packed in panels which stay in
+// cache, and the row panels of C are computed in parallel. The sum over k is
+// blocked, so the result differs from a plain dot product by rounding only.
+inline void sgemm(bool trans_a, bool trans_b, int m, int n, int k,
+                  const float *a, int lda, const float *b, int ldb, float beta,
+                  float *c, int ldc) {
+  // a kMr x kNr block of C is kept in registers by the micro kernel, the
+  // fixed trip counts let the compiler vectorize it. kc x nc floats of B
+  // take 128KB, mc x kc of A 32KB.
+  constexpr int kMr = 4, kNr = 16;
+  constexpr int kMc = 64, kKc = 128, kNc = 256;
+  if (m <= 0 || n <= 0) return;
+  if (beta != 1.0f) {
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < m; ++i) {
+      float *row = c + static_cast<int64_t>(i) * ldc;
+      for (int j = 0; j < n; ++j) row[j] = beta == 0.0f ? 0.0f : beta * row[j];
+    }
+  }
+  auto at = [&](int i, int p) {
+    return trans_a ? a[static_cast<int64_t>(p) * lda + i]
+                   : a[static_cast<int64_t>(i) * lda + p];
+  };
+  auto bt = [&](int p, int j) {
+    return trans_b ? b[static_cast<int64_t>(j) * ldb + p]
+                   : b[static_cast<int64_t>(p) * ldb + j];
+  };
+  std::vector<float> packed_b(kKc * kNc);
+  for (int j0 = 0; j0 < n; j0 += kNc) {
+    const int nc = std::min(kNc, n - j0);
+    const int panels = (nc + kNr - 1) / kNr;
+    for (int p0 = 0; p0 < k; p0 += kKc) {
+      const int kc = std::min(kKc, k - p0);
+      // packed_b is a [kc, kNr] panel per kNr columns, zero padded.
+#pragma omp parallel for schedule(static)
+      for (int panel = 0; panel < panels; ++panel) {
+        float *dst = packed_b.data() + panel * kc * kNr;
+        for (int p = 0; p < kc; ++p) {
+          for (int j = 0; j < kNr; ++j) {
+            const int col = panel * kNr + j;
+            dst[p * kNr + j] = col < nc ? bt(p0 + p, j0 + col) : 0.0f;
+          }
+        }
+      }
+      const int m_blocks = (m + kMc - 1) / kMc;
+#pragma omp parallel for schedule(dynamic)
+      for (int blk = 0; blk < m_blocks; ++blk) {
+        const int i0 = blk * kMc;
+        const int mc = std::min(kMc, m - i0);
+        // packed_a is a [kc, kMr] panel per kMr rows, zero padded.
+        float packed_a[kMc * kKc];
+        for (int r0 = 0; r0 < mc; r0 += kMr) {
+          for (int p = 0; p < kc; ++p) {
+            for (int r = 0; r < kMr; ++r) {
+              packed_a[r0 * kc + p * kMr + r] =
+                  r0 + r < mc ? at(i0 + r0 + r, p0 + p) : 0.0f;
+            }
+          }
+        }
+        for (int r0 = 0; r0 < mc; r0 += kMr) {
+          const float *pa = packed_a + r0 * kc;
+          for (int panel = 0; panel < panels; ++panel) {
+            const float *pb = packed_b.data() + panel * kc * kNr;
+            float acc[kMr][kNr] = {};
+            for (int p = 0; p < kc; ++p) {
+              for (int r = 0; r < kMr; ++r) {
+                for (int j = 0; j < kNr; ++j) {
+                  acc[r][j] += pa[p * kMr + r] * pb[p * kNr + j];
+                }
+              }
+            }
+            const int nr = std::min(kNr, nc - panel * kNr);
+            for (int r = 0; r < kMr && r0 + r < mc; ++r) {
+              float *crow = c + static_cast<int64_t>(i0 + r0 + r) * ldc +
+                            j0 + panel * kNr;
+              for (int j = 0; j < nr; ++j) crow[j] += acc[r][j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Sizes of a 2D deformable convolution over NHWC input, pad is top and
+// left only, the output size is given.
+struct DcnShape {
+  int n;  // images in one im2col step
+  int hi, wi, ci;
+  int ho, wo;
+  int kh, kw;
+  int pt, pl;
+  int sh, sw;
+  int dh, dw;
+  int dg;  // deformable groups, ci / dg channels share an offset
+};
+
+// Deformable im2col of one im2col step.
+//   input  : [n, hi, wi, ci]
+//   offset : [n, ho, wo, dg, kh, kw, 2]
+//   mask   : [n, ho, wo, dg, kh, kw], may be null
+//   columns: [g, n * ho * wo, kh * kw, ci / g]
+// With g == 1 columns is the usual [n * ho * wo, kh, kw, ci], and every
+// conv group gets a contiguous k = kh * kw * ci / g row per output pixel.
+// The bilinear weights are computed once per sampling point and applied to
+// the ci / dg channels sharing it. A sampling point out of the image gives
+// zeros.
+inline void deformableIm2col(const DcnShape &s, int g, const float *input,
+                             const float *offset, const float *mask,
+                             float *columns) {
+  const int rows = s.n * s.ho * s.wo;
+  const int taps = s.kh * s.kw;
+  const int c_per_dg = s.ci / s.dg;
+  const int c_per_g = s.ci / g;
+  const int64_t group_stride = static_cast<int64_t>(rows) * taps * c_per_g;
+#pragma omp parallel for schedule(static)
+  for (int row = 0; row < rows; ++row) {
+    const int idx_n = row / (s.ho * s.wo);
+    const int idx_ho = row / s.wo % s.ho;
+    const int idx_wo = row % s.wo;
+    const float *input_ptr =
+        input + static_cast<int64_t>(idx_n) * s.hi * s.wi * s.ci;
+    const float *offset_ptr =
+        offset + static_cast<int64_t>(row) * s.dg * taps * 2;
+    const float *mask_ptr =
+        mask ? mask + static_cast<int64_t>(row) * s.dg * taps : nullptr;
+    const int hi_start = idx_ho * s.sh - s.pt;
+    const int wi_start = idx_wo * s.sw - s.pl;
+    for (int tap = 0; tap < taps; ++tap) {
+      const int idx_kh = tap / s.kw;
+      const int idx_kw = tap % s.kw;
+      for (int idx_dg = 0; idx_dg < s.dg; ++idx_dg) {
+        const int point = idx_dg * taps + tap;
+        const float h_in = hi_start + idx_kh * s.dh + offset_ptr[point * 2];
+        const float w_in =
+            wi_start + idx_kw * s.dw + offset_ptr[point * 2 + 1];
+        const float m = mask_ptr ? mask_ptr[point] : 1.0f;
+        const bool inside =
+            h_in > -1 && w_in > -1 && h_in < s.hi && w_in < s.wi;
+        // corner weights and rows, a missing corner has a null row.
+        float w1 = 0, w2 = 0, w3 = 0, w4 = 0;
+        const float *p1 = nullptr, *p2 = nullptr, *p3 = nullptr,
+                    *p4 = nullptr;
+        if (inside) {
+          const int h_low = floor(h_in);
+          const int w_low = floor(w_in);
+          const int h_high = h_low + 1;
+          const int w_high = w_low + 1;
+          const float lh = h_in - h_low;
+          const float lw = w_in - w_low;
+          const float hh = 1 - lh;
+          const float hw = 1 - lw;
+          w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+          const int c0 = idx_dg * c_per_dg;
+          if (h_low >= 0 && w_low >= 0) {
+            p1 = input_ptr + (h_low * s.wi + w_low) * s.ci + c0;
+          }
+          if (h_low >= 0 && w_high <= s.wi - 1) {
+            p2 = input_ptr + (h_low * s.wi + w_high) * s.ci + c0;
+          }
+          if (h_high <= s.hi - 1 && w_low >= 0) {
+            p3 = input_ptr + (h_high * s.wi + w_low) * s.ci + c0;
+          }
+          if (h_high <= s.hi - 1 && w_high <= s.wi - 1) {
+            p4 = input_ptr + (h_high * s.wi + w_high) * s.ci + c0;
+          }
+        }
+        // channels of this deformable group, split at conv group borders.
+        int c = 0;
+        while (c < c_per_dg) {
+          const int channel = idx_dg * c_per_dg + c;
+          const int grp = channel / c_per_g;
+          const int len = std::min(c_per_dg - c, (grp + 1) * c_per_g - channel);
+          float *col = columns + grp * group_stride +
+                       (static_cast<int64_t>(row) * taps + tap) * c_per_g +
+                       channel - grp * c_per_g;
+          if (!inside) {
+            std::fill(col, col + len, 0.0f);
+          } else {
+            for (int i = 0; i < len; ++i) {
+              const float v1 = p1 ? p1[c + i] : 0.0f;
+              const float v2 = p2 ? p2[c + i] : 0.0f;
+              const float v3 = p3 ? p3[c + i] : 0.0f;
+              const float v4 = p4 ? p4[c + i] : 0.0f;
+              col[i] = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4) * m;
+            }
+          }
+          c += len;
+        }
+      }
+    }
+  }
+}
+
+// Deformable col2im of one im2col step, the adjoint of deformableIm2col.
+//   grad_col   : [n * ho * wo, kh, kw, ci]
+//   grad_input : [n, hi, wi, ci], accumulated into
+//   grad_offset: [n, ho, wo, dg, kh, kw, 2]
+//   grad_mask  : [n, ho, wo, dg, kh, kw], may be null
+// grad_offset and grad_mask are overwritten. Every (image, deformable group)
+// writes its own channels of grad_input, so those tasks run in parallel and
+// each one keeps the serial order.
+inline void deformableCol2img(const DcnShape &s, const float *grad_col,
+                              const float *input, const float *offset,
+                              const float *mask, float *grad_input,
+                              float *grad_offset, float *grad_mask) {
+  const int taps = s.kh * s.kw;
+  const int c_per_dg = s.ci / s.dg;
+#pragma omp parallel for schedule(dynamic)
+  for (int task = 0; task < s.n * s.dg; ++task) {
+    const int idx_n = task / s.dg;
+    const int idx_dg = task % s.dg;
+    const int64_t image = static_cast<int64_t>(idx_n) * s.hi * s.wi * s.ci;
+    const float *input_ptr = input + image + idx_dg * c_per_dg;
+    float *grad_input_ptr = grad_input + image + idx_dg * c_per_dg;
+    for (int pixel = 0; pixel < s.ho * s.wo; ++pixel) {
+      const int row = idx_n * s.ho * s.wo + pixel;
+      const int hi_start = pixel / s.wo * s.sh - s.pt;
+      const int wi_start = pixel % s.wo * s.sw - s.pl;
+      for (int tap = 0; tap < taps; ++tap) {
+        const int64_t point =
+            (static_cast<int64_t>(row) * s.dg + idx_dg) * taps + tap;
+        const float h_in = hi_start + tap / s.kw * s.dh + offset[point * 2];
+        const float w_in =
+            wi_start + tap % s.kw * s.dw + offset[point * 2 + 1];
+        const float m = mask ? mask[point] : 1.0f;
+        const float *top = grad_col +
+                           (static_cast<int64_t>(row) * taps + tap) * s.ci +
+                           idx_dg * c_per_dg;
+        float grad_m = 0.0f, grad_h = 0.0f, grad_w = 0.0f;
+        if (h_in > -1 && w_in > -1 && h_in < s.hi && w_in < s.wi) {
+          const int h_low = floor(h_in);
+          const int w_low = floor(w_in);
+          const float lh = h_in - h_low;
+          const float lw = w_in - w_low;
+          const float hh = 1 - lh;
+          const float hw = 1 - lw;
+          // corners as (dy, dx), with the bilinear weight and its
+          // derivatives along h and w.
+          const float weights[4] = {hh * hw, hh * lw, lh * hw, lh * lw};
+          const float dweights_h[4] = {-hw, -lw, hw, lw};
+          const float dweights_w[4] = {-hh, hh, -lh, lh};
+          for (int corner = 0; corner < 4; ++corner) {
+            const int y = h_low + corner / 2;
+            const int x = w_low + corner % 2;
+            if (y < 0 || x < 0 || y > s.hi - 1 || x > s.wi - 1) continue;
+            const int64_t at = (static_cast<int64_t>(y) * s.wi + x) * s.ci;
+            const float *v = input_ptr + at;
+            float *g = grad_input_ptr + at;
+            const float weight = weights[corner] * m;
+            for (int c = 0; c < c_per_dg; ++c) {
+              g[c] += weight * top[c];
+              grad_m += weights[corner] * v[c] * top[c];
+              grad_h += dweights_h[corner] * v[c] * top[c];
+              grad_w += dweights_w[corner] * v[c] * top[c];
+            }
+          }
+        }
+        grad_offset[point * 2] = grad_h * m;
+        grad_offset[point * 2 + 1] = grad_w * m;
+        if (grad_mask) grad_mask[point] = grad_m;
+      }
+    }
+  }
+}
+
+}  // namespace dcn_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_DCN_CPU_ENGINE_H_
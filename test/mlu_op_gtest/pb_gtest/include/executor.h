@@ -369,6 +369,19 @@ class Executor {
   bool ready();
   void sync();
   EvaluateResult teardown();
+
+  // setup() is prepare() then upload(), teardown() is fetchMluOutput(),
+  // computeBaseline() then evaluate(). The pipelined runner calls them from
+  // different threads, one step of an executor at a time.
+  // prepare(): parse, host malloc, init input data, cast in (host only).
+  void prepare(std::string file, const std::shared_ptr<ExecuteConfig> ecfg);
+  // upload(): device malloc, copy in, workspace and algo search.
+  void upload();
+  // perf repeat and copy out, false if baseline and diff are skipped.
+  bool fetchMluOutput();
+  // baseline output (cpu compute or read from case), cast out.
+  void computeBaseline();
+  EvaluateResult evaluate();
   inline EvaluateResult *result() { return &eva_res_; }
 
  protected:
@@ -503,6 +516,19 @@ class Executor {
     time_point_records_.emplace_back(
         std::make_tuple(name, std::chrono::steady_clock::now()));
   }
+  // run func as the named stage of this case, see GtestInternal::spans_ms
+  template <typename Func>
+  inline void recordGtestSpan(const std::string &name, Func &&func) {
+    auto begin = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    eva_res_.gtest.spans_ms.emplace_back(std::make_tuple(
+        name,
+        std::chrono::duration<double, std::milli>(begin - time_point_init_)
+            .count(),
+        std::chrono::duration<double, std::milli>(end - time_point_init_)
+            .count()));
+  }
   // some ops might allocate device space inside compute
   virtual std::vector<size_t> getExtraDevSpaceCompute() {
     return std::vector<size_t>();
@@ -631,6 +657,7 @@ class Executor {
   void getGpuPerfInfo(PerfInfo *info);
   void getGtestInternalInfo();  // will access time_point_records_ and
                                 // time_point_init_
+  void launchImpl();  // launch() without the gtest time records
   void fillRam();
 
   std::shared_ptr<kernelTracingCtx> kernel_tracing_ctx;
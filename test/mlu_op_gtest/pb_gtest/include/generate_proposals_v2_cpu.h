@@ -0,0 +1,372 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_GENERATE_PROPOSALS_V2_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_GENERATE_PROPOSALS_V2_CPU_H_
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "nms_cpu_engine.h"
+
+namespace mluoptest {
+namespace generate_proposals_v2_cpu {
+
+// marks the consumed scores of the legacy selection.
+constexpr float kFloatMin = -FLT_MAX;
+
+template <typename T>
+bool isRealBox(const T xmin, const T ymin, const T xmax, const T ymax,
+               const T im_h, const T im_w, bool pixel_offset, const T min_size,
+               T *area) {
+  bool is_real_box = false;
+  float real_min_size = min_size > 1.0 ? min_size : 1.0;
+  T offset = pixel_offset ? static_cast<T>(1.0) : 0;
+  T w = xmax - xmin + offset;
+  T h = ymax - ymin + offset;
+
+  if (pixel_offset) {
+    T cx = xmin + w / 2.;
+    T cy = ymin + h / 2.;
+
+    if (w >= real_min_size && h >= real_min_size && cx <= im_w && cy <= im_h) {
+      is_real_box = true;
+    }
+  } else {
+    if (w >= real_min_size && h >= real_min_size) {
+      is_real_box = true;
+    }
+  }
+
+  if (is_real_box) {
+    *area = w * h;
+  }
+  return is_real_box;
+}
+
+// decodes anchor k with its deltas and clips it to the image, returns
+// false if the box is too small (or its center is out of the image).
+template <typename T>
+bool decodeProposalBox(const T *anchors_slice, const T *bbox_deltas_slice,
+                       const T *im_shape_slice, const T *variances_slice,
+                       const int k, const float min_size, bool pixel_offset,
+                       T *box, T *box_area) {
+
+  T axmin = anchors_slice[k * 4];
+  T aymin = anchors_slice[k * 4 + 1];
+  T axmax = anchors_slice[k * 4 + 2];
+  T aymax = anchors_slice[k * 4 + 3];
+
+  T offset = pixel_offset ? static_cast<T>(1.0) : 0;
+
+  T w = axmax - axmin + offset;
+  T h = aymax - aymin + offset;
+  T cx = axmin + 0.5 * w;
+  T cy = aymin + 0.5 * h;
+
+  T dxmin = bbox_deltas_slice[4 * k];
+  T dymin = bbox_deltas_slice[4 * k + 1];
+  T dxmax = bbox_deltas_slice[4 * k + 2];
+  T dymax = bbox_deltas_slice[4 * k + 3];
+
+  // kBBoxClipDefault = std::log(1000.0 / 16.0);
+  static const float kBBoxClipDefault = 4.135166556742356f;
+  T bbox_clip_default = static_cast<T>(kBBoxClipDefault);
+
+  T d_cx, d_cy, d_w, d_h;
+  if (variances_slice) {
+    d_cx = cx + dxmin * w * variances_slice[4 * k];
+    d_cy = cy + dymin * h * variances_slice[4 * k + 1];
+    d_w = std::exp(std::min(dxmax * variances_slice[4 * k + 2],
+                            bbox_clip_default)) *
+          w;
+    d_h = std::exp(std::min(dymax * variances_slice[4 * k + 3],
+                            bbox_clip_default)) *
+          h;
+
+  } else {
+    d_cx = cx + dxmin * w;
+    d_cy = cy + dymin * h;
+    d_w = std::exp(std::min(dxmax, bbox_clip_default)) * w;
+    d_h = std::exp(std::min(dymax, bbox_clip_default)) * h;
+  }
+
+  T oxmin = d_cx - d_w * 0.5;
+  T oymin = d_cy - d_h * 0.5;
+  T oxmax = d_cx + d_w * 0.5 - offset;
+  T oymax = d_cy + d_h * 0.5 - offset;
+
+  T p_xmin = std::max(std::min(oxmin, im_shape_slice[1] - offset), (T)0.);
+  T p_ymin = std::max(std::min(oymin, im_shape_slice[0] - offset), (T)0.);
+  T p_xmax = std::max(std::min(oxmax, im_shape_slice[1] - offset), (T)0.);
+  T p_ymax = std::max(std::min(oymax, im_shape_slice[0] - offset), (T)0.);
+
+  T area = 0;
+  bool isValidBox = isRealBox(p_xmin, p_ymin, p_xmax, p_ymax, im_shape_slice[0],
+                              im_shape_slice[1], pixel_offset, min_size, &area);
+  if (isValidBox) {
+    box[0] = p_xmin;
+    box[1] = p_ymin;
+    box[2] = p_xmax;
+    box[3] = p_ymax;
+    *box_area = area;
+  }
+  return isValidBox;
+}
+
+template <typename T>
+void creatAndFilterProposalsBox(T *anchors_slice, T *bbox_deltas_slice,
+                                T *im_shape_slice, T *variances_slice,
+                                T *out_scores, T *out_proposals, T *out_areas,
+                                const int A, const int H, const int W,
+                                const float min_size, const float max_score,
+                                const int max_score_id, bool pixel_offset,
+                                int *proposals_num) {
+  int proposals_count = *proposals_num;
+  if (decodeProposalBox(anchors_slice, bbox_deltas_slice, im_shape_slice,
+                        variances_slice, max_score_id, min_size, pixel_offset,
+                        out_proposals + proposals_count * 4,
+                        out_areas + proposals_count)) {
+    out_scores[proposals_count] = max_score;
+    *proposals_num = *proposals_num + 1;
+  }
+}
+
+template <typename T>
+void findMaxScore(T *h_scores_buf, int size, T *max_score, int *max_score_id) {
+  if (size == 0) {
+    return;
+  }
+  T max_score_local = h_scores_buf[0];
+  int max_score_id_local = 0;
+  for (int i = 1; i < size; ++i) {
+    if (h_scores_buf[i] > max_score_local) {
+      max_score_local = h_scores_buf[i];
+      max_score_id_local = i;
+    }
+  }
+  *max_score = max_score_local;
+  *max_score_id = max_score_id_local;
+  return;
+}
+
+template <typename T>
+T calcIoU(T *a, T *b, bool pixel_offset) {
+  float offset = pixel_offset ? static_cast<float>(1.0) : 0;
+  float left = std::max(a[0], b[0]), right = std::min(a[2], b[2]);
+  float top = std::max(a[1], b[1]), bottom = std::min(a[3], b[3]);
+  float width = std::max(right - left + offset, 0.f),
+        height = std::max(bottom - top + offset, 0.f);
+  float inter_s = width * height;
+  float s_a = (a[2] - a[0] + offset) * (a[3] - a[1] + offset);
+  float s_b = (b[2] - b[0] + offset) * (b[3] - b[1] + offset);
+  return inter_s / (s_a + s_b - inter_s);
+}
+
+// the proposals of one image, in output order.
+template <typename T>
+struct ImageProposals {
+  std::vector<T> rois;  // 4 per proposal
+  std::vector<T> probs;
+};
+
+// The k anchors the argmax loop of ProposalForOneImageLegacy picks, in its
+// order: by score, ties to the smaller index. Only holds while the loop
+// finds a score above kFloatMin every time and scores[0] is not nan, else
+// it picks consumed entries again; returns false then.
+template <typename T>
+bool topKScores(const T *scores, const int size, const int k,
+                std::vector<int> *ids) {
+  ids->clear();
+  if (size == 0 || std::isnan(scores[0])) {
+    return false;
+  }
+  for (int i = 0; i < size; ++i) {
+    if (scores[i] > kFloatMin) ids->push_back(i);
+  }
+  if (static_cast<int>(ids->size()) < k) {
+    return false;
+  }
+  auto before = [scores](int a, int b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+  };
+  if (k < static_cast<int>(ids->size())) {
+    std::nth_element(ids->begin(), ids->begin() + k, ids->end(), before);
+    ids->resize(k);
+  }
+  std::sort(ids->begin(), ids->end(), before);
+  return true;
+}
+
+template <typename T>
+void emptyProposal(ImageProposals<T> *out) {
+  out->rois.assign(4, 0);
+  out->probs.assign(1, 0);
+}
+
+// selects with findMaxScore over all scores for every proposal, and
+// suppresses against every box, for the inputs topKScores can not take.
+template <typename T>
+void ProposalForOneImageLegacy(T *scores_slice, T *bbox_deltas_slice,
+                               T *im_shape_slice, T *anchors_slice,
+                               T *variances_slice, int H, int W, int A,
+                               ImageProposals<T> *out, const int pre_nms_num,
+                               const int post_nms_top_n, const T nms_thresh,
+                               const T min_size, const bool pixel_offset) {
+  const int HWA = A * H * W;
+  int proposals_num = 0;
+
+  std::vector<T> out_scores(pre_nms_num), out_box(pre_nms_num * 4),
+      out_area(pre_nms_num);
+  T *out_scores_buf = out_scores.data();
+  T *out_box_buf = out_box.data();
+  T *out_area_buf = out_area.data();
+  std::vector<T> temp_scores(scores_slice, scores_slice + HWA);
+  // top k, creatbox, filter box
+  for (int top_id = 0; top_id < pre_nms_num; ++top_id) {
+    int max_score_id = top_id;
+    T max_score = scores_slice[max_score_id];
+
+    findMaxScore(temp_scores.data(), HWA, &max_score, &max_score_id);
+    temp_scores[max_score_id] = kFloatMin;
+
+    creatAndFilterProposalsBox<T>(
+        anchors_slice, bbox_deltas_slice, im_shape_slice, variances_slice,
+        out_scores_buf, out_box_buf, out_area_buf, A, H, W, min_size, max_score,
+        max_score_id, pixel_offset, &proposals_num);
+  }
+
+  if (proposals_num == 0) {
+    emptyProposal(out);
+    return;
+  }
+
+  int nms_num = std::min(proposals_num, post_nms_top_n);
+
+  for (int nms_id = 0; nms_id < nms_num; ++nms_id) {
+    // Find max score
+    float max_score = 0.0f;
+    int max_score_id = 0;
+    findMaxScore(out_scores_buf, proposals_num, &max_score, &max_score_id);
+    out_scores_buf[max_score_id] = kFloatMin;
+
+    if (max_score <= kFloatMin) {
+      break;
+    }
+    // save max score and box to output
+    out->rois.insert(out->rois.end(), out_box_buf + max_score_id * 4,
+                     out_box_buf + max_score_id * 4 + 4);
+    out->probs.push_back(max_score);
+
+    for (int inner_id = 0; inner_id < proposals_num; ++inner_id) {
+      if (inner_id == max_score_id) {
+        continue;
+      }
+
+      float *a = out_box_buf + max_score_id * 4;
+      float *b = out_box_buf + inner_id * 4;
+      float iou = calcIoU(a, b, pixel_offset);
+      if (iou > nms_thresh) {
+        out_scores_buf[inner_id] = kFloatMin;
+      }
+    }
+  }
+}
+
+template <typename T>
+void ProposalForOneImage(T *scores_slice, T *bbox_deltas_slice,
+                         T *im_shape_slice, T *anchors_slice,
+                         T *variances_slice, int H, int W, int A,
+                         ImageProposals<T> *out, const int pre_nms_top_n,
+                         const int post_nms_top_n, const T nms_thresh,
+                         const T min_size, const bool pixel_offset) {
+  const int HWA = A * H * W;
+  int pre_nms_num =
+      (pre_nms_top_n <= 0 || pre_nms_top_n > HWA) ? HWA : pre_nms_top_n;
+
+  std::vector<int> top_ids;
+  if (!topKScores(scores_slice, HWA, pre_nms_num, &top_ids)) {
+    ProposalForOneImageLegacy(scores_slice, bbox_deltas_slice, im_shape_slice,
+                              anchors_slice, variances_slice, H, W, A, out,
+                              pre_nms_num, post_nms_top_n, nms_thresh,
+                              min_size, pixel_offset);
+    return;
+  }
+
+  // decode the boxes of the top anchors, then keep the valid ones in
+  // score order.
+  std::vector<T> boxes(pre_nms_num * 4), areas(pre_nms_num);
+  std::vector<uint8_t> valid(pre_nms_num);
+#pragma omp parallel for schedule(static)
+  for (int r = 0; r < pre_nms_num; ++r) {
+    valid[r] = decodeProposalBox(anchors_slice, bbox_deltas_slice,
+                                 im_shape_slice, variances_slice, top_ids[r],
+                                 min_size, pixel_offset, &boxes[r * 4],
+                                 &areas[r]);
+  }
+  int proposals_num = 0;
+  for (int r = 0; r < pre_nms_num; ++r) {
+    if (!valid[r]) continue;
+    std::copy(&boxes[r * 4], &boxes[r * 4 + 4], &boxes[proposals_num * 4]);
+    top_ids[proposals_num++] = top_ids[r];
+  }
+
+  if (proposals_num == 0) {
+    emptyProposal(out);
+    return;
+  }
+
+  // the scores are in descending order already, so the argmax of the legacy
+  // nms is the first box left: plain greedy nms. pairs whose bounds (grown
+  // by the pixel offset) do not meet have no intersection, their iou can
+  // not pass a threshold >= 0 and are skipped.
+  int nms_num = std::min(proposals_num, post_nms_top_n);
+  if (nms_num <= 0) {
+    return;
+  }
+  const float offset = pixel_offset ? 1 : 0;
+  std::vector<int> order(proposals_num);
+  std::vector<nms_cpu::Bound> bounds(proposals_num);
+  for (int r = 0; r < proposals_num; ++r) {
+    order[r] = r;
+    const T *box = &boxes[r * 4];
+    bounds[r] = {box[0], box[1], box[2] + offset, box[3] + offset};
+  }
+  auto overlap = [&boxes, pixel_offset](int i, int j) {
+    return calcIoU(&boxes[i * 4], &boxes[j * 4], pixel_offset);
+  };
+  auto keep = nms_cpu::greedyNms(
+      order, proposals_num, overlap, nms_thresh,
+      nms_thresh >= 0 ? bounds.data() : nullptr, nms_num);
+  for (int r : keep) {
+    out->rois.insert(out->rois.end(), &boxes[r * 4], &boxes[r * 4 + 4]);
+    out->probs.push_back(scores_slice[top_ids[r]]);
+  }
+}
+}  // namespace generate_proposals_v2_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_GENERATE_PROPOSALS_V2_CPU_H_
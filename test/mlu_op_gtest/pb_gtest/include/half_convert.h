@@ -0,0 +1,131 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_HALF_CONVERT_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_HALF_CONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Host conversions between float and half/bfloat16 used to prepare and
+// round the data of the cases, without going through the runtime library.
+// Every array conversion has a scalar, an AVX2 (with F16C) and an AVX-512
+// implementation giving the same bits, the best one supported by the CPU is
+// picked at runtime. Large arrays are split across OpenMP threads.
+
+namespace mluoptest {
+
+enum class HalfRounding {
+  NEAREST_EVEN,  // IEEE default
+  NEAREST_AWAY,  // ties away from zero, cnrtRounding_rm
+};
+
+enum class ConvertIsa {
+  SCALAR = 0,
+  AVX2 = 1,  // AVX2 and F16C
+  AVX512 = 2,
+};
+
+// The best implementation supported by the CPU, detected once.
+ConvertIsa bestConvertIsa();
+
+// Exact, NaN payloads are kept (quieted) like the F16C instructions do.
+void convertHalfToFloat(float *dst, const uint16_t *src, size_t num,
+                        ConvertIsa isa = bestConvertIsa());
+
+// Values whose magnitude rounds past 65504 become infinity, NaN becomes
+// the quiet NaN 0x7e00 with the sign kept.
+void convertFloatToHalf(uint16_t *dst, const float *src, size_t num,
+                        HalfRounding rounding,
+                        ConvertIsa isa = bestConvertIsa());
+
+void convertBF16ToFloat(float *dst, const uint16_t *src, size_t num,
+                        ConvertIsa isa = bestConvertIsa());
+
+// Rounds to nearest even, NaN becomes 0x7fc0 (sign and payload dropped).
+void convertFloatToBF16(uint16_t *dst, const float *src, size_t num,
+                        ConvertIsa isa = bestConvertIsa());
+
+inline float halfToFloatScalar(uint16_t src) {
+  const uint32_t sign = (uint32_t)(src & 0x8000) << 16;
+  const uint32_t exp = (src >> 10) & 0x1f;
+  const uint32_t mant = src & 0x3ff;
+  uint32_t bits;
+  if (exp == 0x1f) {
+    // inf, or NaN with the quiet bit set.
+    bits = sign | 0x7f800000 | (mant << 13) | (mant ? 0x400000 : 0);
+  } else if (exp == 0) {
+    // zero and subnormals are mant * 2^-24, exact in float.
+    float value = (float)mant * 5.9604644775390625e-8f;
+    memcpy(&bits, &value, sizeof(bits));
+    bits |= sign;
+  } else {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+  float dst;
+  memcpy(&dst, &bits, sizeof(dst));
+  return dst;
+}
+
+inline uint16_t floatToHalfScalar(float src, HalfRounding rounding) {
+  uint32_t bits;
+  memcpy(&bits, &src, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t abs = bits & 0x7fffffff;
+  const bool away = rounding == HalfRounding::NEAREST_AWAY;
+  if (abs > 0x7f800000) return sign | 0x7e00;
+  // 65520 is halfway between 65504 and 65536, both modes round it up.
+  if (abs >= 0x477ff000) return sign | 0x7c00;
+  if (abs >= 0x38800000) {
+    // normal half, rebias the exponent from 127 to 15 and round 13 bits.
+    const uint32_t bias = away ? 0x1000 : 0xfff + ((abs >> 13) & 1);
+    return sign | ((abs - 0x38000000 + bias) >> 13);
+  }
+  // subnormal half, the value is mant * 2^(exp - 126) in units of 2^-24.
+  const uint32_t exp = abs >> 23;
+  if (exp < 102) return sign;
+  const uint32_t mant = (abs & 0x7fffff) | 0x800000;
+  const uint32_t shift = 126 - exp;
+  const uint32_t half_ulp = 1u << (shift - 1);
+  const uint32_t bias = away ? half_ulp : half_ulp - 1 + ((mant >> shift) & 1);
+  return sign | ((mant + bias) >> shift);
+}
+
+inline float bf16ToFloatScalar(uint16_t src) {
+  const uint32_t bits = (uint32_t)src << 16;
+  float dst;
+  memcpy(&dst, &bits, sizeof(dst));
+  return dst;
+}
+
+inline uint16_t floatToBF16Scalar(float src) {
+  uint32_t bits;
+  memcpy(&bits, &src, sizeof(bits));
+  if ((bits & 0x7fffffff) > 0x7f800000) return 0x7fc0;
+  const uint32_t bias = ((bits >> 16) & 1) + 0x7fff;
+  return static_cast<uint16_t>((bits + bias) >> 16);
+}
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_HALF_CONVERT_H_
@@ -24,15 +24,23 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 namespace mluoptest {
 
 using TimePoint_t = std::tuple<std::string, double>;
 using TimeSeries_t = std::vector<TimePoint_t>;
+// <name>, <begin>, <end> of a named stage, spans of the same name add up.
+using TimeSpan_t = std::tuple<std::string, double, double>;
+using TimeSpans_t = std::vector<TimeSpan_t>;
 
 /**
  * convert `TimeSeries_t` value into '[ [<key1>, <val1>], [<key2>, <val2>], ...
@@ -41,42 +49,109 @@ using TimeSeries_t = std::vector<TimePoint_t>;
 std::string timeseries_to_array_str(const TimeSeries_t&);
 
 struct GtestInternal {
+  std::string op_name;
+  // index in the case list of the op, cases are reported in this order
+  size_t case_index = SIZE_MAX;
   size_t parsed_file_size = 0;
   double parsed_cost_seconds = 0.;
+  // VmHWM when the case is recorded. with --thread > 1 it is the peak of the
+  // whole process, cases running at the same time are not told apart.
+  size_t peak_rss_bytes = 0;
   TimeSeries_t time_costs_ms;  // cumulative time on different time point
+  TimeSpans_t spans_ms;  // parse, host_malloc, random_init, cast_in, ...
 };
 
 struct GtestInternalMsg {
   std::string serialize_to_csv(std::string sep = "|") const;
   std::string get_csv_header(std::string sep = "|") const;
+  // one json object, with the spans summed by name
+  std::string serialize_to_json() const;
 
   GtestInternal gtest_internal_;
   TimeSeries_t timespan_record_;
   std::string case_path_;
+  size_t record_seq_ = 0;  // order of record_case(), breaks case_index ties
 };
 
 class TestInternalInfo {
  public:
   /**
-   * save gtest internal perf info
+   * save gtest internal perf info. cases go to a buffer of the calling
+   * thread, so that worker threads do not wait for each other or for the
+   * reader, the buffers are merged when read.
    */
   void record_case(const std::string& case_path,
                    const GtestInternal& gtest_internal);
 
+  /**
+   * invoke f on the cases recorded since clear_cases(), ordered by
+   * case_index. f runs on a copy, without holding any lock.
+   */
   template <typename Functor>
   void iterate_invoke(Functor f) {
-    cases_info_mutex.lock();
-    std::for_each(cases_info_.begin(), cases_info_.end(), f);
-    cases_info_mutex.unlock();
+    std::vector<GtestInternalMsg> cases;
+    {
+      std::lock_guard<std::mutex> lk(cases_info_mutex);
+      collect();
+      cases = cases_info_;
+    }
+    std::for_each(cases.begin(), cases.end(), f);
   }
 
-  void clear_cases() { cases_info_.clear(); }
+  void clear_cases() {
+    std::lock_guard<std::mutex> lk(cases_info_mutex);
+    collect();
+    cases_info_.clear();
+  }
+
+  /**
+   * wall time history of cases, kept across clear_cases(). one
+   * '<case_path>|<seconds>' per line, recorded cases overwrite loaded ones.
+   */
+  bool load_case_costs(const std::string& file);
+  bool save_case_costs(const std::string& file);
+  bool case_wall_seconds(const std::string& case_path, double* seconds);
+
+  struct StageSummary {
+    size_t count = 0;
+    double p50 = 0.;
+    double p95 = 0.;
+    double max = 0.;
+    double total = 0.;
+  };
+  // op -> stage -> ms of the cases recorded since clear_summary(). the
+  // stage "wall" is the whole case, "peak_rss_mb" is not in ms.
+  using Summary_t = std::map<std::string, std::map<std::string, StageSummary>>;
+  Summary_t summarize();
+  void clear_summary();
+  static std::string summary_to_json(const Summary_t&);
+  static std::string summary_to_table(const Summary_t&);
 
  private:
+  struct ThreadBuffer {
+    std::mutex mutex;  // only taken by its thread and collect()
+    std::vector<GtestInternalMsg> cases;
+  };
+  ThreadBuffer* thread_buffer();
+  // move the buffered cases into cases_info_, needs cases_info_mutex.
+  void collect();
+
   // compute timespan based on cumulative time
   static TimeSeries_t evaluate_timespan(const TimeSeries_t&);
   std::vector<GtestInternalMsg> cases_info_;
   std::mutex cases_info_mutex;
+  std::mutex buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  std::atomic<size_t> record_seq_{0};
+  std::shared_ptr<char> alive_ = std::make_shared<char>();
+  // case path -> <record_seq_ + 1 of the latest record, 0 if loaded, seconds>
+  std::unordered_map<std::string, std::pair<size_t, double>>
+      case_wall_seconds_;
+  std::map<std::string, std::map<std::string, std::vector<double>>>
+      stage_samples_;
 };
 
+// total time of the spans of each name, in order of first appearance
+TimeSeries_t span_durations(const TimeSpans_t&);
+
 }  // namespace mluoptest  // NOLINT
\ No newline at end of file
@@ -0,0 +1,254 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_MUTUAL_INFORMATION_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_MUTUAL_INFORMATION_CPU_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace mluoptest {
+namespace mutual_information_cpu {
+
+// Same as MIN_LOG_DIFF_FLOAT of the forward kernel.
+constexpr float kMinLogDiff = -15.9423847198486328125f;
+// p below this is clamped before the backward terms are computed.
+constexpr float kLargeNeg = -1.0e+30f;
+// Lattices whose shorter side is below this are computed row by row.
+constexpr int kParallelDiagonal = 256;
+
+// The lattice of one batch: px is [S, T + 1], py is [S + 1, T] and p is
+// [S + 1, T + 1], all row-major. Only the [s_begin, s_end] x
+// [t_begin, t_end] box of p is computed.
+struct Lattice {
+  int S, T;
+  int s_begin, s_end, t_begin, t_end;
+
+  int64_t px(int s, int t) const { return int64_t(s) * (T + 1) + t; }
+  int64_t py(int s, int t) const { return int64_t(s) * T + t; }
+  int64_t p(int s, int t) const { return int64_t(s) * (T + 1) + t; }
+};
+
+// log(exp(x) + exp(y)), adding its operations to *ops.
+inline float logAdd(float x, float y, int64_t *ops) {
+  float diff;
+  if (x < y) {
+    diff = x - y;
+    x = y;
+    *ops += 2;
+  } else {
+    diff = y - x;
+    *ops += 1;
+  }
+  if (diff >= kMinLogDiff) {
+    *ops += 4;
+    return x + log1pf(expf(diff));
+  }
+  return x;
+}
+
+// exp(x), or 0 when x or the result is not finite.
+inline float safeExp(float x, int64_t *ops) {
+  if (x - x != 0) {
+    *ops += 2;
+    return 0;
+  }
+  float ans = std::exp(x);
+  *ops += 5;
+  if (ans - ans != 0.0) return 0;
+  return ans;
+}
+
+// Calls edge(s, t) for the first row and column of the box (the last ones
+// with reverse) and interior(s, t) for the rest, each cell after both of
+// its neighbours towards the start (or the end) of the box, and returns
+// the sum of what they return. The cells of an anti-diagonal only depend
+// on the previous one, so when there are threads to spare (the caller is
+// not already parallel over the batch) and the shorter side of the box
+// reaches parallel_diagonal, the box is swept an anti-diagonal at a time
+// with each diagonal shared out between the threads. Otherwise it is
+// swept row by row, which is several times cheaper on one thread. A
+// parallel_diagonal of 0 always takes the diagonals. Both orders compute
+// every cell the same way.
+template <bool reverse, typename Edge, typename Interior>
+inline int64_t wavefront(const Lattice &l, int parallel_diagonal, Edge edge,
+                         Interior interior) {
+  const int ns = l.s_end - l.s_begin, nt = l.t_end - l.t_begin;
+  int threads = 1;
+#ifdef _OPENMP
+  if (!omp_in_parallel()) threads = omp_get_max_threads();
+#endif
+  const bool diagonals =
+      parallel_diagonal == 0 ||
+      (threads > 1 && std::min(ns, nt) + 1 >= parallel_diagonal);
+  // (i, j) are the distances of a cell from the corner the sweep starts at
+  const int s0 = reverse ? l.s_end : l.s_begin;
+  const int t0 = reverse ? l.t_end : l.t_begin;
+  constexpr int step = reverse ? -1 : 1;
+  int64_t ops = 0;
+  if (!diagonals) {
+    for (int j = 0; j <= nt; ++j) ops += edge(s0, t0 + step * j);
+    for (int i = 1; i <= ns; ++i) {
+      const int s = s0 + step * i;
+      ops += edge(s, t0);
+      for (int j = 1; j <= nt; ++j) ops += interior(s, t0 + step * j);
+    }
+    return ops;
+  }
+  for (int d = 0; d <= ns + nt; ++d) {
+    const int lo = std::max(0, d - nt), hi = std::min(ns, d);
+#pragma omp parallel for schedule(static) reduction(+ : ops)
+    for (int i = lo; i <= hi; ++i) {
+      const int s = s0 + step * i, t = t0 + step * (d - i);
+      ops += (i == 0 || i == d) ? edge(s, t) : interior(s, t);
+    }
+  }
+  return ops;
+}
+
+// The forward recursion
+//   p[s][t] = logAdd(p[s - 1][t] + px[s - 1][t], p[s][t - 1] + py[s][t - 1])
+// from p[s_begin][t_begin] = 0. Writes the box of p and returns the
+// operation count; the answer is p[s_end][t_end].
+inline int64_t forward(const Lattice &l, const float *px, const float *py,
+                       float *p, int parallel_diagonal = kParallelDiagonal) {
+  auto edge = [&](int s, int t) -> int64_t {
+    int64_t ops = 1;
+    if (s == l.s_begin && t == l.t_begin) {
+      p[l.p(s, t)] = 0;
+    } else if (t == l.t_begin) {
+      p[l.p(s, t)] =
+          logAdd(p[l.p(s - 1, t)] + px[l.px(s - 1, t)], -INFINITY, &ops);
+    } else {
+      p[l.p(s, t)] =
+          logAdd(-INFINITY, p[l.p(s, t - 1)] + py[l.py(s, t - 1)], &ops);
+    }
+    return ops;
+  };
+  auto interior = [&](int s, int t) -> int64_t {
+    int64_t ops = 2;
+    p[l.p(s, t)] = logAdd(p[l.p(s - 1, t)] + px[l.px(s - 1, t)],
+                          p[l.p(s, t - 1)] + py[l.py(s, t - 1)], &ops);
+    return ops;
+  };
+  return wavefront<false>(l, parallel_diagonal, edge, interior);
+}
+
+// Clamps p and turns px and py into the backward terms in place:
+//   term1 = exp(p[s][t] + px[s][t] - p[s + 1][t])
+//   term2 = exp(p[s][t] + py[s][t] - p[s][t + 1])
+inline int64_t terms(const Lattice &l, float *px, float *py, float *p) {
+  int64_t ops = 0;
+#pragma omp parallel for schedule(static) reduction(+ : ops)
+  for (int s = l.s_begin; s <= l.s_end; ++s) {
+    for (int t = l.t_begin; t <= l.t_end; ++t) {
+      ops++;
+      if (p[l.p(s, t)] < kLargeNeg) {
+        p[l.p(s, t)] = kLargeNeg;
+        ops++;
+      }
+    }
+  }
+#pragma omp parallel for schedule(static) reduction(+ : ops)
+  for (int s = l.s_begin; s <= l.s_end; ++s) {
+    for (int t = l.t_begin; t <= l.t_end; ++t) {
+      if (s < l.s_end) {
+        px[l.px(s, t)] = safeExp(
+            p[l.p(s, t)] + px[l.px(s, t)] - p[l.p(s + 1, t)], &ops);
+        ops += 2;
+      }
+      if (t < l.t_end) {
+        py[l.py(s, t)] = safeExp(
+            p[l.p(s, t)] + py[l.py(s, t)] - p[l.p(s, t + 1)], &ops);
+        ops += 2;
+      }
+    }
+  }
+  return ops;
+}
+
+// The backward recursion
+//   g[s][t] = term1[s][t] * g[s + 1][t] + term2[s][t] * g[s][t + 1]
+// from g[s_end][t_end] = ans_grad, written over p.
+inline int64_t pGrad(const Lattice &l, const float *term1, const float *term2,
+                     float ans_grad, float *p,
+                     int parallel_diagonal = kParallelDiagonal) {
+  auto edge = [&](int s, int t) -> int64_t {
+    if (s == l.s_end && t == l.t_end) {
+      p[l.p(s, t)] = ans_grad;
+    } else if (s == l.s_end) {
+      p[l.p(s, t)] = term2[l.py(s, t)] * p[l.p(s, t + 1)];
+    } else {
+      p[l.p(s, t)] = term1[l.px(s, t)] * p[l.p(s + 1, t)];
+    }
+    return 1;
+  };
+  auto interior = [&](int s, int t) -> int64_t {
+    p[l.p(s, t)] = term1[l.px(s, t)] * p[l.p(s + 1, t)] +
+                   term2[l.py(s, t)] * p[l.p(s, t + 1)];
+    return 3;
+  };
+  return wavefront<true>(l, parallel_diagonal, edge, interior);
+}
+
+// px_grad = g[s + 1][t] * term1 and py_grad = g[s][t + 1] * term2 inside
+// the box, zero in the corners outside of it.
+inline int64_t pxPyGrad(const Lattice &l, const float *term1,
+                        const float *term2, const float *p_grad,
+                        float *px_grad, float *py_grad) {
+#pragma omp parallel for schedule(static)
+  for (int s = l.s_begin; s <= l.s_end; ++s) {
+    for (int t = l.t_begin; t <= l.t_end; ++t) {
+      if (s < l.s_end) {
+        px_grad[l.px(s, t)] = p_grad[l.p(s + 1, t)] * term1[l.px(s, t)];
+      }
+      if (t < l.t_end) {
+        py_grad[l.py(s, t)] = p_grad[l.p(s, t + 1)] * term2[l.py(s, t)];
+      }
+    }
+  }
+#pragma omp parallel for schedule(static)
+  for (int s = 0; s <= l.S; ++s) {
+    for (int t = 0; t <= l.T; ++t) {
+      if (s < l.S && (s < l.s_begin || s >= l.s_end) &&
+          (t < l.t_begin || t > l.t_end)) {
+        px_grad[l.px(s, t)] = 0;
+      }
+      if (t < l.T && (s < l.s_begin || s > l.s_end) &&
+          (t < l.t_begin || t >= l.t_end)) {
+        py_grad[l.py(s, t)] = 0;
+      }
+    }
+  }
+  return int64_t(l.S) * (l.T + 1) + int64_t(l.S + 1) * l.T;
+}
+
+}  // namespace mutual_information_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_MUTUAL_INFORMATION_CPU_H_
@@ -0,0 +1,256 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_NMS_CPU_ENGINE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_NMS_CPU_ENGINE_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace mluoptest {
+namespace nms_cpu {
+
+// Axis-aligned bound of a box, used only to skip pairs that can not overlap.
+struct Bound {
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+};
+
+inline bool isFiniteBound(const Bound &b) {
+  return std::isfinite(b.x1) && std::isfinite(b.y1) && std::isfinite(b.x2) &&
+         std::isfinite(b.y2) && b.x1 <= b.x2 && b.y1 <= b.y2;
+}
+
+inline bool boundsOverlap(const Bound &a, const Bound &b) {
+  return !(a.x2 < b.x1 || b.x2 < a.x1 || a.y2 < b.y1 || b.y2 < a.y1);
+}
+
+// Uniform grid over the bounds of the candidate boxes. Boxes covering too
+// many cells and boxes without a finite bound are kept in a separate list
+// which is visited by every query.
+class BoxGrid {
+ public:
+  void build(const std::vector<int> &ids, const Bound *bounds) {
+    cells_.clear();
+    wide_.clear();
+    std::vector<int> gridded;
+    gridded.reserve(ids.size());
+    double extent = 0.0;
+    bool first = true;
+    for (int id : ids) {
+      const Bound &b = bounds[id];
+      if (!isFiniteBound(b)) {
+        wide_.push_back(id);
+        continue;
+      }
+      if (first) {
+        x0_ = b.x1, y0_ = b.y1, x_end_ = b.x2, y_end_ = b.y2;
+        first = false;
+      } else {
+        x0_ = std::min(x0_, b.x1), y0_ = std::min(y0_, b.y1);
+        x_end_ = std::max(x_end_, b.x2), y_end_ = std::max(y_end_, b.y2);
+      }
+      extent += std::max(b.x2 - b.x1, b.y2 - b.y1);
+      gridded.push_back(id);
+    }
+    if (gridded.empty()) {
+      nx_ = ny_ = 0;
+      return;
+    }
+
+    // cell size follows the mean box extent, the cell count is capped so
+    // that sparse inputs do not allocate a huge grid.
+    const double mean_extent = extent / gridded.size();
+    const double span_x = std::max<double>(x_end_ - x0_, 1e-6);
+    const double span_y = std::max<double>(y_end_ - y0_, 1e-6);
+    double cell = std::max(mean_extent, 1e-6);
+    const double max_cells = 4.0 * gridded.size() + 16;
+    while ((span_x / cell + 1) * (span_y / cell + 1) > max_cells) {
+      cell *= 2;
+    }
+    inv_cell_ = 1.0 / cell;
+    nx_ = static_cast<int>(span_x * inv_cell_) + 1;
+    ny_ = static_cast<int>(span_y * inv_cell_) + 1;
+
+    // counting sort of the ids into cells, ids keep their input order.
+    std::vector<int> count(nx_ * ny_ + 1, 0);
+    for (int id : gridded) {
+      int cx0, cy0, cx1, cy1;
+      cellRange(bounds[id], &cx0, &cy0, &cx1, &cy1);
+      if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > kMaxCellsPerBox) {
+        wide_.push_back(id);
+        continue;
+      }
+      for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+          count[cy * nx_ + cx + 1]++;
+        }
+      }
+    }
+    for (size_t i = 1; i < count.size(); ++i) {
+      count[i] += count[i - 1];
+    }
+    start_ = count;
+    cells_.resize(count.back());
+    for (int id : gridded) {
+      int cx0, cy0, cx1, cy1;
+      cellRange(bounds[id], &cx0, &cy0, &cx1, &cy1);
+      if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > kMaxCellsPerBox) {
+        continue;
+      }
+      for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+          cells_[count[cy * nx_ + cx]++] = id;
+        }
+      }
+    }
+  }
+
+  // Calls func(id) for every box which may overlap the query bound. An id
+  // can be reported more than once when it spans several cells.
+  template <typename Func>
+  void query(const Bound &q, Func &&func) const {
+    for (int id : wide_) func(id);
+    if (nx_ == 0) return;
+    if (!isFiniteBound(q)) {
+      for (int id : cells_) func(id);
+      return;
+    }
+    if (q.x2 < x0_ || q.y2 < y0_ || q.x1 > x_end_ || q.y1 > y_end_) return;
+    int cx0, cy0, cx1, cy1;
+    cellRange(q, &cx0, &cy0, &cx1, &cy1);
+    for (int cy = cy0; cy <= cy1; ++cy) {
+      for (int cx = cx0; cx <= cx1; ++cx) {
+        const int cell = cy * nx_ + cx;
+        for (int k = start_[cell]; k < start_[cell + 1]; ++k) {
+          func(cells_[k]);
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr int kMaxCellsPerBox = 64;
+
+  int clampCell(double v, int n) const {
+    if (!(v > 0)) return 0;
+    if (v >= n - 1) return n - 1;
+    return static_cast<int>(v);
+  }
+
+  void cellRange(const Bound &b, int *cx0, int *cy0, int *cx1,
+                 int *cy1) const {
+    *cx0 = clampCell((b.x1 - x0_) * inv_cell_, nx_);
+    *cy0 = clampCell((b.y1 - y0_) * inv_cell_, ny_);
+    *cx1 = clampCell((b.x2 - x0_) * inv_cell_, nx_);
+    *cy1 = clampCell((b.y2 - y0_) * inv_cell_, ny_);
+  }
+
+  float x0_ = 0, y0_ = 0, x_end_ = 0, y_end_ = 0;
+  double inv_cell_ = 1.0;
+  int nx_ = 0, ny_ = 0;
+  std::vector<int> start_;
+  std::vector<int> cells_;
+  std::vector<int> wide_;
+};
+
+// Greedy hard NMS over `order`, which lists box ids from the highest to the
+// lowest priority. overlap(i, j) returns the overlap of the kept box i with
+// the candidate j, and j is suppressed when it is greater than iou_threshold.
+//
+// When `bounds` is not null the caller guarantees overlap(i, j) can not
+// exceed iou_threshold for boxes whose bounds do not intersect; those pairs
+// are skipped through a uniform grid. Otherwise every remaining candidate is
+// tested, in parallel when there are many of them. Either way the kept ids
+// are exactly the ones of the plain O(n^2) greedy loop.
+//
+// Returns the kept ids in the order they were selected, at most max_keep of
+// them when max_keep >= 0.
+template <typename Overlap>
+std::vector<int> greedyNms(const std::vector<int> &order, int num_boxes,
+                           Overlap &&overlap, float iou_threshold,
+                           const Bound *bounds, int max_keep = -1) {
+  std::vector<int> keep;
+  const int num = static_cast<int>(order.size());
+  if (num == 0 || max_keep == 0) return keep;
+  std::vector<uint8_t> suppressed(num_boxes, 0);
+
+  if (bounds != nullptr) {
+    std::vector<int> rank(num_boxes, -1);
+    for (int r = 0; r < num; ++r) rank[order[r]] = r;
+    BoxGrid grid;
+    grid.build(order, bounds);
+    std::vector<int> visited(num_boxes, -1);
+    for (int r = 0; r < num; ++r) {
+      const int i = order[r];
+      if (suppressed[i]) continue;
+      keep.push_back(i);
+      if (max_keep >= 0 && static_cast<int>(keep.size()) >= max_keep) break;
+      grid.query(bounds[i], [&](int j) {
+        if (rank[j] <= r || suppressed[j] || visited[j] == r) return;
+        visited[j] = r;
+        if (isFiniteBound(bounds[i]) && isFiniteBound(bounds[j]) &&
+            !boundsOverlap(bounds[i], bounds[j])) {
+          return;
+        }
+        if (overlap(i, j) > iou_threshold) suppressed[j] = 1;
+      });
+    }
+    return keep;
+  }
+
+  std::vector<int> pending;
+  pending.reserve(num);
+  for (int r = 0; r < num; ++r) {
+    const int i = order[r];
+    if (suppressed[i]) continue;
+    keep.push_back(i);
+    if (max_keep >= 0 && static_cast<int>(keep.size()) >= max_keep) break;
+    pending.clear();
+    for (int s = r + 1; s < num; ++s) {
+      if (!suppressed[order[s]]) pending.push_back(order[s]);
+    }
+    const int pending_num = static_cast<int>(pending.size());
+#pragma omp parallel for schedule(static) if (pending_num > 256)
+    for (int k = 0; k < pending_num; ++k) {
+      const int j = pending[k];
+      if (overlap(i, j) > iou_threshold) suppressed[j] = 1;
+    }
+  }
+  return keep;
+}
+
+// Sort ids by descending score, ties keep the smaller id first. This is the
+// selection order of an argmax loop which takes the first maximum.
+inline void sortByScoreStable(const float *scores, std::vector<int> *ids) {
+  std::stable_sort(ids->begin(), ids->end(),
+                   [scores](int a, int b) { return scores[a] > scores[b]; });
+}
+
+}  // namespace nms_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_NMS_CPU_ENGINE_H_
@@ -0,0 +1,183 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_PHILOX_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_PHILOX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host Philox4x32-10 with the constants and counter layout of
+// kernels/utils/philox_generator.h. The key is the 64-bit seed and the
+// counter is (offset low, offset high, subsequence low, subsequence high):
+// the device only uses subsequences below 2^32, so c3 is 0 there. Every
+// block of four words can be computed on its own, so skipping is O(1).
+//
+// The batch functions have a scalar and an AVX2 implementation giving the
+// same bits, the AVX2 one is used when the CPU supports it and use_simd is
+// true.
+
+namespace mluoptest {
+
+const uint32_t kPhiloxM4xA = 0xD2511F53;
+const uint32_t kPhiloxM4xB = 0xCD9E8D57;
+const uint32_t kPhiloxW32A = 0x9E3779B9;
+const uint32_t kPhiloxW32B = 0xBB67AE85;
+const int kPhiloxRounds = 10;
+
+inline void philox4x32(uint32_t ctr[4], uint32_t key0, uint32_t key1) {
+  for (int round = 0; round < kPhiloxRounds; ++round) {
+    const uint64_t p0 = static_cast<uint64_t>(kPhiloxM4xA) * ctr[0];
+    const uint64_t p1 = static_cast<uint64_t>(kPhiloxM4xB) * ctr[2];
+    ctr[0] = static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key0;
+    ctr[1] = static_cast<uint32_t>(p1);
+    ctr[2] = static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key1;
+    ctr[3] = static_cast<uint32_t>(p0);
+    key0 += kPhiloxW32A;
+    key1 += kPhiloxW32B;
+  }
+}
+
+// The four words of block `offset` in subsequence 0 of stream `seed`.
+inline void philoxBlock(uint64_t seed, uint64_t offset, uint32_t out[4]) {
+  out[0] = static_cast<uint32_t>(offset);
+  out[1] = static_cast<uint32_t>(offset >> 32);
+  out[2] = 0;
+  out[3] = 0;
+  philox4x32(out, static_cast<uint32_t>(seed),
+             static_cast<uint32_t>(seed >> 32));
+}
+
+// Blocks [offset, offset + kPhiloxLanes) of subsequence 0, word k of block
+// offset + j in out[k][j]. The lanes are independent so the rounds vectorize.
+const int kPhiloxLanes = 8;
+
+inline void philoxBlocks(uint64_t seed, uint64_t offset,
+                         uint32_t out[4][kPhiloxLanes]) {
+  uint32_t key0 = static_cast<uint32_t>(seed);
+  uint32_t key1 = static_cast<uint32_t>(seed >> 32);
+  uint32_t *c0 = out[0], *c1 = out[1], *c2 = out[2], *c3 = out[3];
+  for (int j = 0; j < kPhiloxLanes; ++j) {
+    c0[j] = static_cast<uint32_t>(offset + j);
+    c1[j] = static_cast<uint32_t>((offset + j) >> 32);
+    c2[j] = 0;
+    c3[j] = 0;
+  }
+  for (int round = 0; round < kPhiloxRounds; ++round) {
+    for (int j = 0; j < kPhiloxLanes; ++j) {
+      const uint64_t p0 = static_cast<uint64_t>(kPhiloxM4xA) * c0[j];
+      const uint64_t p1 = static_cast<uint64_t>(kPhiloxM4xB) * c2[j];
+      c0[j] = static_cast<uint32_t>(p1 >> 32) ^ c1[j] ^ key0;
+      c1[j] = static_cast<uint32_t>(p1);
+      c2[j] = static_cast<uint32_t>(p0 >> 32) ^ c3[j] ^ key1;
+      c3[j] = static_cast<uint32_t>(p0);
+    }
+    key0 += kPhiloxW32A;
+    key1 += kPhiloxW32B;
+  }
+}
+
+// [0, 1) from the top 24 bits of a word, exact in float.
+inline float philoxUnitFloat(uint32_t word) {
+  return (word >> 8) * (1.0f / 16777216.0f);
+}
+
+// [0, 1) from 53 bits of two words, exact in double.
+inline double philoxUnitDouble(uint32_t hi, uint32_t lo) {
+  const uint64_t bits = (static_cast<uint64_t>(hi) << 21) | (lo >> 11);
+  return bits * (1.0 / 9007199254740992.0);
+}
+
+// Words of `blocks` consecutive blocks, word k of block j in dst[4 * j + k].
+// Block j has offset `offset + j`, or subsequence `subsequence + j` if
+// step_subsequence is set.
+void philoxGenerate(uint32_t *dst, size_t blocks, uint64_t seed,
+                    uint64_t offset, uint64_t subsequence,
+                    bool step_subsequence, bool use_simd = true);
+
+// [min, max) like the float branch of cvtUniform() on device:
+// (word & 0x7fffff) * 2^-23 * (max - min) + min, with a fused multiply-add.
+void philoxWordsToUniform(float *dst, const uint32_t *words, size_t num,
+                          float min, float max, bool use_simd = true);
+
+// Box-Muller over pairs of words, dst[2i] and dst[2i + 1] are the cos and
+// sin values of words 2i and 2i + 1. num is even. log and sincos are
+// polynomials so that the scalar and SIMD results are the same.
+void philoxWordsToNormal(float *dst, const uint32_t *words, size_t num,
+                         float mean, float stddev, bool use_simd = true);
+
+// A stream of (seed, subsequence) starting at block `offset`.
+class PhiloxEngine {
+ public:
+  explicit PhiloxEngine(uint64_t seed, uint64_t subsequence = 0,
+                        uint64_t offset = 0)
+      : seed_(seed), subsequence_(subsequence), offset_(offset) {}
+
+  // The words of the next (num + 3) / 4 blocks, the words of the last block
+  // past num are dropped.
+  void generate(uint32_t *dst, size_t num, bool use_simd = true);
+  void uniform(float *dst, size_t num, float min, float max,
+               bool use_simd = true);
+  // One pair of words per two values, num is even.
+  void normal(float *dst, size_t num, float mean, float stddev,
+              bool use_simd = true);
+
+  void skip(uint64_t blocks) { offset_ += blocks; }
+  uint64_t offset() const { return offset_; }
+  uint64_t subsequence() const { return subsequence_; }
+
+ private:
+  uint64_t seed_;
+  uint64_t subsequence_;
+  uint64_t offset_;
+};
+
+// The state genUniform() keeps on one core. Each call of gen_random_u32()
+// makes 128 blocks at subsequences thread_begin + thread_acc + [0, 128) and
+// moves to the next offset once the thread_cur_core threads of the core
+// are visited. thread_cur_core is a multiple of 128.
+struct PhiloxDeviceState {
+  uint32_t key0;
+  uint32_t key1;
+  uint64_t offset;
+  int32_t thread_begin;
+  int32_t thread_acc;
+  int32_t thread_cur_core;
+
+  // The state after `calls` calls of gen_random_u32(), in O(1).
+  void skip(uint64_t calls);
+};
+
+const size_t kPhiloxDeviceCallNum = 512;
+
+// The uint32 words genUniform() writes before cvtUniform(), num is a
+// multiple of kPhiloxDeviceCallNum.
+void philoxDeviceGenerate(PhiloxDeviceState *state, uint32_t *dst,
+                          size_t num, bool use_simd = true);
+
+// genUniform<float, float>() with is_int false.
+void philoxDeviceUniform(PhiloxDeviceState *state, float *dst, size_t num,
+                         float min, float max, bool use_simd = true);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_PHILOX_H_
@@ -0,0 +1,294 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_POINT_CLOUD_INDEX_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_POINT_CLOUD_INDEX_H_
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "nms_cpu_engine.h"
+
+namespace mluoptest {
+namespace point_cloud {
+
+// squared distance as the baselines compute it, in float.
+inline float distance2(float ax, float ay, float az, float bx, float by,
+                       float bz) {
+  const float dx = ax - bx, dy = ay - by, dz = az - bz;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+inline bool isFinitePoint(const float *p) {
+  return std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]);
+}
+
+// Uniform voxel grid over one cloud of interleaved x, y, z points. The
+// points are kept sorted by cell as x, y, z arrays, and in index order
+// inside a cell.
+//
+// Points with a non-finite coordinate are left out: their distance to any
+// query is inf or nan, which no baseline ever selects.
+class PointGrid {
+ public:
+  void build(const float *xyz, int n) {
+    std::vector<int> ids;
+    ids.reserve(n);
+    for (int i = 0; i < n; ++i) {
+      const float *p = xyz + 3 * i;
+      if (!isFinitePoint(p)) continue;
+      if (ids.empty()) {
+        std::copy(p, p + 3, lo_);
+        std::copy(p, p + 3, hi_);
+      }
+      for (int a = 0; a < 3; ++a) {
+        lo_[a] = std::min<double>(lo_[a], p[a]);
+        hi_[a] = std::max<double>(hi_[a], p[a]);
+      }
+      ids.push_back(i);
+    }
+    num_ = static_cast<int>(ids.size());
+    if (num_ == 0) {
+      dims_[0] = dims_[1] = dims_[2] = 0;
+      start_.clear();
+      return;
+    }
+
+    // about kPointsPerCell points per cell for a uniform cloud, the cell
+    // count is capped so that flat or sparse clouds do not allocate a huge
+    // grid.
+    double span[3];
+    for (int a = 0; a < 3; ++a) span[a] = std::max(hi_[a] - lo_[a], 1e-6);
+    double cell = std::cbrt(span[0] * span[1] * span[2] * kPointsPerCell /
+                            num_);
+    cell = std::max(cell, std::max({span[0], span[1], span[2]}) / 1024);
+    const double max_cells = 2.0 * num_ + 8;
+    auto count_cells = [&span](double c) {
+      return (span[0] / c + 1) * (span[1] / c + 1) * (span[2] / c + 1);
+    };
+    while (count_cells(cell) > max_cells) cell *= 2;
+    cell_ = cell;
+    inv_cell_ = 1.0 / cell;
+    for (int a = 0; a < 3; ++a) {
+      dims_[a] = static_cast<int>(span[a] * inv_cell_) + 1;
+    }
+
+    // counting sort of the points into cells.
+    const int cells = dims_[0] * dims_[1] * dims_[2];
+    std::vector<int> cell_of(num_);
+    start_.assign(cells + 1, 0);
+    for (int k = 0; k < num_; ++k) {
+      cell_of[k] = cellIndex(xyz + 3 * ids[k]);
+      start_[cell_of[k] + 1]++;
+    }
+    for (int c = 0; c < cells; ++c) start_[c + 1] += start_[c];
+    std::vector<int> pos(start_.begin(), start_.end() - 1);
+    x_.resize(num_), y_.resize(num_), z_.resize(num_), id_.resize(num_);
+    for (int k = 0; k < num_; ++k) {
+      const int at = pos[cell_of[k]]++;
+      const float *p = xyz + 3 * ids[k];
+      x_[at] = p[0], y_[at] = p[1], z_[at] = p[2];
+      id_[at] = ids[k];
+    }
+  }
+
+  int size() const { return num_; }
+
+  // Calls func(id, x, y, z) for every point which may be within radius of
+  // q, in no particular order. A query or radius which is not finite visits
+  // every point.
+  template <typename Func>
+  void forEachNear(const float *q, double radius, Func &&func) const {
+    if (num_ == 0) return;
+    radius = fabs(radius);
+    if (!isFinitePoint(q) || !std::isfinite(radius)) {
+      for (int k = 0; k < num_; ++k) func(id_[k], x_[k], y_[k], z_[k]);
+      return;
+    }
+    // the float distance may round below the bound, keep some slack.
+    radius = radius * (1 + kSlack) + cell_ * kSlack;
+    int c0[3], c1[3];
+    for (int a = 0; a < 3; ++a) {
+      if (q[a] + radius < lo_[a] || q[a] - radius > hi_[a]) return;
+      c0[a] = clampCell((q[a] - radius - lo_[a]) * inv_cell_, dims_[a]);
+      c1[a] = clampCell((q[a] + radius - lo_[a]) * inv_cell_, dims_[a]);
+    }
+    for (int cz = c0[2]; cz <= c1[2]; ++cz) {
+      for (int cy = c0[1]; cy <= c1[1]; ++cy) {
+        const int row = (cz * dims_[1] + cy) * dims_[0];
+        for (int k = start_[row + c0[0]]; k < start_[row + c1[0] + 1]; ++k) {
+          func(id_[k], x_[k], y_[k], z_[k]);
+        }
+      }
+    }
+  }
+
+  // The k nearest points of q by (distance2, index), i.e. the first k of
+  // a stable sort by distance, as a scan in index order keeping the k best
+  // with `<` would find them. Points at an inf or nan distance are never
+  // taken. Returns how many were found, at most k.
+  int nearest(const float *q, int k, int *idx, float *dist2) const {
+    int found = 0;
+    if (num_ == 0 || k <= 0 || !isFinitePoint(q)) return 0;
+    auto take = [&](int id, float d) {
+      if (!std::isfinite(d)) return;
+      if (found == k && !before(d, id, dist2[k - 1], idx[k - 1])) return;
+      int at = found < k ? found++ : k - 1;
+      for (; at > 0 && before(d, id, dist2[at - 1], idx[at - 1]); --at) {
+        dist2[at] = dist2[at - 1];
+        idx[at] = idx[at - 1];
+      }
+      dist2[at] = d;
+      idx[at] = id;
+    };
+    int cq[3];
+    for (int a = 0; a < 3; ++a) {
+      cq[a] = clampCell((q[a] - lo_[a]) * inv_cell_, dims_[a]);
+    }
+    for (int r = 0;; ++r) {
+      forEachCellOnRing(cq, r, [&](int cell) {
+        for (int j = start_[cell]; j < start_[cell + 1]; ++j) {
+          take(id_[j], distance2(q[0], q[1], q[2], x_[j], y_[j], z_[j]));
+        }
+      });
+      // every point not visited yet is at least gap away from q.
+      double gap = INFINITY;
+      for (int a = 0; a < 3; ++a) {
+        if (cq[a] - r > 0) {
+          gap = std::min(gap, q[a] - (lo_[a] + (cq[a] - r) * cell_));
+        }
+        if (cq[a] + r < dims_[a] - 1) {
+          gap = std::min(gap, lo_[a] + (cq[a] + r + 1) * cell_ - q[a]);
+        }
+      }
+      if (gap == INFINITY) break;
+      gap = std::max(gap - cell_ * kSlack, 0.0);
+      if (found == k && gap * gap * (1 - kSlack) > dist2[k - 1]) break;
+    }
+    return found;
+  }
+
+ private:
+  static constexpr double kPointsPerCell = 4;
+  static constexpr double kSlack = 1e-4;
+
+  static bool before(float d, int id, float other_d, int other_id) {
+    return d < other_d || (d == other_d && id < other_id);
+  }
+
+  static int clampCell(double v, int n) {
+    if (!(v > 0)) return 0;
+    if (v >= n - 1) return n - 1;
+    return static_cast<int>(v);
+  }
+
+  int cellIndex(const float *p) const {
+    const int cx = clampCell((p[0] - lo_[0]) * inv_cell_, dims_[0]);
+    const int cy = clampCell((p[1] - lo_[1]) * inv_cell_, dims_[1]);
+    const int cz = clampCell((p[2] - lo_[2]) * inv_cell_, dims_[2]);
+    return (cz * dims_[1] + cy) * dims_[0] + cx;
+  }
+
+  // func(cell) for the cells at chebyshev distance r from c.
+  template <typename Func>
+  void forEachCellOnRing(const int *c, int r, Func &&func) const {
+    for (int z = std::max(c[2] - r, 0); z <= std::min(c[2] + r, dims_[2] - 1);
+         ++z) {
+      for (int y = std::max(c[1] - r, 0);
+           y <= std::min(c[1] + r, dims_[1] - 1); ++y) {
+        const int row = (z * dims_[1] + y) * dims_[0];
+        const bool face = abs(z - c[2]) == r || abs(y - c[1]) == r;
+        const int x0 = c[0] - r, x1 = c[0] + r;
+        if (face) {
+          for (int x = std::max(x0, 0); x <= std::min(x1, dims_[0] - 1); ++x) {
+            func(row + x);
+          }
+        } else {
+          if (x0 >= 0) func(row + x0);
+          if (x1 != x0 && x1 < dims_[0]) func(row + x1);
+        }
+      }
+    }
+  }
+
+  int num_ = 0;
+  double lo_[3] = {0, 0, 0};
+  double hi_[3] = {0, 0, 0};
+  double cell_ = 1.0;
+  double inv_cell_ = 1.0;
+  int dims_[3] = {0, 0, 0};
+  std::vector<int> start_;
+  std::vector<float> x_, y_, z_;
+  std::vector<int> id_;
+};
+
+// Boxes rotated around z, indexed by the circle around each box in the x-y
+// plane, which holds every point the box can contain.
+class RotatedBoxIndex {
+ public:
+  // boxes are num of (cx, cy, cz, dx, dy, dz, heading), margin is the slack
+  // of the containment test on dx / 2 and dy / 2.
+  void build(const float *boxes, int num, float margin) {
+    bounds_.resize(num);
+    std::vector<int> ids(num);
+    for (int m = 0; m < num; ++m) {
+      const float *b = boxes + 7 * m;
+      // the rotation of the test rounds too, keep some slack.
+      const double r =
+          (0.5 * std::hypot<double>(b[3], b[4]) + 2.0 * margin) * 1.0001 +
+          1e-6;
+      bounds_[m] = {down(b[0] - r), down(b[1] - r), up(b[0] + r),
+                    up(b[1] + r)};
+      ids[m] = m;
+    }
+    grid_.build(ids, bounds_.data());
+  }
+
+  // the smallest box id for which contains(id) holds, -1 if there is none.
+  template <typename Contains>
+  int first(float x, float y, Contains &&contains) const {
+    int best = -1;
+    grid_.query({x, y, x, y}, [&](int m) {
+      if ((best < 0 || m < best) && contains(m)) best = m;
+    });
+    return best;
+  }
+
+ private:
+  // a float bound of a double, rounded outward.
+  static float down(double v) {
+    const float f = static_cast<float>(v);
+    return f > v ? std::nextafter(f, -INFINITY) : f;
+  }
+  static float up(double v) {
+    const float f = static_cast<float>(v);
+    return f < v ? std::nextafter(f, INFINITY) : f;
+  }
+
+  std::vector<nms_cpu::Bound> bounds_;
+  nms_cpu::BoxGrid grid_;
+};
+
+}  // namespace point_cloud
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_POINT_CLOUD_INDEX_H_
@@ -0,0 +1,244 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_RANDOM_DATA_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_RANDOM_DATA_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "mlu_op_test.pb.h"
+#include "philox.h"
+
+namespace mluoptest {
+
+// Random data of one RandomData, addressed by element index. Element i only
+// depends on the seed, the parameters and i, so any range can be generated
+// on its own: the data is the same whatever the chunking and thread count.
+//
+// Element i of float data comes from word i of the Philox stream of the
+// seed, double data uses words 2i and 2i + 1. Gaussian values come in
+// Box-Muller (cos, sin) pairs of consecutive elements.
+template <typename T>
+class RandomDataStream {
+ public:
+  RandomDataStream(const RandomData *random_param, DataType dtype)
+      : dtype_(dtype) {
+    // if convert_dtype == true, round(float) to int,
+    // else don't round, int is qint
+    convert_dtype_ = random_param->has_convert_dtype()
+                         ? random_param->convert_dtype()
+                         : false;
+    const int seed = random_param->has_seed() ? random_param->seed() : 23;
+    seed_ = static_cast<uint32_t>(seed);
+    if (random_param->distribution() == mluoptest::UNIFORM) {
+      if (random_param->has_lower_bound_double()) {
+        a_ = (T)random_param->lower_bound_double();
+        b_ = (T)random_param->upper_bound_double();
+      } else {
+        a_ = (T)random_param->lower_bound();
+        b_ = (T)random_param->upper_bound();
+      }
+      kind_ = a_ == b_ ? CONSTANT : UNIFORM_REAL;
+    } else if (random_param->distribution() == mluoptest::GAUSSIAN) {
+      if (random_param->has_mu_double()) {
+        a_ = (T)random_param->mu_double();
+        b_ = (T)random_param->sigma_double();
+      } else {
+        a_ = (T)random_param->mu();
+        b_ = (T)random_param->sigma();
+      }
+      kind_ = NORMAL;
+    }
+  }
+
+  static bool supportDtype(DataType dtype) {
+    switch (dtype) {
+      case DTYPE_BFLOAT16:
+      case DTYPE_HALF:
+      case DTYPE_FLOAT:
+      case DTYPE_DOUBLE:
+      case DTYPE_COMPLEX_HALF:
+      case DTYPE_COMPLEX_FLOAT:
+      case DTYPE_INT8:
+      case DTYPE_INT16:
+      case DTYPE_UINT8:
+      case DTYPE_UINT16:
+      case DTYPE_UINT32:
+      case DTYPE_INT31:
+      case DTYPE_INT32:
+      case DTYPE_INT64:
+      case DTYPE_UINT64:
+      case DTYPE_BOOL: return true;
+      default: return false;
+    }
+  }
+
+  // Elements [begin, begin + count) of the stream.
+  void fill(T *dst, size_t begin, size_t count) const {
+    switch (kind_) {
+      case CONSTANT: std::fill(dst, dst + count, a_); break;
+      case UNIFORM_REAL: fillBlocks(dst, begin, count, false); break;
+      case NORMAL: fillBlocks(dst, begin, count, true); break;
+      default: break;
+    }
+    castToDtype(dst, count);
+  }
+
+  // All of [0, count), chunk by chunk over the omp threads.
+  void fillParallel(T *dst, size_t count) const {
+    const size_t chunk = 1 << 16;
+    const int64_t chunk_num = (count + chunk - 1) / chunk;
+#pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < chunk_num; ++i) {
+      const size_t begin = i * chunk;
+      fill(dst + begin, begin, std::min(chunk, count - begin));
+    }
+  }
+
+ private:
+  enum Kind { NONE, CONSTANT, UNIFORM_REAL, NORMAL };
+  // elements generated together, and Philox words per element.
+  static const size_t kTile = 1024;
+  static const size_t kWordNum = sizeof(T) == sizeof(float) ? 1 : 2;
+
+  void fillBlocks(T *dst, size_t begin, size_t count, bool normal) const {
+    const size_t end = begin + count;
+    uint32_t words[kTile * kWordNum];
+    T values[kTile];
+    // tiles of kTile elements, cut to the multiples of 4 around the range.
+    for (size_t first = begin / 4 * 4; first < end; first += kTile) {
+      const size_t num = std::min(kTile, (end - first + 3) / 4 * 4);
+      philoxGenerate(words, num * kWordNum / 4, seed_, first * kWordNum / 4,
+                     0, false);
+      if (normal) {
+        normalTile(words, values, num);
+      } else {
+        uniformTile(words, values, num);
+      }
+      const size_t from = std::max(first, begin);
+      const size_t to = std::min(first + num, end);
+      std::copy(values + (from - first), values + (to - first),
+                dst + (from - begin));
+    }
+  }
+
+  void uniformTile(const uint32_t *words, T *values, size_t num) const {
+    // [lower, upper), without overflow for wide bounds.
+    const T below_upper =
+        std::nextafter(b_, -std::numeric_limits<T>::infinity());
+    for (size_t i = 0; i < num; ++i) {
+      const double u = kWordNum == 1 ? philoxUnitFloat(words[i])
+                                     : philoxUnitDouble(words[2 * i],
+                                                        words[2 * i + 1]);
+      const T value = (T)((1.0 - u) * a_ + u * b_);
+      values[i] = std::max(a_, std::min(value, below_upper));
+    }
+  }
+
+  // Box-Muller in float, two words per pair.
+  void normalTile(const uint32_t *words, float *values, size_t num) const {
+    for (size_t i = 0; i < num; i += 2) {
+      // (0, 1] keeps the log finite.
+      const float u1 = philoxUnitFloat(words[i]) + 1.0f / 16777216.0f;
+      const float u2 = philoxUnitFloat(words[i + 1]);
+      const float radius = std::sqrt(-2.0f * std::log(u1));
+      const float theta = 6.2831853f * u2;
+      values[i] = a_ + b_ * radius * std::cos(theta);
+      values[i + 1] = a_ + b_ * radius * std::sin(theta);
+    }
+  }
+
+  // Box-Muller in double, four words per pair.
+  void normalTile(const uint32_t *words, double *values, size_t num) const {
+    for (size_t i = 0; i < num; i += 2) {
+      const double u1 = philoxUnitDouble(words[2 * i], words[2 * i + 1]) +
+                        1.0 / 9007199254740992.0;
+      const double u2 = philoxUnitDouble(words[2 * i + 2], words[2 * i + 3]);
+      const double radius = std::sqrt(-2.0 * std::log(u1));
+      const double theta = 6.283185307179586 * u2;
+      values[i] = a_ + b_ * radius * std::cos(theta);
+      values[i + 1] = a_ + b_ * radius * std::sin(theta);
+    }
+  }
+
+  // reset data by dtype
+  void castToDtype(T *data, size_t count) const {
+    switch (dtype_) {
+      case DTYPE_INT8:
+      case DTYPE_INT16: {
+        if (convert_dtype_) {
+          for (size_t i = 0; i < count; ++i) {
+            int x = std::floor(data[i]);
+            data[i] = x;
+          }
+        }
+      }; break;
+      case DTYPE_UINT8:
+      case DTYPE_UINT16:
+      case DTYPE_UINT32: {
+        for (size_t i = 0; i < count; ++i) {
+          uint32_t x = std::floor(data[i]);
+          data[i] = x;
+        }
+      }; break;
+      case DTYPE_INT31:
+      case DTYPE_INT32: {
+        for (size_t i = 0; i < count; ++i) {
+          int x = std::floor(data[i]);
+          data[i] = x;
+        }
+      }; break;
+      case DTYPE_INT64: {
+        for (size_t i = 0; i < count; ++i) {
+          int64_t x = std::floor(data[i]);
+          data[i] = x;
+        }
+      }; break;
+      case DTYPE_UINT64: {
+        for (size_t i = 0; i < count; ++i) {
+          uint64_t x = std::floor(std::abs(data[i]));
+          data[i] = x;
+        }
+      }; break;
+      case DTYPE_BOOL: {
+        // bool with data other than 0/1 is allowed
+        for (size_t i = 0; i < count; ++i) {
+          data[i] = (int8_t)(int32_t)(data[i]);
+        }
+      }; break;
+      default: break;
+    }
+  }
+
+  DataType dtype_;
+  bool convert_dtype_ = false;
+  uint32_t seed_ = 23;
+  Kind kind_ = NONE;
+  T a_ = 0;
+  T b_ = 0;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_RANDOM_DATA_H_
@@ -0,0 +1,421 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_ROTATED_IOU_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_ROTATED_IOU_CPU_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+namespace mluoptest {
+namespace rotated_iou {
+
+// The CPU baselines of box_iou_rotated and nms_rotated were written
+// separately and differ in two details of their float arithmetic. Both are
+// kept so that moving to this library does not change any baseline.
+struct Flavor {
+  bool float_trig;      // cosf/sinf instead of cos/sin on the angle
+  bool reciprocal_div;  // a * (1.0f / b) instead of a / b
+};
+constexpr Flavor kBoxIouRotatedFlavor = {false, false};
+constexpr Flavor kNmsRotatedFlavor = {true, true};
+
+enum Mode {
+  MODE_IOU = 0,
+  MODE_IOF = 1,
+};
+
+// Rotated boxes (x_ctr, y_ctr, w, h, angle) in SoA layout with the per-box
+// trigonometry and the vertex offsets computed once.
+struct RotatedBoxes {
+  std::vector<float> x, y, w, h;
+  // vertex offsets relative to the center, see vertices().
+  std::vector<float> ox0, oy0, ox1, oy1;
+  // half extent of the circumscribed square, inf/nan for invalid boxes.
+  std::vector<float> radius;
+
+  int size() const { return static_cast<int>(x.size()); }
+
+  void assign(const float *boxes, int num, int box_dim, const Flavor &flavor) {
+    x.resize(num), y.resize(num), w.resize(num), h.resize(num);
+    ox0.resize(num), oy0.resize(num), ox1.resize(num), oy1.resize(num);
+    radius.resize(num);
+    for (int i = 0; i < num; ++i) {
+      const float *box = boxes + i * box_dim;
+      x[i] = box[0], y[i] = box[1], w[i] = box[2], h[i] = box[3];
+      double theta = box[4];
+      float cos_half, sin_half;
+      if (flavor.float_trig) {
+        cos_half = (float)cosf(theta) * 0.5f;
+        sin_half = (float)sinf(theta) * 0.5f;
+      } else {
+        cos_half = (float)cos(theta) * 0.5f;
+        sin_half = (float)sin(theta) * 0.5f;
+      }
+      // p0 = c - s * h - c * w, p1 = c + s * h - c * w, evaluated in the
+      // same order as the scalar baselines.
+      float sh = sin_half * h[i], cw = cos_half * w[i];
+      float ch = cos_half * h[i], sw = sin_half * w[i];
+      ox0[i] = sh, oy0[i] = ch, ox1[i] = cw, oy1[i] = sw;
+      radius[i] = 0.5f * (fabsf(w[i]) + fabsf(h[i]));
+      if (!std::isfinite(box[4])) radius[i] = NAN;
+    }
+  }
+};
+
+namespace detail {
+struct Vec2 {
+  float x, y;
+};
+
+inline Vec2 sub(const Vec2 &a, const Vec2 &b) { return {a.x - b.x, a.y - b.y}; }
+inline float dot(const Vec2 &a, const Vec2 &b) { return a.x * b.x + a.y * b.y; }
+inline float cross(const Vec2 &a, const Vec2 &b) {
+  return a.x * b.y - a.y * b.x;
+}
+
+inline void vertices(const RotatedBoxes &b, int i, float ctr_x, float ctr_y,
+                     Vec2 (&pts)[4]) {
+  // y: top->down; x: left->right
+  pts[0].x = ctr_x - b.ox0[i] - b.ox1[i];
+  pts[0].y = ctr_y + b.oy0[i] - b.oy1[i];
+  pts[1].x = ctr_x + b.ox0[i] - b.ox1[i];
+  pts[1].y = ctr_y - b.oy0[i] - b.oy1[i];
+  pts[2].x = 2 * ctr_x - pts[0].x;
+  pts[2].y = 2 * ctr_y - pts[0].y;
+  pts[3].x = 2 * ctr_x - pts[1].x;
+  pts[3].y = 2 * ctr_y - pts[1].y;
+}
+
+// Vertices of rectangle `q` lying inside the rectangle `r`.
+inline int verticesInside(const Vec2 (&q)[4], const Vec2 (&r)[4],
+                          const Vec2 (&r_edge)[4], Vec2 *out) {
+  const Vec2 &AB = r_edge[0];
+  const Vec2 &DA = r_edge[3];
+  float ABdotAB = dot(AB, AB);
+  float ADdotAD = dot(DA, DA);
+  int num = 0;
+  for (int i = 0; i < 4; i++) {
+    // P is inside ABCD iff. P's projection on AB lines within AB
+    // and P's projection on AD lies within AD
+    Vec2 AP = sub(q[i], r[0]);
+    float APdotAB = dot(AP, AB);
+    float APdotAD = -dot(AP, DA);
+    if ((APdotAB >= 0) && (APdotAD >= 0) && (APdotAB <= ABdotAB) &&
+        (APdotAD <= ADdotAD)) {
+      out[num++] = q[i];
+    }
+  }
+  return num;
+}
+
+// Up to 4 x 4 + 4 + 4 = 24 intersection points (including dups).
+inline int intersectionPoints(const Vec2 (&pts1)[4], const Vec2 (&pts2)[4],
+                              bool reciprocal_div, Vec2 (&out)[24]) {
+  Vec2 vec1[4], vec2[4];
+  for (int i = 0; i < 4; i++) {
+    vec1[i] = sub(pts1[(i + 1) % 4], pts1[i]);
+    vec2[i] = sub(pts2[(i + 1) % 4], pts2[i]);
+  }
+
+  int num = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      float det = cross(vec2[j], vec1[i]);
+      // deal with parallel lines
+      if (fabs(det) <= 1e-14) {
+        continue;
+      }
+      Vec2 vec12 = sub(pts2[j], pts1[i]);
+      float t1, t2;
+      if (reciprocal_div) {
+        t1 = cross(vec2[j], vec12) * (1.0f / det);
+        t2 = cross(vec1[i], vec12) * (1.0f / det);
+      } else {
+        t1 = cross(vec2[j], vec12) / det;
+        t2 = cross(vec1[i], vec12) / det;
+      }
+      if (t1 >= 0.0f && t1 <= 1.0f && t2 >= 0.0f && t2 <= 1.0f) {
+        out[num++] = {pts1[i].x + vec1[i].x * t1, pts1[i].y + vec1[i].y * t1};
+      }
+    }
+  }
+  num += verticesInside(pts1, pts2, vec2, out + num);
+  num += verticesInside(pts2, pts1, vec1, out + num);
+  return num;
+}
+
+// Graham scan, the points are returned in q in counter-clockwise order.
+inline int convexHullGraham(const Vec2 (&p)[24], int num_in, Vec2 (&q)[24]) {
+  int t = 0;
+  for (int i = 0; i < num_in; i++) {
+    if (p[i].y < p[t].y || (p[i].y == p[t].y && p[i].x < p[t].x)) {
+      t = i;
+    }
+  }
+  const Vec2 &start = p[t];
+  for (int i = 0; i < num_in; i++) {
+    q[i] = sub(p[i], start);
+  }
+  Vec2 tmp = q[0];
+  q[0] = q[t];
+  q[t] = tmp;
+
+  float dist[24];
+  for (int i = 0; i < num_in; i++) {
+    dist[i] = dot(q[i], q[i]);
+  }
+  float temp;
+  for (int i = 1; i < num_in - 1; i++) {
+    for (int j = i + 1; j < num_in; j++) {
+      temp = cross(q[i], q[j]);
+      if ((temp < -1e-6) || ((fabs(temp) < 1e-6) && (dist[i] > dist[j]))) {
+        tmp = q[i];
+        q[i] = q[j];
+        q[j] = tmp;
+        temp = dist[i];
+        dist[i] = dist[j];
+        dist[j] = temp;
+      }
+    }
+  }
+
+  int k;
+  for (k = 1; k < num_in; k++) {
+    if (dist[k] > 1e-8) {
+      break;
+    }
+  }
+  if (k == num_in) {
+    q[0] = p[t];
+    return 1;
+  }
+  q[1] = q[k];
+  int m = 2;
+  for (int i = k + 1; i < num_in; i++) {
+    while (m > 1 && cross(sub(q[i], q[m - 2]), sub(q[m - 1], q[m - 2])) >= 0) {
+      m--;
+    }
+    q[m++] = q[i];
+  }
+  return m;
+}
+
+inline float polygonArea(const Vec2 (&q)[24], int m) {
+  if (m <= 2) {
+    return 0;
+  }
+  float area = 0;
+  for (int i = 1; i < m - 1; i++) {
+    area += fabs(cross(sub(q[i], q[0]), sub(q[i + 1], q[0])));
+  }
+  return area / 2.0;
+}
+
+// Circumscribed squares apart by more than the rounding of the center shift
+// and the vertices: the scalar code finds no intersection point for them.
+inline bool farApart(const RotatedBoxes &b1, int i, const RotatedBoxes &b2,
+                     int j) {
+  const float reach = b1.radius[i] + b2.radius[j];
+  const float margin =
+      1e-4f * (fabsf(b1.x[i]) + fabsf(b1.y[i]) + fabsf(b2.x[j]) +
+               fabsf(b2.y[j]) + reach) +
+      1e-6f;
+  return fabsf(b1.x[i] - b2.x[j]) > reach + margin ||
+         fabsf(b1.y[i] - b2.y[j]) > reach + margin;
+}
+}  // namespace detail
+
+// Area of the intersection of box i of b1 and box j of b2. Both boxes are
+// shifted by their common center first to keep the precision.
+inline float intersection(const RotatedBoxes &b1, int i,
+                          const RotatedBoxes &b2, int j,
+                          const Flavor &flavor) {
+  auto center_shift_x = (b1.x[i] + b2.x[j]) / 2.0;
+  auto center_shift_y = (b1.y[i] + b2.y[j]) / 2.0;
+  float x1 = b1.x[i] - center_shift_x, y1 = b1.y[i] - center_shift_y;
+  float x2 = b2.x[j] - center_shift_x, y2 = b2.y[j] - center_shift_y;
+  detail::Vec2 pts1[4], pts2[4];
+  detail::vertices(b1, i, x1, y1, pts1);
+  detail::vertices(b2, j, x2, y2, pts2);
+  detail::Vec2 points[24], ordered[24];
+  int num = detail::intersectionPoints(pts1, pts2, flavor.reciprocal_div,
+                                       points);
+  if (num <= 2) {
+    return 0.0;
+  }
+  int num_convex = detail::convexHullGraham(points, num, ordered);
+  return detail::polygonArea(ordered, num_convex);
+}
+
+// IoU (mode 0) or IoF (mode 1) of box i of b1 and box j of b2, equal to
+// the scalar baseline selected by `flavor`.
+inline float overlap(const RotatedBoxes &b1, int i, const RotatedBoxes &b2,
+                     int j, int mode, const Flavor &flavor) {
+  const float area1 = b1.w[i] * b1.h[i];
+  const float area2 = b2.w[j] * b2.h[j];
+  if (area1 < 1e-14 || area2 < 1e-14) {
+    return 0.f;
+  }
+  // boxes far apart have an intersection of exactly 0.
+  const float inter = detail::farApart(b1, i, b2, j)
+                          ? 0.f
+                          : intersection(b1, i, b2, j, flavor);
+  // nms_rotated only knows mode 0 and 1, box_iou_rotated treats every
+  // non-zero mode as IoF.
+  float base = 1.0;
+  if (mode == MODE_IOU) {
+    base = area1 + area2 - inter;
+  } else if (mode == MODE_IOF || !flavor.reciprocal_div) {
+    base = area1;
+  }
+  return flavor.reciprocal_div ? inter * (1.0f / base) : inter / base;
+}
+
+// ious[i] = overlap(b1[i], b2[i]).
+inline void alignedOverlaps(const RotatedBoxes &b1, const RotatedBoxes &b2,
+                            int mode, const Flavor &flavor, float *ious) {
+  const int num = b1.size();
+#pragma omp parallel for schedule(static) if (num > 1024)
+  for (int i = 0; i < num; ++i) {
+    ious[i] = overlap(b1, i, b2, i, mode, flavor);
+  }
+}
+
+// ious[i * n2 + j] = overlap(b1[i], b2[j]), computed in row tiles.
+inline void pairwiseOverlaps(const RotatedBoxes &b1, const RotatedBoxes &b2,
+                             int mode, const Flavor &flavor, float *ious) {
+  const int num1 = b1.size(), num2 = b2.size();
+  const int64_t total = (int64_t)num1 * num2;
+#pragma omp parallel for schedule(dynamic, 4) if (total > 4096)
+  for (int i = 0; i < num1; ++i) {
+    float *row = ious + (int64_t)i * num2;
+    for (int j = 0; j < num2; ++j) {
+      row[j] = overlap(b1, i, b2, j, mode, flavor);
+    }
+  }
+}
+
+// Angular order of the valid intersection vertices of two boxes, used by
+// diff_iou_rotated. `vertices` holds dim_m (x, y) points around (0, 0) of
+// which the first 8 are box corners; `idx` receives kMaxVertIdx indices.
+constexpr int kMaxVertIdx = 9;
+constexpr int kIntersectionOffset = 8;
+constexpr double kVertexEps = 1e-8;
+
+// if vertex1 < vertex2 return true. order: minimum at x-axis, become larger
+// in anti-clockwise direction.
+inline bool compareVertices(const float x1, const float y1, const float x2,
+                            const float y2) {
+  if (fabs(x1 - x2) < kVertexEps && fabs(y2 - y1) < kVertexEps)
+    return false;  // if equal, return false
+
+  if (y1 > 0 && y2 < 0) return true;
+  if (y1 < 0 && y2 > 0) return false;
+
+  float n1 = x1 * x1 + y1 * y1 + kVertexEps;
+  float n2 = x2 * x2 + y2 * y2 + kVertexEps;
+  float diff = fabs(x1) * x1 / n1 - fabs(x2) * x2 / n2;
+
+  if (y1 > 0 && y2 > 0) {
+    return diff > kVertexEps;
+  }
+  if (y1 < 0 && y2 < 0) {
+    return diff < kVertexEps;
+  }
+  return false;
+}
+
+inline void sortVertices(const float *vertices, const float *mask,
+                         int num_valid, int dim_m, float *idx) {
+  int pad = 0;  // index of arbitrary invalid intersection point (not box
+                // corner!)
+  for (int j = kIntersectionOffset; j < dim_m; ++j) {
+    if (!mask[j]) {
+      pad = j;
+      break;
+    }
+  }
+  if (num_valid < 3) {
+    // not enough vertices, take an invalid intersection point
+    for (int j = 0; j < kMaxVertIdx; ++j) {
+      idx[j] = (float)pad;
+    }
+    return;
+  }
+  // selection of the next larger vertex, the number of valid vertices is
+  // known.
+  for (int j = 0; j < num_valid; ++j) {
+    // initialize with a "big" value
+    float x_min = 1;
+    float y_min = -kVertexEps;
+    int i_take = 0;
+    float x2 = 0, y2 = 0;
+    if (j != 0) {
+      int i2 = idx[j - 1];
+      x2 = vertices[i2 * 2 + 0];
+      y2 = vertices[i2 * 2 + 1];
+    }
+    for (int k = 0; k < dim_m; ++k) {
+      float x = vertices[k * 2 + 0];
+      float y = vertices[k * 2 + 1];
+      if (mask[k] && compareVertices(x, y, x_min, y_min)) {
+        if ((j == 0) || compareVertices(x2, y2, x, y)) {
+          x_min = x;
+          y_min = y;
+          i_take = k;
+        }
+      }
+    }
+    idx[j] = (float)i_take;
+  }
+  // duplicate the first idx
+  idx[num_valid] = idx[0];
+  for (int j = num_valid + 1; j < kMaxVertIdx; ++j) {
+    idx[j] = (float)pad;
+  }
+
+  // corner case: the two boxes are exactly the same. idx then has duplicate
+  // elements in the first 8 positions ("corners in box"), which breaks the
+  // shoelace formula.
+  if (num_valid == 8) {
+    int counter = 0;
+    for (int j = 0; j < 4; ++j) {
+      float check = idx[j];
+      for (int k = 4; k < kIntersectionOffset; ++k) {
+        if (idx[k] == check) counter++;
+      }
+    }
+    if (counter == 4) {
+      idx[4] = idx[0];
+      for (int j = 5; j < kMaxVertIdx; ++j) {
+        idx[j] = (float)pad;
+      }
+    }
+  }
+}
+
+}  // namespace rotated_iou
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_ROTATED_IOU_CPU_H_
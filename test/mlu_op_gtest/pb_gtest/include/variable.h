@@ -54,6 +54,21 @@ class GlobalVar {
                      // ave hw_time
   int thread_num_ = 1;    // thread num
   bool shuffle_ = false;  // shuffle cases.
+  // run the cases of --thread > 1 as a staged pipeline, and the threads of
+  // the prepare,device,baseline,evaluate,teardown stages, e.g. "4,2,8,1,1".
+  bool pipeline_ = false;
+  std::string pipeline_threads_ = "";
+  // wall time history of cases, read before listing the cases (for the cost
+  // of longest-first scheduling and sharding) and rewritten at the end.
+  std::string case_cost_file_ = "";
+  // run only the shard_index-th of total_shards shards of the cases, split by
+  // cost, e.g. for several CI machines.
+  int shard_index_ = 0;
+  int total_shards_ = 1;
+  // with --thread > 1, only start a case if the estimated host/device memory
+  // of the cases running fits, in MB. 0 is no limit.
+  int host_memory_budget_ = 0;
+  int device_memory_budget_ = 0;
   unsigned int half2float_algo_ = getEnvInt(
       "MLUOP_GTEST_EXPERIMENT_HALF2FLOAT_ALGO",
       AlgoHalfToFloat::CPU_INTRINSIC);  // half2float algorithm selection
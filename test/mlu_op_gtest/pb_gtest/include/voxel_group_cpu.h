@@ -0,0 +1,280 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_VOXEL_GROUP_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_VOXEL_GROUP_CPU_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "kernels/voxelization/voxel_map.h"
+
+namespace mluoptest {
+namespace voxel_group_cpu {
+
+// Points grouped by one task. Every block has its own hash table and
+// partials; they are merged in block order, so the results do not depend
+// on the number of threads.
+constexpr int64_t kPointBlock = 1 << 14;
+
+enum class Reduce { kNone, kMax, kMean };
+
+/**
+ * @brief Points grouped by voxel coordinate, as mluOpDynamicPointToVoxel
+ * Forward gives them: the voxels in ascending (z, y, x) order, which is the
+ * order of a sorted unique, and points with a negative coordinate in no
+ * voxel.
+ */
+struct Groups {
+  int32_t voxel_num = 0;
+  std::vector<int32_t> coors;        // [voxel_num, 3]
+  std::vector<int32_t> point2voxel;  // [n], -1 for a dropped point
+  std::vector<int32_t> counts;       // [voxel_num]
+  std::vector<float> feats;          // [voxel_num, channels]
+};
+
+// Coordinates too wide to be packed into 64 bits.
+struct Key {
+  int32_t c[3];
+  bool operator==(const Key &o) const {
+    return c[0] == o.c[0] && c[1] == o.c[1] && c[2] == o.c[2];
+  }
+  bool operator<(const Key &o) const {
+    if (c[0] != o.c[0]) return c[0] < o.c[0];
+    if (c[1] != o.c[1]) return c[1] < o.c[1];
+    return c[2] < o.c[2];
+  }
+};
+
+inline size_t hashOf(uint64_t key) { return mluop::VoxelKeyHash()(key); }
+
+inline size_t hashOf(const Key &key) {
+  return hashOf(((uint64_t)(uint32_t)key.c[0] << 42) ^
+                ((uint64_t)(uint32_t)key.c[1] << 21) ^ (uint32_t)key.c[2]);
+}
+
+/**
+ * @brief Open-addressing set of keys, numbered in insertion order. The
+ * slots hold the numbers only; the keys stay in a dense array.
+ */
+template <typename K>
+class KeyTable {
+ public:
+  explicit KeyTable(size_t capacity) {
+    size_t slots = 16;
+    while (slots < 2 * capacity) slots <<= 1;
+    slots_.assign(slots, -1);
+    mask_ = slots - 1;
+    keys_.reserve(capacity);
+  }
+
+  // Returns the number of the key and whether it is new.
+  std::pair<int32_t, bool> insert(const K &key) {
+    size_t slot = hashOf(key) & mask_;
+    while (slots_[slot] >= 0) {
+      if (keys_[slots_[slot]] == key) return {slots_[slot], false};
+      slot = (slot + 1) & mask_;
+    }
+    slots_[slot] = static_cast<int32_t>(keys_.size());
+    keys_.push_back(key);
+    return {slots_[slot], true};
+  }
+
+  std::vector<K> &keys() { return keys_; }
+
+ private:
+  std::vector<int32_t> slots_;
+  std::vector<K> keys_;
+  size_t mask_;
+};
+
+namespace detail {
+
+template <typename K, typename KeyOf>
+void groupBy(KeyOf key_of, const int32_t *coors, const float *feats,
+             int64_t n, int channels, Reduce reduce, float init, Groups *out,
+             int64_t block) {
+  struct Partial {
+    std::vector<K> keys;
+    std::vector<int64_t> first;  // the first point of each voxel
+    std::vector<int32_t> counts;
+    std::vector<float> feats;
+    std::vector<int32_t> to_voxel;
+  };
+  const int64_t blocks = (n + block - 1) / block;
+  std::vector<Partial> partials(blocks);
+  std::vector<int32_t> local(n);
+  const bool reduced = reduce != Reduce::kNone;
+
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t b = 0; b < blocks; ++b) {
+    const int64_t begin = b * block, end = std::min(n, begin + block);
+    Partial &p = partials[b];
+    KeyTable<K> table(end - begin);
+    for (int64_t i = begin; i < end; ++i) {
+      const int32_t *c = coors + i * 3;
+      if (c[0] < 0 || c[1] < 0 || c[2] < 0) {
+        local[i] = -1;
+        continue;
+      }
+      const std::pair<int32_t, bool> id = table.insert(key_of(c));
+      local[i] = id.first;
+      if (id.second) {
+        p.first.push_back(i);
+        p.counts.push_back(0);
+        if (reduced) p.feats.resize(p.feats.size() + channels, init);
+      }
+      p.counts[id.first]++;
+      if (!reduced) continue;
+      const float *f = feats + i * channels;
+      float *acc = p.feats.data() + (size_t)id.first * channels;
+      if (reduce == Reduce::kMax) {
+        for (int k = 0; k < channels; ++k) {
+          acc[k] = f[k] >= acc[k] ? f[k] : acc[k];
+        }
+      } else {
+        for (int k = 0; k < channels; ++k) acc[k] += f[k];
+      }
+    }
+    p.keys.swap(table.keys());
+  }
+
+  // merge the tables in block order, then number the voxels by key
+  size_t total = 0;
+  for (const Partial &p : partials) total += p.keys.size();
+  KeyTable<K> merged(total);
+  std::vector<int64_t> first;
+  for (Partial &p : partials) {
+    p.to_voxel.resize(p.keys.size());
+    for (size_t l = 0; l < p.keys.size(); ++l) {
+      const std::pair<int32_t, bool> id = merged.insert(p.keys[l]);
+      if (id.second) first.push_back(p.first[l]);
+      p.to_voxel[l] = id.first;
+    }
+  }
+  const int32_t voxel_num = static_cast<int32_t>(first.size());
+  std::vector<std::pair<K, int32_t>> sorted(voxel_num);
+  for (int32_t v = 0; v < voxel_num; ++v) {
+    sorted[v] = {merged.keys()[v], v};
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<K, int32_t> &a,
+               const std::pair<K, int32_t> &b) { return a.first < b.first; });
+  std::vector<int32_t> rank(voxel_num);
+  out->coors.resize((size_t)voxel_num * 3);
+  for (int32_t r = 0; r < voxel_num; ++r) {
+    rank[sorted[r].second] = r;
+    const int32_t *c = coors + first[sorted[r].second] * 3;
+    std::copy(c, c + 3, &out->coors[r * 3]);
+  }
+  for (Partial &p : partials) {
+    for (int32_t &v : p.to_voxel) v = rank[v];
+  }
+  out->voxel_num = voxel_num;
+  out->counts.assign(voxel_num, 0);
+  out->feats.assign((size_t)voxel_num * channels, init);
+  for (Partial &p : partials) {
+    for (size_t l = 0; l < p.to_voxel.size(); ++l) {
+      const int32_t v = p.to_voxel[l];
+      out->counts[v] += p.counts[l];
+      if (!reduced) continue;
+      const float *part = p.feats.data() + l * channels;
+      float *acc = out->feats.data() + (size_t)v * channels;
+      if (reduce == Reduce::kMax) {
+        for (int k = 0; k < channels; ++k) {
+          acc[k] = part[k] >= acc[k] ? part[k] : acc[k];
+        }
+      } else {
+        for (int k = 0; k < channels; ++k) acc[k] += part[k];
+      }
+    }
+  }
+  if (reduce == Reduce::kMean) {
+    for (int32_t v = 0; v < voxel_num; ++v) {
+      const float count = out->counts[v];
+      float *acc = out->feats.data() + (size_t)v * channels;
+      for (int k = 0; k < channels; ++k) acc[k] /= count;
+    }
+  }
+
+  out->point2voxel.resize(n);
+#pragma omp parallel for schedule(static)
+  for (int64_t i = 0; i < n; ++i) {
+    const std::vector<int32_t> &to_voxel = partials[i / block].to_voxel;
+    out->point2voxel[i] = local[i] < 0 ? -1 : to_voxel[local[i]];
+  }
+}
+
+inline int bitWidth(uint32_t x) {
+  int bits = 0;
+  for (; x != 0; x >>= 1) bits++;
+  return bits;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Groups the n points of coors, [n, 3], into voxels and reduces
+ * their feats, [n, channels], per voxel in the same pass.
+ *
+ * The coordinates are packed into 64-bit keys, wide enough for the largest
+ * coordinate of each axis, so that the packed order is the (z, y, x) order.
+ * Each block of points is hashed into its own table and reduced into
+ * per-voxel partials. The tables are merged in block order and only the
+ * unique voxels are sorted, not the points.
+ *
+ * kMax keeps the last point with feats >= the running value, starting from
+ * init; kMean divides the sum by the count, as the device does. With kNone
+ * the feats are left at init.
+ */
+inline void group(const int32_t *coors, const float *feats, int64_t n,
+                  int channels, Reduce reduce, float init, Groups *out,
+                  int64_t block = kPointBlock) {
+  int32_t z = 0, y = 0, x = 0;
+#pragma omp parallel for schedule(static) reduction(max : z, y, x)
+  for (int64_t i = 0; i < n; ++i) {
+    const int32_t *c = coors + i * 3;
+    z = std::max(z, c[0]), y = std::max(y, c[1]), x = std::max(x, c[2]);
+  }
+  const int y_bits = detail::bitWidth(y), x_bits = detail::bitWidth(x);
+  if (detail::bitWidth(z) + y_bits + x_bits <= 64) {
+    auto pack = [=](const int32_t *c) {
+      return ((uint64_t)c[0] << (y_bits + x_bits)) |
+             ((uint64_t)c[1] << x_bits) | (uint64_t)c[2];
+    };
+    detail::groupBy<uint64_t>(pack, coors, feats, n, channels, reduce, init,
+                              out, block);
+  } else {
+    auto wide = [](const int32_t *c) { return Key{{c[0], c[1], c[2]}}; };
+    detail::groupBy<Key>(wide, coors, feats, n, channels, reduce, init, out,
+                         block);
+  }
+}
+
+}  // namespace voxel_group_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_VOXEL_GROUP_CPU_H_
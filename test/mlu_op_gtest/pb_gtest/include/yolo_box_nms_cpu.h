@@ -0,0 +1,244 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_YOLO_BOX_NMS_CPU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_YOLO_BOX_NMS_CPU_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "kernels/yolo_box/yolo_box_nms_plan.h"
+
+namespace mluoptest {
+namespace yolo_box_nms_cpu {
+
+using Candidate = mluop::YoloBoxNmsCandidate;
+
+// The scalars of mluOpYoloBoxNms.
+struct Param {
+  int class_num;
+  float conf_thresh;
+  int downsample_ratio;
+  bool clip_bbox;
+  float scale;
+  bool iou_aware;
+  float iou_aware_factor;
+  float score_thresh;
+  int top_k;
+  float iou_threshold;
+  int max_output;
+};
+
+// The shape of x, [n, c, h, w], with anchor_s anchors.
+struct Shape {
+  int n;
+  int anchor_s;
+  int h;
+  int w;
+};
+
+inline float sigmoid(const float x) { return 1.0 / (1.0 + std::exp(-x)); }
+
+// Offset of channel entry of anchor s in image i of x, as mluOpYoloBox
+// lays the channels out: with iou_aware, the anchor_s iou channels come
+// first.
+inline int64_t entryOffset(const Shape &s, const Param &p, int i, int an,
+                           int entry) {
+  const int64_t hw = (int64_t)s.h * s.w;
+  const int64_t c_in =
+      (int64_t)s.anchor_s * (p.class_num + (p.iou_aware ? 6 : 5));
+  const int64_t channel = (p.iou_aware ? s.anchor_s : 0) +
+                          (int64_t)an * (p.class_num + 5) + entry;
+  return ((int64_t)i * c_in + channel) * hw;
+}
+
+// The objectness of every box of image i, [anchor_s, h * w], with the iou
+// factor applied as mluOpYoloBox does.
+inline void confidence(const float *x, const Shape &s, const Param &p, int i,
+                       float *conf) {
+  const int64_t hw = (int64_t)s.h * s.w;
+  for (int an = 0; an < s.anchor_s; ++an) {
+    const float *obj = x + entryOffset(s, p, i, an, 4);
+    const float *iou =
+        x + ((int64_t)i * s.anchor_s * (p.class_num + 6) + an) * hw;
+    for (int64_t k = 0; k < hw; ++k) {
+      float c = sigmoid(obj[k]);
+      if (p.iou_aware) {
+        c = std::pow(c, static_cast<float>(1. - p.iou_aware_factor)) *
+            std::pow(sigmoid(iou[k]), static_cast<float>(p.iou_aware_factor));
+      }
+      conf[an * hw + k] = c;
+    }
+  }
+}
+
+// The corners (x0, y0, x1, y1) of box index, in [anchor_s, h * w], of
+// image i, as mluOpYoloBox decodes it.
+inline void decode(const float *x, const float *img_size,
+                   const float *anchors, const Shape &s, const Param &p,
+                   int i, int index, float *box) {
+  const int hw = s.h * s.w;
+  const int an = index / hw, k = index % hw;
+  const int gx = k % s.w, gy = k / s.w;
+  const float *t = x + entryOffset(s, p, i, an, 0) + k;
+  const float img_h = img_size[2 * i], img_w = img_size[2 * i + 1];
+  const float bias = -0.5 * (p.scale - 1);
+  const int input_h = p.downsample_ratio * s.h;
+  const int input_w = p.downsample_ratio * s.w;
+  const float cx = (gx + sigmoid(t[0]) * p.scale + bias) * img_w / s.w;
+  const float cy = (gy + sigmoid(t[hw]) * p.scale + bias) * img_h / s.h;
+  const float bw =
+      std::exp(t[2 * hw]) * anchors[2 * an] * img_w / input_w;
+  const float bh =
+      std::exp(t[3 * hw]) * anchors[2 * an + 1] * img_h / input_h;
+  box[0] = cx - bw / 2;
+  box[1] = cy - bh / 2;
+  box[2] = cx + bw / 2;
+  box[3] = cy + bh / 2;
+  if (p.clip_bbox) {
+    box[0] = box[0] > 0 ? box[0] : static_cast<float>(0);
+    box[1] = box[1] > 0 ? box[1] : static_cast<float>(0);
+    box[2] = box[2] < img_w - 1 ? box[2] : static_cast<float>(img_w - 1);
+    box[3] = box[3] < img_h - 1 ? box[3] : static_cast<float>(img_h - 1);
+  }
+}
+
+inline float iou(const float *a, const float *b) {
+  const float iw = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+  const float ih = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+  if (iw <= 0 || ih <= 0) return 0.0f;
+  const float inter = iw * ih;
+  const float area_a =
+      std::max(a[2] - a[0], 0.0f) * std::max(a[3] - a[1], 0.0f);
+  const float area_b =
+      std::max(b[2] - b[0], 0.0f) * std::max(b[3] - b[1], 0.0f);
+  const float uni = area_a + area_b - inter;
+  return uni > 0 ? inter / uni : 0.0f;
+}
+
+// The order of the candidates: higher score first, then lower index.
+inline bool better(const Candidate &a, const Candidate &b) {
+  return a.score > b.score || (a.score == b.score && a.index < b.index);
+}
+
+/**
+ * @brief Greedy NMS over candidates in better() order: a box is kept
+ * unless its IoU with a kept box exceeds iou_threshold, until max_output
+ * boxes are kept. Writes the kept boxes and scores, returns their number.
+ */
+template <typename Decode>
+int nms(const std::vector<Candidate> &sorted, const Param &p, Decode decode,
+        float *boxes, float *scores) {
+  int kept = 0;
+  for (const Candidate &c : sorted) {
+    if (kept == p.max_output) break;
+    float box[4];
+    decode(c.index, box);
+    bool keep = true;
+    for (int j = 0; j < kept && keep; ++j) {
+      keep = iou(boxes + j * 4, box) <= p.iou_threshold;
+    }
+    if (!keep) continue;
+    std::copy(box, box + 4, boxes + kept * 4);
+    scores[kept++] = c.score;
+  }
+  return kept;
+}
+
+/**
+ * @brief Reference of mluOpYoloBoxNms: decode, score threshold, per-class
+ * top-k and NMS of every (image, class) pair, without materializing the
+ * boxes and scores of mluOpYoloBox.
+ *
+ * A box is a candidate of class c if its objectness is at least
+ * conf_thresh and its class score, objectness * sigmoid(logit c), is more
+ * than score_thresh. The top_k best candidates of a pair are kept while
+ * the scores are scanned, in a buffer pruned back to top_k whenever it
+ * doubles, and only they are decoded.
+ *
+ * boxes: [n, class_num, max_output, 4], scores: [n, class_num, max_output]
+ * and num: [n, class_num]. The unused slots are zero.
+ */
+inline void yoloBoxNms(const float *x, const float *img_size,
+                       const float *anchors, const Shape &s, const Param &p,
+                       float *boxes, float *scores, int32_t *num) {
+  const int64_t hw = (int64_t)s.h * s.w;
+  std::vector<float> conf((size_t)s.n * s.anchor_s * hw);
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < s.n; ++i) {
+    confidence(x, s, p, i, conf.data() + (size_t)i * s.anchor_s * hw);
+  }
+
+  const int64_t pairs = (int64_t)s.n * p.class_num;
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t t = 0; t < pairs; ++t) {
+    const int i = t / p.class_num, c = t % p.class_num;
+    const float *conf_i = conf.data() + (size_t)i * s.anchor_s * hw;
+    // the best top_k of the candidates seen so far are in the first
+    // top_k slots of the buffer once it is pruned, the newer ones after them
+    std::vector<Candidate> top;
+    const size_t keep = p.top_k > 0 ? p.top_k : 0;
+    auto prune = [&]() {
+      if (top.size() <= keep) return;
+      std::nth_element(top.begin(), top.begin() + keep - 1, top.end(), better);
+      top.resize(keep);
+    };
+    float thresh = p.score_thresh;
+    for (int an = 0; an < s.anchor_s && keep > 0; ++an) {
+      const float *cls = x + entryOffset(s, p, i, an, 5 + c);
+      for (int64_t k = 0; k < hw; ++k) {
+        // the score is at most the objectness
+        const float obj = conf_i[an * hw + k];
+        if (obj < p.conf_thresh || !(obj > thresh)) continue;
+        const Candidate cand = {obj * sigmoid(cls[k]),
+                                static_cast<int32_t>(an * hw + k)};
+        if (!(cand.score > thresh)) continue;
+        top.push_back(cand);
+        if (top.size() < 2 * keep) continue;
+        // only scores above the worst of the top_k can still get in: the
+        // ties come later in index order
+        prune();
+        thresh = std::max(thresh, top[keep - 1].score);
+      }
+    }
+    prune();
+    std::sort(top.begin(), top.end(), better);
+
+    float *boxes_t = boxes + t * p.max_output * 4;
+    float *scores_t = scores + t * p.max_output;
+    std::fill(boxes_t, boxes_t + p.max_output * 4, 0.0f);
+    std::fill(scores_t, scores_t + p.max_output, 0.0f);
+    num[t] = nms(
+        top, p,
+        [&](int index, float *box) {
+          decode(x, img_size, anchors, s, p, i, index, box);
+        },
+        boxes_t, scores_t);
+  }
+}
+
+}  // namespace yolo_box_nms_cpu
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_YOLO_BOX_NMS_CPU_H_
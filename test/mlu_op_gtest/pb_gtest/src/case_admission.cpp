@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "case_admission.h"
+
+#include <algorithm>
+
+namespace mluoptest {
+
+CaseMemory estimateCaseMemory(const CaseHeader &header, size_t file_bytes) {
+  CaseMemory memory;
+  memory.host_bytes = file_bytes;
+  for (const auto &tensor : header.tensors) {
+    const size_t dtype_bytes = tensor.dtype_bytes > 0 ? tensor.dtype_bytes : 4;
+    const size_t data = tensor.elements * dtype_bytes;
+    // cpu_fp32_input/output, and mlu_fp32_output for outputs.
+    const size_t fp = tensor.elements * std::max<size_t>(dtype_bytes, 4);
+    memory.host_bytes += data + fp + (tensor.output ? fp : 0);
+    memory.device_bytes += data;
+  }
+  memory.device_bytes += header.workspace_size;
+  return memory;
+}
+
+bool MemoryAdmission::fits(const CaseMemory &memory) const {
+  if (cases_ == 0) {
+    return true;
+  }
+  auto fit = [](size_t budget, size_t in_flight, size_t bytes) {
+    return budget == 0 || (in_flight <= budget && bytes <= budget - in_flight);
+  };
+  return fit(budget_.host_bytes, in_flight_.host_bytes, memory.host_bytes) &&
+         fit(budget_.device_bytes, in_flight_.device_bytes,
+             memory.device_bytes);
+}
+
+void MemoryAdmission::take(const CaseMemory &memory) {
+  cases_ += 1;
+  in_flight_.host_bytes += memory.host_bytes;
+  in_flight_.device_bytes += memory.device_bytes;
+  peak_.host_bytes = std::max(peak_.host_bytes, in_flight_.host_bytes);
+  peak_.device_bytes = std::max(peak_.device_bytes, in_flight_.device_bytes);
+}
+
+bool MemoryAdmission::tryAdmit(const CaseMemory &memory) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!fits(memory)) {
+    return false;
+  }
+  take(memory);
+  return true;
+}
+
+void MemoryAdmission::admit(const CaseMemory &memory,
+                            std::function<void()> on_defer) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  if (!fits(memory)) {
+    if (on_defer) on_defer();
+    released_.wait(lk, [&]() { return fits(memory); });
+  }
+  take(memory);
+}
+
+void MemoryAdmission::release(const CaseMemory &memory) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    cases_ -= 1;
+    in_flight_.host_bytes -= memory.host_bytes;
+    in_flight_.device_bytes -= memory.device_bytes;
+  }
+  released_.notify_all();
+}
+
+CaseMemory MemoryAdmission::inFlight() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return in_flight_;
+}
+
+CaseMemory MemoryAdmission::peak() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return peak_;
+}
+
+}  // namespace mluoptest
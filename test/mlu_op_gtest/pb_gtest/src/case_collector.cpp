@@ -216,6 +216,30 @@ std::vector<std::string> Collector::list_by_case_dir(std::string case_dir) {
   return res;
 }
 
+void Collector::schedule_by_cost(std::vector<std::string> &case_names) {
+  if (global_var.total_shards_ <= 1 && global_var.thread_num_ <= 1) {
+    // one thread runs the cases in any order in the same time.
+    return;
+  }
+  auto costs =
+      mluoptest::estimateCaseCosts(case_names, &global_var.internal_info_);
+  if (global_var.total_shards_ > 1) {
+    auto shard = mluoptest::shardCases(costs, global_var.shard_index_,
+                                       global_var.total_shards_,
+                                       mluoptest::stableHash(op_name_));
+    std::vector<mluoptest::CaseCost> shard_costs;
+    shard_costs.reserve(shard.size());
+    for (auto idx : shard) {
+      shard_costs.emplace_back(std::move(costs[idx]));
+    }
+    costs.swap(shard_costs);
+  }
+  case_names.clear();
+  for (auto idx : mluoptest::lptOrder(costs)) {
+    case_names.emplace_back(costs[idx].case_path);
+  }
+}
+
 std::vector<std::string> Collector::list() {
   // for --case_path
   // vector<> size is 1
@@ -235,6 +259,8 @@ std::vector<std::string> Collector::list() {
     case_names = list_by_case_dir("../../test/mlu_op_gtest/pb_gtest/src/zoo/");
   }
 
+  schedule_by_cost(case_names);
+
   auto fisher_shuffle = [](std::vector<std::string> res,
                            int n) -> std::vector<std::string> {
     std::vector<std::string> res_n;
@@ -0,0 +1,334 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "case_cost.h"
+
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mlu_op_test.pb.h"
+
+namespace mluoptest {
+
+namespace {
+// a case without history costs about kCaseBaseSeconds (handle, memory and
+// kernel launch), plus parsing its file and generating, computing and
+// comparing its elements.
+constexpr double kCaseBaseSeconds = 0.05;
+constexpr double kSecondsPerByte = 5e-9;
+constexpr double kSecondsPerElement = 2e-8;
+
+namespace pb = google::protobuf;
+using pb::internal::WireFormatLite;
+
+// tags of the fields read below, any other wire type is an unknown field to
+// skip, as for a full parse.
+bool isVarint(uint32_t tag, int field) {
+  return tag == WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_VARINT);
+}
+
+bool isLengthDelimited(uint32_t tag, int field) {
+  return tag == WireFormatLite::MakeTag(
+                    field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+}
+
+// the length of a nested message, pushed as the limit. ReadLengthAndPushLimit
+// reads a missing length as 0.
+bool pushLength(pb::io::CodedInputStream *in,
+                pb::io::CodedInputStream::Limit *limit) {
+  uint32_t length;
+  if (!in->ReadVarint32(&length)) return false;
+  *limit = in->PushLimit(length);
+  return true;
+}
+
+// a nested message ends at its limit. ReadTag also stops at the end of the
+// file, which is a legitimate end for the top level message only.
+bool popLimit(pb::io::CodedInputStream *in,
+              pb::io::CodedInputStream::Limit limit) {
+  const bool ended = in->BytesUntilLimit() == 0 && in->ConsumedEntireMessage();
+  in->PopLimit(limit);
+  return ended;
+}
+
+// the product of the dims of a serialized Shape, plain or packed. int32 and
+// int64 dims are both varints, negative ones are invalid shapes.
+bool readPbShape(pb::io::CodedInputStream *in, size_t *elements) {
+  *elements = 1;
+  uint64_t dim;
+  auto read_dim = [in, elements, &dim]() {
+    if (!in->ReadVarint64(&dim)) return false;
+    *elements *= static_cast<int64_t>(dim) < 0 ? 0 : dim;
+    return true;
+  };
+  for (uint32_t tag = in->ReadTag(); tag != 0; tag = in->ReadTag()) {
+    if (isVarint(tag, Shape::kDimsFieldNumber)) {
+      if (!read_dim()) return false;
+    } else if (isLengthDelimited(tag, Shape::kDimsFieldNumber)) {
+      pb::io::CodedInputStream::Limit limit;
+      if (!pushLength(in, &limit)) return false;
+      while (in->BytesUntilLimit() > 0) {
+        if (!read_dim()) return false;
+      }
+      in->PopLimit(limit);
+    } else if (!WireFormatLite::SkipField(in, tag)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the shape and dtype of a serialized Tensor, its values are skipped.
+bool readPbTensor(pb::io::CodedInputStream *in, CaseTensorHeader *tensor) {
+  for (uint32_t tag = in->ReadTag(); tag != 0; tag = in->ReadTag()) {
+    if (isLengthDelimited(tag, Tensor::kShapeFieldNumber)) {
+      pb::io::CodedInputStream::Limit limit;
+      if (!pushLength(in, &limit) || !readPbShape(in, &tensor->elements) ||
+          !popLimit(in, limit)) {
+        return false;
+      }
+    } else if (isVarint(tag, Tensor::kDtypeFieldNumber)) {
+      uint32_t dtype;
+      if (!in->ReadVarint32(&dtype)) return false;
+      tensor->dtype_bytes =
+          DataType_IsValid(dtype)
+              ? dtypeNameBytes(DataType_Name(static_cast<DataType>(dtype)))
+              : 0;
+    } else if (!WireFormatLite::SkipField(in, tag)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the inputs, outputs and workspace_size of a serialized Node, without
+// parsing the values: skipping them goes through lseek, which does not stop
+// at the end of a cut file, so the position is checked against its size.
+bool readPbHeader(int fd, size_t file_bytes, CaseHeader *header) {
+  pb::io::FileInputStream file(fd);
+  pb::io::CodedInputStream in(&file);
+  // the same limit as Parser::readMessageFromFile.
+  in.SetTotalBytesLimit(INT_MAX, INT_MAX - 1);
+  for (uint32_t tag = in.ReadTag(); tag != 0; tag = in.ReadTag()) {
+    const bool input = isLengthDelimited(tag, Node::kInputFieldNumber);
+    if (input || isLengthDelimited(tag, Node::kOutputFieldNumber)) {
+      CaseTensorHeader tensor;
+      tensor.output = !input;
+      pb::io::CodedInputStream::Limit limit;
+      if (!pushLength(&in, &limit) || !readPbTensor(&in, &tensor) ||
+          !popLimit(&in, limit)) {
+        return false;
+      }
+      header->tensors.push_back(tensor);
+    } else if (isVarint(tag, Node::kWorkspaceSizeFieldNumber)) {
+      uint64_t workspace_size;
+      if (!in.ReadVarint64(&workspace_size)) return false;
+      header->workspace_size = workspace_size;
+    } else if (!WireFormatLite::SkipField(&in, tag)) {
+      return false;
+    }
+  }
+  return in.ConsumedEntireMessage() &&
+         static_cast<size_t>(in.CurrentPosition()) == file_bytes;
+}
+
+// a text Node is small enough to be parsed whole.
+bool readPrototxtHeader(int fd, CaseHeader *header) {
+  pb::io::FileInputStream file(fd);
+  Node node;
+  if (!pb::TextFormat::Parse(&file, &node)) {
+    return false;
+  }
+  auto add = [header](const Tensor &tensor, bool output) {
+    CaseTensorHeader item;
+    item.output = output;
+    if (tensor.has_shape()) {
+      item.elements = 1;
+      for (auto dim : tensor.shape().dims()) {
+        item.elements *= dim < 0 ? 0 : static_cast<size_t>(dim);
+      }
+    }
+    if (tensor.has_dtype()) {
+      item.dtype_bytes = dtypeNameBytes(DataType_Name(tensor.dtype()));
+    }
+    header->tensors.push_back(item);
+  };
+  for (const auto &tensor : node.input()) add(tensor, false);
+  for (const auto &tensor : node.output()) add(tensor, true);
+  header->workspace_size = node.workspace_size();
+  return true;
+}
+}  // namespace
+
+size_t dtypeNameBytes(const std::string &dtype) {
+  static const std::unordered_map<std::string, size_t> bytes = {
+      {"DTYPE_HALF", 2},         {"DTYPE_FLOAT", 4},
+      {"DTYPE_INT8", 1},         {"DTYPE_INT16", 2},
+      {"DTYPE_INT31", 4},        {"DTYPE_INT32", 4},
+      {"DTYPE_INT64", 8},        {"DTYPE_UINT8", 1},
+      {"DTYPE_UINT16", 2},       {"DTYPE_UINT32", 4},
+      {"DTYPE_UINT64", 8},       {"DTYPE_BOOL", 1},
+      {"DTYPE_DOUBLE", 8},       {"DTYPE_COMPLEX_HALF", 4},
+      {"DTYPE_COMPLEX_FLOAT", 8}, {"DTYPE_BFLOAT16", 2}};
+  auto it = bytes.find(dtype);
+  return it == bytes.end() ? 0 : it->second;
+}
+
+size_t CaseHeader::elementCount() const {
+  size_t count = 0;
+  for (const auto &tensor : tensors) count += tensor.elements;
+  return count;
+}
+
+bool readCaseHeader(const std::string &case_path, CaseHeader *header) {
+  *header = CaseHeader();
+  auto ends_with = [&case_path](const std::string &suffix) {
+    return case_path.size() >= suffix.size() &&
+           case_path.compare(case_path.size() - suffix.size(), suffix.size(),
+                             suffix) == 0;
+  };
+  const int fd = open(case_path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat file_stat;
+  bool ret = false;
+  if (fstat(fd, &file_stat) != 0) {
+    ret = false;
+  } else if (ends_with(".pb")) {
+    ret = readPbHeader(fd, file_stat.st_size, header);
+  } else if (ends_with(".prototxt") &&
+             static_cast<size_t>(file_stat.st_size) <= kCaseHeaderScanBytes) {
+    ret = readPrototxtHeader(fd, header);
+  }
+  close(fd);
+  if (!ret) {
+    *header = CaseHeader();
+  }
+  return ret;
+}
+
+bool caseElementCount(const std::string &case_path, size_t *count) {
+  CaseHeader header;
+  const bool ret = readCaseHeader(case_path, &header);
+  *count = header.elementCount();
+  return ret;
+}
+
+std::vector<CaseCost> estimateCaseCosts(
+    const std::vector<std::string> &case_paths, TestInternalInfo *history) {
+  std::vector<CaseCost> costs(case_paths.size());
+  double history_seconds = 0., estimated_seconds = 0.;
+  for (size_t i = 0; i < case_paths.size(); ++i) {
+    auto &cost = costs[i];
+    cost.case_path = case_paths[i];
+    struct stat file_stat;
+    if (stat(cost.case_path.c_str(), &file_stat) == 0) {
+      cost.file_bytes = file_stat.st_size;
+    }
+    if (!caseElementCount(cost.case_path, &cost.elements)) {
+      cost.elements = 0;
+    }
+    cost.estimate = kCaseBaseSeconds + cost.file_bytes * kSecondsPerByte +
+                    cost.elements * kSecondsPerElement;
+    cost.seconds = cost.estimate;
+    double seconds;
+    if (history != nullptr &&
+        history->case_wall_seconds(cost.case_path, &seconds)) {
+      history_seconds += seconds;
+      estimated_seconds += cost.estimate;
+      cost.seconds = seconds;
+      cost.history = true;
+    }
+  }
+  // the constants above only know the relative cost, the history tells how
+  // fast this op on this machine really is.
+  if (history_seconds > 0. && estimated_seconds > 0.) {
+    const double scale = history_seconds / estimated_seconds;
+    for (auto &cost : costs) {
+      if (!cost.history) cost.seconds *= scale;
+    }
+  }
+  return costs;
+}
+
+std::vector<size_t> lptOrder(const std::vector<CaseCost> &costs) {
+  std::vector<size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) {
+    return costs[a].seconds > costs[b].seconds;
+  });
+  return order;
+}
+
+std::vector<size_t> shardCases(const std::vector<CaseCost> &costs,
+                               int shard_index, int total_shards,
+                               uint64_t salt) {
+  std::vector<size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (total_shards <= 1) {
+    return order;
+  }
+  // the estimates, not the history: every machine has its own history,
+  // and the shards have to agree on who runs what.
+  std::sort(order.begin(), order.end(), [&costs](size_t a, size_t b) {
+    if (costs[a].estimate != costs[b].estimate) {
+      return costs[a].estimate > costs[b].estimate;
+    }
+    return costs[a].case_path < costs[b].case_path;
+  });
+  const size_t shards = total_shards;
+  const size_t first = salt % shards;
+  std::vector<double> loads(shards, 0.);
+  std::vector<size_t> mine;
+  for (size_t idx : order) {
+    size_t target = first;
+    for (size_t k = 1; k < shards; ++k) {
+      const size_t s = (first + k) % shards;
+      if (loads[s] < loads[target]) target = s;
+    }
+    loads[target] += costs[idx].estimate;
+    if (target == static_cast<size_t>(shard_index)) mine.push_back(idx);
+  }
+  std::sort(mine.begin(), mine.end());
+  return mine;
+}
+
+uint64_t stableHash(const std::string &str) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : str) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace mluoptest
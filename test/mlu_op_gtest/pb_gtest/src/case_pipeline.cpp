@@ -0,0 +1,155 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "case_pipeline.h"
+
+#include <chrono>  // NOLINT
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>  // NOLINT
+
+namespace mluoptest {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// counting semaphore for the cases in flight.
+class Slots {
+ public:
+  explicit Slots(size_t num) : free_(num) {}
+  void acquire() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    cond_.wait(lk, [this]() { return free_ > 0; });
+    --free_;
+  }
+  void release() {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      ++free_;
+    }
+    cond_.notify_one();
+  }
+
+ private:
+  size_t free_;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+};
+}  // namespace
+
+void CasePipeline::addStage(const std::string &name, size_t threads,
+                            StageFunc func) {
+  stages_.push_back(func);
+  PipelineStageStats stats;
+  stats.name = name;
+  stats.threads = threads > 0 ? threads : 1;
+  stats_.push_back(stats);
+}
+
+void CasePipeline::run(size_t num) {
+  const auto start = Clock::now();
+  const size_t stage_num = stages_.size();
+  std::vector<std::unique_ptr<BoundedQueue<size_t>>> queues;
+  for (size_t s = 0; s < stage_num; ++s) {
+    queues.emplace_back(new BoundedQueue<size_t>(queue_capacity_));
+  }
+  Slots slots(max_in_flight_ > 0 ? max_in_flight_ : 1);
+  std::mutex stats_mtx;
+
+  auto work = [&](size_t s) {
+    if (thread_init_) thread_init_();
+    PipelineStageStats local;
+    size_t index = 0;
+    for (;;) {
+      auto wait_start = Clock::now();
+      if (!queues[s]->pop(&index)) {
+        break;
+      }
+      local.starved_s += secondsSince(wait_start);
+      auto busy_start = Clock::now();
+      stages_[s](index);
+      local.busy_s += secondsSince(busy_start);
+      local.cases += 1;
+      if (s + 1 < stage_num) {
+        auto push_start = Clock::now();
+        queues[s + 1]->push(index);
+        local.blocked_s += secondsSince(push_start);
+      } else {
+        slots.release();
+      }
+    }
+    std::lock_guard<std::mutex> lk(stats_mtx);
+    stats_[s].cases += local.cases;
+    stats_[s].busy_s += local.busy_s;
+    stats_[s].starved_s += local.starved_s;
+    stats_[s].blocked_s += local.blocked_s;
+  };
+
+  std::vector<std::vector<std::thread>> workers(stage_num);
+  for (size_t s = 0; s < stage_num; ++s) {
+    for (size_t t = 0; t < stats_[s].threads; ++t) {
+      workers[s].emplace_back(work, s);
+    }
+  }
+  if (stage_num > 0) {
+    for (size_t i = 0; i < num; ++i) {
+      slots.acquire();
+      if (admit_) admit_(i);
+      queues[0]->push(i);
+    }
+  }
+  // a stage is done once the previous one is done and its queue drained.
+  for (size_t s = 0; s < stage_num; ++s) {
+    queues[s]->close();
+    for (auto &worker : workers[s]) {
+      worker.join();
+    }
+  }
+  wall_s_ = secondsSince(start);
+}
+
+std::string CasePipeline::report() const {
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2);
+  oss << "[ PIPELINE ]: " << std::setw(10) << std::left << "stage"
+      << std::right << std::setw(8) << "threads" << std::setw(8) << "cases"
+      << std::setw(11) << "busy(s)" << std::setw(9) << "util(%)"
+      << std::setw(12) << "starved(s)" << std::setw(12) << "blocked(s)"
+      << "\n";
+  for (const auto &stats : stats_) {
+    const double capacity = stats.threads * wall_s_;
+    oss << "[ PIPELINE ]: " << std::setw(10) << std::left << stats.name
+        << std::right << std::setw(8) << stats.threads << std::setw(8)
+        << stats.cases << std::setw(11) << stats.busy_s << std::setw(9)
+        << (capacity > 0 ? stats.busy_s / capacity * 100 : 0.0)
+        << std::setw(12) << stats.starved_s << std::setw(12)
+        << stats.blocked_s << "\n";
+  }
+  oss << "[ PIPELINE ]: wall time " << wall_s_ << " s\n";
+  return oss.str();
+}
+
+}  // namespace mluoptest
@@ -104,6 +104,12 @@ void Executor::init(const std::shared_ptr<ExecuteContext> ectx) {
 
 void Executor::setup(std::string file,
                      const std::shared_ptr<ExecuteConfig> ecfg) {
+  prepare(file, ecfg);
+  upload();
+}
+
+void Executor::prepare(std::string file,
+                       const std::shared_ptr<ExecuteConfig> ecfg) {
   exe_config_ = ecfg;
 
   eva_res_.mlu.kernel_tracing_enabled = true;
@@ -116,8 +122,12 @@ void Executor::setup(std::string file,
 
   clusterLimitCheck();
 
+  if (global_var.enable_gtest_internal_perf && global_var.thread_num_ == 1) {
+    // so that the peak rss of getGtestInternalInfo() is of this case only
+    proc_rss_peak_reset();
+  }
   recordGtestTimePoint("before_parse");
-  parser_->parse(file);
+  recordGtestSpan("parse", [&]() { parser_->parse(file); });
   recordGtestTimePoint("after_parse");
   eva_res_.case_path = file;
   VLOG(4) << "param check.";
@@ -130,7 +140,7 @@ void Executor::setup(std::string file,
   createTensors();
 
   VLOG(4) << "Host malloc.";
-  hostMalloc();
+  recordGtestSpan("host_malloc", [this]() { hostMalloc(); });
   recordGtestTimePoint("after_host_malloc");
 
   getPerfTestMode();
@@ -142,30 +152,35 @@ void Executor::setup(std::string file,
   if (mlu_need_host_data) {
     if (parser_->device() == CPU) {
       VLOG(4) << "Host malloc (for cpu compute).";
-      baselineInputMalloc();
+      recordGtestSpan("host_malloc", [this]() { baselineInputMalloc(); });
       recordGtestTimePoint("after_baseline_input_malloc");
       VLOG(4) << "Init data (random data for cpu compute).";
-      initBaselineInput();  // init fp32 cpu data
+      // init fp32 cpu data
+      recordGtestSpan("random_init", [this]() { initBaselineInput(); });
       recordGtestTimePoint("after_baseline_input_init");
       VLOG(4) << "Cast dtype (host fp32 -> mlu X).";
-      castIn();  // init host data(copy to host_data).
+      // init host data(copy to host_data).
+      recordGtestSpan("cast_in", [this]() { castIn(); });
     } else {
       flag_quant_mode_ = NO_QUANT;
       VLOG(4) << "Init data from prototxt.";
-      initHostData();  // read data to host_data directly
+      // read data to host_data directly
+      recordGtestSpan("init_host_data", [this]() { initHostData(); });
       recordGtestTimePoint("after_init_host_data");
       VLOG(4) << "Set quant param to tensor descs.";
       setQuantizedParam();  // set quant param
     }
   }
   hostReorder();
+}
 
+void Executor::upload() {
   VLOG(4) << "Device malloc.";
   setMiscellaneousParam();
-  deviceMalloc();
+  recordGtestSpan("device_malloc", [this]() { deviceMalloc(); });
   recordGtestTimePoint("after_device_malloc");
   VLOG(4) << "Copy data from host to device.";
-  copyIn();
+  recordGtestSpan("copy_in", [this]() { copyIn(); });
   recordGtestTimePoint("after_copy_in");
 
   VLOG(4) << "switch to origin data buffer.";
@@ -178,9 +193,10 @@ void Executor::setup(std::string file,
   prepareComputeParam();
 
   VLOG(4) << "Device malloc (for workspace).";
-  workspaceMalloc();
-
-  deviceRestSpaceMalloc();
+  recordGtestSpan("device_malloc", [this]() {
+    workspaceMalloc();
+    deviceRestSpaceMalloc();
+  });
 
   // when get MLUOP_GTEST_FILL_RAM env,
   // fill nram/sram/warm for nan or inf before compute for each case
@@ -258,6 +274,11 @@ void Executor::enableKernelTracing() {
 }
 
 void Executor::launch() {
+  recordGtestSpan("launch", [this]() { launchImpl(); });
+  recordGtestTimePoint("after_launch");
+}
+
+void Executor::launchImpl() {
   // for fusedOp, get layer by layer time
   if (need_compute_by_layer_) {
     launchAndGetTime(BY_LAYER, repeat_val_1);
@@ -283,7 +304,6 @@ void Executor::launch() {
                   &Executor::stopInterfaceListening);
   launchAndGetTime(NORMAL, repeat_val_1);
   interface_listening_handle->release();
-  recordGtestTimePoint("after_launch");
 }
 
 bool Executor::ready() {
@@ -300,7 +320,9 @@ bool Executor::ready() {
 }
 
 void Executor::sync() {
-  GTEST_CHECK(cnrtSuccess == cnrtQueueSync(exe_context_->queue));
+  recordGtestSpan("sync", [this]() {
+    GTEST_CHECK(cnrtSuccess == cnrtQueueSync(exe_context_->queue));
+  });
   recordGtestTimePoint("after_sync");
 }
 
@@ -589,13 +611,19 @@ void Executor::getTestInfo() {
 }
 
 void Executor::postProcessAfterLaunch() {
+  if (fetchMluOutput()) {
+    computeBaseline();
+  }
+}
+
+bool Executor::fetchMluOutput() {
   // comupte for perf test
   const char *zero_element = std::getenv("MLUOP_GTEST_BUILD_ZERO_ELEMENT");
   if (zero_element != NULL) {
     std::string env_str = zero_element;
     int env_num = std::stoi(env_str);
     if (env_num == 1) {
-      return;
+      return false;
     }
   }
 
@@ -609,36 +637,43 @@ void Executor::postProcessAfterLaunch() {
   eva_res_.compute_completed = true;
 
   if (exe_config_->mlu_only) {
-    return;
+    return false;
   }
 
   // The rest steps are for computing diffs
   VLOG(4) << "Copy data from device to host.";
   // mlu_only should never get here as host space is not allocated
-  copyOut();
+  recordGtestSpan("copy_out", [this]() { copyOut(); });
   recordGtestTimePoint("after_copy_out");
+  return true;
+}
 
+void Executor::computeBaseline() {
   VLOG(4) << "Host malloc (for baseline output, fp32)";
-  baselineOutputMallocFunc(this);
+  recordGtestSpan("host_malloc", [this]() { baselineOutputMallocFunc(this); });
   if (parser_->device() == CPU) {
     VLOG(4) << "Begin cpu compute.";
-    cpuCompute();
-    // if out dtype is half, cast cpu data from float to half to float,
-    // consistent with mlu.
-    castHalfOuput();
+    recordGtestSpan("cpu_baseline", [this]() {
+      cpuCompute();
+      // if out dtype is half, cast cpu data from float to half to float,
+      // consistent with mlu.
+      castHalfOuput();
+    });
     VLOG(4) << "End cpu compute.";
   } else {
     // baseline output
     VLOG(4) << "Read in baseline device outputs.";
-    getBaselineOutputFunc(this);  // read in baseline output
+    // read in baseline output
+    recordGtestSpan("baseline_output",
+                    [this]() { getBaselineOutputFunc(this); });
     recordGtestTimePoint("after_get_baseline_output");
   }
 
   VLOG(4) << "Host malloc (for mlu output, fp32).";
-  mluOutputMallocFunc(this);
+  recordGtestSpan("host_malloc", [this]() { mluOutputMallocFunc(this); });
   recordGtestTimePoint("after_mlu_output_malloc");
 
-  castOutFunc(this);
+  recordGtestSpan("cast_out", [this]() { castOutFunc(this); });
   recordGtestTimePoint("after_cast_out");
 
   diffPreprocess();
@@ -692,7 +727,11 @@ void Executor::getAllTestResult() {
 
 EvaluateResult Executor::teardown() {
   postProcessAfterLaunch();
-  getAllTestResult();
+  return evaluate();
+}
+
+EvaluateResult Executor::evaluate() {
+  recordGtestSpan("evaluation", [this]() { getAllTestResult(); });
   getTestInfo();
   return eva_res_;
 }
@@ -798,6 +837,8 @@ void Executor::getGtestInternalInfo() {
                                  std::get<1>(record) - time_point_init_)
                                  .count()));
   }
+  eva_res_.gtest.op_name = eva_res_.op_name;
+  eva_res_.gtest.peak_rss_bytes = proc_rss_peak();
   eva_res_.gtest.parsed_file_size = parser_->getParsedFileSize();
   eva_res_.gtest.parsed_cost_seconds = parser_->getParsedCostSeconds();
   global_var.internal_info_.record_case(eva_res_.case_path, eva_res_.gtest);
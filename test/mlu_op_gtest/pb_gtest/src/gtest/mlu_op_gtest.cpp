@@ -22,6 +22,7 @@
  *************************************************************************/
 #include <malloc.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <algorithm>
 #include <iterator>
 #include <functional>
@@ -33,6 +34,7 @@
 #include "mlu_op_gtest.h"
 #include "op_register.h"
 #include "internal_perf.h"
+#include "case_admission.h"
 #include "gtest/mlu_op_test_case.h"
 
 extern mluoptest::GlobalVar mluoptest::global_var;
@@ -111,6 +113,7 @@ void TestSuite::Thread1() {
 
     // TODO(None): modify ctor, set op_name in ctor.
     exe->result()->op_name = op_name_;
+    exe->result()->gtest.case_index = case_idx;
     exe->init(ectx_);
     exe->setup(case_path_vec_[case_idx], ecfg_);
     exe->launch();
@@ -140,6 +143,42 @@ void TestSuite::Thread1() {
   }
 }
 
+// estimated memory of a case, from its header only. the estimate is skipped
+// when there is no budget to check it against.
+static mluoptest::CaseMemory caseMemory(
+    const std::string &case_path, const mluoptest::MemoryAdmission &admission) {
+  if (!admission.enabled()) {
+    return mluoptest::CaseMemory();
+  }
+  mluoptest::CaseHeader header;
+  mluoptest::readCaseHeader(case_path, &header);
+  struct stat file_stat;
+  const size_t file_bytes =
+      stat(case_path.c_str(), &file_stat) == 0 ? file_stat.st_size : 0;
+  return mluoptest::estimateCaseMemory(header, file_bytes);
+}
+
+static std::shared_ptr<mluoptest::MemoryAdmission> memoryAdmission() {
+  return std::make_shared<mluoptest::MemoryAdmission>(
+      static_cast<size_t>(global_var.host_memory_budget_) << 20,
+      static_cast<size_t>(global_var.device_memory_budget_) << 20);
+}
+
+static void printDeferred(const std::string &case_path,
+                          const mluoptest::CaseMemory &memory) {
+  printf("[ DEFERRED ]: %s (host %zu MB, device %zu MB estimated)\n",
+         case_path.c_str(), memory.host_bytes >> 20,
+         memory.device_bytes >> 20);  // printf is thread-safe
+}
+
+static void printMemoryPeak(const mluoptest::MemoryAdmission &admission) {
+  if (admission.enabled()) {
+    auto peak = admission.peak();
+    printf("[ MEMORY   ]: peak estimate in flight host %zu MB, device %zu MB\n",
+           peak.host_bytes >> 20, peak.device_bytes >> 20);
+  }
+}
+
 // wrap a executor and it status flag
 // task buffer is a vector and each element is an ExecutorWrap.
 // when setup, set in_used as true, then setup(), then set exe.
@@ -151,6 +190,8 @@ struct ExecutorWrap {
   }
 
   std::shared_ptr<mluoptest::Executor> exe = nullptr;
+  size_t case_idx = 0;  // index in case_path_vec_, where its result goes.
+  mluoptest::CaseMemory memory;  // given back to admission in teardown.
   // flag for teardown polling and pick up.
   // if 1 thread choose this exe, other thread shouldn't choose it.
   bool been_chosen = false;
@@ -238,7 +279,9 @@ struct Context {
   // so it is not fifo. so use vector.
   std::vector<std::shared_ptr<ExecutorWrap>> exe_vec;
 
-  std::list<mluoptest::EvaluateResult> results;
+  // one slot per case, only written by the thread running that case.
+  std::vector<mluoptest::EvaluateResult> results;
+  std::shared_ptr<mluoptest::MemoryAdmission> admission;
   // set current device for all thread.
   std::set<std::thread::id, std::greater<std::thread::id>> been_initialized;
 };
@@ -255,6 +298,8 @@ void TestSuite::ThreadX() {
   size_t max_exe_vec_num = thread_num * 1.5;
   auto thread_pool = std::make_shared<mluoptest::ThreadPool>(thread_num);
   auto context = std::make_shared<Context>(max_exe_vec_num);
+  context->results.resize(case_path_vec_.size());
+  context->admission = memoryAdmission();
 
   // set device for each thread.
   auto set_device = [](std::shared_ptr<Context> ctx) {
@@ -298,6 +343,7 @@ void TestSuite::ThreadX() {
   auto teardown = [](size_t id, std::shared_ptr<Context> ctx) {
     mluoptest::EvaluateResult res;
     auto exe = ctx->exe_vec[id]->exe;
+    auto case_idx = ctx->exe_vec[id]->case_idx;
     try {
       if (!global_var.use_default_queue_) {
         // when we use default cnrt queue, sync has been called in setup phase
@@ -317,17 +363,18 @@ void TestSuite::ThreadX() {
     printf("[ TEARDOWN ]: %s\n",
            res.case_path.c_str());  // printf is thread-safe
     exe.reset();                    // free this exe.
+    ctx->results[case_idx] = std::move(res);
+    ctx->admission->release(ctx->exe_vec[id]->memory);
     {
       std::lock_guard<std::mutex> lk(ctx->mtx);
       ctx->exe_vec[id]->reset();  // reset this position as idle.
-      ctx->results.emplace_back(res);
     }
     // this thread is free, wake master thread to schedule new task.
     ctx->cond.notify_all();
   };
 
   auto setup = [](std::string op_name, std::string case_path,
-                  std::shared_ptr<Context> ctx, size_t pos) {
+                  size_t case_idx, std::shared_ptr<Context> ctx, size_t pos) {
     printf("[ SETUP    ]: %s\n", case_path.c_str());  // printf is thread-safe
     // get corresponding executor context which saved handle queue ...
     auto ecw = ctx->ecw_vec[pos];
@@ -339,6 +386,7 @@ void TestSuite::ThreadX() {
       exe = getOpExecutor(op_name);
       // TODO(None): modify ctor, set op_name in ctor.
       exe->result()->op_name = op_name;
+      exe->result()->gtest.case_index = case_idx;
       exe->init(ecw->ectx);
       exe->setup(case_path, ecfg_);
       exe->launch();
@@ -354,6 +402,7 @@ void TestSuite::ThreadX() {
       exe = nullptr;
     } catch (std::exception &e) {
       ctx->ecw_vec[pos]->reset();  // reset running env
+      ctx->admission->release(ctx->exe_vec[pos]->memory);
       ctx->exe_vec[pos]->reset();  // mark pos as free
 
       mluoptest::EvaluateResult res;
@@ -362,10 +411,7 @@ void TestSuite::ThreadX() {
       res.case_path = case_path;
       res.what.emplace_back(
           "Unknown error: maybe exception raised, other info is lost.");
-      {
-        std::lock_guard<std::mutex> lk(ctx->mtx);
-        ctx->results.emplace_back(res);
-      }
+      ctx->results[case_idx] = res;
       ADD_FAILURE() << "MLUOPGTEST: catched " << e.what() << " in setup. (of "
                     << res.case_path << ") tid: " << std::this_thread::get_id();
     }
@@ -376,6 +422,23 @@ void TestSuite::ThreadX() {
     thread_pool->enqueue(set_device, context);
   }
 
+  // start case i only if its memory fits next to the cases running, it is
+  // estimated once however long it is deferred.
+  size_t memory_idx = case_path_vec_.size();
+  mluoptest::CaseMemory memory;
+  auto admit = [&](size_t i) -> bool {
+    if (memory_idx != i) {
+      memory_idx = i;
+      memory = caseMemory(case_path_vec_[i], *context->admission);
+      if (!context->admission->tryAdmit(memory)) {
+        printDeferred(case_path_vec_[i], memory);
+        return false;
+      }
+      return true;
+    }
+    return context->admission->tryAdmit(memory);
+  };
+
   for (size_t i = 0;;) {
     auto teardown_pos = any_done(context);
     if (teardown_pos != -1) {
@@ -385,10 +448,13 @@ void TestSuite::ThreadX() {
       auto it =
           find_if(context->exe_vec.begin(), context->exe_vec.end(),
                   [](std::shared_ptr<ExecutorWrap> e) { return e->is_free(); });
-      if (it != context->exe_vec.end() && i < case_path_vec_.size()) {
+      if (it != context->exe_vec.end() && i < case_path_vec_.size() &&
+          admit(i)) {
         (*it)->used();  // occupy this position
+        (*it)->case_idx = i;
+        (*it)->memory = memory;
         auto setup_pos = std::distance(context->exe_vec.begin(), it);
-        thread_pool->enqueue(setup, op_name_, case_path_vec_[i], context,
+        thread_pool->enqueue(setup, op_name_, case_path_vec_[i], i, context,
                              setup_pos);
         i++;
       } else {
@@ -414,9 +480,11 @@ void TestSuite::ThreadX() {
 
   // join thread pool
   thread_pool.reset();
+  printMemoryPeak(*context->admission);
 
-  // get results.
-  res_ = context->results;
+  // get results, in case order.
+  res_.assign(std::make_move_iterator(context->results.begin()),
+              std::make_move_iterator(context->results.end()));
 
   // free all.
   context->destroy();
@@ -425,9 +493,154 @@ void TestSuite::ThreadX() {
   ASSERT_EQ(case_path_vec_.size(), res_.size());
 }
 
+// one case in the pipeline, only touched by the stage it is in.
+struct PipelineCase {
+  std::shared_ptr<mluoptest::Executor> exe = nullptr;
+  std::shared_ptr<ExecuteContextWrap> ecw = nullptr;
+  mluoptest::EvaluateResult res;
+  mluoptest::CaseMemory memory;
+  bool failed = false;  // the later stages are skipped, res has the error.
+  bool need_baseline = true;
+};
+
+// thread num of each stage, from --pipeline_threads or --thread.
+static std::vector<size_t> pipelineThreads(size_t thread_num) {
+  std::vector<size_t> threads = {thread_num, thread_num, thread_num, 1, 1};
+  if (global_var.pipeline_threads_.empty()) {
+    return threads;
+  }
+  std::vector<size_t> parsed;
+  std::stringstream ss(global_var.pipeline_threads_);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item.size() > 6 || !mluoptest::isNumber(item) ||
+        std::stoi(item) <= 0) {
+      break;
+    }
+    parsed.push_back(std::stoi(item));
+  }
+  if (parsed.size() != threads.size()) {
+    LOG(ERROR) << "MLUOPGTEST: --pipeline_threads should be 5 positive "
+                  "numbers, got "
+               << global_var.pipeline_threads_ << ", use default.";
+    return threads;
+  }
+  return parsed;
+}
+
+void TestSuite::Pipeline() {
+  ASSERT_EQ(cnrtSetDevice(global_var.dev_id_), cnrtSuccess);
+
+  size_t thread_num = global_var.thread_num_;
+  auto threads = pipelineThreads(thread_num);
+  // every case in flight holds its host data, keep it near ThreadX.
+  size_t max_in_flight = thread_num * 2;
+  mluoptest::CasePipeline pipeline(thread_num, max_in_flight);
+  pipeline.setThreadInit(
+      []() { ASSERT_EQ(cnrtSetDevice(global_var.dev_id_), cnrtSuccess); });
+
+  std::vector<PipelineCase> cases(case_path_vec_.size());
+  auto admission = memoryAdmission();
+  if (admission->enabled()) {
+    pipeline.setAdmit([&](size_t idx) {
+      auto &c = cases[idx];
+      c.memory = caseMemory(case_path_vec_[idx], *admission);
+      admission->admit(c.memory,
+                       [&]() { printDeferred(case_path_vec_[idx], c.memory); });
+    });
+  }
+  // one execute context per case in flight, so one is always free.
+  std::mutex ecw_mtx;
+  std::vector<std::shared_ptr<ExecuteContextWrap>> all_ecw, free_ecw;
+  for (size_t i = 0; i < max_in_flight; ++i) {
+    all_ecw.emplace_back(std::make_shared<ExecuteContextWrap>());
+  }
+  free_ecw = all_ecw;
+
+  auto run_stage = [&](size_t idx, const char *stage,
+                       std::function<void(PipelineCase &)> func) {
+    auto &c = cases[idx];
+    if (c.failed) return;
+    try {
+      func(c);
+    } catch (std::exception &e) {
+      c.failed = true;
+      if (c.ecw) c.ecw->reset();  // reset running env
+      if (c.exe) c.res = *(c.exe->result());
+      c.res.op_name = op_name_;
+      c.res.case_path = case_path_vec_[idx];
+      c.res.what.emplace_back(
+          "Unknown error: maybe exception raised, other info is lost.");
+      ADD_FAILURE() << "MLUOPGTEST: catched " << e.what() << " in " << stage
+                    << ". (of " << case_path_vec_[idx]
+                    << ") tid: " << std::this_thread::get_id();
+    }
+  };
+
+  pipeline.addStage("prepare", threads[0], [&](size_t idx) {
+    run_stage(idx, "prepare", [&](PipelineCase &c) {
+      printf("[ SETUP    ]: %s\n", case_path_vec_[idx].c_str());
+      {
+        std::lock_guard<std::mutex> lk(ecw_mtx);
+        c.ecw = free_ecw.back();
+        free_ecw.pop_back();
+      }
+      c.ecw->init();  // if initialized, this func will return directly.
+      c.exe = getOpExecutor(op_name_);
+      c.exe->result()->op_name = op_name_;
+      c.exe->result()->gtest.case_index = idx;
+      c.exe->init(c.ecw->ectx);
+      c.exe->prepare(case_path_vec_[idx], ecfg_);
+    });
+  });
+  pipeline.addStage("device", threads[1], [&](size_t idx) {
+    run_stage(idx, "device", [&](PipelineCase &c) {
+      c.exe->upload();
+      c.exe->launch();
+      c.exe->sync();
+      c.need_baseline = c.exe->fetchMluOutput();
+    });
+  });
+  pipeline.addStage("baseline", threads[2], [&](size_t idx) {
+    run_stage(idx, "baseline", [&](PipelineCase &c) {
+      if (c.need_baseline) c.exe->computeBaseline();
+    });
+  });
+  pipeline.addStage("evaluate", threads[3], [&](size_t idx) {
+    run_stage(idx, "evaluate",
+              [&](PipelineCase &c) { c.res = c.exe->evaluate(); });
+  });
+  pipeline.addStage("teardown", threads[4], [&](size_t idx) {
+    auto &c = cases[idx];
+    printf("[ TEARDOWN ]: %s\n", case_path_vec_[idx].c_str());
+    c.exe.reset();  // free this exe.
+    if (c.ecw) {
+      std::lock_guard<std::mutex> lk(ecw_mtx);
+      free_ecw.push_back(c.ecw);
+      c.ecw.reset();
+    }
+    if (admission->enabled()) admission->release(c.memory);
+  });
+
+  pipeline.run(case_path_vec_.size());
+  std::cout << pipeline.report();
+  printMemoryPeak(*admission);
+
+  // results in case order.
+  for (auto &c : cases) {
+    res_.emplace_back(std::move(c.res));
+  }
+  for (auto &ecw : all_ecw) {
+    ecw->destroy();
+  }
+  ASSERT_EQ(case_path_vec_.size(), res_.size());
+}
+
 void TestSuite::Run() {
   if (global_var.thread_num_ == 1) {
     Thread1();
+  } else if (global_var.pipeline_) {
+    Pipeline();
   } else {
     ThreadX();
   }
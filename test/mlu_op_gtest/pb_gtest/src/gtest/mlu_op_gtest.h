@@ -37,6 +37,7 @@
 #include "executor.h"
 #include "evaluator.h"
 #include "case_collector.h"
+#include "case_pipeline.h"
 #include "thread_pool.h"
 #include "tools.h"
 
@@ -69,6 +70,7 @@ class TestSuite : public TestWithParam<std::tuple<std::string, size_t>> {
  private:
   void Thread1();
   void ThreadX();
+  void Pipeline();
 
   std::list<mluoptest::EvaluateResult> res_;
 
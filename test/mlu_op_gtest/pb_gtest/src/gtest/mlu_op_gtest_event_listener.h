@@ -58,6 +58,17 @@ class MLUOPGtestInternalPerfEventListener
     if (fout == NULL) {
       GTEST_LOG_(FATAL) << "Unable to open file \"" << output_file_name << "\"";
     }
+
+    // the same cases as json, with the per-op summary at the end.
+    std::string json_file_name =
+        fileprefix + "_" + std::to_string(iteration) + json_ext;
+    json_fout = testing::internal::posix::FOpen(json_file_name.c_str(), "w");
+    if (json_fout == NULL) {
+      GTEST_LOG_(FATAL) << "Unable to open file \"" << json_file_name << "\"";
+    }
+    fprintf(json_fout, "{\"cases\": [");
+    need_json_sep = false;
+    global_var.internal_info_.clear_summary();
   }
 
   void OnTestIterationEnd(const ::testing::UnitTest& unit_test,
@@ -67,6 +78,16 @@ class MLUOPGtestInternalPerfEventListener
       fclose(fout);
     }
     fout = NULL;
+
+    auto summary = global_var.internal_info_.summarize();
+    if (json_fout) {
+      fprintf(json_fout, "\n], \"summary\": %s}\n",
+              TestInternalInfo::summary_to_json(summary).c_str());
+      fclose(json_fout);
+    }
+    json_fout = NULL;
+    std::cout << "[ INTERNAL PERF ]: per-op time of stages (ms)\n"
+              << TestInternalInfo::summary_to_table(summary);
   }
 
   void OnTestStart(const ::testing::TestInfo& test_info) override {
@@ -113,6 +134,11 @@ class MLUOPGtestInternalPerfEventListener
       }
       std::string serialized(item.serialize_to_csv());
       fprintf(fout, CSV_BODY_TOKEN "%s\n", serialized.c_str());
+      if (json_fout) {
+        fprintf(json_fout, "%s\n%s", need_json_sep ? "," : "",
+                item.serialize_to_json().c_str());
+        need_json_sep = true;
+      }
     });
     // clear internal state
     global_var.internal_info_.clear_cases();
@@ -143,6 +169,9 @@ class MLUOPGtestInternalPerfEventListener
   FILE* fout = NULL;
   std::string fileprefix = "mluop_gtest_internal_perf";
   std::string file_ext = ".csv";
+  FILE* json_fout = NULL;
+  bool need_json_sep = false;
+  std::string json_ext = ".json";
   std::string csv_header;
 };
 
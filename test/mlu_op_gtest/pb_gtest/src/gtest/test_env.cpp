@@ -191,6 +191,12 @@ void TestEnvironment::TearDown() {
   VLOG(4) << "TearDown CNRT environment.";
   showSummary();
 
+  if (!global_var.case_cost_file_.empty() &&
+      !global_var.internal_info_.save_case_costs(global_var.case_cost_file_)) {
+    LOG(WARNING) << "Failed to save case cost history to "
+                 << global_var.case_cost_file_;
+  }
+
   // set compute mode as default
   restoreComputeMode();
   mluoptest::monitor->signalMonitorOneGRepeatDone();
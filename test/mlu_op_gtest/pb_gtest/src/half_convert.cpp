@@ -0,0 +1,352 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "half_convert.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace mluoptest {
+
+namespace {
+// arrays shorter than this are converted by the calling thread only.
+constexpr size_t kParallelBlock = 1 << 16;
+
+void halfToFloatScalarArray(float *dst, const uint16_t *src, size_t num,
+                            HalfRounding) {
+  for (size_t i = 0; i < num; ++i) dst[i] = halfToFloatScalar(src[i]);
+}
+
+void floatToHalfScalarArray(uint16_t *dst, const float *src, size_t num,
+                            HalfRounding rounding) {
+  for (size_t i = 0; i < num; ++i) dst[i] = floatToHalfScalar(src[i], rounding);
+}
+
+void bf16ToFloatScalarArray(float *dst, const uint16_t *src, size_t num,
+                            HalfRounding) {
+  for (size_t i = 0; i < num; ++i) dst[i] = bf16ToFloatScalar(src[i]);
+}
+
+void floatToBF16ScalarArray(uint16_t *dst, const float *src, size_t num,
+                            HalfRounding) {
+  for (size_t i = 0; i < num; ++i) dst[i] = floatToBF16Scalar(src[i]);
+}
+
+#if defined(__x86_64__)
+#define AVX2_TARGET __attribute__((target("avx2,f16c")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw,avx512vl")))
+// The AVX-512 kernels use the maskz forms of the shifts and conversions
+// with every lane set: the unmasked ones start from an undefined register,
+// which GCC 12 reports as maybe uninitialized under -Wall.
+constexpr __mmask16 kAllLanes = 0xffff;
+
+AVX2_TARGET void halfToFloatAvx2(float *dst, const uint16_t *src, size_t num,
+                                 HalfRounding rounding) {
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  halfToFloatScalarArray(dst + i, src + i, num - i, rounding);
+}
+
+// Same steps as floatToHalfScalar on 8 lanes.
+AVX2_TARGET void floatToHalfAvx2(uint16_t *dst, const float *src, size_t num,
+                                 HalfRounding rounding) {
+  const bool away = rounding == HalfRounding::NEAREST_AWAY;
+  const __m256i one = _mm256_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m256i bits = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i sign =
+        _mm256_srli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(
+                                                     (int)0x80000000)),
+                          16);
+    __m256i abs = _mm256_and_si256(bits, _mm256_set1_epi32(0x7fffffff));
+
+    __m256i normal_bias =
+        away ? _mm256_set1_epi32(0x1000)
+             : _mm256_add_epi32(
+                   _mm256_set1_epi32(0xfff),
+                   _mm256_and_si256(_mm256_srli_epi32(abs, 13), one));
+    __m256i normal = _mm256_srli_epi32(
+        _mm256_add_epi32(
+            _mm256_sub_epi32(abs, _mm256_set1_epi32(0x38000000)),
+            normal_bias),
+        13);
+
+    // shifts of 32 or more give 0, which flushes the values below 2^-25.
+    __m256i shift =
+        _mm256_sub_epi32(_mm256_set1_epi32(126), _mm256_srli_epi32(abs, 23));
+    __m256i mant = _mm256_or_si256(
+        _mm256_and_si256(abs, _mm256_set1_epi32(0x7fffff)),
+        _mm256_set1_epi32(0x800000));
+    __m256i half_ulp = _mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one));
+    __m256i sub_bias =
+        away ? half_ulp
+             : _mm256_add_epi32(
+                   _mm256_sub_epi32(half_ulp, one),
+                   _mm256_and_si256(_mm256_srlv_epi32(mant, shift), one));
+    __m256i subnormal =
+        _mm256_srlv_epi32(_mm256_add_epi32(mant, sub_bias), shift);
+
+    __m256i is_normal =
+        _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x387fffff));
+    __m256i is_inf = _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x477fefff));
+    __m256i is_nan = _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x7f800000));
+    __m256i res = _mm256_blendv_epi8(subnormal, normal, is_normal);
+    res = _mm256_blendv_epi8(res, _mm256_set1_epi32(0x7c00), is_inf);
+    res = _mm256_blendv_epi8(res, _mm256_set1_epi32(0x7e00), is_nan);
+    res = _mm256_or_si256(res, sign);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(res),
+                                      _mm256_extracti128_si256(res, 1));
+    _mm_storeu_si128((__m128i *)(dst + i), packed);
+  }
+  floatToHalfScalarArray(dst + i, src + i, num - i, rounding);
+}
+
+AVX2_TARGET void bf16ToFloatAvx2(float *dst, const uint16_t *src, size_t num,
+                                 HalfRounding rounding) {
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+    __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+    _mm256_storeu_si256((__m256i *)(dst + i), bits);
+  }
+  bf16ToFloatScalarArray(dst + i, src + i, num - i, rounding);
+}
+
+AVX2_TARGET void floatToBF16Avx2(uint16_t *dst, const float *src, size_t num,
+                                 HalfRounding rounding) {
+  const __m256i one = _mm256_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m256i bits = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i abs = _mm256_and_si256(bits, _mm256_set1_epi32(0x7fffffff));
+    __m256i bias =
+        _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(bits, 16), one),
+                         _mm256_set1_epi32(0x7fff));
+    __m256i res = _mm256_srli_epi32(_mm256_add_epi32(bits, bias), 16);
+    __m256i is_nan = _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x7f800000));
+    res = _mm256_blendv_epi8(res, _mm256_set1_epi32(0x7fc0), is_nan);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(res),
+                                      _mm256_extracti128_si256(res, 1));
+    _mm_storeu_si128((__m128i *)(dst + i), packed);
+  }
+  floatToBF16ScalarArray(dst + i, src + i, num - i, rounding);
+}
+
+AVX512_TARGET void halfToFloatAvx512(float *dst, const uint16_t *src,
+                                     size_t num, HalfRounding rounding) {
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i h = _mm256_loadu_si256((const __m256i *)(src + i));
+    _mm512_storeu_ps(dst + i, _mm512_maskz_cvtph_ps(kAllLanes, h));
+  }
+  if (i < num) {
+    const __mmask16 tail = (__mmask16)((1u << (num - i)) - 1);
+    __m256i h = _mm256_maskz_loadu_epi16(tail, src + i);
+    _mm512_mask_storeu_ps(dst + i, tail, _mm512_maskz_cvtph_ps(tail, h));
+  }
+}
+
+AVX512_TARGET void floatToHalfAvx512(uint16_t *dst, const float *src,
+                                     size_t num, HalfRounding rounding) {
+  const bool away = rounding == HalfRounding::NEAREST_AWAY;
+  const __m512i one = _mm512_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m512i bits = _mm512_loadu_si512(src + i);
+    __m512i sign = _mm512_maskz_srli_epi32(
+        kAllLanes, _mm512_and_si512(bits, _mm512_set1_epi32((int)0x80000000)),
+        16);
+    __m512i abs = _mm512_and_si512(bits, _mm512_set1_epi32(0x7fffffff));
+
+    __m512i normal_bias =
+        away ? _mm512_set1_epi32(0x1000)
+             : _mm512_add_epi32(
+                   _mm512_set1_epi32(0xfff),
+                   _mm512_and_si512(
+                       _mm512_maskz_srli_epi32(kAllLanes, abs, 13), one));
+    __m512i normal = _mm512_maskz_srli_epi32(
+        kAllLanes,
+        _mm512_add_epi32(_mm512_sub_epi32(abs, _mm512_set1_epi32(0x38000000)),
+                         normal_bias),
+        13);
+
+    __m512i shift =
+        _mm512_sub_epi32(_mm512_set1_epi32(126),
+                         _mm512_maskz_srli_epi32(kAllLanes, abs, 23));
+    __m512i mant = _mm512_or_si512(
+        _mm512_and_si512(abs, _mm512_set1_epi32(0x7fffff)),
+        _mm512_set1_epi32(0x800000));
+    __m512i half_ulp = _mm512_maskz_sllv_epi32(
+        kAllLanes, one, _mm512_sub_epi32(shift, one));
+    __m512i sub_bias =
+        away ? half_ulp
+             : _mm512_add_epi32(
+                   _mm512_sub_epi32(half_ulp, one),
+                   _mm512_and_si512(
+                       _mm512_maskz_srlv_epi32(kAllLanes, mant, shift), one));
+    __m512i res = _mm512_maskz_srlv_epi32(
+        kAllLanes, _mm512_add_epi32(mant, sub_bias), shift);
+
+    __mmask16 is_normal =
+        _mm512_cmpgt_epi32_mask(abs, _mm512_set1_epi32(0x387fffff));
+    __mmask16 is_inf =
+        _mm512_cmpgt_epi32_mask(abs, _mm512_set1_epi32(0x477fefff));
+    __mmask16 is_nan =
+        _mm512_cmpgt_epi32_mask(abs, _mm512_set1_epi32(0x7f800000));
+    res = _mm512_mask_blend_epi32(is_normal, res, normal);
+    res = _mm512_mask_blend_epi32(is_inf, res, _mm512_set1_epi32(0x7c00));
+    res = _mm512_mask_blend_epi32(is_nan, res, _mm512_set1_epi32(0x7e00));
+    res = _mm512_or_si512(res, sign);
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm512_maskz_cvtepi32_epi16(kAllLanes, res));
+  }
+  floatToHalfScalarArray(dst + i, src + i, num - i, rounding);
+}
+
+AVX512_TARGET void bf16ToFloatAvx512(float *dst, const uint16_t *src,
+                                     size_t num, HalfRounding rounding) {
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i h = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m512i bits = _mm512_maskz_slli_epi32(
+        kAllLanes, _mm512_maskz_cvtepu16_epi32(kAllLanes, h), 16);
+    _mm512_storeu_si512(dst + i, bits);
+  }
+  bf16ToFloatScalarArray(dst + i, src + i, num - i, rounding);
+}
+
+AVX512_TARGET void floatToBF16Avx512(uint16_t *dst, const float *src,
+                                     size_t num, HalfRounding rounding) {
+  const __m512i one = _mm512_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m512i bits = _mm512_loadu_si512(src + i);
+    __m512i abs = _mm512_and_si512(bits, _mm512_set1_epi32(0x7fffffff));
+    __m512i bias =
+        _mm512_add_epi32(_mm512_and_si512(
+                             _mm512_maskz_srli_epi32(kAllLanes, bits, 16), one),
+                         _mm512_set1_epi32(0x7fff));
+    __m512i res = _mm512_maskz_srli_epi32(
+        kAllLanes, _mm512_add_epi32(bits, bias), 16);
+    __mmask16 is_nan =
+        _mm512_cmpgt_epi32_mask(abs, _mm512_set1_epi32(0x7f800000));
+    res = _mm512_mask_blend_epi32(is_nan, res, _mm512_set1_epi32(0x7fc0));
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm512_maskz_cvtepi32_epi16(kAllLanes, res));
+  }
+  floatToBF16ScalarArray(dst + i, src + i, num - i, rounding);
+}
+#undef AVX2_TARGET
+#undef AVX512_TARGET
+#endif  // __x86_64__
+
+template <typename TDst, typename TSrc>
+using ConvertFunc = void (*)(TDst *, const TSrc *, size_t, HalfRounding);
+
+template <typename TDst, typename TSrc>
+void convertArray(TDst *dst, const TSrc *src, size_t num,
+                  HalfRounding rounding, ConvertIsa isa,
+                  ConvertFunc<TDst, TSrc> scalar,
+                  ConvertFunc<TDst, TSrc> avx2,
+                  ConvertFunc<TDst, TSrc> avx512) {
+  ConvertFunc<TDst, TSrc> func = scalar;
+#if defined(__x86_64__)
+  if (isa == ConvertIsa::AVX512 && bestConvertIsa() == ConvertIsa::AVX512) {
+    func = avx512;
+  } else if (isa != ConvertIsa::SCALAR &&
+             bestConvertIsa() != ConvertIsa::SCALAR) {
+    func = avx2;
+  }
+#endif
+  if (num <= kParallelBlock) {
+    func(dst, src, num, rounding);
+    return;
+  }
+  const size_t blocks = (num + kParallelBlock - 1) / kParallelBlock;
+#pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < blocks; ++b) {
+    const size_t begin = b * kParallelBlock;
+    const size_t count =
+        begin + kParallelBlock < num ? kParallelBlock : num - begin;
+    func(dst + begin, src + begin, count, rounding);
+  }
+}
+
+#if defined(__x86_64__)
+#define CONVERT_IMPLS(name) \
+  name##ScalarArray, name##Avx2, name##Avx512
+#else
+#define CONVERT_IMPLS(name) \
+  name##ScalarArray, name##ScalarArray, name##ScalarArray
+#endif
+}  // namespace
+
+ConvertIsa bestConvertIsa() {
+#if defined(__x86_64__)
+  static const ConvertIsa isa = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+      return ConvertIsa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+      return ConvertIsa::AVX2;
+    }
+    return ConvertIsa::SCALAR;
+  }();
+  return isa;
+#else
+  return ConvertIsa::SCALAR;
+#endif
+}
+
+void convertHalfToFloat(float *dst, const uint16_t *src, size_t num,
+                        ConvertIsa isa) {
+  convertArray(dst, src, num, HalfRounding::NEAREST_EVEN, isa,
+               CONVERT_IMPLS(halfToFloat));
+}
+
+void convertFloatToHalf(uint16_t *dst, const float *src, size_t num,
+                        HalfRounding rounding, ConvertIsa isa) {
+  convertArray(dst, src, num, rounding, isa, CONVERT_IMPLS(floatToHalf));
+}
+
+void convertBF16ToFloat(float *dst, const uint16_t *src, size_t num,
+                        ConvertIsa isa) {
+  convertArray(dst, src, num, HalfRounding::NEAREST_EVEN, isa,
+               CONVERT_IMPLS(bf16ToFloat));
+}
+
+void convertFloatToBF16(uint16_t *dst, const float *src, size_t num,
+                        ConvertIsa isa) {
+  convertArray(dst, src, num, HalfRounding::NEAREST_EVEN, isa,
+               CONVERT_IMPLS(floatToBF16));
+}
+#undef CONVERT_IMPLS
+
+}  // namespace mluoptest
@@ -22,59 +22,165 @@
  *************************************************************************/
 
 #include "transpose_cpu.h"
+#include <algorithm>
 #include <vector>
 #include "core/tensor.h"
 
 
+// A transpose after folding: output dim k has size n[k], and stride
+// in_stride[k] in the input. The output is row-major in n.
+struct FoldedTranspose {
+  int rank = 0;
+  uint64_t n[TRANSPOSE_MAX_DIM];
+  uint64_t in_stride[TRANSPOSE_MAX_DIM];
+};
+
+// drops the dims of size 1 and merges input dims i and i + 1 when they stay
+// next to each other in the output, e.g. [0, 2, 3, 1] of NCHW is folded to
+// [0, 2, 1] of N, C, HW.
+static FoldedTranspose foldTranspose(const int rank, const uint64_t *dims,
+                                     const uint64_t *permute) {
+  // runs of input dims which stay adjacent, in input order.
+  int keep[TRANSPOSE_MAX_DIM], kept = 0;
+  for (int i = 0; i < rank; ++i) {
+    if (dims[i] != 1) keep[kept++] = i;
+  }
+  int out_pos[TRANSPOSE_MAX_DIM];
+  for (int k = 0; k < rank; ++k) out_pos[permute[k]] = k;
+  uint64_t group_size[TRANSPOSE_MAX_DIM];
+  int group_of[TRANSPOSE_MAX_DIM], groups = 0;
+  for (int t = 0; t < kept; ++t) {
+    const int i = keep[t];
+    // i follows the previous kept dim in the output too (only dims of size
+    // 1 between them).
+    bool merge = false;
+    if (t > 0) {
+      merge = true;
+      for (int k = out_pos[keep[t - 1]] + 1; k < out_pos[i]; ++k) {
+        if (dims[permute[k]] != 1) merge = false;
+      }
+      if (out_pos[i] < out_pos[keep[t - 1]]) merge = false;
+    }
+    if (merge) {
+      group_size[groups - 1] *= dims[i];
+    } else {
+      group_size[groups++] = dims[i];
+    }
+    group_of[i] = groups - 1;
+  }
+  uint64_t group_stride[TRANSPOSE_MAX_DIM];
+  uint64_t stride = 1;
+  for (int g = groups - 1; g >= 0; --g) {
+    group_stride[g] = stride;
+    stride *= group_size[g];
+  }
+  FoldedTranspose f;
+  int last_group = -1;
+  for (int k = 0; k < rank; ++k) {
+    const int i = permute[k];
+    if (dims[i] == 1 || group_of[i] == last_group) continue;
+    last_group = group_of[i];
+    f.n[f.rank] = group_size[last_group];
+    f.in_stride[f.rank] = group_stride[last_group];
+    f.rank++;
+  }
+  return f;
+}
+
+// offsets of the outer index `outer` in the input and the output, the
+// outer dims are the first `dims` output dims but `skip`.
+static inline void outerOffsets(const FoldedTranspose &f, const int dims,
+                                const int skip, uint64_t outer,
+                                const uint64_t *out_stride, uint64_t *in_off,
+                                uint64_t *out_off) {
+  *in_off = 0;
+  *out_off = 0;
+  for (int k = dims - 1; k >= 0; --k) {
+    if (k == skip) continue;
+    const uint64_t idx = outer % f.n[k];
+    outer /= f.n[k];
+    *in_off += idx * f.in_stride[k];
+    *out_off += idx * out_stride[k];
+  }
+}
+
+// kTransposeTile x kTransposeTile blocks are read along the input rows and
+// written along the output rows, both stay in cache.
+static constexpr uint64_t kTransposeTile = 16;
+
+template <typename T>
+static void transposeTile(const T *x, T *y, const uint64_t rows,
+                          const uint64_t cols, const uint64_t x_stride,
+                          const uint64_t y_stride) {
+  if (rows == kTransposeTile && cols == kTransposeTile) {
+    // fixed trip counts, unrolled and vectorized by the compiler.
+    for (uint64_t i = 0; i < kTransposeTile; ++i) {
+      for (uint64_t j = 0; j < kTransposeTile; ++j) {
+        y[i * y_stride + j] = x[j * x_stride + i];
+      }
+    }
+    return;
+  }
+  for (uint64_t i = 0; i < rows; ++i) {
+    for (uint64_t j = 0; j < cols; ++j) {
+      y[i * y_stride + j] = x[j * x_stride + i];
+    }
+  }
+}
+
 template <typename T>
 static void transposeCpuNd(const int loop_d, T *x, T *y, const uint64_t sum,
-                           uint64_t *dim, uint64_t *DIM, uint64_t *permute) {
+                           const int rank, const uint64_t *DIM,
+                           const uint64_t *permute) {
+  const FoldedTranspose f = foldTranspose(rank, DIM, permute);
+  uint64_t out_stride[TRANSPOSE_MAX_DIM];
+  uint64_t stride = 1;
+  for (int k = f.rank - 1; k >= 0; --k) {
+    out_stride[k] = stride;
+    stride *= f.n[k];
+  }
   for (int loop_t = 0; loop_t < loop_d; loop_t++) {
     T *output = (T *)(y + sum * loop_t);
     T *input = (T *)(x + sum * loop_t);
-    uint64_t in_index = 0, out_index = 0;
+    if (f.rank <= 1) {  // nothing moves
+      std::copy(input, input + sum, output);
+      continue;
+    }
+
+    const int last = f.rank - 1;
+    if (f.in_stride[last] == 1) {
+      // the innermost dim stays innermost: copy rows.
+      const uint64_t row = f.n[last];
+      const int64_t rows = sum / row;
+#pragma omp parallel for schedule(static)
+      for (int64_t r = 0; r < rows; ++r) {
+        uint64_t in_off, out_off;
+        outerOffsets(f, last, -1, r, out_stride, &in_off, &out_off);
+        std::copy(input + in_off, input + in_off + row, output + out_off);
+      }
+      continue;
+    }
 
-    for (dim[0] = 0; dim[0] < DIM[0]; dim[0]++) {
-      for (dim[1] = 0; dim[1] < DIM[1]; dim[1]++) {
-        for (dim[2] = 0; dim[2] < DIM[2]; dim[2]++) {
-          for (dim[3] = 0; dim[3] < DIM[3]; dim[3]++) {
-            for (dim[4] = 0; dim[4] < DIM[4]; dim[4]++) {
-              for (dim[5] = 0; dim[5] < DIM[5]; dim[5]++) {
-                for (dim[6] = 0; dim[6] < DIM[6]; dim[6]++) {
-                  for (dim[7] = 0; dim[7] < DIM[7]; dim[7]++) {
-                    in_index =
-                        dim[0] * DIM[1] * DIM[2] * DIM[3] * DIM[4] * DIM[5] *
-                            DIM[6] * DIM[7] +
-                        dim[1] * DIM[2] * DIM[3] * DIM[4] * DIM[5] * DIM[6] *
-                            DIM[7] +
-                        dim[2] * DIM[3] * DIM[4] * DIM[5] * DIM[6] * DIM[7] +
-                        dim[3] * DIM[4] * DIM[5] * DIM[6] * DIM[7] +
-                        dim[4] * DIM[5] * DIM[6] * DIM[7] +
-                        dim[5] * DIM[6] * DIM[7] + dim[6] * DIM[7] + dim[7];
-                    out_index =
-                        dim[permute[0]] * DIM[permute[1]] * DIM[permute[2]] *
-                            DIM[permute[3]] * DIM[permute[4]] *
-                            DIM[permute[5]] * DIM[permute[6]] *
-                            DIM[permute[7]] +
-                        dim[permute[1]] * DIM[permute[2]] * DIM[permute[3]] *
-                            DIM[permute[4]] * DIM[permute[5]] *
-                            DIM[permute[6]] * DIM[permute[7]] +
-                        dim[permute[2]] * DIM[permute[3]] * DIM[permute[4]] *
-                            DIM[permute[5]] * DIM[permute[6]] *
-                            DIM[permute[7]] +
-                        dim[permute[3]] * DIM[permute[4]] * DIM[permute[5]] *
-                            DIM[permute[6]] * DIM[permute[7]] +
-                        dim[permute[4]] * DIM[permute[5]] * DIM[permute[6]] *
-                            DIM[permute[7]] +
-                        dim[permute[5]] * DIM[permute[6]] * DIM[permute[7]] +
-                        dim[permute[6]] * DIM[permute[7]] + dim[permute[7]];
-                    output[out_index] = input[in_index];
-                  }
-                }
-              }
-            }
-          }
-        }
+    // the innermost input dim is output dim c, transpose tiles of (c, last)
+    // for every index of the other dims.
+    int c = 0;
+    while (f.in_stride[c] != 1) ++c;
+    const uint64_t tiles_c = (f.n[c] + kTransposeTile - 1) / kTransposeTile;
+    const uint64_t tiles_last =
+        (f.n[last] + kTransposeTile - 1) / kTransposeTile;
+    const int64_t tasks = sum / (f.n[c] * f.n[last]) * tiles_c;
+#pragma omp parallel for schedule(static)
+    for (int64_t task = 0; task < tasks; ++task) {
+      uint64_t in_off, out_off;
+      outerOffsets(f, last, c, task / tiles_c, out_stride, &in_off, &out_off);
+      const uint64_t i0 = task % tiles_c * kTransposeTile;
+      const uint64_t rows = std::min(kTransposeTile, f.n[c] - i0);
+      for (uint64_t t = 0; t < tiles_last; ++t) {
+        const uint64_t j0 = t * kTransposeTile;
+        const uint64_t cols = std::min(kTransposeTile, f.n[last] - j0);
+        transposeTile(input + in_off + i0 + j0 * f.in_stride[last],
+                      output + out_off + i0 * out_stride[c] + j0, rows, cols,
+                      f.in_stride[last], out_stride[c]);
       }
     }
   }
@@ -102,15 +208,10 @@ mluOpStatus_t mluOpTransposeCpu(const int64_t dim_desc,
   if (data_type == MLUOP_DTYPE_INT31) {
     loop_d = 2;
   }
-  // do not change the inited value(8) in permute
-  // 8 is used to match TRANSPOSE_MAX_DIM, which can make the loop below
-  // applies to all-dims transpose, from 2D transpose to 8D transpose
-  // if you change macro TRANSPOSE_MAX_DIM, the inited value(8) should alse be
-  // changed to TRANSPOSE_MAX_DIM. And the loop level should be equal to
-  // TRANSPOSE_MAX_DIM
+  // only the first dim_all entries are used, the dims are folded in
+  // transposeCpuNd so any rank up to TRANSPOSE_MAX_DIM takes the same path.
   uint64_t permute[TRANSPOSE_MAX_DIM] = {8, 8, 8, 8, 8, 8, 8, 8};
   uint64_t DIM[TRANSPOSE_MAX_DIM + 1] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
-  uint64_t dim[TRANSPOSE_MAX_DIM + 1] = {0};
 
   if (x_desc->dim != dim_all || y_desc->dim != dim_all) {
     LOG(ERROR)
@@ -125,12 +226,15 @@ mluOpStatus_t mluOpTransposeCpu(const int64_t dim_desc,
     DIM[i] = x_desc->dims[i];
   }
   if (MLUOP_DTYPE_INT31 == data_type) {
-    transposeCpuNd(loop_d, (int16_t *)x, (int16_t *)y, sum, dim, DIM, permute);
+    transposeCpuNd(loop_d, (int16_t *)x, (int16_t *)y, sum, dim_all, DIM,
+                   permute);
   } else if (MLUOP_DTYPE_COMPLEX_HALF == data_type ||
              MLUOP_DTYPE_COMPLEX_FLOAT == data_type) {
-    transposeCpuNd(loop_d, (double *)x, (double *)y, sum, dim, DIM, permute);
+    transposeCpuNd(loop_d, (double *)x, (double *)y, sum, dim_all, DIM,
+                   permute);
   } else {
-    transposeCpuNd(loop_d, (float *)x, (float *)y, sum, dim, DIM, permute);
+    transposeCpuNd(loop_d, (float *)x, (float *)y, sum, dim_all, DIM,
+                   permute);
   }
   return MLUOP_STATUS_SUCCESS;
 }
@@ -23,7 +23,11 @@
 
 #include "internal_perf.h"
 
+#include <stdio.h>
 #include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
 #include <numeric>
 #include <sstream>
 #include <utility>
@@ -50,6 +54,42 @@ std::string mluoptest::timeseries_to_array_str(const TimeSeries_t &series) {
   return s;
 }
 
+namespace {
+std::string json_string(const std::string &str) {
+  std::string s("\"");
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      s += '\\';
+      s += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      s += buf;
+    } else {
+      s += c;
+    }
+  }
+  return s + "\"";
+}
+}  // namespace
+
+TimeSeries_t mluoptest::span_durations(const TimeSpans_t &spans) {
+  TimeSeries_t durations;
+  for (const auto &span : spans) {
+    const double ms = std::get<2>(span) - std::get<1>(span);
+    auto it = std::find_if(durations.begin(), durations.end(),
+                           [&span](const TimePoint_t &item) {
+                             return std::get<0>(item) == std::get<0>(span);
+                           });
+    if (it == durations.end()) {
+      durations.emplace_back(std::make_tuple(std::get<0>(span), ms));
+    } else {
+      std::get<1>(*it) += ms;
+    }
+  }
+  return durations;
+}
+
 void TestInternalInfo::record_case(const std::string &case_path,
                                    const GtestInternal &gtest_internal) {
   GtestInternalMsg msg;
@@ -57,10 +97,151 @@ void TestInternalInfo::record_case(const std::string &case_path,
   msg.timespan_record_ =
       std::move(evaluate_timespan(msg.gtest_internal_.time_costs_ms));
   msg.case_path_ = case_path;
+  msg.record_seq_ = record_seq_.fetch_add(1, std::memory_order_relaxed);
+
+  auto buffer = thread_buffer();
+  std::lock_guard<std::mutex> lk(buffer->mutex);
+  buffer->cases.emplace_back(std::move(msg));
+}
+
+TestInternalInfo::ThreadBuffer *TestInternalInfo::thread_buffer() {
+  // a thread keeps one buffer per TestInternalInfo, shared with buffers_
+  // so that the cases of an exited thread are still collected.
+  struct Registration {
+    const TestInternalInfo *owner;
+    // another TestInternalInfo may live at the address of a dead one.
+    std::weak_ptr<char> owner_alive;
+    std::shared_ptr<ThreadBuffer> buffer;
+  };
+  thread_local std::vector<Registration> registrations;
+  registrations.erase(
+      std::remove_if(registrations.begin(), registrations.end(),
+                     [](const Registration &r) {
+                       return r.owner_alive.expired();
+                     }),
+      registrations.end());
+  for (auto &registration : registrations) {
+    if (registration.owner == this) {
+      return registration.buffer.get();
+    }
+  }
+  auto buffer = std::make_shared<ThreadBuffer>();
+  {
+    std::lock_guard<std::mutex> lk(buffers_mutex_);
+    buffers_.push_back(buffer);
+  }
+  registrations.push_back({this, alive_, buffer});
+  return buffer.get();
+}
+
+void TestInternalInfo::collect() {
+  std::vector<GtestInternalMsg> cases;
+  {
+    std::lock_guard<std::mutex> lk(buffers_mutex_);
+    auto it = buffers_.begin();
+    while (it != buffers_.end()) {
+      {
+        std::lock_guard<std::mutex> buffer_lk((*it)->mutex);
+        std::move((*it)->cases.begin(), (*it)->cases.end(),
+                  std::back_inserter(cases));
+        (*it)->cases.clear();
+      }
+      // the thread pools of each op come and go, drop the buffers that
+      // only buffers_ still holds.
+      it = it->use_count() == 1 ? buffers_.erase(it) : std::next(it);
+    }
+  }
+  if (cases.empty()) {
+    return;
+  }
+
+  for (const auto &msg : cases) {
+    const auto &gtest_internal = msg.gtest_internal_;
+    auto &samples = stage_samples_[gtest_internal.op_name.empty()
+                                       ? std::string("unknown")
+                                       : gtest_internal.op_name];
+    for (const auto &duration : span_durations(gtest_internal.spans_ms)) {
+      samples[std::get<0>(duration)].push_back(std::get<1>(duration));
+    }
+    // time_costs_ms is cumulative, the last point is the wall time.
+    if (!gtest_internal.time_costs_ms.empty()) {
+      const double wall_ms = std::get<1>(gtest_internal.time_costs_ms.back());
+      samples["wall"].push_back(wall_ms);
+      // the latest record of a case wins.
+      auto &history = case_wall_seconds_[msg.case_path_];
+      if (history.first <= msg.record_seq_) {
+        history = std::make_pair(msg.record_seq_ + 1, wall_ms / 1000.);
+      }
+    }
+    if (gtest_internal.peak_rss_bytes) {
+      samples["peak_rss_mb"].push_back(gtest_internal.peak_rss_bytes / 1024. /
+                                       1024.);
+    }
+  }
+
+  std::move(cases.begin(), cases.end(), std::back_inserter(cases_info_));
+  std::stable_sort(cases_info_.begin(), cases_info_.end(),
+                   [](const GtestInternalMsg &a, const GtestInternalMsg &b) {
+                     return std::make_pair(a.gtest_internal_.case_index,
+                                           a.record_seq_) <
+                            std::make_pair(b.gtest_internal_.case_index,
+                                           b.record_seq_);
+                   });
+}
+
+bool TestInternalInfo::load_case_costs(const std::string &file) {
+  std::ifstream fin(file);
+  if (!fin) {
+    return false;
+  }
+  std::string line;
+  std::lock_guard<std::mutex> lk(cases_info_mutex);
+  collect();
+  while (std::getline(fin, line)) {
+    auto sep = line.rfind('|');
+    if (sep == std::string::npos || sep == 0) {
+      continue;
+    }
+    try {
+      case_wall_seconds_[line.substr(0, sep)] =
+          std::make_pair(0, std::stod(line.substr(sep + 1)));
+    } catch (std::exception &) {
+      // skip broken lines, the history is only a hint.
+    }
+  }
+  return true;
+}
+
+bool TestInternalInfo::save_case_costs(const std::string &file) {
+  std::vector<std::pair<std::string, double>> costs;
+  {
+    std::lock_guard<std::mutex> lk(cases_info_mutex);
+    collect();
+    for (const auto &item : case_wall_seconds_) {
+      costs.emplace_back(item.first, item.second.second);
+    }
+  }
+  std::sort(costs.begin(), costs.end());
+  std::ofstream fout(file);
+  if (!fout) {
+    return false;
+  }
+  for (const auto &cost : costs) {
+    fout << cost.first << "|" << std::to_string(cost.second) << "\n";
+  }
+  return static_cast<bool>(fout);
+}
 
-  cases_info_mutex.lock();
-  cases_info_.emplace_back(std::move(msg));
-  cases_info_mutex.unlock();
+bool TestInternalInfo::case_wall_seconds(const std::string &case_path,
+                                         double *seconds) {
+  std::lock_guard<std::mutex> lk(cases_info_mutex);
+  collect();
+  auto it = case_wall_seconds_.find(case_path);
+  if (it == case_wall_seconds_.end()) {
+    return false;
+  }
+  *seconds = it->second.second;
+  return true;
 }
 
 std::string GtestInternalMsg::serialize_to_csv(std::string sep) const {
@@ -75,6 +256,30 @@ std::string GtestInternalMsg::serialize_to_csv(std::string sep) const {
       });
 }
 
+std::string GtestInternalMsg::serialize_to_json() const {
+  std::string s = "{\"case_path\": " + json_string(case_path_) +
+                  ", \"op_name\": " + json_string(gtest_internal_.op_name) +
+                  ", \"file_size_bytes\": " +
+                  std::to_string(gtest_internal_.parsed_file_size) +
+                  ", \"parse_time_s\": " +
+                  std::to_string(gtest_internal_.parsed_cost_seconds) +
+                  ", \"peak_rss_bytes\": " +
+                  std::to_string(gtest_internal_.peak_rss_bytes) +
+                  ", \"spans_ms\": {";
+  const auto durations = span_durations(gtest_internal_.spans_ms);
+  for (size_t i = 0; i < durations.size(); ++i) {
+    s += (i ? ", " : "") + json_string(std::get<0>(durations[i])) + ": " +
+         std::to_string(std::get<1>(durations[i]));
+  }
+  s += "}, \"time_points_ms\": [";
+  const auto &points = gtest_internal_.time_costs_ms;
+  for (size_t i = 0; i < points.size(); ++i) {
+    s += std::string(i ? ", [" : "[") + json_string(std::get<0>(points[i])) +
+         ", " + std::to_string(std::get<1>(points[i])) + "]";
+  }
+  return s + "]}";
+}
+
 std::string GtestInternalMsg::get_csv_header(std::string sep) const {
   std::string init =
       sep + "case_path" + sep + "file_size_mb" + sep + "parse_time_s" + sep;
@@ -106,3 +311,72 @@ TimeSeries_t TestInternalInfo::evaluate_timespan(
   }
   return ret;
 }
+
+TestInternalInfo::Summary_t TestInternalInfo::summarize() {
+  Summary_t summary;
+  std::lock_guard<std::mutex> lk(cases_info_mutex);
+  collect();
+  for (const auto &op : stage_samples_) {
+    for (const auto &stage : op.second) {
+      std::vector<double> samples(stage.second);
+      if (samples.empty()) continue;
+      std::sort(samples.begin(), samples.end());
+      // nearest rank
+      auto rank = [&samples](double p) {
+        size_t idx = static_cast<size_t>(std::ceil(p * samples.size()));
+        return samples[std::max<size_t>(idx, 1) - 1];
+      };
+      StageSummary &item = summary[op.first][stage.first];
+      item.count = samples.size();
+      item.p50 = rank(0.5);
+      item.p95 = rank(0.95);
+      item.max = samples.back();
+      item.total = std::accumulate(samples.begin(), samples.end(), 0.);
+    }
+  }
+  return summary;
+}
+
+void TestInternalInfo::clear_summary() {
+  std::lock_guard<std::mutex> lk(cases_info_mutex);
+  collect();
+  stage_samples_.clear();
+}
+
+std::string TestInternalInfo::summary_to_json(const Summary_t &summary) {
+  std::string s("{");
+  for (auto op = summary.begin(); op != summary.end(); ++op) {
+    s += (op == summary.begin() ? "" : ", ") + json_string(op->first) + ": {";
+    for (auto stage = op->second.begin(); stage != op->second.end(); ++stage) {
+      const auto &item = stage->second;
+      s += (stage == op->second.begin() ? "" : ", ") +
+           json_string(stage->first) +
+           ": {\"count\": " + std::to_string(item.count) +
+           ", \"p50\": " + std::to_string(item.p50) +
+           ", \"p95\": " + std::to_string(item.p95) +
+           ", \"max\": " + std::to_string(item.max) +
+           ", \"total\": " + std::to_string(item.total) + "}";
+    }
+    s += "}";
+  }
+  return s + "}";
+}
+
+std::string TestInternalInfo::summary_to_table(const Summary_t &summary) {
+  std::string s;
+  char line[256];
+  snprintf(line, sizeof(line), "%-32s %-28s %8s %12s %12s %12s %14s\n", "op",
+           "stage", "count", "p50", "p95", "max", "total");
+  s += line;
+  for (const auto &op : summary) {
+    for (const auto &stage : op.second) {
+      const auto &item = stage.second;
+      snprintf(line, sizeof(line),
+               "%-32s %-28s %8zu %12.3f %12.3f %12.3f %14.3f\n",
+               op.first.c_str(), stage.first.c_str(), item.count, item.p50,
+               item.p95, item.max, item.total);
+      s += line;
+    }
+  }
+  return s;
+}
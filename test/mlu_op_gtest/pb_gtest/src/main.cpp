@@ -36,6 +36,30 @@
 #include "mlu_op_test.h"
 #include "mlu_op_gtest_event_listener.h"
 #include "modules_test.h"
+#include "workspace_arena_test.h"
+#include "tensor_signature_test.h"
+#include "nms_cpu_engine_test.h"
+#include "rotated_iou_cpu_test.h"
+#include "voxel_map_test.h"
+#include "stride_test.h"
+#include "half_convert_test.h"
+#include "float_batch_test.h"
+#include "philox_test.h"
+#include "random_data_test.h"
+#include "case_pipeline_test.h"
+#include "case_cost_test.h"
+#include "internal_perf_test.h"
+#include "case_admission_test.h"
+#include "point_cloud_index_test.h"
+#include "transpose_cpu_test.h"
+#include "dcn_cpu_engine_test.h"
+#include "bilinear_cpu_test.h"
+#include "mutual_information_cpu_test.h"
+#include "batchnorm_cpu_test.h"
+#include "adamw_cpu_test.h"
+#include "voxel_group_cpu_test.h"
+#include "yolo_box_nms_cpu_test.h"
+#include "generate_proposals_v2_cpu_test.h"
 #include "src/gtest-internal-inl.h"
 #include "hardware_monitor.h"
 
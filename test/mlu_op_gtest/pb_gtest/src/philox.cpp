@@ -0,0 +1,487 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "philox.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace mluoptest {
+namespace {
+// blocks of words, or values, per omp task.
+const size_t kParallelBlock = 1 << 16;
+
+void setCounter(uint32_t ctr[4], uint64_t offset, uint64_t subsequence) {
+  ctr[0] = static_cast<uint32_t>(offset);
+  ctr[1] = static_cast<uint32_t>(offset >> 32);
+  ctr[2] = static_cast<uint32_t>(subsequence);
+  ctr[3] = static_cast<uint32_t>(subsequence >> 32);
+}
+
+void generateScalar(uint32_t *dst, size_t blocks, uint64_t seed,
+                    uint64_t offset, uint64_t subsequence,
+                    bool step_subsequence) {
+  for (size_t j = 0; j < blocks; ++j) {
+    uint32_t *ctr = dst + 4 * j;
+    setCounter(ctr, step_subsequence ? offset : offset + j,
+               step_subsequence ? subsequence + j : subsequence);
+    philox4x32(ctr, static_cast<uint32_t>(seed),
+               static_cast<uint32_t>(seed >> 32));
+  }
+}
+
+float uniformScalar(uint32_t word, float min, float range) {
+  // the mantissa bits as a subnormal, times 2^126, is exactly m * 2^-23.
+  const float unit = static_cast<float>(word & 0x7fffff) * 0x1p-23f;
+  return fmaf(unit, range, min);
+}
+
+// log(x) for x in (0, 1], the Cephes logf polynomial.
+float logScalar(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  float e = static_cast<float>(static_cast<int32_t>(bits >> 23) - 126);
+  bits = (bits & 0x7fffff) | 0x3f000000;
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+  // m in [0.5, 1), take it to [sqrt(0.5) - 1, sqrt(2) - 1).
+  if (m < 0.70710677f) {
+    e = e - 1.0f;
+    m = (m + m) - 1.0f;
+  } else {
+    m = m - 1.0f;
+  }
+  const float z = m * m;
+  float y = 7.0376836292e-2f * m + -1.1514610310e-1f;
+  y = y * m + 1.1676998740e-1f;
+  y = y * m + -1.2420140846e-1f;
+  y = y * m + 1.4249322787e-1f;
+  y = y * m + -1.6668057665e-1f;
+  y = y * m + 2.0000714765e-1f;
+  y = y * m + -2.4999993993e-1f;
+  y = y * m + 3.3333331174e-1f;
+  y = (y * m) * z;
+  y = y + e * -2.12194440e-4f;
+  y = y + z * -0.5f;
+  return (m + y) + e * 0.693359375f;
+}
+
+// cos and sin of 2 * pi * u for u in [0, 1): quadrant q and the rest in
+// [-pi / 4, pi / 4] for the Cephes polynomials.
+void sincosScalar(float u, float *c, float *s) {
+  const float v = u * 4.0f;
+  const int32_t q = static_cast<int32_t>(v + 0.5f);
+  const float a = (v - static_cast<float>(q)) * 1.5707964f;
+  const float z = a * a;
+  float ps = -1.9515295891e-4f * z + 8.3321608736e-3f;
+  ps = ps * z + -1.6666654611e-1f;
+  ps = ((ps * z) * a) + a;
+  float pc = 2.443315711809948e-5f * z + -1.388731625493765e-3f;
+  pc = pc * z + 4.166664568298827e-2f;
+  pc = ((pc * z) * z + z * -0.5f) + 1.0f;
+  float cos_q = (q & 1) ? ps : pc;
+  float sin_q = (q & 1) ? pc : ps;
+  uint32_t cos_bits, sin_bits;
+  memcpy(&cos_bits, &cos_q, sizeof(cos_bits));
+  memcpy(&sin_bits, &sin_q, sizeof(sin_bits));
+  cos_bits ^= static_cast<uint32_t>((q + 1) & 2) << 30;
+  sin_bits ^= static_cast<uint32_t>(q & 2) << 30;
+  memcpy(c, &cos_bits, sizeof(cos_bits));
+  memcpy(s, &sin_bits, sizeof(sin_bits));
+}
+
+void normalPairScalar(const uint32_t *words, float mean, float stddev,
+                      float *dst) {
+  // (0, 1] keeps the log finite.
+  const float u1 = static_cast<float>((words[0] >> 8) + 1) * 0x1p-24f;
+  const float u2 = static_cast<float>(words[1] >> 8) * 0x1p-24f;
+  const float radius = sqrtf(std::max(logScalar(u1) * -2.0f, 0.0f));
+  float c, s;
+  sincosScalar(u2, &c, &s);
+  dst[0] = mean + stddev * (radius * c);
+  dst[1] = mean + stddev * (radius * s);
+}
+
+void uniformScalarArray(float *dst, const uint32_t *words, size_t num,
+                        float min, float range) {
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = uniformScalar(words[i], min, range);
+  }
+}
+
+void normalScalarArray(float *dst, const uint32_t *words, size_t num,
+                       float mean, float stddev) {
+  for (size_t i = 0; i + 1 < num; i += 2) {
+    normalPairScalar(words + i, mean, stddev, dst + i);
+  }
+}
+
+#if defined(__x86_64__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX2_FMA_TARGET __attribute__((target("avx2,fma")))
+
+AVX2_TARGET inline void mulhilo(__m256i x, __m256i m, __m256i *hi,
+                                __m256i *lo) {
+  const __m256i even = _mm256_mul_epu32(x, m);
+  const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+  *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+  *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+}
+
+// The 64-bit counters base + [index, index + 8) as low and high words.
+AVX2_TARGET inline void counterLanes(uint64_t base, uint64_t index,
+                                     __m256i *lo, __m256i *hi) {
+  const uint64_t first = base + index;
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000));
+  *lo = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)), lanes);
+  // lanes whose low word wrapped carry into the high word.
+  const __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(lanes, sign),
+                                           _mm256_xor_si256(*lo, sign));
+  *hi = _mm256_sub_epi32(_mm256_set1_epi32(static_cast<int>(first >> 32)),
+                         carry);
+}
+
+AVX2_TARGET inline void counterAvx2(uint64_t offset, uint64_t subsequence,
+                                    bool step_subsequence, uint64_t index,
+                                    __m256i c[4]) {
+  if (step_subsequence) {
+    c[0] = _mm256_set1_epi32(static_cast<int>(offset));
+    c[1] = _mm256_set1_epi32(static_cast<int>(offset >> 32));
+    counterLanes(subsequence, index, &c[2], &c[3]);
+  } else {
+    counterLanes(offset, index, &c[0], &c[1]);
+    c[2] = _mm256_set1_epi32(static_cast<int>(subsequence));
+    c[3] = _mm256_set1_epi32(static_cast<int>(subsequence >> 32));
+  }
+}
+
+AVX2_TARGET inline void roundAvx2(__m256i c[4], __m256i key0, __m256i key1) {
+  const __m256i ma = _mm256_set1_epi32(static_cast<int>(kPhiloxM4xA));
+  const __m256i mb = _mm256_set1_epi32(static_cast<int>(kPhiloxM4xB));
+  __m256i hi0, lo0, hi1, lo1;
+  mulhilo(c[0], ma, &hi0, &lo0);
+  mulhilo(c[2], mb, &hi1, &lo1);
+  c[0] = _mm256_xor_si256(_mm256_xor_si256(hi1, c[1]), key0);
+  c[1] = lo1;
+  c[2] = _mm256_xor_si256(_mm256_xor_si256(hi0, c[3]), key1);
+  c[3] = lo0;
+}
+
+// Word k of 8 lanes in c[k] back to the block order.
+AVX2_TARGET inline void storeBlocksAvx2(uint32_t *dst, const __m256i c[4]) {
+  const __m256i t0 = _mm256_unpacklo_epi32(c[0], c[1]);
+  const __m256i t1 = _mm256_unpackhi_epi32(c[0], c[1]);
+  const __m256i t2 = _mm256_unpacklo_epi32(c[2], c[3]);
+  const __m256i t3 = _mm256_unpackhi_epi32(c[2], c[3]);
+  const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+  const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+  const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+  const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+  __m256i *out = reinterpret_cast<__m256i *>(dst);
+  _mm256_storeu_si256(out, _mm256_permute2x128_si256(u0, u1, 0x20));
+  _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(u2, u3, 0x20));
+  _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(u0, u1, 0x31));
+  _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(u2, u3, 0x31));
+}
+
+// 16 blocks per step, as two independent groups of 8 lanes so that the
+// multiplications of one hide the latency of the other.
+AVX2_TARGET void generateAvx2(uint32_t *dst, size_t blocks, uint64_t seed,
+                              uint64_t offset, uint64_t subsequence,
+                              bool step_subsequence) {
+  __m256i keys0[kPhiloxRounds], keys1[kPhiloxRounds];
+  uint32_t key0 = static_cast<uint32_t>(seed);
+  uint32_t key1 = static_cast<uint32_t>(seed >> 32);
+  for (int round = 0; round < kPhiloxRounds; ++round) {
+    keys0[round] = _mm256_set1_epi32(static_cast<int>(key0));
+    keys1[round] = _mm256_set1_epi32(static_cast<int>(key1));
+    key0 += kPhiloxW32A;
+    key1 += kPhiloxW32B;
+  }
+  size_t j = 0;
+  for (; j + 16 <= blocks; j += 16) {
+    __m256i a[4], b[4];
+    counterAvx2(offset, subsequence, step_subsequence, j, a);
+    counterAvx2(offset, subsequence, step_subsequence, j + 8, b);
+    for (int round = 0; round < kPhiloxRounds; ++round) {
+      roundAvx2(a, keys0[round], keys1[round]);
+      roundAvx2(b, keys0[round], keys1[round]);
+    }
+    storeBlocksAvx2(dst + 4 * j, a);
+    storeBlocksAvx2(dst + 4 * j + 32, b);
+  }
+  // gcc leaves the upper halves dirty here, which makes the SSE code run
+  // after it, such as libm, many times slower.
+  _mm256_zeroupper();
+  generateScalar(dst + 4 * j, blocks - j, seed,
+                 step_subsequence ? offset : offset + j,
+                 step_subsequence ? subsequence + j : subsequence,
+                 step_subsequence);
+}
+
+AVX2_FMA_TARGET void uniformAvx2(float *dst, const uint32_t *words,
+                                 size_t num, float min, float range) {
+  const __m256i mask = _mm256_set1_epi32(0x7fffff);
+  const __m256 scale = _mm256_set1_ps(0x1p-23f);
+  const __m256 vmin = _mm256_set1_ps(min);
+  const __m256 vrange = _mm256_set1_ps(range);
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    const __m256i w = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(words + i));
+    const __m256 unit = _mm256_mul_ps(
+        _mm256_cvtepi32_ps(_mm256_and_si256(w, mask)), scale);
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(unit, vrange, vmin));
+  }
+  uniformScalarArray(dst + i, words + i, num - i, min, range);
+}
+
+// Same operations as logScalar() and sincosScalar(), lane by lane.
+AVX2_TARGET inline __m256 logAvx2(__m256 x) {
+  const __m256i bits = _mm256_castps_si256(x);
+  __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(
+      _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256 m = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7fffff)),
+                      _mm256_set1_epi32(0x3f000000)));
+  const __m256 small =
+      _mm256_cmp_ps(m, _mm256_set1_ps(0.70710677f), _CMP_LT_OQ);
+  e = _mm256_blendv_ps(e, _mm256_sub_ps(e, one), small);
+  m = _mm256_blendv_ps(_mm256_sub_ps(m, one),
+                       _mm256_sub_ps(_mm256_add_ps(m, m), one), small);
+  const __m256 z = _mm256_mul_ps(m, m);
+  __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(7.0376836292e-2f), m),
+                           _mm256_set1_ps(-1.1514610310e-1f));
+  const float coeffs[] = {1.1676998740e-1f,  -1.2420140846e-1f,
+                          1.4249322787e-1f,  -1.6668057665e-1f,
+                          2.0000714765e-1f,  -2.4999993993e-1f,
+                          3.3333331174e-1f};
+  for (float coeff : coeffs) {
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(coeff));
+  }
+  y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+  y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(-2.12194440e-4f)));
+  y = _mm256_add_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(-0.5f)));
+  return _mm256_add_ps(_mm256_add_ps(m, y),
+                       _mm256_mul_ps(e, _mm256_set1_ps(0.693359375f)));
+}
+
+AVX2_TARGET inline void sincosAvx2(__m256 u, __m256 *c, __m256 *s) {
+  const __m256 v = _mm256_mul_ps(u, _mm256_set1_ps(4.0f));
+  const __m256i q =
+      _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_set1_ps(0.5f)));
+  const __m256 a = _mm256_mul_ps(_mm256_sub_ps(v, _mm256_cvtepi32_ps(q)),
+                                 _mm256_set1_ps(1.5707964f));
+  const __m256 z = _mm256_mul_ps(a, a);
+  __m256 ps = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-1.9515295891e-4f), z),
+                            _mm256_set1_ps(8.3321608736e-3f));
+  ps = _mm256_add_ps(_mm256_mul_ps(ps, z), _mm256_set1_ps(-1.6666654611e-1f));
+  ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, z), a), a);
+  __m256 pc =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(2.443315711809948e-5f), z),
+                    _mm256_set1_ps(-1.388731625493765e-3f));
+  pc = _mm256_add_ps(_mm256_mul_ps(pc, z),
+                     _mm256_set1_ps(4.166664568298827e-2f));
+  pc = _mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(pc, z), z),
+                    _mm256_mul_ps(z, _mm256_set1_ps(-0.5f))),
+      _mm256_set1_ps(1.0f));
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256 odd = _mm256_castsi256_ps(
+      _mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+  const __m256 cos_q = _mm256_blendv_ps(pc, ps, odd);
+  const __m256 sin_q = _mm256_blendv_ps(ps, pc, odd);
+  const __m256i cos_sign = _mm256_slli_epi32(
+      _mm256_and_si256(_mm256_add_epi32(q, one), two), 30);
+  const __m256i sin_sign = _mm256_slli_epi32(_mm256_and_si256(q, two), 30);
+  *c = _mm256_xor_ps(cos_q, _mm256_castsi256_ps(cos_sign));
+  *s = _mm256_xor_ps(sin_q, _mm256_castsi256_ps(sin_sign));
+}
+
+AVX2_TARGET void normalAvx2(float *dst, const uint32_t *words, size_t num,
+                            float mean, float stddev) {
+  const __m256 vmean = _mm256_set1_ps(mean);
+  const __m256 vstddev = _mm256_set1_ps(stddev);
+  const __m256 scale = _mm256_set1_ps(0x1p-24f);
+  // even words to the low lane of each 64-bit pair.
+  const __m256i gather = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    const __m256i w0 = _mm256_permutevar8x32_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i)),
+        gather);
+    const __m256i w1 = _mm256_permutevar8x32_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i + 8)),
+        gather);
+    const __m256i first = _mm256_permute2x128_si256(w0, w1, 0x20);
+    const __m256i second = _mm256_permute2x128_si256(w0, w1, 0x31);
+    const __m256 u1 = _mm256_mul_ps(
+        _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_srli_epi32(first, 8),
+                                            _mm256_set1_epi32(1))),
+        scale);
+    const __m256 u2 =
+        _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(second, 8)), scale);
+    const __m256 radius = _mm256_sqrt_ps(_mm256_max_ps(
+        _mm256_mul_ps(logAvx2(u1), _mm256_set1_ps(-2.0f)),
+        _mm256_setzero_ps()));
+    __m256 c, s;
+    sincosAvx2(u2, &c, &s);
+    const __m256 vc =
+        _mm256_add_ps(vmean, _mm256_mul_ps(vstddev, _mm256_mul_ps(radius, c)));
+    const __m256 vs =
+        _mm256_add_ps(vmean, _mm256_mul_ps(vstddev, _mm256_mul_ps(radius, s)));
+    // back to (cos, sin) pairs.
+    const __m256 lo = _mm256_unpacklo_ps(vc, vs);
+    const __m256 hi = _mm256_unpackhi_ps(vc, vs);
+    _mm256_storeu_ps(dst + i, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(dst + i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+  }
+  normalScalarArray(dst + i, words + i, num - i, mean, stddev);
+}
+
+bool hasAvx2(bool use_simd) {
+  static const bool avx2 = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  }();
+  return use_simd && avx2;
+}
+#else
+bool hasAvx2(bool use_simd) { return false; }
+#endif  // __x86_64__
+}  // namespace
+
+void philoxGenerate(uint32_t *dst, size_t blocks, uint64_t seed,
+                    uint64_t offset, uint64_t subsequence,
+                    bool step_subsequence, bool use_simd) {
+  auto func = generateScalar;
+#if defined(__x86_64__)
+  if (hasAvx2(use_simd)) func = generateAvx2;
+#endif
+  const int64_t tasks = (blocks + kParallelBlock - 1) / kParallelBlock;
+#pragma omp parallel for schedule(static) if (tasks > 1)
+  for (int64_t t = 0; t < tasks; ++t) {
+    const size_t begin = t * kParallelBlock;
+    func(dst + 4 * begin, std::min(kParallelBlock, blocks - begin), seed,
+         step_subsequence ? offset : offset + begin,
+         step_subsequence ? subsequence + begin : subsequence,
+         step_subsequence);
+  }
+}
+
+void philoxWordsToUniform(float *dst, const uint32_t *words, size_t num,
+                          float min, float max, bool use_simd) {
+  auto func = uniformScalarArray;
+#if defined(__x86_64__)
+  if (hasAvx2(use_simd)) func = uniformAvx2;
+#endif
+  const float range = max - min;
+  const int64_t tasks = (num + kParallelBlock - 1) / kParallelBlock;
+#pragma omp parallel for schedule(static) if (tasks > 1)
+  for (int64_t t = 0; t < tasks; ++t) {
+    const size_t begin = t * kParallelBlock;
+    func(dst + begin, words + begin, std::min(kParallelBlock, num - begin),
+         min, range);
+  }
+}
+
+void philoxWordsToNormal(float *dst, const uint32_t *words, size_t num,
+                         float mean, float stddev, bool use_simd) {
+  auto func = normalScalarArray;
+#if defined(__x86_64__)
+  if (hasAvx2(use_simd)) func = normalAvx2;
+#endif
+  const int64_t tasks = (num + kParallelBlock - 1) / kParallelBlock;
+#pragma omp parallel for schedule(static) if (tasks > 1)
+  for (int64_t t = 0; t < tasks; ++t) {
+    const size_t begin = t * kParallelBlock;
+    func(dst + begin, words + begin, std::min(kParallelBlock, num - begin),
+         mean, stddev);
+  }
+}
+
+void PhiloxEngine::generate(uint32_t *dst, size_t num, bool use_simd) {
+  const size_t full = num / 4;
+  philoxGenerate(dst, full, seed_, offset_, subsequence_, false, use_simd);
+  offset_ += full;
+  if (num % 4) {
+    uint32_t last[4];
+    philoxGenerate(last, 1, seed_, offset_, subsequence_, false, false);
+    memcpy(dst + 4 * full, last, (num % 4) * sizeof(uint32_t));
+    ++offset_;
+  }
+}
+
+void PhiloxEngine::uniform(float *dst, size_t num, float min, float max,
+                           bool use_simd) {
+  // the words are made in place of the values.
+  uint32_t *words = reinterpret_cast<uint32_t *>(dst);
+  generate(words, num, use_simd);
+  philoxWordsToUniform(dst, words, num, min, max, use_simd);
+}
+
+void PhiloxEngine::normal(float *dst, size_t num, float mean, float stddev,
+                          bool use_simd) {
+  uint32_t *words = reinterpret_cast<uint32_t *>(dst);
+  generate(words, num, use_simd);
+  philoxWordsToNormal(dst, words, num, mean, stddev, use_simd);
+}
+
+void PhiloxDeviceState::skip(uint64_t calls) {
+  const uint64_t threads = thread_acc + calls * 128;
+  offset += threads / thread_cur_core;
+  thread_acc = static_cast<int32_t>(threads % thread_cur_core);
+}
+
+void philoxDeviceGenerate(PhiloxDeviceState *state, uint32_t *dst,
+                          size_t num, bool use_simd) {
+  const uint64_t seed = (static_cast<uint64_t>(state->key1) << 32) |
+                        state->key0;
+  const int64_t calls = num / kPhiloxDeviceCallNum;
+#pragma omp parallel for schedule(static) if (calls > 128)
+  for (int64_t c = 0; c < calls; ++c) {
+    PhiloxDeviceState call = *state;
+    call.skip(c);
+    const uint32_t subsequence =
+        static_cast<uint32_t>(call.thread_begin + call.thread_acc);
+    philoxGenerate(dst + c * kPhiloxDeviceCallNum, 128, seed, call.offset,
+                   subsequence, true, use_simd);
+  }
+  state->skip(calls);
+}
+
+void philoxDeviceUniform(PhiloxDeviceState *state, float *dst, size_t num,
+                         float min, float max, bool use_simd) {
+  uint32_t *words = reinterpret_cast<uint32_t *>(dst);
+  philoxDeviceGenerate(state, words, num, use_simd);
+  philoxWordsToUniform(dst, words, num, min, max, use_simd);
+}
+
+}  // namespace mluoptest
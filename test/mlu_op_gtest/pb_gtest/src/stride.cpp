@@ -22,29 +22,168 @@
  *************************************************************************/
 #include "stride.h"
 
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace mluoptest {
 
-void stride_map(void *dst,                              // dst ptr
-                void *src,                              // src ptr
-                const std::vector<size_t> &shape,       // shape
-                const std::vector<size_t> &dst_stride,  // stride
-                const std::vector<size_t> &src_stride,  // stride
-                size_t dst_offset, size_t src_offset, size_t d,
-                size_t sizeof_dtype, const size_t dst_max,
-                const size_t src_max) {
-  if (d == shape.size() - 1) {  // the last dim
-    for (size_t i = 0; i < shape[d]; ++i) {
-      size_t dst_idx = src_offset + i * src_stride[d];
-      size_t src_idx = dst_offset + i * dst_stride[d];
-      memcpy((char *)dst + dst_idx * sizeof_dtype,
-             (char *)src + src_idx * sizeof_dtype, sizeof_dtype);
+namespace {
+// Dims of a strided copy after dropping the dims of size 1 and merging the
+// dims which are contiguous in both tensors, the innermost dim is the last.
+struct StrideCopyPlan {
+  std::vector<size_t> shape;
+  std::vector<size_t> dst_stride;
+  std::vector<size_t> src_stride;
+};
+
+StrideCopyPlan coalesceDims(const std::vector<size_t> &shape,
+                            const std::vector<size_t> &dst_stride,
+                            const std::vector<size_t> &src_stride) {
+  StrideCopyPlan plan;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (shape[i] == 1) continue;
+    // merging keeps the row-major order of the elements, so tensors whose
+    // elements overlap are written in the same order as before.
+    if (!plan.shape.empty() &&
+        plan.dst_stride.back() == dst_stride[i] * shape[i] &&
+        plan.src_stride.back() == src_stride[i] * shape[i]) {
+      plan.shape.back() *= shape[i];
+      plan.dst_stride.back() = dst_stride[i];
+      plan.src_stride.back() = src_stride[i];
+      continue;
     }
-  } else {
-    for (size_t i = 0; i < shape[d]; ++i) {
-      stride_map(dst, src, shape, dst_stride, src_stride,
-                 dst_offset + i * dst_stride[d], src_offset + i * src_stride[d],
-                 d + 1, sizeof_dtype, dst_max, src_max);
+    plan.shape.push_back(shape[i]);
+    plan.dst_stride.push_back(dst_stride[i]);
+    plan.src_stride.push_back(src_stride[i]);
+  }
+  if (plan.shape.empty()) {
+    plan.shape.push_back(1);
+    plan.dst_stride.push_back(1);
+    plan.src_stride.push_back(1);
+  }
+  return plan;
+}
+
+// True if no two elements are written to the same address, in which case
+// the rows can be copied in any order.
+bool isWriteDisjoint(const StrideCopyPlan &plan) {
+  std::vector<size_t> dims(plan.shape.size());
+  std::iota(dims.begin(), dims.end(), 0);
+  std::sort(dims.begin(), dims.end(), [&plan](size_t a, size_t b) {
+    return plan.dst_stride[a] < plan.dst_stride[b];
+  });
+  size_t extent = 1;
+  for (size_t d : dims) {
+    if (plan.dst_stride[d] < extent) return false;
+    extent = plan.dst_stride[d] * plan.shape[d];
+  }
+  return true;
+}
+
+template <typename T>
+void copyRow(char *dst, const char *src, size_t num, size_t dst_stride,
+             size_t src_stride) {
+  T *dst_t = reinterpret_cast<T *>(dst);
+  const T *src_t = reinterpret_cast<const T *>(src);
+  for (size_t i = 0; i < num; ++i) {
+    dst_t[i * dst_stride] = src_t[i * src_stride];
+  }
+}
+
+// Copies rows [row_begin, row_end) of the plan, a row being the innermost
+// dim. Rows are visited in row-major order.
+void copyRows(char *dst, const char *src, const StrideCopyPlan &plan,
+              size_t sizeof_dtype, size_t row_begin, size_t row_end) {
+  const size_t outer_dims = plan.shape.size() - 1;
+  const size_t num = plan.shape[outer_dims];
+  const size_t dst_inner = plan.dst_stride[outer_dims];
+  const size_t src_inner = plan.src_stride[outer_dims];
+  const bool contiguous = dst_inner == 1 && src_inner == 1;
+
+  std::vector<size_t> index(outer_dims, 0);
+  size_t dst_offset = 0, src_offset = 0;
+  for (size_t d = outer_dims, rest = row_begin; d-- > 0;) {
+    index[d] = rest % plan.shape[d];
+    rest /= plan.shape[d];
+    dst_offset += index[d] * plan.dst_stride[d];
+    src_offset += index[d] * plan.src_stride[d];
+  }
+
+  for (size_t row = row_begin; row < row_end; ++row) {
+    char *dst_row = (char *)dst + dst_offset * sizeof_dtype;
+    const char *src_row = src + src_offset * sizeof_dtype;
+    if (contiguous) {
+      memcpy(dst_row, src_row, num * sizeof_dtype);
+    } else {
+      switch (sizeof_dtype) {
+        case 1:
+          copyRow<uint8_t>(dst_row, src_row, num, dst_inner, src_inner);
+          break;
+        case 2:
+          copyRow<uint16_t>(dst_row, src_row, num, dst_inner, src_inner);
+          break;
+        case 4:
+          copyRow<uint32_t>(dst_row, src_row, num, dst_inner, src_inner);
+          break;
+        case 8:
+          copyRow<uint64_t>(dst_row, src_row, num, dst_inner, src_inner);
+          break;
+        default:
+          for (size_t i = 0; i < num; ++i) {
+            memcpy(dst_row + i * dst_inner * sizeof_dtype,
+                   src_row + i * src_inner * sizeof_dtype, sizeof_dtype);
+          }
+      }
     }
+    // odometer step over the outer dims.
+    for (size_t d = outer_dims; d-- > 0;) {
+      dst_offset += plan.dst_stride[d];
+      src_offset += plan.src_stride[d];
+      if (++index[d] < plan.shape[d]) break;
+      dst_offset -= index[d] * plan.dst_stride[d];
+      src_offset -= index[d] * plan.src_stride[d];
+      index[d] = 0;
+    }
+  }
+}
+}  // namespace
+
+// dst[sum(i_k * dst_stride[k])] = src[sum(i_k * src_stride[k])] for every
+// index of shape, in row-major order of the indices when dst elements
+// overlap. Strides are in elements.
+void stride_map(void *dst, void *src, const std::vector<size_t> &shape,
+                const std::vector<size_t> &dst_stride,
+                const std::vector<size_t> &src_stride, size_t sizeof_dtype) {
+  for (size_t dim : shape) {
+    if (dim == 0) return;
+  }
+  const StrideCopyPlan plan = coalesceDims(shape, dst_stride, src_stride);
+  const size_t rows = std::accumulate(plan.shape.begin(), plan.shape.end() - 1,
+                                      (size_t)1, std::multiplies<size_t>());
+  const size_t total_bytes = rows * plan.shape.back() * sizeof_dtype;
+  // small copies are not worth waking the threads up.
+  const size_t min_parallel_bytes = 1 << 20;
+  if (rows == 1 || total_bytes < min_parallel_bytes ||
+      !isWriteDisjoint(plan)) {
+    copyRows((char *)dst, (const char *)src, plan, sizeof_dtype, 0, rows);
+    return;
+  }
+  int threads = 1;
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  const int chunks = (int)std::min<size_t>(rows, threads * 4);
+#pragma omp parallel for schedule(static)
+  for (int c = 0; c < chunks; ++c) {
+    copyRows((char *)dst, (const char *)src, plan, sizeof_dtype,
+             rows * c / chunks, rows * (c + 1) / chunks);
   }
 }
 
@@ -57,21 +196,13 @@ void tensor_stride_in(void *dst, void *src, const std::vector<size_t> &shape,
   GTEST_CHECK(shape.size() == dst_stride.size(),
               "shape's size is not equal to stride's size.");
 
-  size_t shape_total = std::accumulate(shape.begin(), shape.end(), (size_t)1,
-                                       std::multiplies<size_t>());
-  size_t stride_total = 1;
-  for (size_t i = 0; i < shape.size(); ++i) {
-    stride_total += (shape[i] - 1) * dst_stride[i];
-  }
-
-  std::vector<size_t> src_stride(shape.size());
+  std::vector<size_t> shape_stride(shape.size());
   size_t stride_base = 1;
   for (ssize_t i = shape.size() - 1; i >= 0; --i) {
-    src_stride[i] = stride_base;
+    shape_stride[i] = stride_base;
     stride_base *= shape[i];
   }
-  stride_map(dst, src, shape, dst_stride, src_stride, 0, 0, 0, sizeof_dtype,
-             stride_total, shape_total);
+  stride_map(dst, src, shape, shape_stride, dst_stride, sizeof_dtype);
 }
 
 // src(shape) -> dst(strided)
@@ -83,21 +214,13 @@ void tensor_stride_out(void *dst, void *src, const std::vector<size_t> &shape,
   GTEST_CHECK(shape.size() == src_stride.size(),
               "shape's size is not equal to stride's size.");
 
-  size_t shape_total = std::accumulate(shape.begin(), shape.end(), (size_t)1,
-                                       std::multiplies<size_t>());
-  size_t stride_total = 1;
-  for (size_t i = 0; i < shape.size(); ++i) {
-    stride_total += (shape[i] - 1) * src_stride[i];
-  }
-
-  std::vector<size_t> dst_stride(shape.size());
+  std::vector<size_t> shape_stride(shape.size());
   size_t stride_base = 1;
   for (ssize_t i = shape.size() - 1; i >= 0; --i) {
-    dst_stride[i] = stride_base;
+    shape_stride[i] = stride_base;
     stride_base *= shape[i];
   }
-  stride_map(dst, src, shape, dst_stride, src_stride, 0, 0, 0, sizeof_dtype,
-             shape_total, stride_total);
+  stride_map(dst, src, shape, src_stride, shape_stride, sizeof_dtype);
 }
 
 class Stride::StrideImpl {
@@ -24,6 +24,7 @@
 #include <math.h>
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
 #include <algorithm>
 #include <array>
 #include <string>
@@ -33,6 +34,9 @@
 #ifdef _OPENMP
 #include <omp.h>
 #endif
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include "variable.h"
 #include "evaluator.h"
@@ -41,19 +45,24 @@
 #include "perf_test.h"
 #include "accuracy_test.h"
 #include "math_half.h"
+#include "half_convert.h"
 
 namespace mluoptest {
 
 extern GlobalVar global_var;
 
+// rounds to nearest with ties away from zero on host, so it only differs
+// from the round-to-nearest-even F16C vcvtps2ph on exact ties. NaN becomes
+// sign|0x7e00.
 cnrtRet_t wrapRtConvertFloatToHalf(uint16_t *f16, float d) {
-  return cnrtCastDataType_V2(&d, cnrtFloat, f16, cnrtHalf, 1, NULL,
-                             cnrtRounding_rm);
+  *f16 = floatToHalfScalar(d, HalfRounding::NEAREST_AWAY);
+  return cnrtSuccess;
 }
 
+// exact, the same bits as F16C vcvtph2ps.
 cnrtRet_t wrapRtConvertHalfToFloat(float *d, uint16_t f16) {
-  return cnrtCastDataType_V2(&f16, cnrtHalf, d, cnrtFloat, 1, NULL,
-                             cnrtRounding_rm);
+  *d = halfToFloatScalar(f16);
+  return cnrtSuccess;
 }
 
 size_t shapeStrideCount(const Shape *shape) {
@@ -552,7 +561,8 @@ bool hasRamdomBound(const RandomData *random_param) {
   return has_float_bound || has_double_bound;
 }
 
-size_t proc_usage_peak() {
+// "<key>: <n> kB" of /proc/<pid>/status, in bytes
+static size_t procStatusBytes(const std::string &key) {
   auto pid = getpid();
   std::string name = "/proc/" + std::to_string(pid) + "/status";
   std::ifstream fin(name, std::ios::in);
@@ -563,7 +573,7 @@ size_t proc_usage_peak() {
   std::string line;
   while (!fin.eof()) {
     getline(fin, line);
-    if (line.find("VmPeak:") != std::string::npos) {
+    if (line.find(key + ":") != std::string::npos) {
       try {
         // remove space
         auto it = std::remove(line.begin(), line.end(), ' ');
@@ -584,15 +594,20 @@ size_t proc_usage_peak() {
   return 0;
 }
 
+size_t proc_usage_peak() { return procStatusBytes("VmPeak"); }
+
+size_t proc_rss_peak() { return procStatusBytes("VmHWM"); }
+
+void proc_rss_peak_reset() {
+  // 5 resets VmHWM, see proc(5)
+  std::ofstream fout("/proc/self/clear_refs");
+  fout << "5";
+}
+
+// rounds to nearest with ties away from zero, as wrapRtConvertFloatToHalf.
 void arrayCastFloatToHalf(int16_t *dst, float *src, size_t num) {
-  while (num > 0) {
-    int count = (int)std::min(num, (size_t)(INT_MAX));
-    GTEST_CHECK(cnrtCastDataType_V2(src, cnrtFloat, dst, cnrtHalf, count, NULL,
-                                    cnrtRounding_rm) == cnrtSuccess);
-    dst += count;
-    src += count;
-    num -= count;
-  }
+  convertFloatToHalf(reinterpret_cast<uint16_t *>(dst), src, num,
+                     HalfRounding::NEAREST_AWAY);
 }
 
 template <AlgoHalfToFloat algo>
@@ -603,18 +618,18 @@ void arrayCastHalfToFloatAlgoImpl(float *dst, uint16_t *src, size_t num) {
   }
 }
 
+// both are the exact IEEE conversion, done by the vectorized host kernels.
 template <>
 void arrayCastHalfToFloatAlgoImpl<AlgoHalfToFloat::CNRT>(float *dst,
                                                          uint16_t *src,
                                                          size_t num) {
-  while (num) {
-    int count = (int)std::min(num, (size_t)(INT_MAX));
-    GTEST_CHECK(cnrtCastDataType_V2(src, cnrtHalf, dst, cnrtFloat, count, NULL,
-                                    cnrtRounding_rm) == cnrtSuccess);
-    dst += count;
-    src += count;
-    num -= count;
-  }
+  convertHalfToFloat(dst, src, num);
+}
+
+template <>
+void arrayCastHalfToFloatAlgoImpl<AlgoHalfToFloat::CPU_INTRINSIC>(
+    float *dst, uint16_t *src, size_t num) {
+  convertHalfToFloat(dst, src, num);
 }
 
 void arrayCastHalfToFloatInvalidInf(float *dst, uint16_t *src, size_t num) {
@@ -689,22 +704,9 @@ void arrayCastFloatAndNormal<float, bool>(void *dst, void *src, size_t num) {
 
 // Note: here uint16_t is acutally bf16
 void arrayCastFloatToBF16(uint16_t *dst, float *src, size_t num) {
-// rounding mode: rn
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    union {
-      uint32_t src_i_u32;
-      float src_i_f32;
-    };
-    src_i_f32 = src[i];
-    if (std::isnan(src_i_f32)) {
-      // XXX(zhaolianshui): loosing sign and quiet_nan/signaling_nan info
-      ((uint16_t *)dst)[i] = 0x7FC0;
-    } else {
-      uint32_t rounding_bias = ((src_i_u32 >> 16) & 1) + (uint32_t)0x7FFF;
-      dst[i] = static_cast<uint16_t>((src_i_u32 + rounding_bias) >> 16);
-    }
-  }
+  // rounding mode: rn
+  // XXX(zhaolianshui): loosing sign and quiet_nan/signaling_nan info
+  convertFloatToBF16(dst, src, num);
 }
 
 // the actual dtype of src is bf16
@@ -720,11 +722,7 @@ float cvtBF16ToFloat(uint16_t src_i) {
 
 // Note: here uint16_t is acutally bf16
 void arrayCastBF16ToFloat(float *dst, uint16_t *src, size_t num) {
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    uint16_t src_i = src[i];
-    dst[i] = cvtBF16ToFloat(src_i);
-  }
+  convertBF16ToFloat(dst, src, num);
 }
 
 // support uint8, uint16, uint32, uint64, int8, int16, int32, int64, bool
@@ -857,15 +855,14 @@ uint64_t GenNumberOfFixedWidth(uint64_t a, int width) {
 
 void arrayCastHalfToInt8or16HalfUp(void *dst, int16_t *src, int pos, size_t num,
                                    int int8or16) {
+  float offset_f = powf(2, pos - 1);
+  std::vector<int> sum(src, src + num);
+  std::vector<int> offset_half(num, cvtFloatToHalf(offset_f));
+  float_add_batch(sum.data(), offset_half.data(), sum.data(), num, 0,
+                  ROUND_MODE_NEAREST_EVEN, 0, 1);
 #pragma omp parallel for schedule(guided)
   for (size_t i = 0; i < num; ++i) {
-    int16_t src_int16 = src[i];
-
-    float offset_f = powf(2, pos - 1);
-    int16_t offset_half = cvtFloatToHalf(offset_f);
-
-    src_int16 =
-        float_add(src_int16, offset_half, 0, ROUND_MODE_NEAREST_EVEN, 0, 1);
+    int16_t src_int16 = sum[i];
 
     int exp = GenNumberOfFixedWidth(src_int16 >> 10, 5);
     int eff = (src_int16 & 0x3ff);
@@ -1425,6 +1422,415 @@ int float_mult(int in_a, int in_b, int float_16or32, int round_mode,
                             down);
 }
 
+namespace {
+// Bit layout of the operands of float_add_batch and float_mult_batch.
+struct EmulatedFormat {
+  int width;
+  int man_bits;
+  int bias;
+  int max_exp;
+  uint64_t sign;
+  uint64_t abs_mask;
+  uint64_t man_mask;
+  uint64_t inf;
+};
+
+EmulatedFormat emulatedFormat(int float_16or32) {
+  if (float_16or32) {
+    return {32, 23, 127, 255, 0x80000000, 0x7fffffff, 0x7fffff, 0x7f800000};
+  }
+  return {16, 10, 15, 31, 0x8000, 0x7fff, 0x3ff, 0x7c00};
+}
+
+uint64_t doubleBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double emulatedToDouble(uint64_t bits, int float_16or32) {
+  if (float_16or32) {
+    uint32_t bits32 = static_cast<uint32_t>(bits);
+    float value;
+    memcpy(&value, &bits32, sizeof(value));
+    return value;
+  }
+  return halfToFloatScalar(static_cast<uint16_t>(bits));
+}
+
+int roundIncrement(int round_mode, uint64_t sign, uint64_t guard,
+                   uint64_t rest, uint64_t lsb) {
+  switch (round_mode) {
+    case ROUND_MODE_OFF_ZERO: return guard | rest;
+    case ROUND_MODE_UP: return (guard | rest) & (sign ^ 1);
+    case ROUND_MODE_DOWN: return (guard | rest) & sign;
+    case ROUND_MODE_NEAREST_OFF_ZERO: return guard;
+    case ROUND_MODE_NEAREST_EVEN: return guard & (rest | lsb);
+    // ROUND_MODE_TO_ZERO, ROUND_MODE_MATH and ROUND_MODE_NO truncate.
+    default: return 0;
+  }
+}
+
+// Rounds the exact value sum + err to the format, where sum != 0 and err is
+// the rounding error of sum (at most half an ulp of it). It gives the
+// results of float_add_regular and float_mult_regular: the magnitude is
+// rounded and an exponent out of range saturates before rounding.
+uint64_t roundExact(double sum, double err, const EmulatedFormat &fmt,
+                    int round_mode) {
+  const uint64_t bits = doubleBits(sum);
+  const uint64_t sign = bits >> 63;
+  uint64_t mag = bits & 0x7fffffffffffffffULL;
+  const uint64_t sticky = (doubleBits(err) << 1) != 0;
+  // a smaller magnitude than |sum|: one double ulp below it plus a sticky.
+  if (sticky && (doubleBits(err) >> 63) != sign) mag -= 1;
+  const int64_t exp = (int64_t)(mag >> 52) - 1023 + fmt.bias;
+  const uint64_t mant = (mag & 0xfffffffffffffULL) | (1ULL << 52);
+  const int64_t shift = 52 - fmt.man_bits + (exp < 1 ? 1 - exp : 0);
+  uint64_t res = (exp > 1 ? (uint64_t)(exp - 1) << fmt.man_bits : 0) +
+                 (shift < 64 ? mant >> shift : 0);
+  uint64_t guard = shift <= 64 ? (mant >> (shift - 1)) & 1 : 0;
+  uint64_t rest =
+      sticky | (shift <= 64 ? (mant & ((1ULL << (shift - 1)) - 1)) != 0
+                            : mant != 0);
+  if (exp >= fmt.max_exp) {
+    res = fmt.inf - 1;
+    guard = 1;
+    rest = 1;
+  }
+  res += roundIncrement(round_mode, sign, guard, rest, res & 1);
+  return (sign << (fmt.width - 1)) | res;
+}
+
+// Same as float_add_up_down and float_mult_up_down for one element,
+// without the branches on the value of the operands.
+uint64_t emulatedOp(uint64_t a, uint64_t b, const EmulatedFormat &fmt,
+                    int float_16or32, int round_mode, bool is_mult,
+                    int ieee754) {
+  a &= fmt.sign | fmt.abs_mask;
+  b &= fmt.sign | fmt.abs_mask;
+  const uint64_t abs_a = a & fmt.abs_mask, abs_b = b & fmt.abs_mask;
+  const uint64_t sign_a = a >> (fmt.width - 1), sign_b = b >> (fmt.width - 1);
+  const uint64_t max = fmt.inf - 1, nan = fmt.inf | 1;
+  const int shift = fmt.width - 1;
+  const bool nan_a = abs_a > fmt.inf, nan_b = abs_b > fmt.inf;
+  const bool inf_a = abs_a == fmt.inf, inf_b = abs_b == fmt.inf;
+  const bool zero_a = abs_a == 0, zero_b = abs_b == 0;
+  const double da = emulatedToDouble(a, float_16or32);
+  const double db = emulatedToDouble(b, float_16or32);
+
+  if (is_mult) {
+    const uint64_t sign = sign_a ^ sign_b;
+    const double prod = da * db;
+    uint64_t res = prod != 0 && prod == prod && prod - prod == 0
+                       ? roundExact(prod, 0.0, fmt, round_mode)
+                       : 0;
+    if (ieee754) {
+      if (zero_a || zero_b) res = sign << shift;
+      if (inf_a || inf_b) res = (sign << shift) | fmt.inf;
+      if (nan_a || nan_b || (zero_a && inf_b) || (inf_a && zero_b)) res = nan;
+    } else {
+      if ((res & fmt.abs_mask) == fmt.inf) res -= 1;
+      if (nan_a || nan_b || inf_a || inf_b) res = (sign << shift) | max;
+      if (zero_a || zero_b) res = sign << shift;
+    }
+    return res;
+  }
+
+  // two-sum, exact for half operands.
+  const double sum = da + db;
+  const double bb = sum - da;
+  const double err = (da - (sum - bb)) + (db - bb);
+  uint64_t res = sum != 0 && sum == sum && sum - sum == 0
+                     ? roundExact(sum, err, fmt, round_mode)
+                     : 0;
+  if (ieee754) {
+    if (sum == 0) {
+      res = zero_a && zero_b && sign_a == sign_b
+                ? sign_a << shift
+                : (round_mode == ROUND_MODE_DOWN ? fmt.sign : 0);
+    }
+    if (inf_b) res = (sign_b << shift) | fmt.inf;
+    if (inf_a) res = (sign_a << shift) | fmt.inf;
+    if (nan_a || nan_b || (inf_a && inf_b && sign_a != sign_b)) res = nan;
+  } else {
+    if ((res & fmt.abs_mask) == fmt.inf) res -= 1;
+    if (sum == 0) res = zero_a && zero_b && sign_a && sign_b ? fmt.sign : 0;
+    const bool special_a = nan_a || inf_a, special_b = nan_b || inf_b;
+    if (special_b) res = (sign_b << shift) | max;
+    if (special_a) res = (sign_a << shift) | max;
+    if (special_a && special_b) {
+      const uint64_t man_a = abs_a & fmt.man_mask, man_b = abs_b & fmt.man_mask;
+      const uint64_t sign =
+          man_a > man_b ? sign_a : man_a < man_b ? sign_b : sign_a & sign_b;
+      res = (sign << shift) | max;
+    }
+  }
+  return res;
+}
+
+void emulatedOpScalar(const int *in_a, const int *in_b, int *dst, size_t num,
+                      int float_16or32, int round_mode, bool is_mult,
+                      int ieee754) {
+  const EmulatedFormat fmt = emulatedFormat(float_16or32);
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = static_cast<int>(
+        emulatedOp(static_cast<uint32_t>(in_a[i]),
+                   static_cast<uint32_t>(in_b[i]), fmt, float_16or32,
+                   round_mode, is_mult, ieee754));
+  }
+}
+
+#if defined(__x86_64__)
+#define EMULATED_AVX2 __attribute__((target("avx2,f16c")))
+
+EMULATED_AVX2 __m256i set1u64(uint64_t value) {
+  return _mm256_set1_epi64x(static_cast<int64_t>(value));
+}
+
+// 1 where the lanes are equal, 0 elsewhere.
+EMULATED_AVX2 __m256i eq01(__m256i a, __m256i b) {
+  return _mm256_srli_epi64(_mm256_cmpeq_epi64(a, b), 63);
+}
+
+EMULATED_AVX2 __m256i select(__m256i mask, __m256i a, __m256i b) {
+  return _mm256_blendv_epi8(b, a, mask);
+}
+
+// roundExact on 4 lanes.
+EMULATED_AVX2 __m256i roundExactAvx2(__m256d sum, __m256d err,
+                                     const EmulatedFormat &fmt,
+                                     int round_mode) {
+  const __m256i one = set1u64(1);
+  const __m256i bits = _mm256_castpd_si256(sum);
+  const __m256i err_bits = _mm256_castpd_si256(err);
+  const __m256i sign = _mm256_srli_epi64(bits, 63);
+  const __m256i sticky = _mm256_xor_si256(
+      eq01(_mm256_slli_epi64(err_bits, 1), _mm256_setzero_si256()), one);
+  const __m256i below = _mm256_and_si256(
+      sticky, _mm256_xor_si256(_mm256_srli_epi64(err_bits, 63), sign));
+  const __m256i mag = _mm256_sub_epi64(
+      _mm256_and_si256(bits, set1u64(0x7fffffffffffffffULL)), below);
+  const __m256i exp = _mm256_sub_epi64(_mm256_srli_epi64(mag, 52),
+                                       set1u64(1023 - fmt.bias));
+  const __m256i mant =
+      _mm256_or_si256(_mm256_and_si256(mag, set1u64(0xfffffffffffffULL)),
+                      set1u64(1ULL << 52));
+  const __m256i subnormal = _mm256_cmpgt_epi64(one, exp);
+  const __m256i shift = _mm256_add_epi64(
+      set1u64(52 - fmt.man_bits),
+      _mm256_and_si256(subnormal, _mm256_sub_epi64(one, exp)));
+  const __m256i base = _mm256_and_si256(
+      _mm256_cmpgt_epi64(exp, one),
+      _mm256_sllv_epi64(_mm256_sub_epi64(exp, one), set1u64(fmt.man_bits)));
+  // shifts of 64 or more give 0.
+  __m256i res = _mm256_add_epi64(base, _mm256_srlv_epi64(mant, shift));
+  const __m256i shift_1 = _mm256_sub_epi64(shift, one);
+  __m256i guard = _mm256_and_si256(_mm256_srlv_epi64(mant, shift_1), one);
+  const __m256i rest_mask =
+      _mm256_sub_epi64(_mm256_sllv_epi64(one, shift_1), one);
+  __m256i rest = _mm256_or_si256(
+      sticky, _mm256_xor_si256(eq01(_mm256_and_si256(mant, rest_mask),
+                                    _mm256_setzero_si256()),
+                               one));
+  const __m256i overflow =
+      _mm256_cmpgt_epi64(exp, set1u64(fmt.max_exp - 1));
+  res = select(overflow, set1u64(fmt.inf - 1), res);
+  guard = _mm256_or_si256(guard, _mm256_and_si256(overflow, one));
+  rest = _mm256_or_si256(rest, _mm256_and_si256(overflow, one));
+
+  const __m256i inexact = _mm256_or_si256(guard, rest);
+  __m256i inc = _mm256_setzero_si256();
+  switch (round_mode) {
+    case ROUND_MODE_OFF_ZERO: inc = inexact; break;
+    case ROUND_MODE_UP:
+      inc = _mm256_andnot_si256(sign, inexact);
+      break;
+    case ROUND_MODE_DOWN: inc = _mm256_and_si256(sign, inexact); break;
+    case ROUND_MODE_NEAREST_OFF_ZERO: inc = guard; break;
+    case ROUND_MODE_NEAREST_EVEN:
+      inc = _mm256_and_si256(
+          guard, _mm256_or_si256(rest, _mm256_and_si256(res, one)));
+      break;
+    default: break;
+  }
+  return _mm256_or_si256(_mm256_slli_epi64(sign, fmt.width - 1),
+                         _mm256_add_epi64(res, inc));
+}
+
+// emulatedOp on 4 lanes, the special cases are blended over the result in
+// the same order.
+EMULATED_AVX2 void emulatedOpAvx2(const int *in_a, const int *in_b, int *dst,
+                                  size_t num, int float_16or32,
+                                  int round_mode, bool is_mult, int ieee754) {
+  const EmulatedFormat fmt = emulatedFormat(float_16or32);
+  const int shift = fmt.width - 1;
+  const __m128i width_mask =
+      _mm_set1_epi32(static_cast<int>(fmt.sign | fmt.abs_mask));
+  const __m256i abs_mask = set1u64(fmt.abs_mask);
+  const __m256i inf = set1u64(fmt.inf);
+  const __m256i max = set1u64(fmt.inf - 1);
+  const __m256i nan = set1u64(fmt.inf | 1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256d zero_d = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    const __m128i a32 = _mm_and_si128(
+        _mm_loadu_si128((const __m128i *)(in_a + i)), width_mask);
+    const __m128i b32 = _mm_and_si128(
+        _mm_loadu_si128((const __m128i *)(in_b + i)), width_mask);
+    __m256d da, db;
+    if (float_16or32) {
+      da = _mm256_cvtps_pd(_mm_castsi128_ps(a32));
+      db = _mm256_cvtps_pd(_mm_castsi128_ps(b32));
+    } else {
+      da = _mm256_cvtps_pd(_mm_cvtph_ps(_mm_packus_epi32(a32, a32)));
+      db = _mm256_cvtps_pd(_mm_cvtph_ps(_mm_packus_epi32(b32, b32)));
+    }
+    const __m256i a = _mm256_cvtepu32_epi64(a32);
+    const __m256i b = _mm256_cvtepu32_epi64(b32);
+    const __m256i abs_a = _mm256_and_si256(a, abs_mask);
+    const __m256i abs_b = _mm256_and_si256(b, abs_mask);
+    const __m256i sign_a = _mm256_srli_epi64(a, shift);
+    const __m256i sign_b = _mm256_srli_epi64(b, shift);
+    const __m256i nan_a = _mm256_cmpgt_epi64(abs_a, inf);
+    const __m256i nan_b = _mm256_cmpgt_epi64(abs_b, inf);
+    const __m256i inf_a = _mm256_cmpeq_epi64(abs_a, inf);
+    const __m256i inf_b = _mm256_cmpeq_epi64(abs_b, inf);
+    const __m256i zero_a = _mm256_cmpeq_epi64(abs_a, zero);
+    const __m256i zero_b = _mm256_cmpeq_epi64(abs_b, zero);
+    const __m256i special_a = _mm256_or_si256(nan_a, inf_a);
+    const __m256i special_b = _mm256_or_si256(nan_b, inf_b);
+    __m256i res;
+
+    if (is_mult) {
+      const __m256i sign =
+          _mm256_slli_epi64(_mm256_xor_si256(sign_a, sign_b), shift);
+      res = roundExactAvx2(_mm256_mul_pd(da, db), zero_d, fmt, round_mode);
+      const __m256i zero_any = _mm256_or_si256(zero_a, zero_b);
+      const __m256i special_any = _mm256_or_si256(special_a, special_b);
+      if (ieee754) {
+        res = select(zero_any, sign, res);
+        res = select(_mm256_or_si256(inf_a, inf_b),
+                     _mm256_or_si256(sign, inf), res);
+        const __m256i invalid = _mm256_or_si256(
+            _mm256_or_si256(nan_a, nan_b),
+            _mm256_or_si256(_mm256_and_si256(zero_a, inf_b),
+                            _mm256_and_si256(inf_a, zero_b)));
+        res = select(invalid, nan, res);
+      } else {
+        res = select(_mm256_cmpeq_epi64(_mm256_and_si256(res, abs_mask), inf),
+                     _mm256_sub_epi64(res, set1u64(1)), res);
+        res = select(special_any, _mm256_or_si256(sign, max), res);
+        res = select(zero_any, sign, res);
+      }
+    } else {
+      const __m256d sum = _mm256_add_pd(da, db);
+      const __m256d bb = _mm256_sub_pd(sum, da);
+      const __m256d err =
+          _mm256_add_pd(_mm256_sub_pd(da, _mm256_sub_pd(sum, bb)),
+                        _mm256_sub_pd(db, bb));
+      res = roundExactAvx2(sum, err, fmt, round_mode);
+      const __m256i sum_zero =
+          _mm256_castpd_si256(_mm256_cmp_pd(sum, zero_d, _CMP_EQ_OQ));
+      const __m256i both_zero = _mm256_and_si256(zero_a, zero_b);
+      if (ieee754) {
+        const __m256i same_sign = _mm256_cmpeq_epi64(sign_a, sign_b);
+        const __m256i cancel = set1u64(
+            round_mode == ROUND_MODE_DOWN ? fmt.sign : 0);
+        res = select(sum_zero,
+                     select(_mm256_and_si256(both_zero, same_sign),
+                            _mm256_slli_epi64(sign_a, shift), cancel),
+                     res);
+        res = select(inf_b,
+                     _mm256_or_si256(_mm256_slli_epi64(sign_b, shift), inf),
+                     res);
+        res = select(inf_a,
+                     _mm256_or_si256(_mm256_slli_epi64(sign_a, shift), inf),
+                     res);
+        const __m256i invalid = _mm256_or_si256(
+            _mm256_or_si256(nan_a, nan_b),
+            _mm256_andnot_si256(same_sign, _mm256_and_si256(inf_a, inf_b)));
+        res = select(invalid, nan, res);
+      } else {
+        res = select(_mm256_cmpeq_epi64(_mm256_and_si256(res, abs_mask), inf),
+                     _mm256_sub_epi64(res, set1u64(1)), res);
+        const __m256i neg_zeros = _mm256_and_si256(
+            both_zero,
+            _mm256_slli_epi64(_mm256_and_si256(sign_a, sign_b), shift));
+        res = select(sum_zero, neg_zeros, res);
+        res = select(special_b,
+                     _mm256_or_si256(_mm256_slli_epi64(sign_b, shift), max),
+                     res);
+        res = select(special_a,
+                     _mm256_or_si256(_mm256_slli_epi64(sign_a, shift), max),
+                     res);
+        const __m256i man_mask = set1u64(fmt.man_mask);
+        const __m256i man_a = _mm256_and_si256(abs_a, man_mask);
+        const __m256i man_b = _mm256_and_si256(abs_b, man_mask);
+        __m256i sign = _mm256_and_si256(sign_a, sign_b);
+        sign = select(_mm256_cmpgt_epi64(man_a, man_b), sign_a, sign);
+        sign = select(_mm256_cmpgt_epi64(man_b, man_a), sign_b, sign);
+        res = select(_mm256_and_si256(special_a, special_b),
+                     _mm256_or_si256(_mm256_slli_epi64(sign, shift), max),
+                     res);
+      }
+    }
+    // keep the low 32 bits of each lane.
+    const __m256i packed = _mm256_permutevar8x32_epi32(
+        res, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm256_castsi256_si128(packed));
+  }
+  emulatedOpScalar(in_a + i, in_b + i, dst + i, num - i, float_16or32,
+                   round_mode, is_mult, ieee754);
+}
+#undef EMULATED_AVX2
+#endif  // __x86_64__
+
+void emulatedOpBatch(const int *in_a, const int *in_b, int *dst, size_t num,
+                     int float_16or32, int round_mode, bool is_mult,
+                     int ieee754, bool use_simd) {
+  auto func = emulatedOpScalar;
+#if defined(__x86_64__)
+  if (use_simd && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("f16c")) {
+    func = emulatedOpAvx2;
+  }
+#endif
+  constexpr size_t block = 1 << 14;
+  if (num <= block) {
+    func(in_a, in_b, dst, num, float_16or32, round_mode, is_mult, ieee754);
+    return;
+  }
+  const size_t blocks = (num + block - 1) / block;
+#pragma omp parallel for schedule(static)
+  for (size_t n = 0; n < blocks; ++n) {
+    const size_t begin = n * block;
+    const size_t count = std::min(block, num - begin);
+    func(in_a + begin, in_b + begin, dst + begin, count, float_16or32,
+         round_mode, is_mult, ieee754);
+  }
+}
+}  // namespace
+
+void float_mult_batch(const int *in_a, const int *in_b, int *dst, size_t num,
+                      int float_16or32, int round_mode, int ieee754,
+                      bool use_simd) {
+  emulatedOpBatch(in_a, in_b, dst, num, float_16or32, round_mode, true,
+                  ieee754, use_simd);
+}
+
+void float_add_batch(const int *in_a, const int *in_b, int *dst, size_t num,
+                     int float_16or32, int round_mode, int add_or_sub,
+                     int ieee754, bool use_simd) {
+  if (add_or_sub != 0) {
+    LOG(ERROR) << "CPU float add batch only support add now.";
+    throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                std::to_string(__LINE__));
+  }
+  emulatedOpBatch(in_a, in_b, dst, num, float_16or32, round_mode, false,
+                  ieee754, use_simd);
+}
+
 // check if string is number
 bool isNumber(const std::string str) {
   for (auto &c : str) {
@@ -107,6 +107,30 @@ void GlobalVar::init(int *argc, char **argv) {
     auto_tuning_ =
         paramDefinedMatch(arg, "--auto_tuning") ? true : auto_tuning_;
     shuffle_ = paramDefinedMatch(arg, "--gtest_shuffle") ? true : shuffle_;
+    pipeline_ = paramDefinedMatch(arg, "--pipeline") ? true : pipeline_;
+    pipeline_threads_ = getParam(arg, "--pipeline_threads").empty()
+                            ? pipeline_threads_
+                            : getParam(arg, "--pipeline_threads");
+    case_cost_file_ = getParam(arg, "--case_cost_file").empty()
+                          ? case_cost_file_
+                          : getParam(arg, "--case_cost_file");
+    shard_index_ =
+        getParam(arg, "--shard_index").empty()
+            ? shard_index_
+            : to_int(getParam(arg, "--shard_index"), "--shard_index");
+    total_shards_ =
+        getParam(arg, "--total_shards").empty()
+            ? total_shards_
+            : to_int(getParam(arg, "--total_shards"), "--total_shards");
+    host_memory_budget_ = getParam(arg, "--host_memory_budget").empty()
+                              ? host_memory_budget_
+                              : to_int(getParam(arg, "--host_memory_budget"),
+                                       "--host_memory_budget");
+    device_memory_budget_ =
+        getParam(arg, "--device_memory_budget").empty()
+            ? device_memory_budget_
+            : to_int(getParam(arg, "--device_memory_budget"),
+                     "--device_memory_budget");
     mlu_only_ = paramDefinedMatch(arg, "--mlu_only") ? true : mlu_only_;
     test_llc_ = paramDefinedMatch(arg, "--test_llc") ? true : test_llc_;
     use_default_queue_ = paramDefinedMatch(arg, "--use_default_queue")
@@ -196,6 +220,12 @@ void GlobalVar::init(int *argc, char **argv) {
   // print();
 
   checkUnsupportedTest();
+
+  if (!case_cost_file_.empty() &&
+      !internal_info_.load_case_costs(case_cost_file_)) {
+    LOG(INFO) << "No case cost history in " << case_cost_file_
+              << ", estimate the cost of cases by their size.";
+  }
 }
 void GlobalVar::validate() {
 #if MLUOP_GTEST_DISABLE_CNRT_HOOK
@@ -225,6 +255,13 @@ void GlobalVar::print() {
   std::cout << "thread is " << thread_num_ << ENDL;
   std::cout << "half2float_algo is " << half2float_algo_ << ENDL;
   std::cout << "shuffle is " << shuffle_ << ENDL;
+  std::cout << "pipeline is " << pipeline_ << ENDL;
+  std::cout << "pipeline_threads is " << pipeline_threads_ << ENDL;
+  std::cout << "case_cost_file is " << case_cost_file_ << ENDL;
+  std::cout << "shard_index is " << shard_index_ << ENDL;
+  std::cout << "total_shards is " << total_shards_ << ENDL;
+  std::cout << "host_memory_budget is " << host_memory_budget_ << ENDL;
+  std::cout << "device_memory_budget is " << device_memory_budget_ << ENDL;
   std::cout << "mlu_only is " << mlu_only_ << ENDL;
   std::cout << "use_default_queue is " << use_default_queue_ << ENDL;
   std::cout << "unaligned_mlu_address_random is "
@@ -242,6 +279,18 @@ void GlobalVar::print() {
 }
 
 void GlobalVar::checkUnsupportedTest() const {
+  if (total_shards_ < 1 || shard_index_ < 0 || shard_index_ >= total_shards_) {
+    LOG(ERROR) << "Invalid --shard_index=" << shard_index_
+               << " or --total_shards=" << total_shards_
+               << ", need 0 <= shard_index < total_shards.";
+    exit(EXIT_FAILURE_MLUOP);
+  }
+  if (host_memory_budget_ < 0 || device_memory_budget_ < 0) {
+    LOG(ERROR) << "Invalid --host_memory_budget=" << host_memory_budget_
+               << " or --device_memory_budget=" << device_memory_budget_
+               << ", need >= 0 (MB, 0 is no limit).";
+    exit(EXIT_FAILURE_MLUOP);
+  }
   // random_mlu_address use MLU memory pool, which is not mutex guarded, so
   // don't use it in multi-thread mode
   if (thread_num_ > 1) {
@@ -254,6 +303,14 @@ void GlobalVar::checkUnsupportedTest() const {
           << "Does not support monitor_mlu_hardware in multi-thread mode.";
       exit(EXIT_FAILURE_MLUOP);
     }
+  } else {
+    if (pipeline_) {
+      LOG(WARNING) << "--pipeline only works with --thread > 1, ignored.";
+    }
+    if (host_memory_budget_ > 0 || device_memory_budget_ > 0) {
+      LOG(WARNING) << "--host_memory_budget and --device_memory_budget only "
+                      "work with --thread > 1, ignored.";
+    }
   }
 }
 
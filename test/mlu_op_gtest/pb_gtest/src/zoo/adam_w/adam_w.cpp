@@ -24,6 +24,8 @@
 #include "adam_w.h"
 #include "cn_api.h"
 
+#include "adamw_cpu.h"
+
 namespace mluoptest {
 
 void AdamWExecutor::paramCheck() {
@@ -37,6 +39,57 @@ void AdamWExecutor::paramCheck() {
   flag_input_reuse_ = true;
 }
 
+std::vector<size_t> AdamWExecutor::listSizes() {
+  const size_t count = parser_->getInputDataCount(0);
+  if (getTestVersion() != 2) {
+    return {count};
+  }
+  // uneven entries whose ends fall inside the chunks of the launch table,
+  // and an empty one that the table skips
+  return {count / 8, 0, count / 2 - count / 8, count - count / 2};
+}
+
+mluOpAdamWDescriptor_t AdamWExecutor::createAdamWDesc() {
+  const float fp32_weight_decay =
+      parser_->getProtoNode()->adamw_param().weight_decay();
+  const float fp32_scale = parser_->getProtoNode()->adamw_param().scale();
+  bool use_nesterov = parser_->getProtoNode()->adamw_param().use_nesterov();
+
+  mluOpAdamWDescriptor_t adamw_desc;
+  MLUOP_CHECK(mluOpCreateAdamWDescriptor(&adamw_desc));
+  MLUOP_CHECK(mluOpSetAdamWDescAttr(adamw_desc, MLUOP_ADAMW_WEIGHT_DECAY,
+                                    &fp32_weight_decay,
+                                    sizeof(fp32_weight_decay)));
+  MLUOP_CHECK(mluOpSetAdamWDescAttr(adamw_desc, MLUOP_ADAMW_GRAD_SCALE,
+                                    &fp32_scale, sizeof(fp32_scale)));
+  MLUOP_CHECK(mluOpSetAdamWDescAttr(adamw_desc, MLUOP_ADAMW_USE_NESTEROV,
+                                    &use_nesterov, sizeof(use_nesterov)));
+  return adamw_desc;
+}
+
+void AdamWExecutor::workspaceMalloc() {
+  void *temp = nullptr;
+  if (getTestVersion() == 2) {
+    const std::vector<size_t> sizes = listSizes();
+    MLUOP_CHECK(mluOpGetAdamWForeachWorkspaceSize(
+        handle_, (int)sizes.size(), sizes.data(), &workspace_size_));
+    VLOG(4) << "Malloc workspace space: " << workspace_size_;
+    if (workspace_size_ > 0) {
+      temp = mlu_runtime_.allocate(workspace_size_);
+    }
+  }
+  workspace_.push_back(temp);
+  eva_->setMluWorkspaceSize(workspace_size_);
+}
+
+void AdamWExecutor::workspaceFree() {
+  if (workspace_[0]) {
+    VLOG(4) << "Free device workspace space.";
+    GTEST_CHECK(cnrtSuccess == mlu_runtime_.deallocate(workspace_[0]));
+    workspace_[0] = nullptr;
+  }
+}
+
 void AdamWExecutor::compute() {
   VLOG(4) << "AdamWExecutor compute ";
   auto desc_param = tensor_desc_[0].tensor;
@@ -57,20 +110,8 @@ void AdamWExecutor::compute() {
   const float fp32_bias1 = parser_->getProtoNode()->adamw_param().bias1();
   const float fp32_bias2 = parser_->getProtoNode()->adamw_param().bias2();
   const float fp32_epsilon = parser_->getProtoNode()->adamw_param().epsilon();
-  const float fp32_weight_decay =
-      parser_->getProtoNode()->adamw_param().weight_decay();
-  const float fp32_scale = parser_->getProtoNode()->adamw_param().scale();
-  bool use_nesterov = parser_->getProtoNode()->adamw_param().use_nesterov();
 
-  mluOpAdamWDescriptor_t adamw_desc;
-  MLUOP_CHECK(mluOpCreateAdamWDescriptor(&adamw_desc));
-  MLUOP_CHECK(mluOpSetAdamWDescAttr(adamw_desc, MLUOP_ADAMW_WEIGHT_DECAY,
-                                    &fp32_weight_decay,
-                                    sizeof(fp32_weight_decay)));
-  MLUOP_CHECK(mluOpSetAdamWDescAttr(adamw_desc, MLUOP_ADAMW_GRAD_SCALE,
-                                    &fp32_scale, sizeof(fp32_scale)));
-  MLUOP_CHECK(mluOpSetAdamWDescAttr(adamw_desc, MLUOP_ADAMW_USE_NESTEROV,
-                                    &use_nesterov, sizeof(use_nesterov)));
+  mluOpAdamWDescriptor_t adamw_desc = createAdamWDesc();
 
   VLOG(4) << "call mluOpAdamw()";
   interface_timer_.start();
@@ -83,6 +124,43 @@ void AdamWExecutor::compute() {
   MLUOP_CHECK(mluOpDestroyAdamWDescriptor(adamw_desc));
 }
 
+void AdamWExecutor::compute_v2() {
+  VLOG(4) << "AdamWExecutor compute_v2 ";
+  const float fp32_lr = parser_->getProtoNode()->adamw_param().lr();
+  const float fp32_beta1 = parser_->getProtoNode()->adamw_param().beta1();
+  const float fp32_beta2 = parser_->getProtoNode()->adamw_param().beta2();
+  const float fp32_bias1 = parser_->getProtoNode()->adamw_param().bias1();
+  const float fp32_bias2 = parser_->getProtoNode()->adamw_param().bias2();
+  const float fp32_epsilon = parser_->getProtoNode()->adamw_param().epsilon();
+
+  // entry i of every list starts at the same element of its tensor
+  const std::vector<size_t> sizes = listSizes();
+  const int tensor_num = sizes.size();
+  std::vector<void *> lists[5];
+  for (int t = 0; t < 5; ++t) {
+    size_t dwidth = 0;
+    MLUOP_CHECK(mluOpGetSizeOfDataType(tensor_desc_[t].tensor->dtype,
+                                       &dwidth));
+    size_t offset = 0;
+    for (int i = 0; i < tensor_num; ++i) {
+      lists[t].push_back((char *)data_vector_[t].device_ptr + offset);
+      offset += sizes[i] * dwidth;
+    }
+  }
+
+  mluOpAdamWDescriptor_t adamw_desc = createAdamWDesc();
+
+  VLOG(4) << "call mluOpAdamWForeach() over " << tensor_num << " tensors";
+  interface_timer_.start();
+  MLUOP_CHECK(mluOpAdamWForeach(
+      handle_, adamw_desc, tensor_num, lists[0].data(), lists[1].data(),
+      lists[2].data(), lists[3].data(), lists[4].data(), sizes.data(),
+      workspace_[0], workspace_size_, fp32_lr, fp32_beta1, fp32_beta2,
+      fp32_bias1, fp32_bias2, fp32_epsilon));
+  interface_timer_.stop();
+  MLUOP_CHECK(mluOpDestroyAdamWDescriptor(adamw_desc));
+}
+
 void AdamWExecutor::setMiscellaneousParam() {
   data_vector_[0].alsoServeAsOutput();
   data_vector_[1].alsoServeAsOutput();
@@ -126,23 +204,30 @@ void AdamWExecutor::cpuCompute() {
   auto cpu_tensor_momentum_output = cpu_fp32_output_[2];
   auto cpu_tensor_velocity_output = cpu_fp32_output_[3];
 
-  for (int i = 0; i < count1; ++i) {
-    // output is: momentum velocity param param_h
-    cpu_tensor_grad[i] = cpu_tensor_grad[i] / fp32_scale;
-    cpu_tensor_momentum_output[i] =
-        cpu_tensor_momentum[i] +
-        (cpu_tensor_grad[i] - cpu_tensor_momentum[i]) * (1 - beta1);
-    cpu_tensor_velocity_output[i] =
-        cpu_tensor_velocity[i] +
-        (cpu_tensor_grad[i] * cpu_tensor_grad[i] - cpu_tensor_velocity[i]) *
-            (1 - beta2);
-    cpu_tensor_param_output[i] =
-        cpu_tensor_param[i] -
-        lr * cpu_tensor_momentum_output[i] / bias1 /
-            (sqrt(cpu_tensor_velocity_output[i] / bias2) + epsilon) -
-        lr * fp32_weight_decay * cpu_tensor_param[i];
-    cpu_tensor_paramh_output[i] = cpu_tensor_param_output[i];
+  // output is: momentum velocity param param_h
+  // the reference walks the launch table of the same list entries the
+  // device gets, a single tensor being a one-entry list.
+  const adamw_cpu::Hyper hyper = {
+      lr, beta1, beta2, bias1, bias2, epsilon, fp32_weight_decay, fp32_scale};
+  const std::vector<size_t> sizes = listSizes();
+  const int tensor_num = sizes.size();
+  float *const buffers[8] = {
+      cpu_tensor_param,           cpu_tensor_momentum,
+      cpu_tensor_velocity,        cpu_tensor_grad,
+      cpu_tensor_param_output,    cpu_tensor_paramh_output,
+      cpu_tensor_momentum_output, cpu_tensor_velocity_output};
+  std::vector<float *> lists[8];
+  for (int t = 0; t < 8; ++t) {
+    size_t offset = 0;
+    for (int i = 0; i < tensor_num; ++i) {
+      lists[t].push_back(buffers[t] + offset);
+      offset += sizes[i];
+    }
   }
+  const adamw_cpu::TensorList tensors = {
+      lists[0].data(), lists[1].data(), lists[2].data(), lists[3].data(),
+      lists[4].data(), lists[5].data(), lists[6].data(), lists[7].data()};
+  adamw_cpu::foreach(hyper, tensors, tensor_num, sizes.data());
 }
 
 }  // namespace mluoptest
@@ -22,20 +22,31 @@
  *************************************************************************/
 #ifndef TEST_MLU_OP_GTEST_SRC_ZOO_ADAMW_ADAMW_H_
 #define TEST_MLU_OP_GTEST_SRC_ZOO_ADAMW_ADAMW_H_
+#include <vector>
+
 #include "executor.h"
 
 namespace mluoptest {
 
+// compute() launches mluOpAdamW on the case tensors. The _v2 cases launch
+// mluOpAdamWForeach instead, over the tensors cut into list entries.
 class AdamWExecutor : public Executor {
  public:
   AdamWExecutor() {}
   ~AdamWExecutor() {}
   void paramCheck() override;
+  void workspaceMalloc() override;
+  void workspaceFree() override;
   void compute() override;
+  void compute_v2() override;
   void cpuCompute() override;
   void setMiscellaneousParam() override;
 
  private:
+  mluOpAdamWDescriptor_t createAdamWDesc();
+  // The element counts of the list entries the tensors are cut into.
+  std::vector<size_t> listSizes();
+  size_t workspace_size_ = 0;
   float lr;
   float beta1;
   float beta2;
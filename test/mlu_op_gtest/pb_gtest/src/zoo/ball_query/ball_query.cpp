@@ -23,10 +23,12 @@
 
 #include "ball_query.h"
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
 #include "mlu_op.h"
+#include "point_cloud_index.h"
 #include "core/type.h"
 
 namespace mluoptest {
@@ -93,37 +95,36 @@ void BallQueryExecutor::cpuCompute() {
   float min_radius2 = min_radius_ * min_radius_;
   float max_radius2 = max_radius_ * max_radius_;
 
+  // the first nsample points in index order which are in the ball (or at
+  // the query itself), the first one also fills the unused samples. points
+  // only come from the cells near the query, then go back in index order.
+  std::vector<point_cloud::PointGrid> grids(b);
+#pragma omp parallel for schedule(static)
   for (int b_idx = 0; b_idx < b; ++b_idx) {
-    for (int row = 0; row < m; ++row) {
-      int record_idx = 0;
-      bool in_ball = false;
-      for (int col = 0; col < n; ++col) {
-        float sub_x1 = new_xyz_host[b_idx * m * 3 + row * 3 + 0] -
-                       xyz_host[b_idx * n * 3 + col * 3 + 0];
-        float sub_y1 = new_xyz_host[b_idx * m * 3 + row * 3 + 1] -
-                       xyz_host[b_idx * n * 3 + col * 3 + 1];
-        float sub_z1 = new_xyz_host[b_idx * m * 3 + row * 3 + 2] -
-                       xyz_host[b_idx * n * 3 + col * 3 + 2];
-        float distance2 = sub_x1 * sub_x1 + sub_y1 * sub_y1 + sub_z1 * sub_z1;
-        if (distance2 == 0 ||
-            (distance2 >= min_radius2 && distance2 < max_radius2)) {
-          in_ball = true;
-          if (record_idx == 0) {
-            for (int i = 0; i < nsample_; ++i) {
-              idx_host[b_idx * m * nsample_ + row * nsample_ + i] = col;
-            }
+    grids[b_idx].build(xyz_host + (size_t)b_idx * n * 3, n);
+  }
+  const int64_t queries = (int64_t)b * m;
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int64_t q_idx = 0; q_idx < queries; ++q_idx) {
+    const int b_idx = q_idx / m;
+    const float *q = new_xyz_host + q_idx * 3;
+    float *idx = idx_host + q_idx * nsample_;
+    std::vector<int> in_ball;
+    grids[b_idx].forEachNear(
+        q, max_radius_, [&](int col, float x, float y, float z) {
+          float distance2 = point_cloud::distance2(q[0], q[1], q[2], x, y, z);
+          if (distance2 == 0 ||
+              (distance2 >= min_radius2 && distance2 < max_radius2)) {
+            in_ball.push_back(col);
           }
-          idx_host[b_idx * m * nsample_ + row * nsample_ + record_idx] = col;
-          ++record_idx;
-          if (record_idx >= nsample_) break;
-        }
-      }
-      if (!in_ball) {  // for one nex_xyz point, if xyz points are out of
-                       // ball,then set this idx_host to 0
-        for (int i = 0; i < nsample_; ++i) {
-          idx_host[b_idx * m * nsample_ + row * nsample_ + i] = 0;
-        }
-      }
+        });
+    const size_t taken = std::min<size_t>(in_ball.size(), nsample_);
+    std::partial_sort(in_ball.begin(), in_ball.begin() + taken, in_ball.end());
+    // for one new_xyz point, if xyz points are out of ball, then set this
+    // idx_host to 0
+    const float first = taken > 0 ? in_ball[0] : 0;
+    for (int i = 0; i < nsample_; ++i) {
+      idx[i] = static_cast<size_t>(i) < taken ? in_ball[i] : first;
     }
   }
   VLOG(4) << "BallQuery cpu compute done";
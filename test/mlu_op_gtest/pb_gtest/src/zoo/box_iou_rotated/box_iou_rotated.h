@@ -25,39 +25,6 @@
 #include "executor.h"
 
 namespace mluoptest {
-template <typename T>
-struct Box {
-  T x_ctr, y_ctr, w, h, a;
-};
-
-template <typename T>
-struct Point {
-  T x, y;
-  explicit inline Point(const T &px = 0, const T &py = 0) : x(px), y(py) {}
-  inline Point operator+(const Point &p) const {
-    return Point(x + p.x, y + p.y);
-  }
-  inline Point operator-(const Point &p) const {
-    return Point(x - p.x, y - p.y);
-  }
-  inline Point operator+=(const Point &p) const {
-    x += p.x;
-    y += p.y;
-    return *this;
-  }
-  inline Point operator*(const T coeff) const {
-    return Point(x * coeff, y * coeff);
-  }
-};
-template <typename T>
-inline T dot2d(const Point<T> &A, const Point<T> &B) {
-  return A.x * B.x + A.y * B.y;
-}
-template <typename T>
-inline T cross2d(const Point<T> &A, const Point<T> &B) {
-  return A.x * B.y - A.y * B.x;
-}
-
 class BoxIouRotatedExecutor : public Executor {
  public:
   BoxIouRotatedExecutor() {}
@@ -74,20 +41,6 @@ class BoxIouRotatedExecutor : public Executor {
   void cpuBoxIouRotated(const T *box1, const T *box2, T *ious,
                         const int num_box1, const int num_box2, const int mode,
                         const bool aligned);
-  template <typename T>
-  T singleBoxIouRotated(const Box<T> box1, const Box<T> box2, const int mode);
-  template <typename T>
-  T rotatedBoxesIntersection(const Box<T> box1, const Box<T> box2);
-  template <typename T>
-  void getRotatedVertices(const Box<T> &box, Point<T> (&pts)[4]);
-  template <typename T>
-  T getIntersectionPoints(const Point<T> (&pts1)[4], const Point<T> (&pts2)[4],
-                          Point<T> (&intersections)[24]);
-  template <typename T>
-  int convexHullGraham(const Point<T> (&p)[24], const int &num_in,
-                       Point<T> (&q)[24]);
-  template <typename T>
-  T polygonArea(const Point<T> (&q)[24], const int &m);
 };  // class Executor
 }  // namespace mluoptest
 #endif  // TEST_MLU_OP_GTEST_SRC_ZOO_BOX_IOU_ROTATED_BOX_IOU_ROTATED_H_
@@ -23,11 +23,7 @@
 
 #include <string>
 #include "dcn_backward_data.h"
-#define USE_OPENBLAS 0
-
-#if USE_OPENBLAS
-#include <openblas/cblas.h>
-#endif
+#include "dcn_cpu_engine.h"
 
 namespace mluoptest {
 
@@ -195,24 +191,6 @@ void DcnBackwardDataExecutor::cpuCompute() {
                       grad_mask_desc_, host_grad_mask);
 }
 
-void DcnBackwardDataExecutor::transposeGradOutput(const float *output,
-                                                  const int group,
-                                                  const int ndhw, const int c,
-                                                  float *transpose_output) {
-  // [1, im2col * d * h * w, group, c]
-  // ->
-  // [1, group, im2col * d * h * w, c]
-  VLOG(4) << "transposeGradOutput()";
-  for (int ndhw_iter = 0; ndhw_iter < ndhw; ndhw_iter++) {
-    for (int group_iter = 0; group_iter < group; group_iter++) {
-      for (int c_iter = 0; c_iter < c; c_iter++) {
-        transpose_output[group_iter * ndhw * c + ndhw_iter * c + c_iter] =
-            output[ndhw_iter * group * c + group_iter * c + c_iter];
-      }
-    }
-  }
-}
-
 void DcnBackwardDataExecutor::transposeGradCol(const float *dcol,
                                                const int group,
                                                const int middle, const int c,
@@ -272,62 +250,24 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
       grad_mask[iter] = 0.0;
     }
   }
-#if USE_OPENBLAS
-#else
-  auto matmul = [](float *lhs, float *rhs, float *output, bool is_trans_a,
-                   bool is_trans_b, int M, int N, int K) {
-    for (int m = 0; m < M; m++) {
-      for (int n = 0; n < N; n++) {
-        output[m * N + n] = 0.0f;
-        for (int k = 0; k < K; k++) {
-          int lhs_idx = m * K + k;
-          if (is_trans_a) lhs_idx = k * M + m;
-          int rhs_idx = k * N + n;
-          if (is_trans_b) rhs_idx = n * K + k;
-          output[m * N + n] += lhs[lhs_idx] * rhs[rhs_idx];
-        }
-      }
-    }
-  };
-#endif
-
   for (int batch_iter = 0; batch_iter < n / im2col_step; batch_iter++) {
     VLOG(4) << "iter: " << batch_iter << " / " << n / im2col_step << ".";
-    float *trans_grad_output;
-    if (conv_group_ == 1) {
-      trans_grad_output =
-          grad_output + batch_iter * im2col_step * d_o * ho * wo * co;
-    } else {
-      trans_grad_output = cpu_runtime_.allocate(
-          new float[conv_group_ * im2col_step * d_o * ho * wo * co]);
-      float *grad_output_iter =
-          grad_output + batch_iter * im2col_step * d_o * ho * wo * co;
-      transposeGradOutput(grad_output_iter, conv_group_,
-                          im2col_step * d_o * ho * wo, co, trans_grad_output);
+    // grad_output [m, conv_group, co] is read per group through lda.
+    float *grad_output_iter =
+        grad_output + batch_iter * im2col_step * d_o * ho * wo * co;
+    if (conv_group_ != 1) {
       theory_ops_ += conv_group_ * im2col_step * d_o * ho * wo, co;
     }
 
     for (int group_iter = 0; group_iter < conv_group_; group_iter++) {
-      float *grad_output_addr =
-          trans_grad_output + group_iter * im2col_step * ho * wo * co;
+      float *grad_output_addr = grad_output_iter + group_iter * co;
       float *weight_addr = weight + group_iter * co * kh * kw * ci;
       float *col_addr =
           dcol + group_iter * im2col_step * d_o * ho * wo * kd * kh * kw * ci;
-#if USE_OPENBLAS
-      const CBLAS_ORDER Order = CblasRowMajor;
-      const CBLAS_TRANSPOSE TransA = CblasNoTrans;
-      const CBLAS_TRANSPOSE TransB = CblasNoTrans;
-      const float alpha = 1.0;
-      const float beta = 0.0;
-
-      cblas_sgemm(Order, TransA, TransB, im2col_step * d_o * ho * wo,
-                  kd * kh * kw * ci, co, alpha, grad_output_addr, co,
-                  weight_addr, kd * kh * kw * ci, beta, col_addr,
-                  kd * kh * kw * ci);
-#else
-      matmul(grad_output_addr, weight_addr, col_addr, false, false,
-             im2col_step * d_o * ho * wo, kd * kh * kw * ci, co);
-#endif
+      dcn_cpu::sgemm(false, false, im2col_step * d_o * ho * wo,
+                     kd * kh * kw * ci, co, grad_output_addr, conv_group_ * co,
+                     weight_addr, kd * kh * kw * ci, 0.0f, col_addr,
+                     kd * kh * kw * ci);
       int coeff = getCoefficientOfLT2CT();
       theory_ops_ += 2 * im2col_step * d_o * ho * wo * kd * kh * kw * ci * co /
                      coeff;  // lt2ct
@@ -361,10 +301,14 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
                                   ? nullptr
                                   : grad_mask + batch_iter * mask_deal_once;
 
-      col2img4D(trans_grad_col, input_addr, offset_addr, mask_addr,
-                grad_input_addr, grad_offset_addr, grad_mask_addr, im2col_step,
-                hi, wi, ci, co, kh, kw, pad_, stride_, dilation_,
-                deformable_group_, conv_group_);
+      // trans_grad_col is [im2col_step * ho * wo, kh, kw, conv_group * ci]
+      const dcn_cpu::DcnShape shape = {im2col_step, hi, wi, conv_group_ * ci,
+                                       ho, wo, kh, kw, pad_[0], pad_[2],
+                                       stride_[0], stride_[1], dilation_[0],
+                                       dilation_[1], deformable_group_};
+      dcn_cpu::deformableCol2img(shape, trans_grad_col, input_addr,
+                                 offset_addr, mask_addr, grad_input_addr,
+                                 grad_offset_addr, grad_mask_addr);
       // bilinear(16) + grad_mask(2) + grad_offset(8)
       theory_ops_ += im2col_step * ho * wo * kh * kw * deformable_group_ *
                      c_per_deform_group * 28;
@@ -376,315 +320,11 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
     }
     if (conv_group_ != 1) {
       cpu_runtime_.deallocate(trans_grad_col);
-      cpu_runtime_.deallocate(trans_grad_output);
     }
   }  // end batch iteration
   cpu_runtime_.deallocate(dcol);
 }
 
-/*
- * grad_col: n, ho, wo, kh, kw, deform_group, ci_per_deform_group
- * input: n, hi, wi, conv_group * ci
- * offset: n, ho, wo, deform_group, kh, kw, 2
- * mask: n, ho, wo, deform_group, kh, kw
- */
-void DcnBackwardDataExecutor::col2img4D(float *grad_col, float *input,
-                                        float *offset, float *mask,
-                                        float *grad_input, float *grad_offset,
-                                        float *grad_mask, int n, int hi, int wi,
-                                        int ci, int co, int kh, int kw,
-                                        int pad[], int stride[], int dilation[],
-                                        int deform_group, int conv_group) {
-  int pt = pad[0];
-  int pb = pad[1];
-  int pl = pad[2];
-  int pr = pad[3];
-  int ho = (hi + pt + pb - dilation[0] * (kh - 1) - 1) / stride[0] + 1;
-  int wo = (wi + pl + pr - dilation[1] * (kw - 1) - 1) / stride[1] + 1;
-  int ci_per_deform_group = ci * conv_group / deform_group;
-
-  float *cur_top_grad = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *mval = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *bilinear_result =
-      cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *valh = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *valw = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *interp_weight_h =
-      cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *interp_weight_w =
-      cpu_runtime_.allocate(new float[ci_per_deform_group]);
-
-  for (int i_iter = 0; i_iter < n * ho * wo * kh * kw * deform_group;
-       i_iter++) {
-    int deform_iter = i_iter % deform_group;
-    int kw_iter = (i_iter / deform_group) % kw;
-    int kh_iter = (i_iter / deform_group / kw) % kh;
-    int wo_iter = (i_iter / deform_group / kw / kh) % wo;
-    int ho_iter = (i_iter / deform_group / kw / kh / wo) % ho;
-    int n_iter = (i_iter / deform_group / kw / kh / wo / ho) % n;
-
-    int offset_offset = n_iter * ho * wo * deform_group * kh * kw * 2 +
-                        ho_iter * wo * deform_group * kh * kw * 2 +
-                        wo_iter * deform_group * kh * kw * 2 +
-                        deform_iter * kh * kw * 2 + kh_iter * kw * 2 +
-                        kw_iter * 2;
-    float offset_h = offset[offset_offset + 0];
-    float offset_w = offset[offset_offset + 1];
-
-    float mask_value = 1.0;
-    if (mask != nullptr) {
-      int mask_offset = n_iter * ho * wo * deform_group * kh * kw +
-                        ho_iter * wo * deform_group * kh * kw +
-                        wo_iter * deform_group * kh * kw +
-                        deform_iter * kh * kw + kh_iter * kw + kw_iter;
-      mask_value = mask[mask_offset];
-    }
-
-    float h_im = ho_iter * stride[0] - pt + kh_iter * dilation[0] + offset_h;
-    float w_im = wo_iter * stride[1] - pl + kw_iter * dilation[1] + offset_w;
-
-    int col_offset =
-        n_iter * ho * wo * kh * kw * deform_group * ci_per_deform_group +
-        ho_iter * wo * kh * kw * deform_group * ci_per_deform_group +
-        wo_iter * kh * kw * deform_group * ci_per_deform_group +
-        kh_iter * kw * deform_group * ci_per_deform_group +
-        kw_iter * deform_group * ci_per_deform_group +
-        deform_iter * ci_per_deform_group;
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      cur_top_grad[iter] = grad_col[col_offset + iter];
-    }
-
-    int cur_h = int(h_im);
-    int cur_w = int(w_im);
-
-    // dcn backward data prospect
-    for (int dh_iter = -2; dh_iter < 3; dh_iter++) {
-      for (int dw_iter = -2; dw_iter < 3; dw_iter++) {
-        if (cur_h + dh_iter >= 0 && cur_h + dh_iter < hi &&
-            cur_w + dw_iter >= 0 && cur_w + dw_iter < wi &&
-            fabs(h_im - (cur_h + dh_iter)) < 1.0 &&
-            fabs(w_im - (cur_w + dw_iter)) < 1.0) {
-          float weight = 0.0;
-          if (h_im <= -1 || h_im >= hi || w_im <= -1 || w_im >= wi) {
-            continue;
-          } else {
-            int h_low = floor(h_im);
-            int w_low = floor(w_im);
-            int h_high = h_low + 1;
-            int w_high = w_low + 1;
-            int tmp_h = cur_h + dh_iter;
-            int tmp_w = cur_w + dw_iter;
-            if (tmp_h == h_low && tmp_w == w_low) {
-              weight = (tmp_h + 1.0 - h_im) * (tmp_w + 1.0 - w_im);
-            } else if (tmp_h == h_low && tmp_w == w_high) {
-              weight = (tmp_h + 1.0 - h_im) * (w_im + 1.0 - tmp_w);
-            } else if (tmp_h == h_high && tmp_w == w_low) {
-              weight = (h_im + 1.0 - tmp_h) * (tmp_w + 1.0 - w_im);
-            } else if (tmp_h == h_high && tmp_w == w_high) {
-              weight = (h_im + 1.0 - tmp_h) * (w_im + 1.0 - tmp_w);
-            }
-          }
-          int grad_img_offset =
-              n_iter * hi * wi * deform_group * ci_per_deform_group +
-              (cur_h + dh_iter) * wi * deform_group * ci_per_deform_group +
-              (cur_w + dw_iter) * deform_group * ci_per_deform_group +
-              deform_iter * ci_per_deform_group;
-          for (int iter = 0; iter < ci_per_deform_group; iter++) {
-            grad_input[grad_img_offset + iter] +=
-                weight * cur_top_grad[iter] * mask_value;
-          }
-        }  // if cur h and cur w is valid
-      }    // dw iter
-    }      // dh iter
-    // dcn backward data end
-
-    // dcn backward mask
-
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      mval[iter] = 0.0;
-    }
-
-    if (h_im > -1 && h_im < hi && w_im > -1 && w_im < wi) {
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        im2col_bilinear(input, n_iter, h_im, w_im, deform_iter, hi, wi,
-                        deform_group, ci_per_deform_group, bilinear_result);
-        mval[iter] = cur_top_grad[iter] * bilinear_result[iter];
-      }
-    } else {
-      h_im = -2.0;
-      w_im = -2.0;
-    }
-    if (grad_mask != nullptr) {
-      int mask_offset = n_iter * ho * wo * deform_group * kh * kw +
-                        ho_iter * wo * deform_group * kh * kw +
-                        wo_iter * deform_group * kh * kw +
-                        deform_iter * kh * kw + kh_iter * kw + kw_iter;
-      float grad_mask_value = 0.0;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        grad_mask_value += mval[iter];
-      }
-      grad_mask[mask_offset] = grad_mask_value;
-    }
-    // dcn backward mask end
-
-    // dcn backward offset
-
-    col2img_coordinate(input, n_iter, h_im, w_im, deform_iter, hi, wi,
-                       deform_group, ci_per_deform_group, interp_weight_h,
-                       interp_weight_w);
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      valh[iter] = cur_top_grad[iter] * interp_weight_h[iter] * mask_value;
-      valw[iter] = cur_top_grad[iter] * interp_weight_w[iter] * mask_value;
-    }
-    float grad_offset_h = 0.0;
-    float grad_offset_w = 0.0;
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      grad_offset_h += valh[iter];
-      grad_offset_w += valw[iter];
-    }
-
-    grad_offset[offset_offset + 0] = grad_offset_h;
-    grad_offset[offset_offset + 1] = grad_offset_w;
-  }  // i iter
-}
-
-void DcnBackwardDataExecutor::col2img_coordinate(
-    float *input, int n_iter, float h_im, float w_im, int deform_iter, int hi,
-    int wi, int deform_group, int ci_per_deform_group, float *weight_h,
-    float *weight_w) {
-  int h_low = floor(h_im);
-  int w_low = floor(w_im);
-  int h_high = h_low + 1;
-  int w_high = w_low + 1;
-  float lh = h_im - h_low;
-  float lw = w_im - w_low;
-
-  for (int iter = 0; iter < ci_per_deform_group; iter++) {
-    weight_h[iter] = 0.0;
-    weight_w[iter] = 0.0;
-  }
-  if (h_im > -1 && h_im < hi && w_im > -1 && w_im < wi) {
-    if (h_low >= 0 && w_low >= 0) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_low * wi * deform_group * ci_per_deform_group +
-                         w_low * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        weight_h[iter] += -1.0 * (w_high - w_im) * input[input_offset + iter];
-        weight_w[iter] += -1.0 * (h_high - h_im) * input[input_offset + iter];
-      }
-    }
-    if (h_low >= 0 && w_high < wi) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_low * wi * deform_group * ci_per_deform_group +
-                         w_high * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        weight_h[iter] += -1.0 * (w_im - w_low) * input[input_offset + iter];
-        weight_w[iter] += 1.0 * (h_high - h_im) * input[input_offset + iter];
-      }
-    }
-    if (h_high < hi && w_low >= 0) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_high * wi * deform_group * ci_per_deform_group +
-                         w_low * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        weight_h[iter] += 1.0 * (w_high - w_im) * input[input_offset + iter];
-        weight_w[iter] += -1.0 * (h_im - h_low) * input[input_offset + iter];
-      }
-    }
-    if (h_high < hi && w_high < wi) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_high * wi * deform_group * ci_per_deform_group +
-                         w_high * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        weight_h[iter] += 1.0 * (w_im - w_low) * input[input_offset + iter];
-        weight_w[iter] += 1.0 * (h_im - h_low) * input[input_offset + iter];
-      }
-    }
-  }
-}
-
-void DcnBackwardDataExecutor::im2col_bilinear(
-    float *input, int n_iter, float h_im, float w_im, int deform_iter, int hi,
-    int wi, int deform_group, int ci_per_deform_group, float *bilinear_result) {
-  int h_low = floor(h_im);
-  int w_low = floor(w_im);
-  int h_high = h_low + 1;
-  int w_high = w_low + 1;
-
-  float lh = h_im - h_low;
-  float lw = w_im - w_low;
-  float hh = 1.0 - lh;
-  float hw = 1.0 - lw;
-
-  float *v1 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *v2 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *v3 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *v4 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  for (int iter = 0; iter < ci_per_deform_group; iter++) {
-    v1[iter] = 0.0;
-    v2[iter] = 0.0;
-    v3[iter] = 0.0;
-    v4[iter] = 0.0;
-    bilinear_result[iter] = 0.0;
-  }
-
-  if (h_im > -1.0 && w_im > -1.0 && h_im < hi && w_im < wi) {
-    if (h_low >= 0 && w_low >= 0) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_low * wi * deform_group * ci_per_deform_group +
-                         w_low * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v1[iter] = input[input_offset + iter];
-      }
-    }
-    if (h_low >= 0 && w_high <= wi - 1) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_low * wi * deform_group * ci_per_deform_group +
-                         w_high * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v2[iter] = input[input_offset + iter];
-      }
-    }
-    if (h_high <= hi - 1 && w_low >= 0) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_high * wi * deform_group * ci_per_deform_group +
-                         w_low * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v3[iter] = input[input_offset + iter];
-      }
-    }
-    if (h_high <= hi - 1 && w_high <= wi - 1) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_high * wi * deform_group * ci_per_deform_group +
-                         w_high * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v4[iter] = input[input_offset + iter];
-      }
-    }
-    float w1 = hh * hw;
-    float w2 = hh * lw;
-    float w3 = lh * hw;
-    float w4 = lh * lw;
-
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      bilinear_result[iter] =
-          w1 * v1[iter] + w2 * v2[iter] + w3 * v3[iter] + w4 * v4[iter];
-    }
-  }
-  cpu_runtime_.deallocate(v1);
-  cpu_runtime_.deallocate(v2);
-  cpu_runtime_.deallocate(v3);
-  cpu_runtime_.deallocate(v4);
-}
-
 int64_t DcnBackwardDataExecutor::getTheoryOps() {
   if (exe_config_->mlu_only) {
     int n = mluOpGetTensordimN(input_desc_);
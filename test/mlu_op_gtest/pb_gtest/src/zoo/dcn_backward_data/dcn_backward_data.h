@@ -71,28 +71,12 @@ class DcnBackwardDataExecutor : public Executor {
       mluOpTensorDescriptor_t grad_offset_desc, float *grad_offset,
       mluOpTensorDescriptor_t grad_mask_desc, float *grad_mask);
 
-  void transposeGradOutput(const float *output, const int group, const int ndhw,
-                           const int c, float *transpose_output);
   void transposeGradCol(const float *dcol, const int group, const int middle,
                         const int c, float *transpose_dcol);
 
   void batch_batmul(int batch, int m, int k, int n, float *mat1, float *mat2,
                     float *mat3);
 
-  void col2img4D(float *grad_col, float *input, float *offset, float *mask,
-                 float *grad_input, float *grad_offset, float *grad_mask, int n,
-                 int hi, int wi, int ci, int co, int kh, int kw, int pad[],
-                 int stride[], int dilation[], int deformable_group,
-                 int conv_group);
-
-  void im2col_bilinear(float *input, int n_iter, float h_im, float w_im,
-                       int deform_iter, int hi, int wi, int deform_group,
-                       int ci_per_deform_group, float *bilinear_result);
-
-  void col2img_coordinate(float *input, int n_iter, float h_im, float w_im,
-                          int deform_iter, int hi, int wi, int deform_group,
-                          int ci_per_deform_group, float *weight_h,
-                          float *weight_w);
   int getCoefficientOfLT2CT();
 };
 
@@ -30,8 +30,6 @@ class DcnBackwardWeightExecutor : public Executor {
   int64_t getTheoryOps() override;
 
  private:
-  void transpose(float *input, float *output, const int dims[],
-                 const int dim_num, int permute[]);
   int getCoefficientOfLT2CT();
   void computeDCNBackwardWeightCPU(
       const int &dg, const int &g, const int &im2col_step,
@@ -31,8 +31,6 @@ class DcnForwardExecutor : public Executor {
 
  private:
   int getCoefficientOfLT2CT();
-  void transpose(float *input, float *output, const int dims[],
-                 const int dim_num, const int permute[]);
   void computeDCNForwardCPU(
       const int &dg, const int &g, const int &im2col_step,
       const mluOpTensorDescriptor_t input_desc, const void *cpu_input,
@@ -28,6 +28,9 @@
 #include <fstream>
 #include <map>
 #include <bitset>
+#include <vector>
+
+#include "bilinear_cpu.h"
 
 namespace mluoptest {
 
@@ -190,6 +193,7 @@ void DeformRoiPoolBackwardExecutor::cpuCompute() {
         cpu_fp32_input_[1] + roi_batch_ind * height * width * channels;
     float *offset_grad_input =
         cpu_fp32_output_[0] + roi_batch_ind * height * width * channels;
+    std::vector<float> grad_output_this_bin(channels);
     // no count theory_ops_ end
 
     for (int ph = 0; ph < pooled_height; ++ph) {
@@ -206,6 +210,13 @@ void DeformRoiPoolBackwardExecutor::cpuCompute() {
           roi_start_h = base_roi_start_h + offset_roi_h;
           theory_ops_ += 6;  // cur block
         }
+        // next stmt not count theory_ops_
+        const float *grad_output = cpu_fp32_input_[0] +
+                                   n * pooled_height * pooled_width * channels +
+                                   ph * pooled_width * channels + pw * channels;
+        for (int c = 0; c < channels; ++c) {
+          grad_output_this_bin[c] = grad_output[c] / count;
+        }
         for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
           const float y = roi_start_h + ph * bin_size_h +
                           static_cast<float>(iy + .5f) * bin_size_h /
@@ -222,45 +233,43 @@ void DeformRoiPoolBackwardExecutor::cpuCompute() {
                                           theory_ops_);
             theory_ops_ += 9;  // cur block
             if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
-              for (int c = 0; c < channels; ++c) {
-                // next stmt not count theory_ops_
-                size_t index = n * pooled_height * pooled_width * channels +
-                               ph * pooled_width * channels + pw * channels + c;
-
-                float grad_output_this_bin = cpu_fp32_input_[0][index] / count;
-                offset_grad_input[y_low * width * channels + x_low * channels +
-                                  c] += grad_output_this_bin * w1;
-                offset_grad_input[y_low * width * channels + x_high * channels +
-                                  c] += grad_output_this_bin * w2;
-                offset_grad_input[y_high * width * channels + x_low * channels +
-                                  c] += grad_output_this_bin * w3;
-                offset_grad_input[y_high * width * channels +
-                                  x_high * channels + c] +=
-                    grad_output_this_bin * w4;
-                theory_ops_ += 13;  // cur block
+              // all channels share the corners, so the gradient is
+              // scattered a channel row at a time.
+              const bilinear_cpu::Point point = {
+                  {(y_low * width + x_low) * channels,
+                   (y_low * width + x_high) * channels,
+                   (y_high * width + x_low) * channels,
+                   (y_high * width + x_high) * channels},
+                  {w1, w2, w3, w4}};
+              bilinear_cpu::scatter(offset_grad_input, point,
+                                    grad_output_this_bin.data(), 1.0f,
+                                    channels);
+              theory_ops_ += 13 * channels;  // cur block
 
-                if (offset_desc != NULL && cpu_fp32_input_[3] != NULL) {
-                  float input_00 = offset_input[y_low * width * channels +
-                                                x_low * channels + c];
-                  float input_10 = offset_input[y_low * width * channels +
-                                                x_high * channels + c];
-                  float input_01 = offset_input[y_high * width * channels +
-                                                x_low * channels + c];
-                  float input_11 = offset_input[y_high * width * channels +
-                                                x_high * channels + c];
-                  float ogx = gamma * roi_width * grad_output_this_bin *
-                          (input_11 * (y - y_low) + input_10 * (y_high - y) +
-                           input_01 * (y_low - y) + input_00 * (y - y_high));
-                  float ogy = gamma * roi_height * grad_output_this_bin *
-                          (input_11 * (x - x_low) + input_01 * (x_high - x) +
-                           input_10 * (x_low - x) + input_00 * (x - x_high));
-                  cpu_fp32_output_[1][n * pooled_width * pooled_height * 2 +
-                                      ph * pooled_width + pw] += ogx;
-                  cpu_fp32_output_[1][n * pooled_width * pooled_height * 2 +
-                                      pooled_width * pooled_height +
-                                      ph * pooled_width + pw] += ogy;
-                  theory_ops_ += 28;  // cur block
+              if (offset_desc != NULL && cpu_fp32_input_[3] != NULL) {
+                const float *input_00 = offset_input + point.offset[0];
+                const float *input_10 = offset_input + point.offset[1];
+                const float *input_01 = offset_input + point.offset[2];
+                const float *input_11 = offset_input + point.offset[3];
+                float *grad_offset_w =
+                    cpu_fp32_output_[1] +
+                    n * pooled_width * pooled_height * 2 + ph * pooled_width +
+                    pw;
+                float *grad_offset_h =
+                    grad_offset_w + pooled_width * pooled_height;
+                for (int c = 0; c < channels; ++c) {
+                  float ogx =
+                      gamma * roi_width * grad_output_this_bin[c] *
+                      (input_11[c] * (y - y_low) + input_10[c] * (y_high - y) +
+                       input_01[c] * (y_low - y) + input_00[c] * (y - y_high));
+                  float ogy =
+                      gamma * roi_height * grad_output_this_bin[c] *
+                      (input_11[c] * (x - x_low) + input_01[c] * (x_high - x) +
+                       input_10[c] * (x_low - x) + input_00[c] * (x - x_high));
+                  *grad_offset_w += ogx;
+                  *grad_offset_h += ogy;
                 }
+                theory_ops_ += 28 * channels;  // cur block
               }
             }
           }
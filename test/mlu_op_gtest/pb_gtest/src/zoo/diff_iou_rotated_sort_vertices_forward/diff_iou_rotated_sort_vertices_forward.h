@@ -27,10 +27,6 @@ DIFF_IOU_ROTATED_SORT_VERTICES_FORWARD_H_
 DIFF_IOU_ROTATED_SORT_VERTICES_FORWARD_H_
 #include "executor.h"
 
-#define MAX_NUM_VERT_IDX 9
-#define INTERSECTION_OFFSET 8
-#define EPSILON 1e-8
-
 namespace mluoptest {
 
 class DiffIouRotatedSortVerticesForwardExecutor : public Executor {
@@ -42,10 +38,6 @@ class DiffIouRotatedSortVerticesForwardExecutor : public Executor {
   void compute() override;
   void cpuCompute() override;
   int64_t getTheoryOps() override;
-
- private:
-  bool compare_vertices(const float x1, const float y1, const float x2,
-                        const float y2);
 };
 
 }  // namespace mluoptest
@@ -24,6 +24,9 @@
 #include "dynamic_point_to_voxel_forward.h"
 
 #include <algorithm>
+#include <vector>
+
+#include "voxel_group_cpu.h"
 
 namespace mluoptest {
 void DynamicPointToVoxelForwardExecutor::paramCheck() {
@@ -129,127 +132,45 @@ void DynamicPointToVoxelForwardExecutor::cpuCompute() {
   auto voxel_num = cpu_fp32_output_[4];
   auto voxel_feats_desc = tensor_desc_[2].tensor;
 
-  // step 0
-  // If coors[i,:] contains negative numbers, coors[i,:] fill with -1
-  for (int32_t i = 0; i < N; ++i) {
-    if (coors[i * 3] < 0 || coors[i * 3 + 1] < 0 || coors[i * 3 + 2] < 0) {
-      coors[i * 3] = -1;
-      coors[i * 3 + 1] = -1;
-      coors[i * 3 + 2] = -1;
-    }
+  // Points with a negative coordinate belong to no voxel. The voxels are
+  // hashed block by block and reduced in the same pass; merging the sorted
+  // voxels of the blocks gives the order of a sorted unique.
+  GTEST_CHECK(num_coors == 3,
+              "[DynamicPointToVoxelForwardExecutor] coors must be [N, 3].");
+  std::vector<int32_t> int_coors(N * 3);
+  for (int32_t i = 0; i < N * 3; ++i) {
+    int_coors[i] = coors[i];
   }
-
-  // step 1
-  // 1.1 Get index
-  std::vector<int> index(N);
-  std::generate(index.begin(), index.end(), [n = 0]() mutable { return n++; });
-
-  // 1.2 Sort by comparing coordinates
-  auto compareInput = [=](int32_t i, int32_t j) {
-    for (int32_t idx = 0; idx < num_coors; ++idx) {
-      const int32_t lhs = coors[idx + i * num_coors];
-      const int32_t rhs = coors[idx + j * num_coors];
-      if (lhs < rhs) {
-        return true;
-      } else if (lhs > rhs) {
-        return false;
-      }
-    }
-    return false;
-  };
-  std::sort(index.begin(), index.end(), compareInput);
-  std::vector<int> index_sorted = index;
-
-  // 1.3 Unique
-  auto diffInput = [=](int32_t i, int32_t j) {
-    for (int32_t idx = 0; idx < num_coors; ++idx) {
-      const int32_t lhs = coors[idx + i * num_coors];
-      const int32_t rhs = coors[idx + j * num_coors];
-      if (lhs != rhs) {
-        return false;
-      }
-    }
-    return true;
-  };
-  std::vector<int>::iterator it =
-      std::unique(index.begin(), index.end(), diffInput);
-  index.resize(std::distance(index.begin(), it));
-
-  // 2. Calculate voxel_num
-  const bool flag = coors[index[0] * num_coors] == -1;
-  voxel_num[0] = index.size() - static_cast<int32_t>(flag);
-  for (int32_t i = 0; i < voxel_num[0]; ++i) {
-    for (int32_t j = 0; j < num_coors; ++j) {
-      if (flag) {
-        voxel_coors[i * num_coors + j] = coors[index[i + 1] * num_coors + j];
-      } else {
-        voxel_coors[i * num_coors + j] = coors[index[i] * num_coors + j];
-      }
-    }
+  voxel_group_cpu::Reduce reduce = voxel_group_cpu::Reduce::kNone;
+  if (reduce_mode == REDUCE_MODE_MAX) {
+    reduce = voxel_group_cpu::Reduce::kMax;
+  } else if (reduce_mode == REDUCE_MODE_MEAN) {
+    reduce = voxel_group_cpu::Reduce::kMean;
   }
+  const float fill_value = reduce_mode == REDUCE_MODE_MAX ? -1.17549e038 : 0x0;
+  voxel_group_cpu::Groups groups;
+  voxel_group_cpu::group(int_coors.data(), feats, N, num_features, reduce,
+                         fill_value, &groups);
 
-  // 3. Calculate point2voxel_map
-  std::vector<int> mask(N, 0);
-  for (int32_t i = 1; i < N; ++i) {
-    if (!diffInput(index_sorted[i], index_sorted[i - 1])) {
-      mask[i] = 1;
-    }
-    mask[i] += mask[i - 1];
+  voxel_num[0] = groups.voxel_num;
+  for (int32_t i = 0; i < groups.voxel_num * num_coors; ++i) {
+    voxel_coors[i] = groups.coors[i];
   }
-
+  int64_t valid_num = 0;
   for (int32_t i = 0; i < N; ++i) {
-    point2voxel_map[index_sorted[i]] = mask[i] - static_cast<int32_t>(flag);
+    point2voxel_map[i] = groups.point2voxel[i];
+    valid_num += groups.point2voxel[i] >= 0;
   }
-
-  // 4. Calculate voxel_points_count
-  int32_t voxel_points_count_idx = 0;
-  for (int32_t i = 0; i < index_sorted.size();) {
-    int32_t count = 1;
-    for (int32_t j = i + 1; j < N; ++j) {
-      if (diffInput(index_sorted[i], index_sorted[j])) {
-        count++;
-      } else {
-        break;
-      }
-    }
-    i += count;
-
-    if (flag && i == count) {
-      continue;
-    }
-
-    voxel_points_count[voxel_points_count_idx] = count;
-    voxel_points_count_idx++;
+  for (int32_t i = 0; i < groups.voxel_num; ++i) {
+    voxel_points_count[i] = groups.counts[i];
   }
-
-  // 5. Calculate voxel_feats
-  const float fill_value = reduce_mode == REDUCE_MODE_MAX ? -1.17549e038 : 0x0;
   for (int32_t i = 0; i < voxel_feats_desc->dims[0] * num_features; ++i) {
     voxel_feats[i] = fill_value;
   }
-
-  for (int32_t i = 0; i < N; ++i) {
-    const int32_t point2voxel_idx = point2voxel_map[i];
-    if (point2voxel_idx == -1) {
-      continue;
-    }
-
-    const int32_t reduce_count = voxel_points_count[point2voxel_idx];
-    const float *feats_offset = feats + i * num_features;
-    float *voxel_feats_offset = voxel_feats + point2voxel_idx * num_features;
-    if (reduce_mode == REDUCE_MODE_MAX) {
-      for (int32_t j = 0; j < num_features; ++j) {
-        if (feats_offset[j] >= voxel_feats_offset[j]) {
-          voxel_feats_offset[j] = feats_offset[j];
-          theory_ops_++;
-        }
-      }
-    } else if (reduce_mode == REDUCE_MODE_MEAN) {
-      for (int32_t j = 0; j < num_features; ++j) {
-        voxel_feats_offset[j] += feats_offset[j] / reduce_count;
-        theory_ops_++;
-      }
-    }
+  std::copy(groups.feats.begin(), groups.feats.end(), voxel_feats);
+  if (reduce != voxel_group_cpu::Reduce::kNone) {
+    // one compare or add per feature of a point in a voxel
+    theory_ops_ += valid_num * num_features;
   }
   VLOG(4) << "[DynamicPointToVoxelForwardExecutor] call cpuCompute() End.";
 }
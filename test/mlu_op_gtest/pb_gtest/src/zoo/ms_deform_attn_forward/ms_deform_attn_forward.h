@@ -35,10 +35,6 @@ class MsDeformAttnForwardExecutor : public Executor {
   int64_t getTheoryIoSize() override;
   int64_t getTheoryOps() override;
  private:
-  float ms_deform_attn_im2col_bilinear(
-      const float *&bottom_data, const int &height, const int &width,
-      const int &nheads, const int &channels, const float &h, const float &w,
-      const int &m, const int &c);
   void cpuMsDeformAttnForward(
       const float *data_value, const float *data_spatial_shapes,
       const float *data_level_start_index, const float *data_sampling_loc,
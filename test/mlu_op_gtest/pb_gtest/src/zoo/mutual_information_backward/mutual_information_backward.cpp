@@ -23,6 +23,8 @@
 
 #include "mutual_information_backward.h"
 
+#include "mutual_information_cpu.h"
+
 namespace mluoptest {
 
 void MutualInformationBackwardExecutor::initParam() {
@@ -162,152 +164,43 @@ void MutualInformationBackwardExecutor::cpuCompute() {
   host_px_grad = cpu_fp32_output_[1];
   host_py_grad = cpu_fp32_output_[2];
 
-  int s_begin = 0;
-  int t_begin = 0;
-  int s_end = S_;
-  int t_end = T_;
+  // px and py are turned into the terms in place and p into p_grad. The
+  // lattices of the batch are independent; a single lattice is parallel
+  // over its anti-diagonals in mutual_information_cpu instead.
+  int64_t theory_ops = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : theory_ops) \
+    if (B_ > 1)
   for (int b = 0; b < B_; ++b) {
+    mutual_information_cpu::Lattice lattice = {S_, T_, 0, S_, 0, T_};
     if (host_opt_boundary != nullptr) {
-      s_begin = (int)host_opt_boundary[b * 4];
-      t_begin = (int)host_opt_boundary[b * 4 + 1];
-      s_end = (int)host_opt_boundary[b * 4 + 2];
-      t_end = (int)host_opt_boundary[b * 4 + 3];
+      lattice.s_begin = (int)host_opt_boundary[b * 4];
+      lattice.t_begin = (int)host_opt_boundary[b * 4 + 1];
+      lattice.s_end = (int)host_opt_boundary[b * 4 + 2];
+      lattice.t_end = (int)host_opt_boundary[b * 4 + 3];
     }
-
-    computeTerm1AndTerm2(b, s_begin, s_end, t_begin, t_end, host_px, host_py,
-                         host_p);
-    computePGrad(b, s_begin, s_end, t_begin, t_end, host_px, host_py, host_p,
-                 ans_grad_in_, host_ans_grad_out);
-    computePxGradAndPyGrad(b, s_begin, s_end, t_begin, t_end, host_px, host_py,
-                           host_p, host_px_grad, host_py_grad);
+    float *term1 = host_px + px_index_(b, 0, 0);
+    float *term2 = host_py + py_index_(b, 0, 0);
+    float *p = host_p + p_index_(b, 0, 0);
+
+    theory_ops += mutual_information_cpu::terms(lattice, term1, term2, p);
+    theory_ops += mutual_information_cpu::pGrad(lattice, term1, term2,
+                                                ans_grad_in_[b], p);
+    if (overwrite_ans_grad_ && lattice.s_begin <= lattice.s_end &&
+        lattice.t_begin <= lattice.t_end) {
+      host_ans_grad_out[b] = p[lattice.p(lattice.s_begin, lattice.t_begin)];
+      theory_ops++;
+    }
+    theory_ops += mutual_information_cpu::pxPyGrad(
+        lattice, term1, term2, p, host_px_grad + px_index_(b, 0, 0),
+        host_py_grad + py_index_(b, 0, 0));
   }
+  theory_ops_ += theory_ops;
 
   if (ans_grad_in_) {
     cpu_runtime_.deallocate(ans_grad_in_);
   }
 }
 
-float MutualInformationBackwardExecutor::safeExp(float x) {
-  if (x - x != 0) {
-    theory_ops_ += 2;
-    return 0;
-  } else {
-    float ans = std::exp(x);
-    theory_ops_ += 5;
-    if (ans - ans != 0.0) {
-      return 0;
-    }
-    return ans;
-  }
-}
-
-void MutualInformationBackwardExecutor::computeTerm1AndTerm2(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *px, float *py, float *p) {
-  for (int s = s_begin; s <= s_end; ++s) {
-    for (int t = t_begin; t <= t_end; ++t) {
-      theory_ops_++;
-      if (p[p_index_(b, s, t)] < large_neg_num_) {
-        p[p_index_(b, s, t)] = large_neg_num_;
-        theory_ops_++;
-      }
-    }
-  }
-
-  for (int s = s_begin; s <= s_end; ++s) {
-    for (int t = t_begin; t <= t_end; ++t) {
-      if (s < s_end) {
-        // compute term1
-        px[px_index_(b, s, t)] = safeExp(p[p_index_(b, s, t)] +
-                                         px[px_index_(b, s, t)] -
-                                         p[p_index_(b, s + 1, t)]);
-        theory_ops_ += 2;
-      }
-
-      if (t < t_end) {
-        // compute term2
-        py[py_index_(b, s, t)] = safeExp(p[p_index_(b, s, t)] +
-                                         py[py_index_(b, s, t)] -
-                                         p[p_index_(b, s, t + 1)]);
-        theory_ops_ += 2;
-      }
-    }
-  }
-}
-
-void MutualInformationBackwardExecutor::computePGrad(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *term1, float *term2, float *p, float *ans_grad_in,
-    float *ans_grad_out) {
-  // compute p_grad[b][s_end][t_end]
-  p[p_index_(b, s_end, t_end)] = ans_grad_in[b];
-  theory_ops_++;
-
-  // compute p_grad[b][s_end][0:t_end]
-  for (int t = t_end - 1; t >= t_begin; --t) {
-    p[p_index_(b, s_end, t)] = term2[py_index_(b, s_end, t)] *
-                               p[p_index_(b, s_end, t + 1)];
-    theory_ops_++;
-  }
-
-  // compute p_grad[b][0:s_end][t_end]
-  for (int s = s_end - 1; s >= s_begin; --s) {
-    p[p_index_(b, s, t_end)] = term1[px_index_(b, s, t_end)] *
-                               p[p_index_(b, s + 1, t_end)];
-    theory_ops_++;
-  }
-
-  for (int s = s_end - 1; s >= s_begin; --s) {
-    for (int t = t_end - 1; t >= t_begin; --t) {
-      p[p_index_(b, s, t)] = term1[px_index_(b, s, t)] *
-                             p[p_index_(b, s + 1, t)] +
-                             term2[py_index_(b, s, t)] *
-                             p[p_index_(b, s, t + 1)];
-      theory_ops_ += 3;
-    }
-  }
-
-  if (overwrite_ans_grad_ && s_begin <= s_end && t_begin <= t_end) {
-    ans_grad_out[b] = p[p_index_(b, s_begin, t_begin)];
-    theory_ops_++;
-  }
-}
-
-void MutualInformationBackwardExecutor::computePxGradAndPyGrad(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *term1, float *term2, float *p_grad, float *px_grad,
-    float *py_grad) {
-  for (int s = s_begin; s <= s_end; ++s) {
-    for (int t = t_begin; t <= t_end; ++t) {
-      if (s < s_end) {
-        // compute px_grad
-        px_grad[px_index_(b, s, t)] = p_grad[p_index_(b, s + 1, t)] *
-                                      term1[px_index_(b, s, t)];
-      }
-
-      if (t < t_end) {
-        // compute py_grad
-        py_grad[py_index_(b, s, t)] = p_grad[p_index_(b, s, t + 1)] *
-                                      term2[py_index_(b, s, t)];
-      }
-    }
-  }
-
-  for (int s = 0; s <= S_; ++s) {
-    for (int t = 0; t <= T_; ++t) {
-      if (s < S_ && (s < s_begin || s >= s_end) && (t < t_begin || t > t_end)) {
-        px_grad[px_index_(b, s, t)] = 0;
-      }
-
-      if (t < T_ && (s < s_begin || s > s_end) && (t < t_begin || t >= t_end)) {
-        py_grad[py_index_(b, s, t)] = 0;
-      }
-    }
-  }
-
-  theory_ops_ += S_ * (T_ + 1) + (S_ + 1) * T_;
-}
-
 int64_t MutualInformationBackwardExecutor::getTheoryOps() {
   if (parser_->device() != Device::CPU) {
     theory_ops_ = 0;
@@ -61,18 +61,6 @@ class MutualInformationBackwardExecutor : public Executor {
 
  private:
   void initParam();
-  void computeTerm1AndTerm2(const int b, const int s_begin, const int s_end,
-                            const int t_begin, const int t_end, float *px,
-                            float *py, float *p);
-  void computePGrad(const int b, const int s_begin, const int s_end,
-                    const int t_begin, const int t_end, float *term1,
-                    float *term2, float *p, float *ans_grad_in,
-                    float *ans_grad_out);
-  void computePxGradAndPyGrad(const int b, const int s_begin, const int s_end,
-                              const int t_begin, const int t_end, float *term1,
-                              float *term2, float *p_grad, float *px_grad,
-                              float *py_grad);
-  float safeExp(float x);
 
   mluOpTensorDescriptor_t px_desc_ = nullptr;
   mluOpTensorDescriptor_t py_desc_ = nullptr;
@@ -88,7 +76,6 @@ class MutualInformationBackwardExecutor : public Executor {
   int S_ = 0;
   int T_ = 0;
   int64_t theory_ops_ = 0;
-  const float large_neg_num_ = -1.0e+30;
 
   // max intput num is 5: px, py, opt_boundary, p, ans_grad
   // max output num is 3: ans_grad, px_grad, py_grad
@@ -23,6 +23,8 @@
 
 #include "mutual_information_forward.h"
 
+#include "mutual_information_cpu.h"
+
 namespace mluoptest {
 
 void MutualInformationForwardExecutor::initParam() {
@@ -132,80 +134,33 @@ void MutualInformationForwardExecutor::cpuCompute() {
   memcpy(host_p_out, p_in_, B_ * (S_ + 1) * (T_ + 1) * sizeof(float));
   float *host_ans = cpu_fp32_output_[1];
 
-  int s_begin = 0;
-  int t_begin = 0;
-  int s_end = S_;
-  int t_end = T_;
+  // the lattices of the batch are independent; a single lattice is
+  // parallel over its anti-diagonals in mutual_information_cpu instead.
+  int64_t theory_ops = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : theory_ops) \
+    if (B_ > 1)
   for (int b = 0; b < B_; ++b) {
+    mutual_information_cpu::Lattice lattice = {S_, T_, 0, S_, 0, T_};
     if (host_opt_boundary != nullptr) {
-      s_begin = (int)host_opt_boundary[b * 4];
-      t_begin = (int)host_opt_boundary[b * 4 + 1];
-      s_end = (int)host_opt_boundary[b * 4 + 2];
-      t_end = (int)host_opt_boundary[b * 4 + 3];
+      lattice.s_begin = (int)host_opt_boundary[b * 4];
+      lattice.t_begin = (int)host_opt_boundary[b * 4 + 1];
+      lattice.s_end = (int)host_opt_boundary[b * 4 + 2];
+      lattice.t_end = (int)host_opt_boundary[b * 4 + 3];
     }
-    computeMutualInformation(b, s_begin, s_end, t_begin, t_end, host_px,
-                             host_py, host_p_out, host_ans);
+    float *p = host_p_out + p_index_(b, 0, 0);
+    theory_ops += mutual_information_cpu::forward(
+        lattice, host_px + px_index_(b, 0, 0), host_py + py_index_(b, 0, 0),
+        p);
+    host_ans[b] = p[lattice.p(lattice.s_end, lattice.t_end)];
+    theory_ops++;
   }
+  theory_ops_ += theory_ops;
 
   if (p_in_) {
     cpu_runtime_.deallocate(p_in_);
   }
 }
 
-float MutualInformationForwardExecutor::logAdd(float x, float y) {
-  float diff;
-  if (x < y) {
-    diff = x - y;
-    x = y;
-    theory_ops_ += 2;
-  } else {
-    diff = y - x;
-    theory_ops_++;
-  }
-
-  if (diff >= min_log_diff_float) {
-    float res;
-    res = x + log1pf(expf(diff));
-    theory_ops_ += 4;
-    return res;
-  }
-
-  return x;
-}
-
-void MutualInformationForwardExecutor::computeMutualInformation(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *px, float *py, float *p, float *ans) {
-  p[p_index_(b, s_begin, t_begin)] = 0;
-  theory_ops_++;
-
-  for (int s = s_begin + 1; s <= s_end; ++s) {
-    p[p_index_(b, s, t_begin)] = logAdd(p[p_index_(b, s - 1, t_begin)] +
-                                        px[px_index_(b, s - 1, t_begin)],
-                                        -INFINITY);
-    theory_ops_++;
-  }
-
-  for (int t = t_begin + 1; t <= t_end; ++t) {
-    p[p_index_(b, s_begin, t)] = logAdd(-INFINITY,
-                                        p[p_index_(b, s_begin, t - 1)] +
-                                        py[py_index_(b, s_begin, t - 1)]);
-    theory_ops_++;
-  }
-
-  for (int s = s_begin + 1; s <= s_end; ++s) {
-    for (int t = t_begin + 1; t <= t_end; ++t) {
-      p[p_index_(b, s, t)] = logAdd(
-          p[p_index_(b, s - 1, t)] + px[px_index_(b, s - 1, t)],
-          p[p_index_(b, s, t - 1)] + py[py_index_(b, s, t - 1)]);
-      theory_ops_ += 2;
-    }
-  }
-
-  ans[b] = p[p_index_(b, s_end, t_end)];
-  theory_ops_++;
-}
-
 int64_t MutualInformationForwardExecutor::getTheoryOps() {
   if (parser_->device() != Device::CPU) {
     theory_ops_ = 0;
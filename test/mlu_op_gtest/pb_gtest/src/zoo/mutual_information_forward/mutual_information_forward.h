@@ -62,10 +62,6 @@ class MutualInformationForwardExecutor : public Executor {
 
  private:
   void initParam();
-  void computeMutualInformation(const int b, const int s_begin, const int s_end,
-                                const int t_begin, const int t_end, float *px,
-                                float *py, float *p, float *ans);
-  float logAdd(float x, float y);
 
   mluOpTensorDescriptor_t px_desc_ = nullptr;
   mluOpTensorDescriptor_t py_desc_ = nullptr;
@@ -78,7 +74,6 @@ class MutualInformationForwardExecutor : public Executor {
   int S_ = 0;
   int T_ = 0;
   int64_t theory_ops_ = 0;
-  const float min_log_diff_float = -15.9423847198486328125f;
 
   // max intput num is 4: px, py, opt_boundary, p
   // max output num is 2: p, ans
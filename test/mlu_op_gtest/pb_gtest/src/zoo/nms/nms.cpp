@@ -21,8 +21,13 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include <sys/time.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
 #include "nms.h"
 #include "mlu_op.h"
+#include "nms_cpu_engine.h"
 
 namespace mluoptest {
 void NmsExecutor::paramCheck() {
@@ -224,6 +229,129 @@ void NmsExecutor::nms3D_detection_cpu(float *output_data, int &output_box_num,
   cpu_runtime_.deallocate(box_b);
 }
 
+namespace {
+// Converts a box to (x1, y1, x2, y2) according to box_mode. The selected box
+// and the candidates go through the same code so that their IoU is
+// bit-identical whichever path computes it.
+inline void convertNmsBox(mluOpNmsBoxPointMode_t box_mode, float *x1,
+                          float *y1, float *x2, float *y2) {
+  if (box_mode == 0) {
+    if (*x1 > *x2) {
+      float tmp = *x1;
+      *x1 = *x2;
+      *x2 = tmp;
+    }
+    if (*y1 > *y2) {
+      float tmp = *y1;
+      *y1 = *y2;
+      *y2 = tmp;
+    }
+  } else if (box_mode == 1) {
+    *x1 = *x1 - *x2 * 0.5;
+    *x2 = *x1 + *x2;
+    *y1 = *y1 - *y2 * 0.5;
+    *y2 = *y1 + *y2;
+  }
+}
+
+inline float nmsBoxIou(float max_x1, float max_y1, float max_x2, float max_y2,
+                       float max_area, float x1_cur, float y1_cur,
+                       float x2_cur, float y2_cur, mluOpNmsAlgo_t algo,
+                       float offset) {
+  float area_cur = 0.0;
+  if (algo == 1) {
+    area_cur = (x2_cur - x1_cur + offset) * (y2_cur - y1_cur + offset);
+  } else {
+    area_cur = (x2_cur - x1_cur) * (y2_cur - y1_cur);
+  }
+
+  // get the area_I
+  float inter_x1 = (max_x1 > x1_cur ? max_x1 : x1_cur);
+  float inter_y1 = (max_y1 > y1_cur ? max_y1 : y1_cur);
+  float inter_x2 = (max_x2 > x2_cur ? x2_cur : max_x2);
+  float inter_y2 = (max_y2 > y2_cur ? y2_cur : max_y2);
+  float inter_w = 0.0, inter_h = 0.0;
+  if (algo == 1) {
+    inter_w = inter_x2 - inter_x1 + offset;
+    inter_h = inter_y2 - inter_y1 + offset;
+  } else {
+    inter_w = inter_x2 - inter_x1;
+    inter_h = inter_y2 - inter_y1;
+  }
+  if (inter_w < 0) {
+    inter_w = 0;
+  }
+  if (inter_h < 0) {
+    inter_h = 0;
+  }
+  float area_I = inter_w * inter_h;
+  // get the area_U
+  float area_U = max_area + area_cur - area_I;
+  return area_I / area_U;
+}
+
+inline float nmsMaxArea(float max_x1, float max_y1, float max_x2,
+                        float max_y2, mluOpNmsAlgo_t algo, float offset) {
+  if (algo == 0 || offset == 0.0) {
+    return (max_x2 - max_x1) * (max_y2 - max_y1);
+  }
+  return (max_x2 - max_x1 + offset) * (max_y2 - max_y1 + offset);
+}
+
+inline void writeNmsOutput(float *output_data, int output_box_num,
+                           mluOpNmsOutputMode_t output_mode, int keepNum,
+                           int max_index, float max_score, float max_x1,
+                           float max_y1, float max_x2, float max_y2,
+                           int batch_idx, int class_idx) {
+  if (output_mode == 0) {
+    // save index of max score
+    output_data[output_box_num] = max_index;
+  } else if (output_mode == 1) {
+    output_data[output_box_num * 5 + 0] = max_score;
+    output_data[output_box_num * 5 + 1] = max_x1;
+    output_data[output_box_num * 5 + 2] = max_y1;
+    output_data[output_box_num * 5 + 3] = max_x2;
+    output_data[output_box_num * 5 + 4] = max_y2;
+  } else if (output_mode == 2) {
+    output_data[0 * keepNum + output_box_num] = max_score;
+    output_data[1 * keepNum + output_box_num] = max_x1;
+    output_data[2 * keepNum + output_box_num] = max_y1;
+    output_data[3 * keepNum + output_box_num] = max_x2;
+    output_data[4 * keepNum + output_box_num] = max_y2;
+  } else if (output_mode == 3) {
+    output_data[output_box_num * 3 + 0] = batch_idx;
+    output_data[output_box_num * 3 + 1] = class_idx;
+    output_data[output_box_num * 3 + 2] = max_index;
+  } else {
+    VLOG(4) << "unsupport output mode now.";
+  }
+}
+
+// Copies the entries written by one nms_detection_cpu call from its private
+// buffer, the same entries the serial loop would have (over)written.
+void copyNmsOutput(float *dst, const float *src, int output_box_num,
+                   mluOpNmsOutputMode_t output_mode, int keepNum) {
+  if (output_mode == 0) {
+    memcpy(dst, src, output_box_num * sizeof(float));
+  } else if (output_mode == 1) {
+    memcpy(dst, src, 5 * output_box_num * sizeof(float));
+  } else if (output_mode == 2) {
+    for (int i = 0; i < 5; ++i) {
+      memcpy(dst + i * keepNum, src + i * keepNum,
+             output_box_num * sizeof(float));
+    }
+  } else if (output_mode == 3) {
+    memcpy(dst, src, 3 * output_box_num * sizeof(float));
+  }
+}
+
+int nmsOutputStride(mluOpNmsOutputMode_t output_mode) {
+  if (output_mode == 0) return 1;
+  if (output_mode == 3) return 3;
+  return 5;
+}
+}  // namespace
+
 void NmsExecutor::nms_detection_cpu(
     float *output_data, int &output_box_num, float *input_data,
     float *input_score, int input_box_num, int keepNum, float thresh_iou,
@@ -231,11 +359,13 @@ void NmsExecutor::nms_detection_cpu(
     mluOpNmsAlgo_t algo, float offset, mluOpNmsBoxPointMode_t box_mode,
     mluOpNmsMethodMode_t method_mode, float soft_nms_sigma, int batch_idx,
     int class_idx) {
-  float *score = cpu_runtime_.allocate(new float[input_box_num]);
-  float *x1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *x2 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y2 = cpu_runtime_.allocate(new float[input_box_num]);
+  // plain vectors instead of cpu_runtime_, this function runs concurrently
+  // for different batches and classes.
+  std::vector<float> score(input_score, input_score + input_box_num);
+  std::vector<float> x1(input_box_num);
+  std::vector<float> y1(input_box_num);
+  std::vector<float> x2(input_box_num);
+  std::vector<float> y2(input_box_num);
   if (input_layout == 0) {
     // input layout is [boxes_num, 4]
     for (int i = 0; i < input_box_num; i++) {
@@ -243,25 +373,33 @@ void NmsExecutor::nms_detection_cpu(
       y1[i] = input_data[1 + i * 4];
       x2[i] = input_data[2 + i * 4];
       y2[i] = input_data[3 + i * 4];
-      // VLOG(4) << i << " x1:" << x1[i] << "y1:" << y1[i] << "x2:" << x2[i] <<
-      // "y2:" << y2[i];
     }
   } else if (input_layout == 1) {
     // input layout is [4, boxes_num]
-    memcpy(x1, input_data, input_box_num * sizeof(float));
-    memcpy(y1, input_data + 1 * input_box_num, input_box_num * sizeof(float));
-    memcpy(x2, input_data + 2 * input_box_num, input_box_num * sizeof(float));
-    memcpy(y2, input_data + 3 * input_box_num, input_box_num * sizeof(float));
+    memcpy(x1.data(), input_data, input_box_num * sizeof(float));
+    memcpy(y1.data(), input_data + 1 * input_box_num,
+           input_box_num * sizeof(float));
+    memcpy(x2.data(), input_data + 2 * input_box_num,
+           input_box_num * sizeof(float));
+    memcpy(y2.data(), input_data + 3 * input_box_num,
+           input_box_num * sizeof(float));
   } else {
     VLOG(4) << "unsupport data layout now.";
   }
-  memcpy(score, input_score, input_box_num * sizeof(float));
+
+  if (nms_detection_binned_cpu(output_data, output_box_num, x1.data(),
+                               y1.data(), x2.data(), y2.data(), score.data(),
+                               input_box_num, keepNum, thresh_iou,
+                               thresh_score, output_mode, algo, offset,
+                               box_mode, method_mode, batch_idx, class_idx)) {
+    return;
+  }
+
   for (int keep = 0; keep < keepNum; keep++) {
     // find the max score
     float max_score = score[0];
     int max_index = 0;
     float max_x1, max_y1, max_x2, max_y2;
-    float output_x1, output_y1, output_x2, output_y2;
     float max_area = 0;
 
     for (int i = 1; i < input_box_num; i++) {
@@ -279,57 +417,14 @@ void NmsExecutor::nms_detection_cpu(
       break;
     }
 
-    // VLOG(4) << "max_index:" << max_index;
-    // VLOG(4) << "max_score: " << max_score << "x1: " << max_x1 << "y1: " <<
-    // max_y1
-    //        << "x2: " << max_x2 << "y2: " << max_y2;
-    if (output_mode == 0) {
-      // save index of max score
-      output_data[output_box_num] = max_index;
-    } else if (output_mode == 1) {
-      output_data[output_box_num * 5 + 0] = max_score;
-      output_data[output_box_num * 5 + 1] = max_x1;
-      output_data[output_box_num * 5 + 2] = max_y1;
-      output_data[output_box_num * 5 + 3] = max_x2;
-      output_data[output_box_num * 5 + 4] = max_y2;
-    } else if (output_mode == 2) {
-      output_data[0 * keepNum + output_box_num] = max_score;
-      output_data[1 * keepNum + output_box_num] = max_x1;
-      output_data[2 * keepNum + output_box_num] = max_y1;
-      output_data[3 * keepNum + output_box_num] = max_x2;
-      output_data[4 * keepNum + output_box_num] = max_y2;
-    } else if (output_mode == 3) {
-      output_data[output_box_num * 3 + 0] = batch_idx;
-      output_data[output_box_num * 3 + 1] = class_idx;
-      output_data[output_box_num * 3 + 2] = max_index;
-    } else {
-      VLOG(4) << "unsupport output mode now.";
-    }
+    writeNmsOutput(output_data, output_box_num, output_mode, keepNum,
+                   max_index, max_score, max_x1, max_y1, max_x2, max_y2,
+                   batch_idx, class_idx);
     output_box_num++;
     score[max_index] = 0;
 
-    if (box_mode == 0) {
-      if (max_x1 > max_x2) {
-        float tmp = max_x1;
-        max_x1 = max_x2;
-        max_x2 = tmp;
-      }
-      if (max_y1 > max_y2) {
-        float tmp = max_y1;
-        max_y1 = max_y2;
-        max_y2 = tmp;
-      }
-    } else if (box_mode == 1) {
-      max_x1 = max_x1 - max_x2 * 0.5;
-      max_x2 = max_x1 + max_x2;
-      max_y1 = max_y1 - max_y2 * 0.5;
-      max_y2 = max_y1 + max_y2;
-    }
-    if (algo == 0 || offset == 0.0) {
-      max_area = (max_x2 - max_x1) * (max_y2 - max_y1);
-    } else {
-      max_area = (max_x2 - max_x1 + offset) * (max_y2 - max_y1 + offset);
-    }
+    convertNmsBox(box_mode, &max_x1, &max_y1, &max_x2, &max_y2);
+    max_area = nmsMaxArea(max_x1, max_y1, max_x2, max_y2, algo, offset);
 
     for (int i = 0; i < input_box_num; i++) {
       // compute the IOU
@@ -337,53 +432,9 @@ void NmsExecutor::nms_detection_cpu(
       float y1_cur = y1[i];
       float x2_cur = x2[i];
       float y2_cur = y2[i];
-      float area_cur = 0.0;
-      if (box_mode == 0) {
-        if (x1_cur > x2_cur) {
-          float tmp = x1_cur;
-          x1_cur = x2_cur;
-          x2_cur = tmp;
-        }
-        if (y1_cur > y2_cur) {
-          float tmp = y1_cur;
-          y1_cur = y2_cur;
-          y2_cur = tmp;
-        }
-      } else if (box_mode == 1) {
-        x1_cur = x1_cur - x2_cur * 0.5;
-        x2_cur = x1_cur + x2_cur;
-        y1_cur = y1_cur - y2_cur * 0.5;
-        y2_cur = y1_cur + y2_cur;
-      }
-      if (algo == 1) {
-        area_cur = (x2_cur - x1_cur + offset) * (y2_cur - y1_cur + offset);
-      } else {
-        area_cur = (x2_cur - x1_cur) * (y2_cur - y1_cur);
-      }
-
-      // get the area_I
-      float inter_x1 = (max_x1 > x1_cur ? max_x1 : x1_cur);
-      float inter_y1 = (max_y1 > y1_cur ? max_y1 : y1_cur);
-      float inter_x2 = (max_x2 > x2_cur ? x2_cur : max_x2);
-      float inter_y2 = (max_y2 > y2_cur ? y2_cur : max_y2);
-      float inter_w = 0.0, inter_h = 0.0;
-      if (algo == 1) {
-        inter_w = inter_x2 - inter_x1 + offset;
-        inter_h = inter_y2 - inter_y1 + offset;
-      } else {
-        inter_w = inter_x2 - inter_x1;
-        inter_h = inter_y2 - inter_y1;
-      }
-      if (inter_w < 0) {
-        inter_w = 0;
-      }
-      if (inter_h < 0) {
-        inter_h = 0;
-      }
-      float area_I = inter_w * inter_h;
-      // get the area_U
-      float area_U = max_area + area_cur - area_I;
-      float iou = area_I / area_U;
+      convertNmsBox(box_mode, &x1_cur, &y1_cur, &x2_cur, &y2_cur);
+      float iou = nmsBoxIou(max_x1, max_y1, max_x2, max_y2, max_area, x1_cur,
+                            y1_cur, x2_cur, y2_cur, algo, offset);
       // update the score
       if (method_mode == 0) {
         if (iou > thresh_iou) {
@@ -402,12 +453,127 @@ void NmsExecutor::nms_detection_cpu(
       }
     }
   }
-  // VLOG(4) << "ouput_boxes_num:" << output_box_num;
-  cpu_runtime_.deallocate(score);
-  cpu_runtime_.deallocate(x1);
-  cpu_runtime_.deallocate(y1);
-  cpu_runtime_.deallocate(x2);
-  cpu_runtime_.deallocate(y2);
+}
+
+bool NmsExecutor::nms_detection_binned_cpu(
+    float *output_data, int &output_box_num, const float *x1, const float *y1,
+    const float *x2, const float *y2, const float *score, int input_box_num,
+    int keepNum, float thresh_iou, float thresh_score,
+    mluOpNmsOutputMode_t output_mode, mluOpNmsAlgo_t algo, float offset,
+    mluOpNmsBoxPointMode_t box_mode, mluOpNmsMethodMode_t method_mode,
+    int batch_idx, int class_idx) {
+  // The argmax loop above is a sort followed by a greedy pass only for hard
+  // NMS where suppressed boxes (score 0) can never be selected again, and
+  // disjoint boxes never suppress each other only when thresh_iou >= 0.
+  if (method_mode != 0 || !(thresh_iou >= 0) || !(thresh_score >= 0) ||
+      input_box_num <= 0) {
+    return false;
+  }
+  std::vector<nms_cpu::Bound> bounds(input_box_num);
+  const float pad = (algo == 1 && offset > 0) ? offset : 0.0f;
+  for (int i = 0; i < input_box_num; ++i) {
+    if (std::isnan(score[i])) return false;
+    float bx1 = x1[i], by1 = y1[i], bx2 = x2[i], by2 = y2[i];
+    convertNmsBox(box_mode, &bx1, &by1, &bx2, &by2);
+    if (!std::isfinite(bx1) || !std::isfinite(by1) || !std::isfinite(bx2) ||
+        !std::isfinite(by2)) {
+      return false;
+    }
+    // margin covers the rounding of the offset term in inter_w/inter_h.
+    const float margin =
+        pad + 1e-6f * (1.0f + std::max(std::max(fabsf(bx1), fabsf(bx2)),
+                                       std::max(fabsf(by1), fabsf(by2))));
+    bounds[i].x1 = std::min(bx1, bx2) - margin;
+    bounds[i].y1 = std::min(by1, by2) - margin;
+    bounds[i].x2 = std::max(bx1, bx2) + margin;
+    bounds[i].y2 = std::max(by1, by2) + margin;
+  }
+
+  std::vector<int> order;
+  order.reserve(input_box_num);
+  for (int i = 0; i < input_box_num; ++i) {
+    if (score[i] > thresh_score) order.push_back(i);
+  }
+  nms_cpu::sortByScoreStable(score, &order);
+
+  auto overlap = [&](int i, int j) {
+    float max_x1 = x1[i], max_y1 = y1[i], max_x2 = x2[i], max_y2 = y2[i];
+    convertNmsBox(box_mode, &max_x1, &max_y1, &max_x2, &max_y2);
+    float max_area = nmsMaxArea(max_x1, max_y1, max_x2, max_y2, algo, offset);
+    float x1_cur = x1[j], y1_cur = y1[j], x2_cur = x2[j], y2_cur = y2[j];
+    convertNmsBox(box_mode, &x1_cur, &y1_cur, &x2_cur, &y2_cur);
+    return nmsBoxIou(max_x1, max_y1, max_x2, max_y2, max_area, x1_cur, y1_cur,
+                     x2_cur, y2_cur, algo, offset);
+  };
+  std::vector<int> keep =
+      nms_cpu::greedyNms(order, input_box_num, overlap, thresh_iou,
+                         bounds.data(), std::max(keepNum, 0));
+  for (int max_index : keep) {
+    writeNmsOutput(output_data, output_box_num, output_mode, keepNum,
+                   max_index, score[max_index], x1[max_index], y1[max_index],
+                   x2[max_index], y2[max_index], batch_idx, class_idx);
+    output_box_num++;
+  }
+  return true;
+}
+
+void NmsExecutor::nms_detection_all_cpu(
+    float *output_data, int &total_output_boxes_num, float *input_boxes,
+    float *input_conf, int input_batches_num, int input_classes_num,
+    int input_boxes_num, int keepNum, float thresh_iou, float thresh_score,
+    mluOpNmsOutputMode_t output_mode, int input_layout, mluOpNmsAlgo_t algo,
+    float offset, mluOpNmsBoxPointMode_t box_mode,
+    mluOpNmsMethodMode_t method_mode, float soft_nms_sigma) {
+  const int task_num = input_batches_num * input_classes_num;
+  const size_t task_output_size =
+      (size_t)nmsOutputStride(output_mode) * std::max(keepNum, 0);
+  // every (batch, class) runs into a private buffer, results are then
+  // copied in the serial order since the mode 3 offsets are cumulative.
+  const bool run_parallel =
+      task_num > 1 &&
+      task_num * task_output_size * sizeof(float) <= (256UL << 20);
+  if (!run_parallel) {
+    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
+      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
+        int boxes_offset = input_boxes_num * 4 * batch_idx;
+        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
+                          input_boxes_num * class_idx;
+        int output_offset =
+            output_mode == 3 ? 3 * total_output_boxes_num : 0;
+        int output_boxes_num = 0;
+        nms_detection_cpu(output_data + output_offset, output_boxes_num,
+                          input_boxes + boxes_offset, input_conf + conf_offset,
+                          input_boxes_num, keepNum, thresh_iou, thresh_score,
+                          output_mode, input_layout, algo, offset, box_mode,
+                          method_mode, soft_nms_sigma, batch_idx, class_idx);
+        total_output_boxes_num += output_boxes_num;
+      }
+    }
+    return;
+  }
+
+  std::vector<std::vector<float>> task_output(task_num);
+  std::vector<int> task_boxes_num(task_num, 0);
+#pragma omp parallel for schedule(dynamic)
+  for (int task = 0; task < task_num; ++task) {
+    const int batch_idx = task / input_classes_num;
+    const int class_idx = task % input_classes_num;
+    int boxes_offset = input_boxes_num * 4 * batch_idx;
+    int conf_offset = input_classes_num * input_boxes_num * batch_idx +
+                      input_boxes_num * class_idx;
+    task_output[task].resize(task_output_size);
+    nms_detection_cpu(task_output[task].data(), task_boxes_num[task],
+                      input_boxes + boxes_offset, input_conf + conf_offset,
+                      input_boxes_num, keepNum, thresh_iou, thresh_score,
+                      output_mode, input_layout, algo, offset, box_mode,
+                      method_mode, soft_nms_sigma, batch_idx, class_idx);
+  }
+  for (int task = 0; task < task_num; ++task) {
+    int output_offset = output_mode == 3 ? 3 * total_output_boxes_num : 0;
+    copyNmsOutput(output_data + output_offset, task_output[task].data(),
+                  task_boxes_num[task], output_mode, keepNum);
+    total_output_boxes_num += task_boxes_num[task];
+  }
 }
 
 void NmsExecutor::cpuCompute() {
@@ -479,23 +645,11 @@ void NmsExecutor::cpuCompute() {
     nms3D_detection_cpu(output_info, total_output_boxes_num, input_boxes,
                         input_boxes_num, iou_thresh, input_layout);
   } else {
-    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
-      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
-        int boxes_offset = input_boxes_num * 4 * batch_idx;
-        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
-                          input_boxes_num * class_idx;
-        int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
-        int output_boxes_num = 0;
-        nms_detection_cpu((float *)output_info + output_offset,
-                          output_boxes_num, (float *)input_boxes + boxes_offset,
-                          (float *)input_conf + conf_offset, input_boxes_num,
-                          max_output_boxes, iou_thresh, confidence_threshold,
-                          mode, input_layout, algo, offset, box_mode,
-                          method_mode, soft_nms_sigma, batch_idx, class_idx);
-        total_output_boxes_num += output_boxes_num;
-        // VLOG(4) << "total_output_boxes:" << total_output_boxes_num;
-      }
-    }
+    nms_detection_all_cpu(output_info, total_output_boxes_num, input_boxes,
+                          input_conf, input_batches_num, input_classes_num,
+                          input_boxes_num, max_output_boxes, iou_thresh,
+                          confidence_threshold, mode, input_layout, algo,
+                          offset, box_mode, method_mode, soft_nms_sigma);
   }
   // save the output boxes num, computed by CPU
   VLOG(4) << "total_output_boxes_num:" << total_output_boxes_num;
@@ -720,22 +874,11 @@ int64_t NmsExecutor::getTheoryOps() {
     nms3D_detection_cpu(output_info, total_output_boxes_num, input_boxes,
                         input_boxes_num, iou_thresh, input_layout);
   } else {
-    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
-      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
-        int boxes_offset = input_boxes_num * 4 * batch_idx;
-        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
-                          input_boxes_num * class_idx;
-        int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
-        int output_boxes_num = 0;
-        nms_detection_cpu((float *)output_info + output_offset,
-                          output_boxes_num, (float *)input_boxes + boxes_offset,
-                          (float *)input_conf + conf_offset, input_boxes_num,
-                          max_output_boxes, iou_thresh, confidence_threshold,
-                          mode, input_layout, algo, offset, box_mode,
-                          method_mode, soft_nms_sigma, batch_idx, class_idx);
-        total_output_boxes_num += output_boxes_num;
-      }
-    }
+    nms_detection_all_cpu(output_info, total_output_boxes_num, input_boxes,
+                          input_conf, input_batches_num, input_classes_num,
+                          input_boxes_num, max_output_boxes, iou_thresh,
+                          confidence_threshold, mode, input_layout, algo,
+                          offset, box_mode, method_mode, soft_nms_sigma);
   }
   cpu_runtime_.deallocate(output_info);
   cp_count *= total_output_boxes_num;
@@ -47,6 +47,23 @@ class NmsExecutor : public Executor {
                          mluOpNmsBoxPointMode_t box_mode,
                          mluOpNmsMethodMode_t method_mode, float soft_nms_sigma,
                          int batch_idx, int class_idx);
+  // hard NMS through a sort and a binned greedy pass, returns false when
+  // the parameters need the argmax loop of nms_detection_cpu.
+  bool nms_detection_binned_cpu(
+      float *output_data, int &output_box_num, const float *x1,
+      const float *y1, const float *x2, const float *y2, const float *score,
+      int input_box_num, int keepNum, float thresh_iou, float thresh_score,
+      mluOpNmsOutputMode_t output_mode, mluOpNmsAlgo_t algo, float offset,
+      mluOpNmsBoxPointMode_t box_mode, mluOpNmsMethodMode_t method_mode,
+      int batch_idx, int class_idx);
+  // runs nms_detection_cpu over all batches and classes.
+  void nms_detection_all_cpu(
+      float *output_data, int &total_output_boxes_num, float *input_boxes,
+      float *input_conf, int input_batches_num, int input_classes_num,
+      int input_boxes_num, int keepNum, float thresh_iou, float thresh_score,
+      mluOpNmsOutputMode_t output_mode, int input_layout, mluOpNmsAlgo_t algo,
+      float offset, mluOpNmsBoxPointMode_t box_mode,
+      mluOpNmsMethodMode_t method_mode, float soft_nms_sigma);
   int64_t getTheoryOps() override;
 
  private:
@@ -21,10 +21,14 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "points_in_boxes.h"
+#include <vector>
 #include "mlu_op.h"
+#include "point_cloud_index.h"
 
 namespace mluoptest {
 
+static constexpr float kPointInBoxMargin = 1e-5;
+
 static void lindar_to_local_coords_cpu(float shift_x, float shift_y,
                                        float rot_angle, float &local_x,
                                        float &local_y) {
@@ -35,7 +39,7 @@ static void lindar_to_local_coords_cpu(float shift_x, float shift_y,
 
 static int check_pt_in_box3d_cpu(const float *pt, const float *box3d,
                                  float &local_x, float &local_y) {
-  const float MARGIN = 1e-5;
+  const float MARGIN = kPointInBoxMargin;
   float x = pt[0], y = pt[1], z = pt[2];
   float cx = box3d[0], cy = box3d[1], cz = box3d[2];
   float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
@@ -55,19 +59,28 @@ static void points_in_boxes_cpu(
        i < points_indices_desc->dims[0] * points_indices_desc->dims[1]; i++) {
     *((float *)points_indices + i) = -1.0;
   }
-  for (int64_t i = 0; i < points_desc->dims[0]; i++) {
-    for (int64_t j = 0; j < points_desc->dims[1]; j++) {
-      for (int64_t m = 0; m < boxes_desc->dims[1]; m++) {
-        float local_x, local_y;
-        int cur_in_flag = check_pt_in_box3d_cpu(
-            (float *)points + (i * points_desc->dims[1] + j) * 3,
-            (float *)boxes + (i * boxes_desc->dims[1] + m) * 7, local_x,
-            local_y);
-        if (cur_in_flag) {
-          *((float *)points_indices + i * points_desc->dims[1] + j) = (float)m;
-          break;
-        }
-      }
+  // the first box which holds the point, only the boxes whose circle in
+  // the x-y plane covers the point are tested.
+  const int64_t batch = points_desc->dims[0];
+  const int64_t pts = points_desc->dims[1];
+  const int64_t bs = boxes_desc->dims[1];
+  std::vector<point_cloud::RotatedBoxIndex> index(batch);
+#pragma omp parallel for schedule(static)
+  for (int64_t i = 0; i < batch; i++) {
+    index[i].build((float *)boxes + i * bs * 7, bs, kPointInBoxMargin);
+  }
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int64_t p = 0; p < batch * pts; p++) {
+    const int64_t i = p / pts;
+    const float *pt = (float *)points + p * 3;
+    const float *batch_boxes = (float *)boxes + i * bs * 7;
+    int m = index[i].first(pt[0], pt[1], [&](int box) {
+      float local_x, local_y;
+      return check_pt_in_box3d_cpu(pt, batch_boxes + box * 7, local_x,
+                                   local_y) != 0;
+    });
+    if (m >= 0) {
+      *((float *)points_indices + p) = (float)m;
     }
   }
 }
@@ -29,6 +29,8 @@
 #include <utility>
 #include <vector>
 
+#include "nms_cpu_engine.h"
+
 using namespace std;  // NOLINT
 
 namespace PNMS {
@@ -130,7 +132,7 @@ float intersectArea(Point *ps1, int n1, Point *ps2, int n2) {
   return res;
 }
 
-float iouPoly(vector<float> p, vector<float> q) {
+float iouPoly(const vector<float> &p, const vector<float> &q) {
   Point ps1[MAXN], ps2[MAXN];
   int n1 = 4;
   int n2 = 4;
@@ -154,33 +156,22 @@ float iouPoly(vector<float> p, vector<float> q) {
   return iou;
 }
 
-bool campareValue(const pair<vector<float>, int> &a,
-                  const pair<vector<float>, int> &b) {
-  return (*(a.first.end() - 1) > *(b.first.end() - 1));
-}
-
 vector<int> PolyNmsImpl(vector<vector<float>> &p, const float thresh) {
-  vector<pair<vector<float>, int>> vp;
+  // same std::sort on the same comparisons as sorting (box, index) pairs by
+  // score, so equal scores end up in the same order.
+  vector<int> order(p.size());
   for (int i = 0; i < p.size(); i++) {
-    vp.push_back(make_pair(p[i], i));
-  }
-
-  sort(vp.begin(), vp.end(), campareValue);
-
-  vector<int> keep;
-  while (vp.size()) {
-    keep.push_back(vp.begin()->second);
-    auto box = vp.begin()->first;
-    auto box_index = vp.begin()->second;
-    vp.erase(vp.begin());
-    for (int i = 0; i < vp.size(); i++) {
-      float iou = iouPoly(box, vp[i].first);
-      if (iou > thresh) {
-        vp.erase(vp.begin() + i);
-        i--;
-      }
-    }
+    order[i] = i;
   }
+  sort(order.begin(), order.end(),
+       [&](int a, int b) { return p[a].back() > p[b].back(); });
+
+  // The triangle-fan intersection is not exactly 0 for disjoint polygons, so
+  // there is no safe spatial pruning here; the candidates of every kept box
+  // are evaluated in parallel instead.
+  auto overlap = [&](int i, int j) { return iouPoly(p[i], p[j]); };
+  vector<int> keep = mluoptest::nms_cpu::greedyNms(order, p.size(), overlap,
+                                                   thresh, nullptr);
 
   sort(keep.begin(), keep.end(), [&](int a, int b) { return a < b; });
   return keep;
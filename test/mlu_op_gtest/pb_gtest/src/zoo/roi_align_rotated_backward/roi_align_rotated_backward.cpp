@@ -51,7 +51,7 @@ void RoiAlignRotatedBackwardExecutor::preCalcForBilinearInterpolate(
           theory_ops_ += 16;  // cur block
 
           if (y < -1.0 || y > height || x < -1.0 || x > width) {
-            PreCalc pc{0, 0, 0, 0, 0, 0, 0, 0};
+            PreCalc pc = {{0, 0, 0, 0}, {0, 0, 0, 0}};
             pre_calc[pre_calc_idx] = pc;
             ++pre_calc_idx;
             continue;
@@ -88,14 +88,14 @@ void RoiAlignRotatedBackwardExecutor::preCalcForBilinearInterpolate(
           float w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
 
           PreCalc pc;
-          pc.pos1 = (y_low * width + x_low) * channel;
-          pc.pos2 = (y_low * width + x_high) * channel;
-          pc.pos3 = (y_high * width + x_low) * channel;
-          pc.pos4 = (y_high * width + x_high) * channel;
-          pc.w1 = w1;
-          pc.w2 = w2;
-          pc.w3 = w3;
-          pc.w4 = w4;
+          pc.offset[0] = (y_low * width + x_low) * channel;
+          pc.offset[1] = (y_low * width + x_high) * channel;
+          pc.offset[2] = (y_high * width + x_low) * channel;
+          pc.offset[3] = (y_high * width + x_high) * channel;
+          pc.weight[0] = w1;
+          pc.weight[1] = w2;
+          pc.weight[2] = w3;
+          pc.weight[3] = w4;
           pre_calc[pre_calc_idx] = pc;
           // next stmt not count theory_ops_
           ++pre_calc_idx;
@@ -253,41 +253,42 @@ void RoiAlignRotatedBackwardExecutor::cpuCompute() {
         roi_center_x, roi_center_y, cos_theta, sin_theta, pre_calc);
     theory_ops_ += 14;  // cur block
 
-    for (int c_idx = 0; c_idx < channel; ++c_idx) {
-      // next stmt not count theory_ops_
-      int bottom_grad_offset = roi_batch_idx * height * width * channel +
-      c_idx;
-      int pre_calc_idx = 0;
+    // next stmt not count theory_ops_
+    float *offset_bottom_grad =
+        bottom_grad + roi_batch_idx * height * width * channel;
+    const float *offset_top_grad = top_grad + n_idx * top_grad_noffset;
+    const int bins = pooled_height * pooled_width;
+    const int bin_points = roi_bin_grid_h * roi_bin_grid_w;
+    int64_t valid_points = 0;
+    for (int i = 0; i < bins * bin_points; ++i) {
+      const PreCalc &pc = pre_calc[i];
+      valid_points += !(pc.weight[0] == 0 && pc.weight[1] == 0 &&
+                        pc.weight[2] == 0 && pc.weight[3] == 0);
+    }
 
-      // loop for each bin
-      for (int ph = 0; ph < pooled_height; ++ph) {
-        for (int pw = 0; pw < pooled_width; ++pw) {
-          // next stmt not count theory_ops_
-          int top_grad_offset = n_idx * top_grad_noffset +
-                                (ph * pooled_width + pw) * channel + c_idx;
-          float top_grad_val = top_grad[top_grad_offset];
-          for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-            for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-              PreCalc pc = pre_calc[pre_calc_idx];
-              float g1 = pc.w1 * top_grad_val / count;
-              float g2 = pc.w2 * top_grad_val / count;
-              float g3 = pc.w3 * top_grad_val / count;
-              float g4 = pc.w4 * top_grad_val / count;
-              theory_ops_ += 8;  // cur block
-              if (!(pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0)) {
-                bottom_grad[bottom_grad_offset + pc.pos1] += g1;
-                bottom_grad[bottom_grad_offset + pc.pos2] += g2;
-                bottom_grad[bottom_grad_offset + pc.pos3] += g3;
-                bottom_grad[bottom_grad_offset + pc.pos4] += g4;
-                theory_ops_ += 8;  // cur block
-              }
-              // next stmt not count theory_ops_
-              ++pre_calc_idx;
-            }
+    // sample points of different bins overlap, so tasks split the channels
+    // instead and every element keeps its serial update order.
+    const int blocks = (channel + bilinear_cpu::kChannelBlock - 1) /
+                       bilinear_cpu::kChannelBlock;
+#pragma omp parallel for schedule(static)
+    for (int block = 0; block < blocks; ++block) {
+      const int c0 = block * bilinear_cpu::kChannelBlock;
+      const int cn = std::min(bilinear_cpu::kChannelBlock, channel - c0);
+      for (int bin = 0; bin < bins; ++bin) {
+        const float *top_grad_val = offset_top_grad + bin * channel + c0;
+        for (int i = 0; i < bin_points; ++i) {
+          const PreCalc &pc = pre_calc[bin * bin_points + i];
+          if (pc.weight[0] == 0 && pc.weight[1] == 0 && pc.weight[2] == 0 &&
+              pc.weight[3] == 0) {
+            continue;
           }
+          bilinear_cpu::scatter(offset_bottom_grad + c0, pc, top_grad_val,
+                                count, cn);
         }
       }
     }
+    theory_ops_ +=
+        (8 * bins * bin_points + 8 * valid_points) * channel;  // cur block
   }
 }
 
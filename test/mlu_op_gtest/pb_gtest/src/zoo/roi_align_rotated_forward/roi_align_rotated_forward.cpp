@@ -51,7 +51,7 @@ void RoiAlignRotatedForwardExecutor::preCalcForBilinearInterpolate(
           theory_ops_ += 16;  // cur block
 
           if (y < -1.0 || y > height || x < -1.0 || x > width) {
-            PreCalc pc{0, 0, 0, 0, 0, 0, 0, 0};
+            PreCalc pc = {{0, 0, 0, 0}, {0, 0, 0, 0}};
             pre_calc[pre_calc_idx] = pc;
             ++pre_calc_idx;
             continue;
@@ -88,14 +88,14 @@ void RoiAlignRotatedForwardExecutor::preCalcForBilinearInterpolate(
           float w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
 
           PreCalc pc;
-          pc.pos1 = (y_low * width + x_low) * channel;
-          pc.pos2 = (y_low * width + x_high) * channel;
-          pc.pos3 = (y_high * width + x_low) * channel;
-          pc.pos4 = (y_high * width + x_high) * channel;
-          pc.w1 = w1;
-          pc.w2 = w2;
-          pc.w3 = w3;
-          pc.w4 = w4;
+          pc.offset[0] = (y_low * width + x_low) * channel;
+          pc.offset[1] = (y_low * width + x_high) * channel;
+          pc.offset[2] = (y_high * width + x_low) * channel;
+          pc.offset[3] = (y_high * width + x_high) * channel;
+          pc.weight[0] = w1;
+          pc.weight[1] = w2;
+          pc.weight[2] = w3;
+          pc.weight[3] = w4;
           pre_calc[pre_calc_idx] = pc;
           // next stmt not count theory_ops_
           ++pre_calc_idx;
@@ -244,39 +244,34 @@ void RoiAlignRotatedForwardExecutor::cpuCompute() {
         roi_center_x, roi_center_y, cos_theta, sin_theta, pre_calc);
     theory_ops_ += 16;  // cur block
 
-    for (int c_idx = 0; c_idx < channel; ++c_idx) {
-      // next stmt not count theory_ops_
-      const float *offset_features =
-          features + roi_batch_idx * height * width * channel;
-      int pre_calc_idx = 0;
+    // next stmt not count theory_ops_
+    const float *offset_features =
+        features + roi_batch_idx * height * width * channel;
+    const int bins = pooled_height * pooled_width;
+    const int bin_points = roi_bin_grid_h * roi_bin_grid_w;
+    int64_t valid_points = 0;
 
-      for (int ph = 0; ph < pooled_height; ++ph) {
-        for (int pw = 0; pw < pooled_width; ++pw) {
-          // next stmt not count theory_ops_
-          int output_idx =
-              output_nidx + (ph * pooled_width + pw) * channel + c_idx;
-
-          float output_val = 0.;
-          for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-            for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-              auto pc = pre_calc[pre_calc_idx];
-              if (!(pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0)) {
-                output_val += pc.w1 * offset_features[pc.pos1 + c_idx] +
-                              pc.w2 * offset_features[pc.pos2 + c_idx] +
-                              pc.w3 * offset_features[pc.pos3 + c_idx] +
-                              pc.w4 * offset_features[pc.pos4 + c_idx];
-                theory_ops_ += 9;  // cur block
-              }
-              // next stmt not count theory_ops_
-              ++pre_calc_idx;
-            }
-          }
-          output_val /= count;
-          output[output_idx] = output_val;
-          theory_ops_ += 2;  // cur block
+    // every bin owns its output row, and all channels of a sample point
+    // share its corners and weights.
+#pragma omp parallel for schedule(static) reduction(+ : valid_points)
+    for (int bin = 0; bin < bins; ++bin) {
+      float *output_val = output + output_nidx + bin * channel;
+      std::fill(output_val, output_val + channel, 0.0f);
+      for (int i = 0; i < bin_points; ++i) {
+        const PreCalc &pc = pre_calc[bin * bin_points + i];
+        if (pc.weight[0] == 0 && pc.weight[1] == 0 && pc.weight[2] == 0 &&
+            pc.weight[3] == 0) {
+          continue;
         }
+        bilinear_cpu::accumulate(offset_features, pc, 1.0f, channel,
+                                 output_val);
+        ++valid_points;
+      }
+      for (int c_idx = 0; c_idx < channel; ++c_idx) {
+        output_val[c_idx] /= count;
       }
     }
+    theory_ops_ += (9 * valid_points + 2 * bins) * channel;  // cur block
   }
 }
 
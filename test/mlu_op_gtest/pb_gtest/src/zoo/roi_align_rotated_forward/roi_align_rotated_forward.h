@@ -27,20 +27,13 @@ ROIALIGNROTATED_FORWARD_H_
 
 #include <vector>
 
+#include "bilinear_cpu.h"
 #include "executor.h"
 
 #define ROI_OFFSET 6
 
-struct PreCalc {
-  int pos1;
-  int pos2;
-  int pos3;
-  int pos4;
-  float w1;
-  float w2;
-  float w3;
-  float w4;
-};
+// corner offsets and weights of a sample point, shared by all channels
+typedef mluoptest::bilinear_cpu::Point PreCalc;
 
 namespace mluoptest {
 class RoiAlignRotatedForwardExecutor : public Executor {
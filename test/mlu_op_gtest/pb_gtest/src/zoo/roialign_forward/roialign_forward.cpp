@@ -22,8 +22,10 @@
  *************************************************************************/
 #include <string>
 #include <algorithm>
+#include <vector>
 #include "roialign_forward.h"
 #include "mlu_op.h"
+#include "bilinear_cpu.h"
 
 namespace mluoptest {
 
@@ -94,36 +96,6 @@ void RoialignForwardExecutor::compute() {
   mluOpDestroyRoiAlignForwardDescriptor(roialign_desc);
 }
 
-void RoialignForwardExecutor::bilinear_interpolate(
-    int height, int width, float y, float x, float &w1, float &w2, float &w3,
-    float &w4, int &x_low, int &x_high, int &y_low, int &y_high, int &empty) {
-  if (y < -1.0 || y > height || x < -1.0 || x > width) {
-    empty = 1;
-    return;
-  }
-
-  if (y <= 0) y = 0;
-  if (x <= 0) x = 0;
-  y_low = (int)y;
-  x_low = (int)x;
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (float)y_low;
-  } else {
-    y_high = y_low + 1;
-  }
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (float)x_low;
-  } else {
-    x_high = x_low + 1;
-  }
-  float ly = y - y_low, lx = x - x_low;
-  float hy = 1. - ly, hx = 1. - lx;
-  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-  return;
-}
-
 void RoialignForwardExecutor::cpuCompute() {
   float spatial_scale =
       parser_->getProtoNode()->roialign_param().spatial_scale();
@@ -152,10 +124,6 @@ void RoialignForwardExecutor::cpuCompute() {
     // roialign cpu
     VLOG(4) << "BEGIN CPU pool_mode avg";
 
-    float *pooled_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    int channel_idx = 0;
-
     for (int roi_idx = 0; roi_idx < num_rois; roi_idx++) {
       int batch_idx = int(input_rois[roi_idx * roi_offset]);
       if (batch_idx < 0 || batch_idx >= input_n) {
@@ -196,62 +164,37 @@ void RoialignForwardExecutor::cpuCompute() {
                         : 1;
       float count_value = 1.0f / count;
 
-      for (int ph = 0; ph < pooled_height; ph++) {
-        for (int pw = 0; pw < pooled_width; pw++) {
-          float *output_channel_ptr =
-              output + roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-
-          memset(pooled_value, 0, channels * sizeof(float));
-
-          for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-            float y =
-                roi_start_h + ph * bin_size_h +
-                (iy + 0.5) * bin_size_h / (roi_bin_grid_h);  // center_point y
-            for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-              float x =
-                  roi_start_w + pw * bin_size_w +
-                  (ix + 0.5) * bin_size_w / (roi_bin_grid_w);  // center_point x
-              int empty = 0;
-              float w1, w2, w3, w4;
-              int x_low, x_high, y_low, y_high;
-              bilinear_interpolate(height, width, y, x, w1, w2, w3, w4, x_low,
-                                   x_high, y_low, y_high, empty);
-
-              float *input_temp = input + batch_idx * width * height * channels;
-              float *input_channel_ptr_1 =
-                  input_temp + (y_low * width + x_low) * channels;
-              float *input_channel_ptr_2 =
-                  input_temp + (y_low * width + x_high) * channels;
-              float *input_channel_ptr_3 =
-                  input_temp + (y_high * width + x_low) * channels;
-              float *input_channel_ptr_4 =
-                  input_temp + (y_high * width + x_high) * channels;
-
-              for (channel_idx = 0; channel_idx < channels; channel_idx++) {
-                float value;
-                if (empty == 1) {
-                  value = 0;
-                } else {
-                  float v1 = input_channel_ptr_1[channel_idx];
-                  float v2 = input_channel_ptr_2[channel_idx];
-                  float v3 = input_channel_ptr_3[channel_idx];
-                  float v4 = input_channel_ptr_4[channel_idx];
-                  // bilinear interpolatation
-                  value = w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4;
-                }
-                pooled_value[channel_idx] += value;  // sum
-              }                                      // channels
-            }                                        // roi_bin_grid_w
-          }                                          // roi_bin_grid_h
-          for (channel_idx = 0; channel_idx < channels; channel_idx++) {
-            pooled_value[channel_idx] = pooled_value[channel_idx] * count_value;
-          }
-          memcpy(output_channel_ptr, pooled_value, channels * sizeof(float));
-        }  // pw
-      }    // ph
-    }      // roi
-    cpu_runtime_.deallocate(pooled_value);
+      // all channels of a sample point share its corners and weights, and
+      // every bin owns its output row.
+      float *input_temp = input + batch_idx * width * height * channels;
+#pragma omp parallel for schedule(static)
+      for (int bin = 0; bin < pooled_height * pooled_width; bin++) {
+        const int ph = bin / pooled_width;
+        const int pw = bin % pooled_width;
+        float *pooled_value =
+            output + (roi_idx * pooled_height * pooled_width + bin) * channels;
+        std::fill(pooled_value, pooled_value + channels, 0.0f);
+        for (int iy = 0; iy < roi_bin_grid_h; iy++) {
+          float y =
+              roi_start_h + ph * bin_size_h +
+              (iy + 0.5) * bin_size_h / (roi_bin_grid_h);  // center_point y
+          for (int ix = 0; ix < roi_bin_grid_w; ix++) {
+            float x =
+                roi_start_w + pw * bin_size_w +
+                (ix + 0.5) * bin_size_w / (roi_bin_grid_w);  // center_point x
+            bilinear_cpu::Point point;
+            if (bilinear_cpu::alignedPoint(height, width, y, x, channels,
+                                           &point)) {
+              bilinear_cpu::accumulate(input_temp, point, 1.0f, channels,
+                                       pooled_value);  // sum
+            }
+          }  // roi_bin_grid_w
+        }    // roi_bin_grid_h
+        for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
+          pooled_value[channel_idx] = pooled_value[channel_idx] * count_value;
+        }
+      }  // bin
+    }    // roi
   } else if (pool_mode == 0) {
     // roialign cpu
 
@@ -261,13 +204,6 @@ void RoialignForwardExecutor::cpuCompute() {
 
     float *output_argmax_x = cpu_fp32_output_[1];
     float *output_argmax_y = cpu_fp32_output_[2];
-    float *pooled_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    float *argmax_x_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    float *argmax_y_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-
     for (int roi_idx = 0; roi_idx < num_rois; roi_idx++) {
       int batch_idx = int(input_rois[roi_idx * roi_offset + 0]);
       if (batch_idx < 0 || batch_idx >= input_n) {
@@ -302,74 +238,45 @@ void RoialignForwardExecutor::cpuCompute() {
       int roi_bin_grid_w =
           (sampling_ratio > 0) ? sampling_ratio : ceil(bin_size_w);
 
-      for (int ph = 0; ph < pooled_height; ph++) {
-        for (int pw = 0; pw < pooled_width; pw++) {
-          float *output_channel_ptr =
-              output + roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-          float *output_argmax_x_channel_ptr =
-              output_argmax_x +
-              roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-          float *output_argmax_y_channel_ptr =
-              output_argmax_y +
-              roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-
-          std::fill(pooled_value, pooled_value + channels, -FLT_MAX);
-          std::fill(argmax_x_value, argmax_x_value + channels, -1);
-          std::fill(argmax_y_value, argmax_y_value + channels, -1);
-          for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-            float y = roi_start_h + ph * bin_size_h +
-                      (iy + 0.5) * bin_size_h / (roi_bin_grid_h);
-            for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-              float x = roi_start_w + pw * bin_size_w +
-                        (ix + 0.5) * bin_size_w / (roi_bin_grid_w);
-              float w1, w2, w3, w4;
-              int x_low, x_high, y_low, y_high;
-              int empty = 0;
-              bilinear_interpolate(input_height, input_width, y, x, w1, w2, w3,
-                                   w4, x_low, x_high, y_low, y_high, empty);
-              float *input_temp = input + batch_idx * width * height * channels;
-              float *input_channel_ptr_1 =
-                  input_temp + (y_low * width + x_low) * channels;
-              float *input_channel_ptr_2 =
-                  input_temp + (y_low * width + x_high) * channels;
-              float *input_channel_ptr_3 =
-                  input_temp + (y_high * width + x_low) * channels;
-              float *input_channel_ptr_4 =
-                  input_temp + (y_high * width + x_high) * channels;
-              for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
-                float value;
-                if (empty == 1) {
-                  value = 0;
-                } else {
-                  float v1 = input_channel_ptr_1[channel_idx];
-                  float v2 = input_channel_ptr_2[channel_idx];
-                  float v3 = input_channel_ptr_3[channel_idx];
-                  float v4 = input_channel_ptr_4[channel_idx];
-                  // bilinear interpolatation
-                  value = w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4;
-                }
-                if (value > pooled_value[channel_idx]) {
-                  pooled_value[channel_idx] = value;
-                  argmax_x_value[channel_idx] = x;
-                  argmax_y_value[channel_idx] = y;
-                }
-              }  // channels
-            }    // sample w
-          }      // sample h
-          memcpy(output_channel_ptr, pooled_value, channels * sizeof(float));
-          memcpy(output_argmax_x_channel_ptr, argmax_x_value,
-                 channels * sizeof(float));
-          memcpy(output_argmax_y_channel_ptr, argmax_y_value,
-                 channels * sizeof(float));
-        }  // pw
-      }    // ph
-    }      // roi
-    cpu_runtime_.deallocate(pooled_value);
-    cpu_runtime_.deallocate(argmax_x_value);
-    cpu_runtime_.deallocate(argmax_y_value);
+      float *input_temp = input + batch_idx * width * height * channels;
+#pragma omp parallel for schedule(static)
+      for (int bin = 0; bin < pooled_height * pooled_width; bin++) {
+        const int ph = bin / pooled_width;
+        const int pw = bin % pooled_width;
+        const int bin_offset =
+            (roi_idx * pooled_height * pooled_width + bin) * channels;
+        float *pooled_value = output + bin_offset;
+        float *argmax_x_value = output_argmax_x + bin_offset;
+        float *argmax_y_value = output_argmax_y + bin_offset;
+        std::vector<float> value(channels);
+
+        std::fill(pooled_value, pooled_value + channels, -FLT_MAX);
+        std::fill(argmax_x_value, argmax_x_value + channels, -1);
+        std::fill(argmax_y_value, argmax_y_value + channels, -1);
+        for (int iy = 0; iy < roi_bin_grid_h; iy++) {
+          float y = roi_start_h + ph * bin_size_h +
+                    (iy + 0.5) * bin_size_h / (roi_bin_grid_h);
+          for (int ix = 0; ix < roi_bin_grid_w; ix++) {
+            float x = roi_start_w + pw * bin_size_w +
+                      (ix + 0.5) * bin_size_w / (roi_bin_grid_w);
+            bilinear_cpu::Point point;
+            if (bilinear_cpu::alignedPoint(height, width, y, x, channels,
+                                           &point)) {
+              bilinear_cpu::sample(input_temp, point, channels, value.data());
+            } else {
+              std::fill(value.begin(), value.end(), 0.0f);
+            }
+            for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
+              if (value[channel_idx] > pooled_value[channel_idx]) {
+                pooled_value[channel_idx] = value[channel_idx];
+                argmax_x_value[channel_idx] = x;
+                argmax_y_value[channel_idx] = y;
+              }
+            }  // channels
+          }    // sample w
+        }      // sample h
+      }        // bin
+    }          // roi
   }
 }
 
@@ -436,18 +343,10 @@ int64_t RoialignForwardExecutor::getTheoryOps() {
     int roi_bin_grid_w =
         (sampling_ratio > 0) ? sampling_ratio : ceil(bin_size_w);
 
-    for (int ph = 0; ph < pooled_height; ph++) {
-      for (int pw = 0; pw < pooled_width; pw++) {
-        for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-          for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-            for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
-              theory_ops += 8;
-            }  // channels
-          }    // input w
-        }      // input h
-      }        // pw
-    }          // ph
-  }            // roi
+    theory_ops += 8 * int64_t(pooled_height) * pooled_width *
+                  std::max(roi_bin_grid_h, 0) * std::max(roi_bin_grid_w, 0) *
+                  channels;
+  }  // roi
   VLOG(4) << "getTheoryOps: " << theory_ops << " ops";
   cpu_runtime_.deallocate(input_rois);
 
@@ -519,21 +418,12 @@ int64_t RoialignForwardExecutor::getTheoryIoSize() {
         (sampling_ratio > 0) ? sampling_ratio : ceil(bin_size_w);
 
     theory_io_size += 20;
-    for (int ph = 0; ph < pooled_height; ph++) {
-      for (int pw = 0; pw < pooled_width; pw++) {
-        for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-          for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-            for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
-              theory_io_size += 16;
-            }  // channels
-          }    // input w
-        }      // input h
-        theory_io_size = pool_mode == 1
-                             ? theory_io_size + channels * sizeof(float)
-                             : theory_io_size + channels * sizeof(float) * 3;
-      }  // pw
-    }    // ph
-  }      // roi
+    const int64_t bins = int64_t(pooled_height) * pooled_width;
+    theory_io_size += 16 * bins * std::max(roi_bin_grid_h, 0) *
+                      std::max(roi_bin_grid_w, 0) * channels;
+    theory_io_size +=
+        bins * channels * sizeof(float) * (pool_mode == 1 ? 1 : 3);
+  }  // roi
   VLOG(4) << "theory_io_size: " << theory_io_size << "ops";
   cpu_runtime_.deallocate(input_rois);
 
@@ -24,6 +24,8 @@
 
 #include <memory>
 
+#include "batchnorm_cpu.h"
+
 namespace mluoptest {
 
 void cpuSyncBatchNormBackwardElemt(const float *x, const float *diff_y,
@@ -31,22 +33,8 @@ void cpuSyncBatchNormBackwardElemt(const float *x, const float *diff_y,
                                    const float *invstd, const float *mean_dy,
                                    const float *mean_dy_xmu, float *diff_x,
                                    const int len_x, const int len_c) {
-  int len_nhw = len_x / len_c;
-  for (int ci = 0; ci < len_c; ++ci) {
-    for (int i = 0; i < len_nhw; ++i) {
-      if (weight == nullptr) {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - mean_dy[ci] -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * mean_dy_xmu[ci]) *
-                                 invstd[ci];
-      } else {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - mean_dy[ci] -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * mean_dy_xmu[ci]) *
-                                 weight[ci] * invstd[ci];
-      }
-    }
-  }
+  batchnorm_cpu::backwardElemt(diff_y, x, mean, invstd, weight, mean_dy,
+                               mean_dy_xmu, len_x / len_c, len_c, diff_x);
 }
 
 void SyncBatchNormBackwardElemtExecutor::paramCheck() {
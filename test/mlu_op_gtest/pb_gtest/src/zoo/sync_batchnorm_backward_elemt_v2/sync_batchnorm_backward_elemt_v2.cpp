@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_backward_elemt_v2.h"
 
+#include <vector>
+
+#include "batchnorm_cpu.h"
+
 namespace mluoptest {
 
 void cpuSyncBatchnormBackwardElemt(const float *diff_y, const float *x,
@@ -30,24 +34,14 @@ void cpuSyncBatchnormBackwardElemt(const float *diff_y, const float *x,
                                    const float *sum_dy_xmu, const int32_t sum,
                                    float *diff_x, const int len_x,
                                    const int len_c) {
-  int len_nhw = len_x / len_c;
+  std::vector<float> mean_dy(len_c), mean_dy_xmu(len_c);
   for (int ci = 0; ci < len_c; ++ci) {
-    float sum_dy_temp = sum_dy[ci] / sum;
-    float sum_dy_xmu_temp = sum_dy_xmu[ci] / sum;
-    for (int i = 0; i < len_nhw; ++i) {
-      if (weight == nullptr) {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - sum_dy_temp -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * sum_dy_xmu_temp) *
-                                 invstd[ci];
-      } else {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - sum_dy_temp -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * sum_dy_xmu_temp) *
-                                 weight[ci] * invstd[ci];
-      }
-    }
+    mean_dy[ci] = sum_dy[ci] / sum;
+    mean_dy_xmu[ci] = sum_dy_xmu[ci] / sum;
   }
+  batchnorm_cpu::backwardElemt(diff_y, x, mean, invstd, weight,
+                               mean_dy.data(), mean_dy_xmu.data(),
+                               len_x / len_c, len_c, diff_x);
 }
 
 void SyncBatchnormBackwardElemtV2Executor::paramCheck() {
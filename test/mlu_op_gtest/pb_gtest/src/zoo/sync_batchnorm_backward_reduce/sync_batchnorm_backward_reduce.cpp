@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_backward_reduce.h"
 
+#include <vector>
+
+#include "batchnorm_cpu.h"
+
 namespace mluoptest {
 
 void SyncBatchnormBackwardReduceExecutor::paramCheck() {
@@ -188,45 +192,23 @@ void cpuGetSyncBnBkwReduceOuput(
                   "should not be zero";
     return;
   }
-  int len_nhw = len_x / len_c;
-  float *x_hat = new float[len_x];
-  float *xmu = new float[len_x];
-
-  for (int ci = 0; ci < len_c; ++ci) {
-    const float *xc = x + ci;
-    float *x_hat_c = x_hat + ci;
-    float *xmu_c = xmu + ci;
-    for (int xi = 0; xi < len_nhw; ++xi) {
-      xmu_c[xi * len_c] = xc[xi * len_c] - mean[ci];
-      x_hat_c[xi * len_c] = xmu_c[xi * len_c] * invstd[ci];
-    }
-  }
-
+  // a single pass over x and diff_z, without the x_hat and xmu copies
+  std::vector<double> dbias(len_c), meandyxmu(len_c), dweight(len_c);
+  batchnorm_cpu::reduceBackward(diff_z, x, mean, invstd, len_x / len_c,
+                                len_c, dbias.data(), meandyxmu.data(),
+                                dweight.data());
   for (int ci = 0; ci < len_c; ++ci) {
-    const float *x_hat_c = x_hat + ci;
-    const float *xmu_c = xmu + ci;
-    const float *dzc = diff_z + ci;
-    double dweight = 0, dbias = 0, meandyxmu = 0;
-    for (int i = 0; i < len_nhw; i++) {
-      dweight = dweight + x_hat_c[i * len_c] * dzc[i * len_c];
-      dbias = dbias + dzc[i * len_c];
-      meandyxmu = meandyxmu + xmu_c[i * len_c] * dzc[i * len_c];
-    }
     if (needs_input_grad0 == true) {
-      // diff_weight[ci] = dweight;
-      // diff_bias[ci] = dbias;
-      sum_dy[ci] = dbias;
-      sum_dy_xmu[ci] = meandyxmu;
+      sum_dy[ci] = dbias[ci];
+      sum_dy_xmu[ci] = meandyxmu[ci];
     }
     if (needs_input_grad1 == true) {
-      diff_weight[ci] = dweight;
+      diff_weight[ci] = dweight[ci];
     }
     if (needs_input_grad2 == true) {
-      diff_bias[ci] = dbias;
+      diff_bias[ci] = dbias[ci];
     }
   }
-  delete[] x_hat;
-  delete[] xmu;
 }
 
 void SyncBatchnormBackwardReduceExecutor::cpuCompute() {
@@ -22,6 +22,8 @@
  *************************************************************************/
 #include "sync_batchnorm_elemt.h"
 
+#include "batchnorm_cpu.h"
+
 namespace mluoptest {
 
 void SyncBatchnormElemtExecutor::paramCheck() {
@@ -67,16 +69,8 @@ void SyncBatchnormElemtExecutor::compute() {
 void cpuSyncBNElemt(const float *x, const float *mean, const float *invstd,
                     float *weight, float *bias, float *y, const int len_x,
                     const int len_c) {
-  int len_nhw = len_x / len_c;
-
-  for (int h = 0; h < len_nhw; ++h) {
-    for (int c = 0; c < len_c; ++c) {
-      y[h * len_c + c] = (x[h * len_c + c] - mean[c]) * invstd[c];
-      if (weight != nullptr && bias != nullptr) {
-        y[h * len_c + c] = y[h * len_c + c] * weight[c] + bias[c];
-      }
-    }
-  }
+  batchnorm_cpu::normalize(x, mean, invstd, weight, bias, len_x / len_c,
+                           len_c, y);
 }
 
 void SyncBatchnormElemtExecutor::cpuCompute() {
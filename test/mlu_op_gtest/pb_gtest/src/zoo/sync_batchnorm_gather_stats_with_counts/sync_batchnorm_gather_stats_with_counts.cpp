@@ -22,6 +22,8 @@
  *************************************************************************/
 #include "sync_batchnorm_gather_stats_with_counts.h"
 
+#include "batchnorm_cpu.h"
+
 namespace mluoptest {
 
 void SyncBatchnormGatherStatsWithCountsExecutor::paramCheck() {
@@ -171,13 +173,6 @@ void SyncBatchnormGatherStatsWithCountsExecutor::setMiscellaneousParam() {
   }
 }
 
-void kahan(float input, float &sum, float &delta) {
-  float y = input - delta;
-  float t = sum + y;
-  delta = t - sum - y;
-  sum = t;
-}
-
 void cpuBatchNormForwardTraining(float *mean_all, float *invstd_all,
                                  float *moving_mean, float *moving_var,
                                  const float momentum, const float eps,
@@ -186,27 +181,21 @@ void cpuBatchNormForwardTraining(float *mean_all, float *invstd_all,
                                  const int len_mean_all, const int len_c,
                                  const int output_num) {
   int len_n = len_mean_all / len_c;
-  int len_all = 0;
-  for (int i = 0; i < len_n; ++i) {
-    len_all += count_all[i];
-  }
 
-  // B.P.Welford algo
+  // Chan's merge of the per-replica moments, each recovered as
+  // m2 = (1 / invstd^2 - eps) * count, in replica order
+#pragma omp parallel for schedule(static)
   for (int ci = 0; ci < len_c; ++ci) {
-    float c_sum = 0.0, c_ssum = 0.0;
-    const float *meanc = mean_all + ci;
-    const float *invstdc = invstd_all + ci;
-    float sum = 0.0, ssum = 0.0, temp = 0.0;
+    double count = 0, mean_c = 0, m2 = 0;
     for (int xi = 0; xi < len_n; ++xi) {
-      kahan(meanc[xi * len_c] * count_all[xi], sum, c_sum);
-      temp = 1.0f / (invstdc[xi * len_c] * invstdc[xi * len_c]) +
-             meanc[xi * len_c] * meanc[xi * len_c] - eps;
-      kahan(temp * count_all[xi], ssum, c_ssum);
+      const double invstd_xi = invstd_all[xi * len_c + ci];
+      const double var_xi = 1.0 / (invstd_xi * invstd_xi) - eps;
+      batchnorm_cpu::merge(count_all[xi], mean_all[xi * len_c + ci],
+                           var_xi * count_all[xi], &count, &mean_c, &m2);
     }
-    mean[ci] = sum / len_all;
-    invstd[ci] = 1.0f / sqrt(ssum / len_all - mean[ci] * mean[ci] + eps);
-    float unbiased_var =
-        (1.0f / (invstd[ci] * invstd[ci]) - eps) * len_all / (len_all - 1);
+    mean[ci] = mean_c;
+    invstd[ci] = 1.0 / sqrt(m2 / count + eps);
+    float unbiased_var = m2 / (count - 1);
     if (moving_mean != nullptr && moving_var != nullptr && output_num == 4) {
       m_mean[ci] = momentum * mean[ci] + (1 - momentum) * moving_mean[ci];
       m_var[ci] = momentum * unbiased_var + (1 - momentum) * moving_var[ci];
@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_stats.h"
 
+#include <vector>
+
+#include "batchnorm_cpu.h"
+
 namespace mluoptest {
 
 void SyncBatchnormStatsExecutor::paramCheck() {
@@ -78,39 +82,17 @@ void SyncBatchnormStatsExecutor::compute() {
   interface_timer_.stop();
 }
 
-void kahan_stats(float input, float &sum, float &delta) {
-  float y = input - delta;
-  float t = sum + y;
-  delta = t - sum - y;
-  sum = t;
-}
-
 void cpuSyncBatchNormStats(const float *x, const float eps, float *mean,
                            float *invstd, const int len_x, const int len_c) {
-  float len_nhw = len_x / len_c;
-
-  bool flag_free = false;
-  if (mean == nullptr && invstd == nullptr) {
-    mean = new float[len_c];
-    invstd = new float[len_c];
-    flag_free = true;
-  }
-
+  // one Welford pass over the channel-last rows instead of sum(x^2) -
+  // sum(x)^2, which cancels for channels with a large mean
+  const int64_t len_nhw = len_x / len_c;
+  std::vector<double> moments_mean(len_c), moments_m2(len_c);
+  batchnorm_cpu::moments(x, len_nhw, len_c, moments_mean.data(),
+                         moments_m2.data());
   for (int ci = 0; ci < len_c; ++ci) {
-    float sum = 0, ssum = 0;
-    float c_sum = 0.0, c_ssum = 0.0;
-    const float *xc = x + ci;
-    for (int xi = 0; xi < len_nhw; ++xi) {
-      kahan_stats(xc[xi * len_c], sum, c_sum);
-      kahan_stats(xc[xi * len_c] * xc[xi * len_c], ssum, c_ssum);
-    }
-    mean[ci] = sum / len_nhw;
-    invstd[ci] = 1.0f / sqrt(ssum / len_nhw - (mean[ci] * mean[ci]) + eps);
-  }
-
-  if (flag_free == true) {
-    delete[] mean;
-    delete[] invstd;
+    mean[ci] = moments_mean[ci];
+    invstd[ci] = 1.0 / sqrt(moments_m2[ci] / len_nhw + eps);
   }
 }
 
@@ -25,6 +25,7 @@
 #include "three_nn_forward.h"
 
 #include "mlu_op.h"
+#include "point_cloud_index.h"
 
 namespace mluoptest {
 
@@ -89,56 +90,25 @@ void ThreeNnForwardExecutor::cpuCompute() {
   auto unknown = cpu_fp32_input_[0];
   auto known = cpu_fp32_input_[1];
   auto dist2 = cpu_fp32_output_[0];
-  float *dist2_start = (float *)cpu_fp32_output_[0];
-  float *idx = (float *)cpu_fp32_output_[1];
-  float *idx_start = (float *)cpu_fp32_output_[1];
+  auto idx = cpu_fp32_output_[1];
 
+  // the 3 nearest known points of every unknown point, ties go to the
+  // smaller index. the unused ones stay at the initial 1e40, inf as a float,
+  // and index 0.
+  std::vector<point_cloud::PointGrid> grids(b);
+#pragma omp parallel for schedule(static)
   for (int64_t i = 0; i < b; ++i) {
-    for (int64_t j = 0; j < n; ++j) {
-      float ux = unknown[j * 3 + 0];
-      float uy = unknown[j * 3 + 1];
-      float uz = unknown[j * 3 + 2];
-      double best1 = 1e40;
-      double best2 = 1e40;
-      double best3 = 1e40;
-      int besti1 = 0;
-      int besti2 = 0;
-      int besti3 = 0;
-
-      for (int k = 0; k < m; ++k) {
-        float x = known[k * 3 + 0];
-        float y = known[k * 3 + 1];
-        float z = known[k * 3 + 2];
-        double d =
-            (ux - x) * (ux - x) + (uy - y) * (uy - y) + (uz - z) * (uz - z);
-        if (d < best1) {
-          best3 = best2;
-          besti3 = besti2;
-          best2 = best1;
-          besti2 = besti1;
-          best1 = d;
-          besti1 = k;
-        } else if (d < best2) {
-          best3 = best2;
-          besti3 = besti2;
-          best2 = d;
-          besti2 = k;
-        } else if (d < best3) {
-          best3 = d;
-          besti3 = k;
-        }
-      }
-      dist2[j * 3 + 0] = float(best1);
-      dist2[j * 3 + 1] = float(best2);
-      dist2[j * 3 + 2] = float(best3);
-      idx[j * 3 + 0] = besti1;
-      idx[j * 3 + 1] = besti2;
-      idx[j * 3 + 2] = besti3;
+    grids[i].build(known + i * m * 3, m);
+  }
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int64_t q = 0; q < b * n; ++q) {
+    int besti[3] = {0, 0, 0};
+    float best[3] = {INFINITY, INFINITY, INFINITY};
+    grids[q / n].nearest(unknown + q * 3, 3, besti, best);
+    for (int k = 0; k < 3; ++k) {
+      dist2[q * 3 + k] = best[k];
+      idx[q * 3 + k] = besti[k];
     }
-    unknown += n * 3;
-    known += m * 3;
-    dist2 += n * 3;
-    idx += n * 3;
   }
 }
 
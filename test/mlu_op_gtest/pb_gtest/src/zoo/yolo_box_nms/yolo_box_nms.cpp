@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "yolo_box_nms.h"
+
+#include <vector>
+
+#include "mlu_op.h"
+
+namespace mluoptest {
+void YoloBoxNmsExecutor::paramCheck() {
+  GTEST_CHECK(parser_->getProtoNode()->has_yolo_box_param(),
+              "[YoloBoxNmsExecutor] Lose yolo_box_param. ");
+  GTEST_CHECK(parser_->getProtoNode()->has_nms_param(),
+              "[YoloBoxNmsExecutor] Lose nms_param. ");
+  GTEST_CHECK(parser_->inputs().size() == 3,
+              "[YoloBoxNmsExecutor] input number is wrong. ");
+  GTEST_CHECK(parser_->outputs().size() == 3,
+              "[YoloBoxNmsExecutor] output number is wrong. ");
+}
+
+void YoloBoxNmsExecutor::initData() {
+  auto yolo_box_param = parser_->getProtoNode()->yolo_box_param();
+  auto nms_param = parser_->getProtoNode()->nms_param();
+  param_.class_num = yolo_box_param.class_num();
+  param_.conf_thresh = yolo_box_param.conf_thresh();
+  param_.downsample_ratio = yolo_box_param.downsample_ratio();
+  param_.clip_bbox = yolo_box_param.clip_bbox();
+  param_.scale = yolo_box_param.scale_x_y();
+  param_.iou_aware = yolo_box_param.iou_aware();
+  param_.iou_aware_factor = yolo_box_param.iou_aware_factor();
+  param_.score_thresh = nms_param.confidence_threshold();
+  param_.top_k = nms_param.max_output_boxes();
+  param_.iou_threshold = nms_param.iou_threshold();
+  param_.max_output = parser_->getMetaTensor("output1").tensor->dims[2];
+}
+
+void YoloBoxNmsExecutor::workspaceMalloc() {
+  initData();
+  auto x_desc = parser_->getMetaTensor("input1").tensor;
+  auto anchors_desc = parser_->getMetaTensor("input3").tensor;
+  auto boxes_desc = parser_->getMetaTensor("output1").tensor;
+  MLUOP_CHECK(mluOpGetYoloBoxNmsWorkspaceSize(
+      handle_, x_desc, anchors_desc, boxes_desc, param_.class_num,
+      param_.top_k, &workspace_size_));
+  // a top_k heap too large for NRAM lives in the workspace
+  VLOG(4) << "[YoloBoxNmsExecutor] Malloc workspace space: "
+          << workspace_size_;
+  void *temp = nullptr;
+  if (workspace_size_ > 0) {
+    temp = mlu_runtime_.allocate(workspace_size_);
+  }
+  workspace_.push_back(temp);
+  eva_->setMluWorkspaceSize(workspace_size_);
+}
+
+void YoloBoxNmsExecutor::workspaceFree() {
+  if (workspace_[0]) {
+    VLOG(4) << "[YoloBoxNmsExecutor] Free device workspace space.";
+    GTEST_CHECK(cnrtSuccess == mlu_runtime_.deallocate(workspace_[0]));
+    workspace_[0] = nullptr;
+  }
+}
+
+void YoloBoxNmsExecutor::compute() {
+  VLOG(4) << "[YoloBoxNmsExecutor] call compute() begin.";
+  // input tensor
+  auto x_desc = tensor_desc_[0].tensor;
+  auto img_size_desc = tensor_desc_[1].tensor;
+  auto anchors_desc = tensor_desc_[2].tensor;
+  auto dev_x = data_vector_[0].device_ptr;
+  auto dev_img_size = data_vector_[1].device_ptr;
+  auto dev_anchors = data_vector_[2].device_ptr;
+
+  // output tensor
+  auto boxes_desc = tensor_desc_[3].tensor;
+  auto scores_desc = tensor_desc_[4].tensor;
+  auto num_desc = tensor_desc_[5].tensor;
+  auto dev_boxes = data_vector_[3].device_ptr;
+  auto dev_scores = data_vector_[4].device_ptr;
+  auto dev_num = data_vector_[5].device_ptr;
+
+  interface_timer_.start();
+  MLUOP_CHECK(mluOpYoloBoxNms(
+      handle_, x_desc, dev_x, img_size_desc, dev_img_size, anchors_desc,
+      dev_anchors, param_.class_num, param_.conf_thresh,
+      param_.downsample_ratio, param_.clip_bbox, param_.scale,
+      param_.iou_aware, param_.iou_aware_factor, param_.score_thresh,
+      param_.top_k, param_.iou_threshold, workspace_[0], workspace_size_,
+      boxes_desc, dev_boxes, scores_desc, dev_scores, num_desc, dev_num));
+  interface_timer_.stop();
+  VLOG(4) << "[YoloBoxNmsExecutor] call compute() end.";
+}
+
+void YoloBoxNmsExecutor::cpuCompute() {
+  VLOG(4) << "[YoloBoxNmsExecutor] call cpuCompute() begin.";
+  auto x_desc = tensor_desc_[0].tensor;
+  auto anchors_desc = tensor_desc_[2].tensor;
+  yolo_box_nms_cpu::Shape shape;
+  shape.n = x_desc->dims[0];
+  shape.anchor_s = mluOpGetTensorElementNum(anchors_desc) / 2;
+  shape.h = x_desc->dims[2];
+  shape.w = x_desc->dims[3];
+
+  // num is int32 on the device, the baseline is compared as float
+  std::vector<int32_t> num(parser_->getOutputDataCount(2));
+  yolo_box_nms_cpu::yoloBoxNms(cpu_fp32_input_[0], cpu_fp32_input_[1],
+                               cpu_fp32_input_[2], shape, param_,
+                               cpu_fp32_output_[0], cpu_fp32_output_[1],
+                               num.data());
+  for (size_t i = 0; i < num.size(); ++i) {
+    cpu_fp32_output_[2][i] = static_cast<float>(num[i]);
+  }
+  VLOG(4) << "[YoloBoxNmsExecutor] call cpuCompute() end.";
+}
+
+int64_t YoloBoxNmsExecutor::getTheoryOps() {
+  // the decode of mluOpYoloBox, and an IoU against every kept box for each
+  // of the top_k candidates of an image and class
+  const int cp_count = 30;
+  const int iou_count = 12;
+  int64_t theory_ops = parser_->getInputDataCount(0) * cp_count +
+                       parser_->getOutputDataCount(2) * param_.top_k *
+                           param_.max_output * iou_count;
+  VLOG(4) << "[YoloBoxNmsExecutor] getTheoryOps: " << theory_ops << " ops.";
+  return theory_ops;
+}
+
+}  // namespace mluoptest
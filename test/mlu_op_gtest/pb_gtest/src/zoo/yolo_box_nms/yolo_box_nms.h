@@ -0,0 +1,51 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_SRC_ZOO_YOLO_BOX_NMS_YOLO_BOX_NMS_H_
+#define TEST_MLU_OP_GTEST_SRC_ZOO_YOLO_BOX_NMS_YOLO_BOX_NMS_H_
+
+#include "executor.h"
+#include "yolo_box_nms_cpu.h"
+
+namespace mluoptest {
+// The decode scalars come from yolo_box_param, score_thresh, top_k and
+// iou_threshold from the confidence_threshold, max_output_boxes and
+// iou_threshold of nms_param. max_output is the third dimension of boxes.
+class YoloBoxNmsExecutor : public Executor {
+ public:
+  YoloBoxNmsExecutor() {}
+  ~YoloBoxNmsExecutor() {}
+  void paramCheck() override;
+  void workspaceMalloc() override;
+  void workspaceFree() override;
+  void compute() override;
+  void cpuCompute() override;
+  int64_t getTheoryOps() override;
+
+ private:
+  void initData();
+  yolo_box_nms_cpu::Param param_;
+  size_t workspace_size_ = 0;
+};
+
+}  // namespace mluoptest
+#endif  // TEST_MLU_OP_GTEST_SRC_ZOO_YOLO_BOX_NMS_YOLO_BOX_NMS_H_
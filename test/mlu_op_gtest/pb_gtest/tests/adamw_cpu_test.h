@@ -0,0 +1,165 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_ADAMW_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_ADAMW_CPU_TEST_H_
+
+#include <stdint.h>
+#include <chrono>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "adamw_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+using mluoptest::uniformFloats;
+namespace aw = mluoptest::adamw_cpu;
+
+const aw::Hyper kAwHyper = {1e-3f, 0.9f, 0.999f, 0.19f, 0.0199f,
+                            1e-8f, 1e-2f, 128.0f};
+
+// The inputs and outputs of a list of tensors, and the pointer arrays of
+// their aw::TensorList.
+struct AwList {
+  std::vector<std::vector<float>> param, momentum, velocity, grad;
+  std::vector<std::vector<float>> param_out, param_h_out, momentum_out;
+  std::vector<std::vector<float>> velocity_out;
+  std::vector<const float *> param_p, momentum_p, velocity_p;
+  std::vector<float *> grad_p, param_out_p, param_h_out_p, momentum_out_p;
+  std::vector<float *> velocity_out_p;
+
+  // the values repeat over a few small random pools, which keeps the
+  // setup of the benchmark list cheap
+  explicit AwList(const std::vector<size_t> &sizes) {
+    const size_t pool = 4099;
+    const auto p = uniformFloats(pool, -1.0f, 1.0f, 1);
+    const auto m = uniformFloats(pool, -0.1f, 0.1f, 2);
+    const auto v = uniformFloats(pool, 0.0f, 0.01f, 3);
+    const auto g = uniformFloats(pool, -100.0f, 100.0f, 4);
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      const size_t n = sizes[i];
+      param.emplace_back(n), momentum.emplace_back(n);
+      velocity.emplace_back(n), grad.emplace_back(n);
+      for (size_t j = 0; j < n; ++j) {
+        const size_t k = (j + 131 * i) % pool;
+        param[i][j] = p[k], momentum[i][j] = m[k];
+        velocity[i][j] = v[k], grad[i][j] = g[k];
+      }
+      param_out.emplace_back(n), param_h_out.emplace_back(n);
+      momentum_out.emplace_back(n), velocity_out.emplace_back(n);
+    }
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      param_p.push_back(param[i].data());
+      momentum_p.push_back(momentum[i].data());
+      velocity_p.push_back(velocity[i].data());
+      grad_p.push_back(grad[i].data());
+      param_out_p.push_back(param_out[i].data());
+      param_h_out_p.push_back(param_h_out[i].data());
+      momentum_out_p.push_back(momentum_out[i].data());
+      velocity_out_p.push_back(velocity_out[i].data());
+    }
+  }
+
+  // the list of the tensors from number first on
+  aw::TensorList tensors(bool with_param_h, size_t first = 0) const {
+    float *const *param_h =
+        with_param_h ? param_h_out_p.data() + first : nullptr;
+    return {param_p.data() + first,        momentum_p.data() + first,
+            velocity_p.data() + first,     grad_p.data() + first,
+            param_out_p.data() + first,    param_h,
+            momentum_out_p.data() + first, velocity_out_p.data() + first};
+  }
+};
+}  // namespace
+
+TEST(ADAMW_CPU, plan_covers_every_element_once) {
+  const size_t chunk = 16;
+  const std::vector<size_t> sizes = {0, 1, 15, 16, 17, 0, 53, 32};
+  const auto table = mluop::planAdamWChunks(sizes.size(), sizes.data(), chunk);
+  ASSERT_EQ(mluop::countAdamWChunks(sizes.size(), sizes.data(), chunk),
+            table.size());
+  size_t k = 0;
+  for (int i = 0; i < static_cast<int>(sizes.size()); ++i) {
+    size_t next = 0;
+    for (; k < table.size() && table[k].tensor == i; ++k) {
+      ASSERT_EQ(next, table[k].offset);
+      ASSERT_EQ(0u, table[k].offset % chunk);
+      ASSERT_GT(table[k].num, 0u);
+      ASSERT_LE(table[k].num, chunk);
+      next += table[k].num;
+    }
+    ASSERT_EQ(sizes[i], next);
+  }
+  ASSERT_EQ(table.size(), k);
+}
+
+TEST(ADAMW_CPU, foreach_matches_step) {
+  const std::vector<size_t> sizes = {1, 100, 0, 64, 65, 1000, 7};
+  for (bool with_param_h : {true, false}) {
+    AwList list(sizes), ref(sizes);
+    aw::foreach(kAwHyper, list.tensors(with_param_h), sizes.size(),
+                sizes.data(), 64);
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      aw::step(kAwHyper, ref.param_p[i], ref.momentum_p[i], ref.velocity_p[i],
+               ref.grad_p[i], ref.param_out_p[i], ref.param_h_out_p[i],
+               ref.momentum_out_p[i], ref.velocity_out_p[i], 0, sizes[i]);
+      for (size_t j = 0; j < sizes[i]; ++j) {
+        ASSERT_EQ(ref.grad[i][j], list.grad[i][j]);
+        ASSERT_EQ(ref.param_out[i][j], list.param_out[i][j]);
+        ASSERT_EQ(ref.momentum_out[i][j], list.momentum_out[i][j]);
+        ASSERT_EQ(ref.velocity_out[i][j], list.velocity_out[i][j]);
+        ASSERT_EQ(with_param_h ? ref.param_out[i][j] : 0.0f,
+                  list.param_h_out[i][j]);
+      }
+    }
+  }
+}
+
+TEST(DISABLED_ADAMW_CPU, benchmark) {
+  // a transformer-like list: many bias and norm vectors, a few matrices
+  std::vector<size_t> sizes;
+  for (int layer = 0; layer < 48; ++layer) {
+    for (int v = 0; v < 40; ++v) sizes.push_back(1024);
+    sizes.push_back(256 * 1024);
+  }
+  size_t n = 0;
+  for (size_t size : sizes) n += size;
+  AwList list(sizes);
+
+  // one tensor after the other, as a loop of mluOpAdamW calls does
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    aw::foreach(kAwHyper, list.tensors(true, i), 1, &sizes[i]);
+  }
+  const double loop_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  aw::foreach(kAwHyper, list.tensors(true), sizes.size(), sizes.data());
+  const double foreach_ms = elapsedMs(start);
+
+  BenchmarkLine() << sizes.size() << " tensors, " << n << " elements: loop "
+                  << loop_ms << " ms, foreach " << foreach_ms << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_ADAMW_CPU_TEST_H_
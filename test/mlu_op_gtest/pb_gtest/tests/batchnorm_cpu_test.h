@@ -0,0 +1,201 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_BATCHNORM_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_BATCHNORM_CPU_TEST_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <chrono>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "batchnorm_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+using mluoptest::normalFloats;
+namespace bn = mluoptest::batchnorm_cpu;
+
+// Two-pass moments of channel c in long double.
+void bnTwoPass(const float *x, int64_t rows, int channels, int c,
+               double *mean, double *m2) {
+  long double sum = 0, sq = 0;
+  for (int64_t r = 0; r < rows; ++r) sum += x[r * channels + c];
+  const long double mu = sum / rows;
+  for (int64_t r = 0; r < rows; ++r) {
+    const long double d = x[r * channels + c] - mu;
+    sq += d * d;
+  }
+  *mean = mu, *m2 = sq;
+}
+}  // namespace
+
+TEST(BATCHNORM_CPU, moments_match_two_pass) {
+  // a mean far from zero, where sum(x^2) - sum(x)^2 loses the variance
+  const int channels = 37;
+  for (int64_t rows : {1, 5, 1023, 1024, 3001}) {
+    const auto x = normalFloats(rows * channels, 1000.0f, 0.5f, rows);
+    std::vector<double> mean(channels), m2(channels);
+    bn::moments(x.data(), rows, channels, mean.data(), m2.data());
+    for (int c = 0; c < channels; ++c) {
+      double ref_mean, ref_m2;
+      bnTwoPass(x.data(), rows, channels, c, &ref_mean, &ref_m2);
+      ASSERT_NEAR(ref_mean, mean[c], 1e-9 * fabs(ref_mean));
+      ASSERT_NEAR(ref_m2, m2[c], 1e-9 * ref_m2 + 1e-9);
+    }
+  }
+}
+
+TEST(BATCHNORM_CPU, merge_matches_concatenation) {
+  const int channels = 5;
+  const int64_t counts[] = {7, 0, 1, 300, 64};
+  std::vector<float> all;
+  double count = 0;
+  std::vector<double> mean(channels, 0.0), m2(channels, 0.0);
+  std::vector<double> counts_c(channels, 0.0);
+  for (int g = 0; g < 5; ++g) {
+    const auto x = normalFloats(counts[g] * channels, -3.0f + g, 1.0f + g, g);
+    all.insert(all.end(), x.begin(), x.end());
+    if (counts[g] == 0) continue;
+    std::vector<double> group_mean(channels), group_m2(channels);
+    bn::moments(x.data(), counts[g], channels, group_mean.data(),
+                group_m2.data());
+    for (int c = 0; c < channels; ++c) {
+      bn::merge(counts[g], group_mean[c], group_m2[c], &counts_c[c],
+                &mean[c], &m2[c]);
+    }
+    count += counts[g];
+  }
+  for (int c = 0; c < channels; ++c) {
+    double ref_mean, ref_m2;
+    bnTwoPass(all.data(), count, channels, c, &ref_mean, &ref_m2);
+    ASSERT_EQ(count, counts_c[c]);
+    ASSERT_NEAR(ref_mean, mean[c], 1e-9);
+    ASSERT_NEAR(ref_m2, m2[c], 1e-9 * ref_m2);
+  }
+}
+
+TEST(BATCHNORM_CPU, reduce_backward_matches_naive) {
+  const int64_t rows = 2500;
+  const int channels = 19;
+  const auto x = normalFloats(rows * channels, 2.0f, 3.0f, 1);
+  const auto dy = normalFloats(rows * channels, 0.0f, 1.0f, 2);
+  const auto mean = normalFloats(channels, 2.0f, 0.1f, 3);
+  const auto invstd = normalFloats(channels, 0.3f, 0.01f, 4);
+  std::vector<double> sum_dy(channels), sum_dy_xmu(channels);
+  std::vector<double> sum_dy_xhat(channels);
+  bn::reduceBackward(dy.data(), x.data(), mean.data(), invstd.data(), rows,
+                     channels, sum_dy.data(), sum_dy_xmu.data(),
+                     sum_dy_xhat.data());
+  for (int c = 0; c < channels; ++c) {
+    double ref_dy = 0, ref_dy_xmu = 0, ref_dy_xhat = 0;
+    for (int64_t r = 0; r < rows; ++r) {
+      const float xmu = x[r * channels + c] - mean[c];
+      const float d = dy[r * channels + c];
+      ref_dy += d;
+      ref_dy_xmu += xmu * d;
+      ref_dy_xhat += (xmu * invstd[c]) * d;
+    }
+    ASSERT_NEAR(ref_dy, sum_dy[c], 1e-9);
+    ASSERT_NEAR(ref_dy_xmu, sum_dy_xmu[c], 1e-9);
+    ASSERT_NEAR(ref_dy_xhat, sum_dy_xhat[c], 1e-9);
+  }
+}
+
+TEST(BATCHNORM_CPU, elemt_matches_channel_loops) {
+  const int64_t rows = 333;
+  const int channels = 21;
+  const auto x = normalFloats(rows * channels, 1.0f, 2.0f, 1);
+  const auto dy = normalFloats(rows * channels, 0.0f, 1.0f, 2);
+  const auto mean = normalFloats(channels, 1.0f, 0.1f, 3);
+  const auto invstd = normalFloats(channels, 0.5f, 0.01f, 4);
+  const auto weight = normalFloats(channels, 1.0f, 0.1f, 5);
+  const auto bias = normalFloats(channels, 0.0f, 0.1f, 6);
+  const auto mean_dy = normalFloats(channels, 0.0f, 0.1f, 7);
+  const auto mean_dy_xmu = normalFloats(channels, 0.0f, 0.1f, 8);
+  std::vector<float> y(rows * channels), dx(rows * channels);
+  bn::normalize(x.data(), mean.data(), invstd.data(), weight.data(),
+                bias.data(), rows, channels, y.data());
+  bn::backwardElemt(dy.data(), x.data(), mean.data(), invstd.data(),
+                    weight.data(), mean_dy.data(), mean_dy_xmu.data(), rows,
+                    channels, dx.data());
+  for (int c = 0; c < channels; ++c) {
+    for (int64_t r = 0; r < rows; ++r) {
+      const int64_t i = r * channels + c;
+      float ref_y = (x[i] - mean[c]) * invstd[c];
+      ref_y = ref_y * weight[c] + bias[c];
+      const float ref_dx = (dy[i] - mean_dy[c] -
+                            (x[i] - mean[c]) * invstd[c] * invstd[c] *
+                                mean_dy_xmu[c]) *
+                           weight[c] * invstd[c];
+      ASSERT_EQ(ref_y, y[i]);
+      ASSERT_EQ(ref_dx, dx[i]);
+    }
+  }
+}
+
+TEST(DISABLED_BATCHNORM_CPU, benchmark) {
+  // 256 channels, 64M elements: the stats and backward reduction passes
+  const int channels = 256;
+  const int64_t rows = (64 << 20) / channels, n = rows * channels;
+  const auto x = normalFloats(n, 1.0f, 2.0f, 1);
+  const auto dy = normalFloats(n, 0.0f, 1.0f, 2);
+
+  // per channel, strided over the rows, as the stats baseline had it
+  auto start = std::chrono::steady_clock::now();
+  std::vector<float> strided_mean(channels);
+  for (int c = 0; c < channels; ++c) {
+    double sum = 0, sq = 0;
+    for (int64_t r = 0; r < rows; ++r) {
+      const float v = x[r * channels + c];
+      sum += v, sq += v * v;
+    }
+    strided_mean[c] = sum / rows;
+  }
+  const double strided_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  std::vector<double> mean(channels), m2(channels);
+  bn::moments(x.data(), rows, channels, mean.data(), m2.data());
+  const double moments_ms = elapsedMs(start);
+
+  std::vector<float> mean_f(mean.begin(), mean.end());
+  std::vector<float> invstd(channels);
+  for (int c = 0; c < channels; ++c) invstd[c] = 1.0 / sqrt(m2[c] / rows);
+  start = std::chrono::steady_clock::now();
+  std::vector<double> sum_dy(channels), sum_dy_xmu(channels);
+  std::vector<double> sum_dy_xhat(channels);
+  bn::reduceBackward(dy.data(), x.data(), mean_f.data(), invstd.data(), rows,
+                     channels, sum_dy.data(), sum_dy_xmu.data(),
+                     sum_dy_xhat.data());
+  const double reduce_ms = elapsedMs(start);
+
+  const double gb = n * sizeof(float) / 1e9;
+  BenchmarkLine() << "strided sums " << strided_ms << " ms, welford "
+                  << moments_ms << " ms (" << gb / moments_ms * 1e3
+                  << " GB/s), backward reduce " << reduce_ms << " ms ("
+                  << 2 * gb / reduce_ms * 1e3 << " GB/s)";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_BATCHNORM_CPU_TEST_H_
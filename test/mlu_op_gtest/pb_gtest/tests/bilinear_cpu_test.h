@@ -0,0 +1,203 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_BILINEAR_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_BILINEAR_CPU_TEST_H_
+
+#include <math.h>
+#include <chrono>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "bilinear_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+using mluoptest::uniformFloats;
+
+// The per-element roi_align sample of channel c, as the executors had it.
+float alignedScalar(const float *data, int height, int width, int channels,
+                    float y, float x, int c) {
+  if (y < -1.0 || y > height || x < -1.0 || x > width) return 0;
+  if (y <= 0) y = 0;
+  if (x <= 0) x = 0;
+  int y_low = (int)y, x_low = (int)x, y_high, x_high;
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = (float)y_low;
+  } else {
+    y_high = y_low + 1;
+  }
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = (float)x_low;
+  } else {
+    x_high = x_low + 1;
+  }
+  float ly = y - y_low, lx = x - x_low;
+  float hy = 1. - ly, hx = 1. - lx;
+  float v1 = data[(y_low * width + x_low) * channels + c];
+  float v2 = data[(y_low * width + x_high) * channels + c];
+  float v3 = data[(y_high * width + x_low) * channels + c];
+  float v4 = data[(y_high * width + x_high) * channels + c];
+  return hy * hx * v1 + hy * lx * v2 + ly * hx * v3 + ly * lx * v4;
+}
+
+// The per-element ms_deform_attn sample of channel c.
+float deformScalar(const float *data, int height, int width, int channels,
+                   float h, float w, int c) {
+  if (!(h > -1 && w > -1 && h < height && w < width)) return 0;
+  const int h_low = floorf(h), w_low = floorf(w);
+  const int h_high = h_low + 1, w_high = w_low + 1;
+  const float lh = h - h_low, lw = w - w_low;
+  const float hh = 1 - lh, hw = 1 - lw;
+  auto at = [&](int y, int x) {
+    if (y < 0 || x < 0 || y > height - 1 || x > width - 1) return 0.0f;
+    return data[(y * width + x) * channels + c];
+  };
+  return hh * hw * at(h_low, w_low) + hh * lw * at(h_low, w_high) +
+         lh * hw * at(h_high, w_low) + lh * lw * at(h_high, w_high);
+}
+}  // namespace
+
+TEST(BILINEAR_CPU, aligned_matches_scalar) {
+  const int height = 7, width = 5, channels = 13;
+  const auto data = uniformFloats(height * width * channels, -1, 1, 1);
+  // points from well outside to well past the far border
+  const auto ys = uniformFloats(2000, -2.5, height + 1.5, 2);
+  const auto xs = uniformFloats(2000, -2.5, width + 1.5, 3);
+  std::vector<float> out(channels);
+  for (size_t i = 0; i < ys.size(); ++i) {
+    mluoptest::bilinear_cpu::Point p;
+    const bool valid = mluoptest::bilinear_cpu::alignedPoint(
+        height, width, ys[i], xs[i], channels, &p);
+    ASSERT_EQ(valid, !(ys[i] < -1.0 || ys[i] > height || xs[i] < -1.0 ||
+                       xs[i] > width));
+    if (!valid) continue;
+    mluoptest::bilinear_cpu::sample(data.data(), p, channels, out.data());
+    for (int c = 0; c < channels; ++c) {
+      ASSERT_EQ(alignedScalar(data.data(), height, width, channels, ys[i],
+                              xs[i], c),
+                out[c]);
+    }
+  }
+}
+
+TEST(BILINEAR_CPU, deform_matches_scalar) {
+  const int height = 6, width = 9, channels = 7;
+  const auto data = uniformFloats(height * width * channels, -1, 1, 4);
+  const auto ys = uniformFloats(2000, -2, height + 1, 5);
+  const auto xs = uniformFloats(2000, -2, width + 1, 6);
+  const auto scales = uniformFloats(2000, -1, 1, 7);
+  for (size_t i = 0; i < ys.size(); ++i) {
+    std::vector<float> out(channels, 0.5f);
+    mluoptest::bilinear_cpu::Point p;
+    if (!mluoptest::bilinear_cpu::deformPoint(height, width, ys[i], xs[i],
+                                              channels, &p)) {
+      ASSERT_EQ(0.0f, deformScalar(data.data(), height, width, channels,
+                                   ys[i], xs[i], 0));
+      continue;
+    }
+    mluoptest::bilinear_cpu::accumulate(data.data(), p, scales[i], channels,
+                                        out.data());
+    for (int c = 0; c < channels; ++c) {
+      const float expect =
+          0.5f + deformScalar(data.data(), height, width, channels, ys[i],
+                              xs[i], c) *
+                     scales[i];
+      ASSERT_EQ(expect, out[c]);
+    }
+  }
+}
+
+TEST(BILINEAR_CPU, scatter_is_adjoint_of_sample) {
+  // <scatter(g), v> == <g, sample(v)> for every point, missing corners too
+  const int height = 5, width = 4, channels = 9;
+  const auto data = uniformFloats(height * width * channels, -1, 1, 8);
+  const auto grad = uniformFloats(channels, -1, 1, 9);
+  const auto ys = uniformFloats(500, -1.5, height + 0.5, 10);
+  const auto xs = uniformFloats(500, -1.5, width + 0.5, 11);
+  std::vector<float> sampled(channels);
+  for (size_t i = 0; i < ys.size(); ++i) {
+    for (int rule = 0; rule < 2; ++rule) {
+      mluoptest::bilinear_cpu::Point p;
+      const bool valid =
+          rule ? mluoptest::bilinear_cpu::deformPoint(height, width, ys[i],
+                                                      xs[i], channels, &p)
+               : mluoptest::bilinear_cpu::alignedPoint(height, width, ys[i],
+                                                       xs[i], channels, &p);
+      if (!valid) continue;
+      std::vector<float> scattered(data.size(), 0.0f);
+      mluoptest::bilinear_cpu::scatter(scattered.data(), p, grad.data(), 2.0f,
+                                       channels);
+      mluoptest::bilinear_cpu::sample(data.data(), p, channels,
+                                      sampled.data());
+      double lhs = 0.0, rhs = 0.0;
+      for (size_t j = 0; j < data.size(); ++j) lhs += scattered[j] * data[j];
+      for (int c = 0; c < channels; ++c) rhs += grad[c] * sampled[c] / 2.0;
+      ASSERT_NEAR(lhs, rhs, 1e-5) << "rule " << rule << " point " << i;
+    }
+  }
+}
+
+TEST(DISABLED_BILINEAR_CPU, benchmark) {
+  // roi_align average pooling of 256 channels over a 7x7 grid of 2x2 bins
+  const int height = 100, width = 152, channels = 256, rois = 64;
+  const int pooled = 7, grid = 2, points = pooled * pooled * grid * grid;
+  const auto data = uniformFloats(height * width * channels, -1, 1, 1);
+  const auto ys = uniformFloats(rois * points, 0, height, 2);
+  const auto xs = uniformFloats(rois * points, 0, width, 3);
+  std::vector<float> scalar(rois * pooled * pooled * channels, 0.0f);
+  std::vector<float> rows(scalar.size(), 0.0f);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int bin = 0; bin < rois * pooled * pooled; ++bin) {
+    for (int c = 0; c < channels; ++c) {
+      for (int i = 0; i < grid * grid; ++i) {
+        const int point = bin * grid * grid + i;
+        scalar[bin * channels + c] += alignedScalar(
+            data.data(), height, width, channels, ys[point], xs[point], c);
+      }
+    }
+  }
+  const double scalar_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  for (int bin = 0; bin < rois * pooled * pooled; ++bin) {
+    for (int i = 0; i < grid * grid; ++i) {
+      const int point = bin * grid * grid + i;
+      mluoptest::bilinear_cpu::Point p;
+      if (mluoptest::bilinear_cpu::alignedPoint(height, width, ys[point],
+                                                xs[point], channels, &p)) {
+        mluoptest::bilinear_cpu::accumulate(data.data(), p, 1.0f, channels,
+                                            rows.data() + bin * channels);
+      }
+    }
+  }
+  const double rows_ms = elapsedMs(start);
+  for (size_t i = 0; i < rows.size(); ++i) ASSERT_EQ(scalar[i], rows[i]);
+  BenchmarkLine() << "per element " << scalar_ms << " ms, channel rows "
+                  << rows_ms << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_BILINEAR_CPU_TEST_H_
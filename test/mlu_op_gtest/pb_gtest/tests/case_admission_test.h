@@ -0,0 +1,116 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_CASE_ADMISSION_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_CASE_ADMISSION_TEST_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "case_admission.h"
+#include "case_pipeline.h"
+
+TEST(CASE_ADMISSION, estimate_from_header) {
+  mluoptest::CaseHeader header;
+  header.tensors.resize(3);
+  header.tensors[0].elements = 100;  // half input
+  header.tensors[0].dtype_bytes = 2;
+  header.tensors[1].elements = 10;  // input without dtype, as float
+  header.tensors[2].elements = 50;  // double output
+  header.tensors[2].dtype_bytes = 8;
+  header.tensors[2].output = true;
+  header.workspace_size = 1000;
+  auto memory = mluoptest::estimateCaseMemory(header, 300);
+  EXPECT_EQ(300 + (200 + 400) + (40 + 40) + (400 + 400 + 400),
+            memory.host_bytes);
+  EXPECT_EQ(200 + 40 + 400 + 1000, memory.device_bytes);
+
+  memory = mluoptest::estimateCaseMemory(mluoptest::CaseHeader(), 300);
+  EXPECT_EQ(300, memory.host_bytes);
+  EXPECT_EQ(0, memory.device_bytes);
+}
+
+TEST(CASE_ADMISSION, budget) {
+  mluoptest::MemoryAdmission admission(100, 50);
+  EXPECT_TRUE(admission.enabled());
+  EXPECT_TRUE(admission.tryAdmit({60, 10}));
+  EXPECT_FALSE(admission.tryAdmit({50, 10}));  // host over budget
+  EXPECT_FALSE(admission.tryAdmit({10, 41}));  // device over budget
+  EXPECT_TRUE(admission.tryAdmit({40, 40}));
+  EXPECT_EQ(100, admission.inFlight().host_bytes);
+  admission.release({60, 10});
+  admission.release({40, 40});
+  EXPECT_EQ(0, admission.inFlight().host_bytes);
+  EXPECT_EQ(0, admission.inFlight().device_bytes);
+
+  // too big for the budget, but runs alone.
+  EXPECT_TRUE(admission.tryAdmit({500, 500}));
+  EXPECT_FALSE(admission.tryAdmit({1, 1}));
+  admission.release({500, 500});
+  EXPECT_EQ(500, admission.peak().host_bytes);
+  EXPECT_EQ(500, admission.peak().device_bytes);
+
+  mluoptest::MemoryAdmission unlimited(0, 0);
+  EXPECT_FALSE(unlimited.enabled());
+  for (int i = 0; i < 10; ++i) EXPECT_TRUE(unlimited.tryAdmit({1 << 30, 1}));
+}
+
+TEST(CASE_ADMISSION, pipeline_stays_in_budget) {
+  // big cases (40) and small ones (10) with a budget of 50: never more
+  // than one big case in flight, while up to 5 small ones may run together.
+  const size_t num = 60;
+  std::vector<mluoptest::CaseMemory> memory(num);
+  for (size_t i = 0; i < num; ++i) {
+    const size_t bytes = i % 4 == 0 ? 40 : 10;
+    memory[i] = {bytes, bytes};
+  }
+  mluoptest::MemoryAdmission admission(50, 0);
+  std::atomic<size_t> deferred(0), admitted(0);
+  std::vector<size_t> order;
+
+  mluoptest::CasePipeline pipeline(2, 8);
+  pipeline.setAdmit([&](size_t idx) {
+    admission.admit(memory[idx], [&]() { deferred++; });
+    order.push_back(idx);  // only the feeder thread admits
+    EXPECT_LE(admission.inFlight().host_bytes, 50u);
+    admitted++;
+  });
+  pipeline.addStage("run", 3, [&](size_t idx) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100 + idx % 3));
+  });
+  pipeline.addStage("teardown", 1,
+                    [&](size_t idx) { admission.release(memory[idx]); });
+  pipeline.run(num);
+
+  EXPECT_EQ(num, admitted.load());
+  EXPECT_GT(deferred.load(), 0u);
+  std::vector<size_t> expected(num);
+  for (size_t i = 0; i < num; ++i) expected[i] = i;
+  EXPECT_EQ(expected, order);  // deferring keeps the case order.
+  EXPECT_LE(admission.peak().host_bytes, 50u);
+  EXPECT_EQ(0, admission.inFlight().host_bytes);
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_CASE_ADMISSION_TEST_H_
@@ -0,0 +1,266 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_CASE_COST_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_CASE_COST_TEST_H_
+
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "case_cost.h"
+#include "mlu_op_test.pb.h"
+
+namespace {
+std::string writeCaseFile(const std::string &name, const std::string &data) {
+  const std::string path = testing::TempDir() + name;
+  std::ofstream fout(path, std::ios::binary);
+  fout << data;
+  return path;
+}
+
+void setCaseTensor(mluoptest::Tensor *tensor, const std::string &id,
+                   const std::vector<int> &dims, size_t values) {
+  tensor->set_id(id);
+  for (auto dim : dims) tensor->mutable_shape()->add_dims(dim);
+  for (size_t i = 0; i < values; ++i) tensor->add_value_f(i);
+}
+
+// an input whose dims are packed, which a parser accepts for any repeated
+// int field. the generated code never writes them this way.
+std::string packedDimsInput(const std::vector<int> &dims) {
+  using google::protobuf::io::CodedOutputStream;
+  std::string packed, shape, tensor, node;
+  auto append_field = [](std::string *out, int field,
+                         const std::string &data) {
+    google::protobuf::io::StringOutputStream stream(out);
+    CodedOutputStream coded(&stream);
+    coded.WriteTag(field << 3 | 2);
+    coded.WriteVarint32(data.size());
+    coded.WriteString(data);
+  };
+  {
+    google::protobuf::io::StringOutputStream stream(&packed);
+    CodedOutputStream coded(&stream);
+    for (auto dim : dims) coded.WriteVarint64(dim);
+  }
+  append_field(&shape, mluoptest::Shape::kDimsFieldNumber, packed);
+  append_field(&tensor, mluoptest::Tensor::kShapeFieldNumber, shape);
+  append_field(&node, mluoptest::Node::kInputFieldNumber, tensor);
+  return node;
+}
+}  // namespace
+
+TEST(CASE_COST, prototxt_element_count) {
+  const std::string text =
+      "op_name: \"abs\"  # input { shape { dims: 1000 } }\n"
+      "input {\n  id: \"x{\"\n  shape: {\n    dims: 10\n    dims: 20\n  }\n"
+      "  value_f: [1, 2, 3]\n  random_data: { seed: 23 }\n}\n"
+      "input < shape < dims: [2, 3] > >\n"
+      "output {\n  id: \"y\"\n  shape { dims: 10 dims: 20 }\n}\n"
+      "output { id: \"z\" }\n";
+  size_t count = 0;
+  ASSERT_TRUE(mluoptest::caseElementCount(
+      writeCaseFile("case_cost.prototxt", text), &count));
+  EXPECT_EQ(200 + 6 + 200, count);
+
+  ASSERT_FALSE(mluoptest::caseElementCount(
+      writeCaseFile("case_cost_broken.prototxt", "input { shape {"), &count));
+}
+
+TEST(CASE_COST, pb_element_count) {
+  mluoptest::Node node;
+  node.set_op_name("abs");
+  setCaseTensor(node.add_input(), "x", {10, 20, 3}, 1 << 18);
+  setCaseTensor(node.add_input(), "x1", {7}, 7);
+  node.mutable_input(1)->add_value_i(3);
+  setCaseTensor(node.add_output(), "y", {10, 20, 3}, 0);
+  setCaseTensor(node.add_output(), "y1", {5, 0}, 0);
+  node.set_workspace_size(300);
+  std::string data;
+  ASSERT_TRUE(node.SerializeToString(&data));
+  size_t count = 0;
+  const std::string path = writeCaseFile("case_cost.pb", data);
+  ASSERT_TRUE(mluoptest::caseElementCount(path, &count));
+  EXPECT_EQ(600 + 7 + 600, count);
+
+  ASSERT_FALSE(mluoptest::caseElementCount(
+      writeCaseFile("case_cost_cut.pb", data.substr(0, 100)), &count));
+
+  // packed dims are what a full parse sees too.
+  data += packedDimsInput({4, 5});
+  ASSERT_TRUE(node.ParseFromString(data));
+  ASSERT_EQ(3, node.input_size());
+  EXPECT_EQ(2, node.input(2).shape().dims_size());
+  ASSERT_TRUE(mluoptest::caseElementCount(
+      writeCaseFile("case_cost_packed.pb", data), &count));
+  EXPECT_EQ(600 + 7 + 600 + 20, count);
+}
+
+TEST(CASE_COST, header_dtype_and_workspace) {
+  const std::string text =
+      "op_name: \"abs\"\nworkspace_size: 4096\n"
+      "input { dtype: DTYPE_HALF shape { dims: 10 dims: 20 } }\n"
+      "output { shape { dims: 3 } dtype: DTYPE_DOUBLE }\n";
+  mluoptest::CaseHeader header;
+  ASSERT_TRUE(mluoptest::readCaseHeader(
+      writeCaseFile("case_header.prototxt", text), &header));
+  ASSERT_EQ(2, header.tensors.size());
+  EXPECT_FALSE(header.tensors[0].output);
+  EXPECT_EQ(200, header.tensors[0].elements);
+  EXPECT_EQ(2, header.tensors[0].dtype_bytes);
+  EXPECT_TRUE(header.tensors[1].output);
+  EXPECT_EQ(3, header.tensors[1].elements);
+  EXPECT_EQ(8, header.tensors[1].dtype_bytes);
+  EXPECT_EQ(4096, header.workspace_size);
+
+  // the same header from the binary form of the same node.
+  mluoptest::Node node;
+  ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(text, &node));
+  setCaseTensor(node.add_output(), "z", {7, 3}, 21);
+  std::string data;
+  ASSERT_TRUE(node.SerializeToString(&data));
+  mluoptest::CaseHeader pb_header;
+  ASSERT_TRUE(mluoptest::readCaseHeader(writeCaseFile("case_header.pb", data),
+                                        &pb_header));
+  ASSERT_EQ(3, pb_header.tensors.size());
+  for (size_t i = 0; i < header.tensors.size(); ++i) {
+    EXPECT_EQ(header.tensors[i].output, pb_header.tensors[i].output);
+    EXPECT_EQ(header.tensors[i].elements, pb_header.tensors[i].elements);
+    EXPECT_EQ(header.tensors[i].dtype_bytes,
+              pb_header.tensors[i].dtype_bytes);
+  }
+  EXPECT_EQ(21, pb_header.tensors[2].elements);
+  EXPECT_EQ(0, pb_header.tensors[2].dtype_bytes);
+  EXPECT_EQ(4096, pb_header.workspace_size);
+  EXPECT_EQ(224, pb_header.elementCount());
+}
+
+TEST(CASE_COST, history_scales_estimates) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 3; ++i) {
+    paths.push_back(writeCaseFile("case_cost_" + std::to_string(i) + ".pb",
+                                  std::string(1000 << (i * 4), '\0')));
+  }
+  auto costs = mluoptest::estimateCaseCosts(paths, nullptr);
+  ASSERT_EQ(3, costs.size());
+  EXPECT_LT(costs[0].seconds, costs[1].seconds);
+  EXPECT_LT(costs[1].seconds, costs[2].seconds);
+
+  const std::string history_file = testing::TempDir() + "case_cost_history";
+  {
+    std::ofstream fout(history_file);
+    fout << paths[1] << "|1.5\nbroken line\n";
+  }
+  mluoptest::TestInternalInfo history;
+  ASSERT_TRUE(history.load_case_costs(history_file));
+  auto scaled = mluoptest::estimateCaseCosts(paths, &history);
+  EXPECT_TRUE(scaled[1].history);
+  EXPECT_FALSE(scaled[0].history);
+  const double scale = 1.5 / costs[1].seconds;
+  EXPECT_DOUBLE_EQ(1.5, scaled[1].seconds);
+  EXPECT_DOUBLE_EQ(costs[0].seconds * scale, scaled[0].seconds);
+  EXPECT_DOUBLE_EQ(costs[2].seconds * scale, scaled[2].seconds);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    EXPECT_DOUBLE_EQ(costs[i].estimate, scaled[i].estimate);
+  }
+
+  // recorded cases overwrite the history, and the rest is kept.
+  mluoptest::GtestInternal internal;
+  internal.time_costs_ms = {std::make_tuple("parse", 10.),
+                            std::make_tuple("end", 2500.)};
+  history.record_case(paths[2], internal);
+  history.clear_cases();
+  ASSERT_TRUE(history.save_case_costs(history_file));
+  mluoptest::TestInternalInfo reloaded;
+  ASSERT_TRUE(reloaded.load_case_costs(history_file));
+  double seconds = 0.;
+  ASSERT_TRUE(reloaded.case_wall_seconds(paths[2], &seconds));
+  EXPECT_DOUBLE_EQ(2.5, seconds);
+  ASSERT_TRUE(reloaded.case_wall_seconds(paths[1], &seconds));
+  EXPECT_DOUBLE_EQ(1.5, seconds);
+  EXPECT_FALSE(reloaded.case_wall_seconds(paths[0], &seconds));
+}
+
+TEST(CASE_COST, longest_first) {
+  std::vector<mluoptest::CaseCost> costs(5);
+  const double seconds[] = {1., 5., 2., 5., 0.5};
+  for (size_t i = 0; i < costs.size(); ++i) costs[i].seconds = seconds[i];
+  EXPECT_EQ(std::vector<size_t>({1, 3, 2, 0, 4}),
+            mluoptest::lptOrder(costs));
+}
+
+TEST(CASE_COST, shards_are_balanced_and_deterministic) {
+  std::mt19937 gen(37);
+  std::lognormal_distribution<double> dist(0., 1.5);
+  std::vector<mluoptest::CaseCost> costs(1000);
+  double total = 0., longest = 0.;
+  for (size_t i = 0; i < costs.size(); ++i) {
+    costs[i].case_path = "zoo/op/case_" + std::to_string(i) + ".pb";
+    costs[i].estimate = dist(gen);
+    total += costs[i].estimate;
+    longest = std::max(longest, costs[i].estimate);
+  }
+  auto reversed = costs;
+  std::reverse(reversed.begin(), reversed.end());
+
+  for (int total_shards : {1, 3, 8}) {
+    std::vector<int> owner(costs.size(), -1);
+    for (int shard = 0; shard < total_shards; ++shard) {
+      auto mine = mluoptest::shardCases(costs, shard, total_shards, 5);
+      auto mine_reversed =
+          mluoptest::shardCases(reversed, shard, total_shards, 5);
+      ASSERT_EQ(mine.size(), mine_reversed.size());
+      double load = 0.;
+      for (size_t k = 0; k < mine.size(); ++k) {
+        ASSERT_EQ(-1, owner[mine[k]]);
+        owner[mine[k]] = shard;
+        load += costs[mine[k]].estimate;
+        // the same cases whatever the listing order.
+        ASSERT_EQ(costs.size() - 1 - mine[k],
+                  mine_reversed[mine.size() - 1 - k]);
+      }
+      EXPECT_LE(load, total / total_shards + longest);
+    }
+    for (int shard : owner) ASSERT_NE(-1, shard);
+  }
+
+  // another history moves no case to another shard.
+  auto other_history = costs;
+  for (auto &cost : other_history) cost.seconds = dist(gen);
+  for (int shard = 0; shard < 8; ++shard) {
+    EXPECT_EQ(mluoptest::shardCases(costs, shard, 8, 5),
+              mluoptest::shardCases(other_history, shard, 8, 5));
+  }
+
+  // one case goes to the shard picked by the salt.
+  std::vector<mluoptest::CaseCost> one(1);
+  EXPECT_EQ(1, mluoptest::shardCases(one, 2, 4, 6).size());
+  EXPECT_EQ(0, mluoptest::shardCases(one, 0, 4, 6).size());
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_CASE_COST_TEST_H_
@@ -0,0 +1,100 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_CASE_PIPELINE_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_CASE_PIPELINE_TEST_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "case_pipeline.h"
+
+TEST(CASE_PIPELINE, every_case_through_every_stage_in_order) {
+  const size_t num = 200;
+  const size_t max_in_flight = 6;
+  std::vector<std::atomic<int>> done(num);
+  for (auto &d : done) d = 0;
+  std::atomic<int> in_flight(0), max_seen(0), inits(0), disorder(0);
+
+  mluoptest::CasePipeline pipeline(2, max_in_flight);
+  pipeline.setThreadInit([&]() { inits++; });
+  const size_t threads[] = {3, 1, 4, 2};
+  for (int s = 0; s < 4; ++s) {
+    pipeline.addStage("stage" + std::to_string(s), threads[s],
+                      [&, s](size_t idx) {
+                        if (s == 0) {
+                          int now = ++in_flight;
+                          int seen = max_seen;
+                          while (now > seen &&
+                                 !max_seen.compare_exchange_weak(seen, now)) {
+                          }
+                        }
+                        if (done[idx] != s) disorder++;
+                        if (idx % 7 == 0) {
+                          std::this_thread::sleep_for(
+                              std::chrono::microseconds(200));
+                        }
+                        done[idx] = s + 1;
+                        if (s == 3) in_flight--;
+                      });
+  }
+  pipeline.run(num);
+
+  EXPECT_EQ(0, disorder.load());
+  for (auto &d : done) ASSERT_EQ(4, d.load());
+  EXPECT_LE(max_seen.load(), (int)max_in_flight);
+  EXPECT_EQ(10, inits.load());
+  ASSERT_EQ(4u, pipeline.stats().size());
+  for (const auto &stats : pipeline.stats()) {
+    EXPECT_EQ(num, stats.cases) << stats.name;
+  }
+  EXPECT_NE(std::string::npos, pipeline.report().find("stage2"));
+}
+
+TEST(CASE_PIPELINE, stages_overlap) {
+  // 3 stages of 5 ms for 20 cases: 300 ms in sequence, about 110 ms when
+  // the stages overlap.
+  const size_t num = 20;
+  mluoptest::CasePipeline pipeline(1, 3);
+  for (int s = 0; s < 3; ++s) {
+    pipeline.addStage("sleep", 1, [](size_t) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    });
+  }
+  pipeline.run(num);
+  EXPECT_LT(pipeline.wallSeconds(), 0.2);
+  for (const auto &stats : pipeline.stats()) {
+    EXPECT_GE(stats.busy_s, 0.1);
+  }
+}
+
+TEST(CASE_PIPELINE, no_case) {
+  mluoptest::CasePipeline pipeline(4, 4);
+  pipeline.addStage("only", 2, [](size_t) { FAIL(); });
+  pipeline.run(0);
+  EXPECT_EQ(0u, pipeline.stats()[0].cases);
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_CASE_PIPELINE_TEST_H_
@@ -0,0 +1,436 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_DCN_CPU_ENGINE_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_DCN_CPU_ENGINE_TEST_H_
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "dcn_cpu_engine.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::uniformFloats;
+
+float dcnSample(const float *image, int hi, int wi, int ci, int c, float h,
+                float w) {
+  if (!(h > -1 && w > -1 && h < hi && w < wi)) return 0.0f;
+  const int h0 = floor(h), w0 = floor(w);
+  float v = 0.0f;
+  for (int dy = 0; dy < 2; ++dy) {
+    for (int dx = 0; dx < 2; ++dx) {
+      const int y = h0 + dy, x = w0 + dx;
+      if (y < 0 || x < 0 || y >= hi || x >= wi) continue;
+      const float wy = dy ? h - h0 : 1 - (h - h0);
+      const float wx = dx ? w - w0 : 1 - (w - w0);
+      v += wy * wx * image[(y * wi + x) * ci + c];
+    }
+  }
+  return v;
+}
+
+// The scalar reference, one output at a time over (kh, kw, ci / g).
+std::vector<float> dcnForwardScalar(const mluoptest::dcn_cpu::DcnShape &s,
+                                    int g, int co, const float *input,
+                                    const float *offset, const float *mask,
+                                    const float *weight) {
+  const int c_per_g = s.ci / g, co_per_g = co / g;
+  std::vector<float> output(static_cast<size_t>(s.n) * s.ho * s.wo * co);
+  for (int n = 0; n < s.n; ++n) {
+    const float *image = input + static_cast<size_t>(n) * s.hi * s.wi * s.ci;
+    for (int oh = 0; oh < s.ho; ++oh) {
+      for (int ow = 0; ow < s.wo; ++ow) {
+        const int row = (n * s.ho + oh) * s.wo + ow;
+        for (int o = 0; o < co; ++o) {
+          const int grp = o / co_per_g;
+          double acc = 0.0;
+          for (int kh = 0; kh < s.kh; ++kh) {
+            for (int kw = 0; kw < s.kw; ++kw) {
+              for (int c = 0; c < c_per_g; ++c) {
+                const int channel = grp * c_per_g + c;
+                const int point =
+                    (channel / (s.ci / s.dg) * s.kh + kh) * s.kw + kw;
+                const float *off = offset + (row * s.dg * s.kh * s.kw) * 2;
+                const float h = oh * s.sh - s.pt + kh * s.dh + off[point * 2];
+                const float w =
+                    ow * s.sw - s.pl + kw * s.dw + off[point * 2 + 1];
+                const float m =
+                    mask ? mask[row * s.dg * s.kh * s.kw + point] : 1.0f;
+                acc += dcnSample(image, s.hi, s.wi, s.ci, channel, h, w) * m *
+                       weight[((o * s.kh + kh) * s.kw + kw) * c_per_g + c];
+              }
+            }
+          }
+          output[static_cast<size_t>(row) * co + o] = acc;
+        }
+      }
+    }
+  }
+  return output;
+}
+
+// im2col of the whole batch and one GEMM per conv group, as in dcn_forward.
+std::vector<float> dcnForwardGemm(const mluoptest::dcn_cpu::DcnShape &s,
+                                  int g, int co, const float *input,
+                                  const float *offset, const float *mask,
+                                  const float *weight) {
+  const int m = s.n * s.ho * s.wo, k = s.kh * s.kw * s.ci / g, n = co / g;
+  std::vector<float> columns(static_cast<size_t>(m) * k * g);
+  std::vector<float> output(static_cast<size_t>(m) * co);
+  mluoptest::dcn_cpu::deformableIm2col(s, g, input, offset, mask,
+                                       columns.data());
+  for (int grp = 0; grp < g; ++grp) {
+    mluoptest::dcn_cpu::sgemm(false, true, m, n, k,
+                              columns.data() + (size_t)grp * m * k, k,
+                              weight + (size_t)grp * n * k, k, 0.0f,
+                              output.data() + grp * n, co);
+  }
+  return output;
+}
+
+struct DcnGrads {
+  std::vector<float> input, offset, mask;
+};
+
+// The scalar reference of backward data, the adjoint of dcnForwardScalar
+// taken one (output pixel, tap, channel) at a time. grad_mask is left at
+// zero without a mask.
+DcnGrads dcnBackwardDataScalar(const mluoptest::dcn_cpu::DcnShape &s, int g,
+                               int co, const float *input, const float *offset,
+                               const float *mask, const float *weight,
+                               const float *grad_output) {
+  const int c_per_g = s.ci / g, co_per_g = co / g, c_per_dg = s.ci / s.dg;
+  const int taps = s.kh * s.kw;
+  const size_t points = static_cast<size_t>(s.n) * s.ho * s.wo * s.dg * taps;
+  std::vector<double> grad_input(static_cast<size_t>(s.n) * s.hi * s.wi * s.ci);
+  std::vector<double> grad_offset(points * 2), grad_mask(points);
+  for (int n = 0; n < s.n; ++n) {
+    const size_t image = static_cast<size_t>(n) * s.hi * s.wi * s.ci;
+    for (int oh = 0; oh < s.ho; ++oh) {
+      for (int ow = 0; ow < s.wo; ++ow) {
+        const int row = (n * s.ho + oh) * s.wo + ow;
+        for (int tap = 0; tap < taps; ++tap) {
+          const int kh = tap / s.kw, kw = tap % s.kw;
+          for (int channel = 0; channel < s.ci; ++channel) {
+            const int grp = channel / c_per_g;
+            double top = 0.0;
+            for (int o = grp * co_per_g; o < (grp + 1) * co_per_g; ++o) {
+              top += (double)grad_output[static_cast<size_t>(row) * co + o] *
+                     weight[(o * taps + tap) * c_per_g + channel % c_per_g];
+            }
+            const size_t point =
+                (static_cast<size_t>(row) * s.dg + channel / c_per_dg) * taps +
+                tap;
+            const float h = oh * s.sh - s.pt + kh * s.dh + offset[point * 2];
+            const float w =
+                ow * s.sw - s.pl + kw * s.dw + offset[point * 2 + 1];
+            const double m = mask ? mask[point] : 1.0;
+            if (!(h > -1 && w > -1 && h < s.hi && w < s.wi)) continue;
+            const int h0 = floor(h), w0 = floor(w);
+            for (int dy = 0; dy < 2; ++dy) {
+              for (int dx = 0; dx < 2; ++dx) {
+                const int y = h0 + dy, x = w0 + dx;
+                if (y < 0 || x < 0 || y >= s.hi || x >= s.wi) continue;
+                const double wy = dy ? h - h0 : 1 - (h - h0);
+                const double wx = dx ? w - w0 : 1 - (w - w0);
+                const size_t at = image + (y * s.wi + x) * s.ci + channel;
+                const double v = input[at];
+                grad_input[at] += wy * wx * m * top;
+                if (mask) grad_mask[point] += wy * wx * v * top;
+                grad_offset[point * 2] += (dy ? wx : -wx) * v * m * top;
+                grad_offset[point * 2 + 1] += (dx ? wy : -wy) * v * m * top;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return {std::vector<float>(grad_input.begin(), grad_input.end()),
+          std::vector<float>(grad_offset.begin(), grad_offset.end()),
+          std::vector<float>(grad_mask.begin(), grad_mask.end())};
+}
+
+// One GEMM per conv group reading grad_output through lda, the grouped
+// columns interleaved back and col2img, as in dcn_backward_data.
+DcnGrads dcnBackwardDataGemm(const mluoptest::dcn_cpu::DcnShape &s, int g,
+                             int co, const float *input, const float *offset,
+                             const float *mask, const float *weight,
+                             const float *grad_output) {
+  const int m = s.n * s.ho * s.wo, k = s.kh * s.kw * s.ci / g, n = co / g;
+  const int c_per_g = s.ci / g;
+  std::vector<float> grouped(static_cast<size_t>(m) * k * g);
+  std::vector<float> columns(grouped.size());
+  for (int grp = 0; grp < g; ++grp) {
+    mluoptest::dcn_cpu::sgemm(false, false, m, k, n, grad_output + grp * n,
+                              co, weight + (size_t)grp * n * k, k, 0.0f,
+                              grouped.data() + (size_t)grp * m * k, k);
+  }
+  // [g, m * kh * kw, ci / g] to [m * kh * kw, g, ci / g]
+  for (size_t r = 0; r < static_cast<size_t>(m) * s.kh * s.kw; ++r) {
+    for (int grp = 0; grp < g; ++grp) {
+      const float *src = grouped.data() + (grp * m * s.kh * s.kw + r) * c_per_g;
+      std::copy(src, src + c_per_g, columns.data() + (r * g + grp) * c_per_g);
+    }
+  }
+  const size_t points = static_cast<size_t>(m) * s.dg * s.kh * s.kw;
+  DcnGrads grads = {
+      std::vector<float>(static_cast<size_t>(s.n) * s.hi * s.wi * s.ci),
+      std::vector<float>(points * 2), std::vector<float>(points)};
+  mluoptest::dcn_cpu::deformableCol2img(
+      s, columns.data(), input, offset, mask, grads.input.data(),
+      grads.offset.data(), mask ? grads.mask.data() : nullptr);
+  return grads;
+}
+
+// The scalar reference of backward weight, grad_weight starts at init.
+std::vector<float> dcnBackwardWeightScalar(
+    const mluoptest::dcn_cpu::DcnShape &s, int g, int co, const float *input,
+    const float *offset, const float *mask, const float *grad_output,
+    const std::vector<float> &init) {
+  const int c_per_g = s.ci / g, co_per_g = co / g, c_per_dg = s.ci / s.dg;
+  const int taps = s.kh * s.kw;
+  std::vector<float> grad_weight(init.size());
+  for (int o = 0; o < co; ++o) {
+    const int grp = o / co_per_g;
+    for (int tap = 0; tap < taps; ++tap) {
+      const int kh = tap / s.kw, kw = tap % s.kw;
+      for (int c = 0; c < c_per_g; ++c) {
+        const int channel = grp * c_per_g + c;
+        const size_t at = (static_cast<size_t>(o) * taps + tap) * c_per_g + c;
+        double acc = init[at];
+        for (int row = 0; row < s.n * s.ho * s.wo; ++row) {
+          const int n = row / (s.ho * s.wo);
+          const int oh = row / s.wo % s.ho, ow = row % s.wo;
+          const size_t point =
+              (static_cast<size_t>(row) * s.dg + channel / c_per_dg) * taps +
+              tap;
+          const float h = oh * s.sh - s.pt + kh * s.dh + offset[point * 2];
+          const float w =
+              ow * s.sw - s.pl + kw * s.dw + offset[point * 2 + 1];
+          const float m = mask ? mask[point] : 1.0f;
+          acc += (double)grad_output[static_cast<size_t>(row) * co + o] *
+                 dcnSample(input + static_cast<size_t>(n) * s.hi * s.wi * s.ci,
+                           s.hi, s.wi, s.ci, channel, h, w) *
+                 m;
+        }
+        grad_weight[at] = acc;
+      }
+    }
+  }
+  return grad_weight;
+}
+
+// im2col per step of s.n images and one GEMM per conv group reading
+// grad_output transposed through lda, summed into init with beta = 1, as
+// in dcn_backward_weight.
+std::vector<float> dcnBackwardWeightGemm(const mluoptest::dcn_cpu::DcnShape &s,
+                                         int batch, int g, int co,
+                                         const float *input,
+                                         const float *offset,
+                                         const float *mask,
+                                         const float *grad_output,
+                                         const std::vector<float> &init) {
+  const int k = s.n * s.ho * s.wo, m = co / g, n = s.kh * s.kw * s.ci / g;
+  const size_t points = static_cast<size_t>(k) * s.dg * s.kh * s.kw;
+  std::vector<float> columns(static_cast<size_t>(k) * n * g);
+  std::vector<float> grad_weight = init;
+  for (int step = 0; step < batch / s.n; ++step) {
+    mluoptest::dcn_cpu::deformableIm2col(
+        s, g, input + (size_t)step * s.n * s.hi * s.wi * s.ci,
+        offset + step * points * 2, mask ? mask + step * points : nullptr,
+        columns.data());
+    for (int grp = 0; grp < g; ++grp) {
+      mluoptest::dcn_cpu::sgemm(
+          true, false, m, n, k, grad_output + (size_t)step * k * co + grp * m,
+          co, columns.data() + (size_t)grp * k * n, n, 1.0f,
+          grad_weight.data() + (size_t)grp * m * n, n);
+    }
+  }
+  return grad_weight;
+}
+
+void expectClose(const std::vector<float> &expect,
+                 const std::vector<float> &actual, double rel) {
+  ASSERT_EQ(expect.size(), actual.size());
+  double diff = 0.0, norm = 0.0;
+  for (size_t i = 0; i < expect.size(); ++i) {
+    diff += fabs(expect[i] - actual[i]);
+    norm += fabs(expect[i]);
+  }
+  EXPECT_LE(diff, rel * norm + 1e-6);
+}
+
+// conv groups, deformable groups, ci, co and whether there is a mask.
+struct DcnSetting {
+  int g, dg, ci, co;
+  bool mask;
+};
+const DcnSetting kDcnSettings[] = {{1, 1, 8, 6, true},   {1, 2, 8, 5, false},
+                                   {2, 1, 8, 6, true},   {2, 4, 8, 4, true},
+                                   {4, 2, 12, 8, false}, {3, 2, 6, 9, true}};
+}  // namespace
+
+TEST(DCN_CPU_ENGINE, sgemm_matches_dot_products) {
+  const int m = 70, n = 300, k = 150;
+  for (int trans = 0; trans < 4; ++trans) {
+    const bool ta = trans & 1, tb = trans & 2;
+    // leading dims wider than the matrices, as for the grouped convs.
+    const int lda = (ta ? m : k) + 3, ldb = (tb ? k : n) + 5, ldc = n + 7;
+    const auto a = uniformFloats((ta ? k : m) * lda, -1, 1, trans);
+    const auto b = uniformFloats((tb ? n : k) * ldb, -1, 1, trans + 10);
+    for (float beta : {0.0f, 1.0f}) {
+      auto c = uniformFloats(m * ldc, -1, 1, 42);
+      auto expect = c;
+      for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+          double acc = beta * c[i * ldc + j];
+          for (int p = 0; p < k; ++p) {
+            acc += (double)(ta ? a[p * lda + i] : a[i * lda + p]) *
+                   (tb ? b[j * ldb + p] : b[p * ldb + j]);
+          }
+          expect[i * ldc + j] = acc;
+        }
+      }
+      mluoptest::dcn_cpu::sgemm(ta, tb, m, n, k, a.data(), lda, b.data(), ldb,
+                                beta, c.data(), ldc);
+      for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+          ASSERT_NEAR(expect[i * ldc + j], c[i * ldc + j], 1e-4)
+              << "trans " << trans << " beta " << beta;
+        }
+        // the padding of C is untouched
+        for (int j = n; j < ldc; ++j) {
+          ASSERT_EQ(expect[i * ldc + j], c[i * ldc + j]);
+        }
+      }
+    }
+  }
+}
+
+TEST(DCN_CPU_ENGINE, forward_matches_scalar_reference) {
+  for (const auto &st : kDcnSettings) {
+    mluoptest::dcn_cpu::DcnShape s = {2, 9, 7, st.ci, 5, 4, 3, 3,
+                                      1, 1, 2, 2, 1, 1, st.dg};
+    const auto input = uniformFloats(s.n * s.hi * s.wi * s.ci, -1, 1, 1);
+    // offsets large enough to leave the image and hit every border case
+    const auto offset =
+        uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw * 2, -3, 3, 2);
+    const auto mask =
+        uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw, 0, 1, 3);
+    const auto weight =
+        uniformFloats(st.co * s.kh * s.kw * s.ci / st.g, -1, 1, 4);
+    const float *m = st.mask ? mask.data() : nullptr;
+    expectClose(dcnForwardScalar(s, st.g, st.co, input.data(), offset.data(),
+                                 m, weight.data()),
+                dcnForwardGemm(s, st.g, st.co, input.data(), offset.data(), m,
+                               weight.data()),
+                1e-5);
+  }
+}
+
+TEST(DCN_CPU_ENGINE, backward_data_matches_scalar_reference) {
+  for (const auto &st : kDcnSettings) {
+    mluoptest::dcn_cpu::DcnShape s = {2, 9, 7, st.ci, 5, 4, 3, 3,
+                                      1, 1, 2, 2, 1, 1, st.dg};
+    const auto input = uniformFloats(s.n * s.hi * s.wi * s.ci, -1, 1, 1);
+    const auto offset =
+        uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw * 2, -3, 3, 2);
+    const auto mask =
+        uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw, 0, 1, 3);
+    const auto weight =
+        uniformFloats(st.co * s.kh * s.kw * s.ci / st.g, -1, 1, 4);
+    const auto grad_output =
+        uniformFloats(s.n * s.ho * s.wo * st.co, -1, 1, 5);
+    const float *m = st.mask ? mask.data() : nullptr;
+    const DcnGrads expect =
+        dcnBackwardDataScalar(s, st.g, st.co, input.data(), offset.data(), m,
+                              weight.data(), grad_output.data());
+    const DcnGrads actual =
+        dcnBackwardDataGemm(s, st.g, st.co, input.data(), offset.data(), m,
+                            weight.data(), grad_output.data());
+    expectClose(expect.input, actual.input, 1e-5);
+    expectClose(expect.offset, actual.offset, 1e-5);
+    expectClose(expect.mask, actual.mask, 1e-5);
+  }
+}
+
+TEST(DCN_CPU_ENGINE, backward_weight_matches_scalar_reference) {
+  for (const auto &st : kDcnSettings) {
+    // 4 images in im2col steps of 2, so grad_weight is accumulated over
+    // the steps on top of its initial value.
+    mluoptest::dcn_cpu::DcnShape s = {4, 9, 7, st.ci, 5, 4, 3, 3,
+                                      1, 1, 2, 2, 1, 1, st.dg};
+    const auto input = uniformFloats(s.n * s.hi * s.wi * s.ci, -1, 1, 1);
+    const auto offset =
+        uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw * 2, -3, 3, 2);
+    const auto mask =
+        uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw, 0, 1, 3);
+    const auto grad_output =
+        uniformFloats(s.n * s.ho * s.wo * st.co, -1, 1, 5);
+    const auto init =
+        uniformFloats(st.co * s.kh * s.kw * s.ci / st.g, -1, 1, 6);
+    const float *m = st.mask ? mask.data() : nullptr;
+    const auto expect =
+        dcnBackwardWeightScalar(s, st.g, st.co, input.data(), offset.data(),
+                                m, grad_output.data(), init);
+    mluoptest::dcn_cpu::DcnShape step = s;
+    step.n = 2;
+    expectClose(expect,
+                dcnBackwardWeightGemm(step, s.n, st.g, st.co, input.data(),
+                                      offset.data(), m, grad_output.data(),
+                                      init),
+                1e-5);
+  }
+}
+
+TEST(DISABLED_DCN_CPU_ENGINE, benchmark) {
+  // a ResNet-50 stage 3 layer with a smaller batch
+  mluoptest::dcn_cpu::DcnShape s = {2, 28, 28, 128, 28, 28, 3, 3,
+                                    1, 1, 1, 1, 1, 1, 1};
+  const int co = 128;
+  const auto input = uniformFloats(s.n * s.hi * s.wi * s.ci, -1, 1, 1);
+  const auto offset =
+      uniformFloats(s.n * s.ho * s.wo * s.dg * s.kh * s.kw * 2, -2, 2, 2);
+  const auto weight = uniformFloats(co * s.kh * s.kw * s.ci, -1, 1, 4);
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+  };
+  auto start = Clock::now();
+  const auto scalar = dcnForwardScalar(s, 1, co, input.data(), offset.data(),
+                                       nullptr, weight.data());
+  auto mid = Clock::now();
+  const auto gemm = dcnForwardGemm(s, 1, co, input.data(), offset.data(),
+                                   nullptr, weight.data());
+  auto end = Clock::now();
+  expectClose(scalar, gemm, 1e-5);
+  BenchmarkLine() << "dcn forward " << s.n << "x" << s.hi << "x" << s.wi << "x"
+                  << s.ci << " -> " << co << ": scalar " << ms(start, mid)
+                  << " ms, im2col + gemm " << ms(mid, end) << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_DCN_CPU_ENGINE_TEST_H_
@@ -0,0 +1,237 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_FLOAT_BATCH_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_FLOAT_BATCH_TEST_H_
+
+#include <chrono>  // NOLINT
+#include <numeric>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "tools.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+const int kFloatBatchRoundModes[] = {
+    mluoptest::ROUND_MODE_TO_ZERO,          mluoptest::ROUND_MODE_OFF_ZERO,
+    mluoptest::ROUND_MODE_UP,               mluoptest::ROUND_MODE_DOWN,
+    mluoptest::ROUND_MODE_NEAREST_OFF_ZERO, mluoptest::ROUND_MODE_NEAREST_EVEN,
+    mluoptest::ROUND_MODE_MATH,             mluoptest::ROUND_MODE_NO};
+
+// Every half against every half congruent to it modulo 16384, so that each
+// value shows up on both sides with all the special ones.
+void halfPairs(std::vector<int> *in_a, std::vector<int> *in_b) {
+  for (int a = 0; a <= UINT16_MAX; ++a) {
+    for (int b = a % 16384; b <= UINT16_MAX; b += 16384) {
+      in_a->push_back(a);
+      in_b->push_back(b);
+    }
+  }
+}
+
+bool isRegularFloat(int bits) {
+  const uint32_t abs = static_cast<uint32_t>(bits) & 0x7fffffff;
+  return abs != 0 && abs < 0x7f800000;
+}
+}  // namespace
+
+TEST(FLOAT_BATCH, half_same_as_scalar) {
+  std::vector<int> in_a, in_b;
+  halfPairs(&in_a, &in_b);
+  const size_t num = in_a.size();
+  std::vector<int> simd(num), scalar(num);
+  for (int ieee754 = 0; ieee754 < 2; ++ieee754) {
+    for (int round_mode : kFloatBatchRoundModes) {
+      mluoptest::float_mult_batch(in_a.data(), in_b.data(), simd.data(), num,
+                                  0, round_mode, ieee754);
+      mluoptest::float_mult_batch(in_a.data(), in_b.data(), scalar.data(),
+                                  num, 0, round_mode, ieee754, false);
+      for (size_t i = 0; i < num; ++i) {
+        const int expected =
+            mluoptest::float_mult(in_a[i], in_b[i], 0, round_mode, ieee754);
+        ASSERT_EQ(expected, simd[i])
+            << std::hex << "mult " << in_a[i] << " " << in_b[i] << std::dec
+            << ", round mode " << round_mode << ", ieee754 " << ieee754;
+        ASSERT_EQ(expected, scalar[i]);
+      }
+
+      mluoptest::float_add_batch(in_a.data(), in_b.data(), simd.data(), num,
+                                 0, round_mode, 0, ieee754);
+      mluoptest::float_add_batch(in_a.data(), in_b.data(), scalar.data(), num,
+                                 0, round_mode, 0, ieee754, false);
+      for (size_t i = 0; i < num; ++i) {
+        const int expected =
+            mluoptest::float_add(in_a[i], in_b[i], 0, round_mode, 0, ieee754);
+        ASSERT_EQ(expected, simd[i])
+            << std::hex << "add " << in_a[i] << " " << in_b[i] << std::dec
+            << ", round mode " << round_mode << ", ieee754 " << ieee754;
+        ASSERT_EQ(expected, scalar[i]);
+      }
+    }
+  }
+}
+
+TEST(FLOAT_BATCH, float_same_as_regular) {
+  // random bits, operands with close exponents (cancellation) and
+  // subnormals.
+  std::mt19937 gen(33);
+  std::vector<int> in_a, in_b;
+  for (int i = 0; i < 200003; ++i) {
+    uint32_t a = gen(), b = gen();
+    if (i % 3 == 0) {
+      b = (a & 0xff800000) ^ (gen() & 0x807fffff) ^ ((gen() % 40) << 23);
+    }
+    if (i % 7 == 0) a &= 0x807fffff;
+    if (i % 11 == 0) b &= 0x80ffffff;
+    in_a.push_back(static_cast<int>(a));
+    in_b.push_back(static_cast<int>(b));
+  }
+  const size_t num = in_a.size();
+  std::vector<int> simd(num), scalar(num);
+  for (int round_mode : kFloatBatchRoundModes) {
+    for (int is_mult = 0; is_mult < 2; ++is_mult) {
+      if (is_mult) {
+        mluoptest::float_mult_batch(in_a.data(), in_b.data(), simd.data(),
+                                    num, 1, round_mode, 1);
+        mluoptest::float_mult_batch(in_a.data(), in_b.data(), scalar.data(),
+                                    num, 1, round_mode, 1, false);
+      } else {
+        mluoptest::float_add_batch(in_a.data(), in_b.data(), simd.data(), num,
+                                   1, round_mode, 0, 1);
+        mluoptest::float_add_batch(in_a.data(), in_b.data(), scalar.data(),
+                                   num, 1, round_mode, 0, 1, false);
+      }
+      for (size_t i = 0; i < num; ++i) {
+        ASSERT_EQ(scalar[i], simd[i]);
+        // the regular functions do not take exact cancellation.
+        if (!isRegularFloat(in_a[i]) || !isRegularFloat(in_b[i]) ||
+            (!is_mult && in_a[i] == (in_b[i] ^ (int)0x80000000))) {
+          continue;
+        }
+        int up, down;
+        const int expected =
+            is_mult ? mluoptest::float_mult_regular(in_a[i], in_b[i], 1,
+                                                    round_mode, up, down)
+                    : mluoptest::float_add_regular(in_a[i], in_b[i], 1,
+                                                   round_mode, 0, up, down);
+        ASSERT_EQ(expected, simd[i])
+            << std::hex << in_a[i] << (is_mult ? " * " : " + ") << in_b[i]
+            << std::dec << ", round mode " << round_mode;
+      }
+    }
+  }
+
+  // the special values follow the half rules.
+  const int in_sa[] = {0x7f800000, 0x7f800000, (int)0xff800000, 0x7fc00000,
+                       0x3f800000, 0x7f7fffff};
+  const int in_sb[] = {0x3f800000, (int)0xff800000, (int)0x80000000,
+                       0x3f800000, (int)0xbf800000, 0x7f7fffff};
+  int add_ieee[6], add_sat[6], mult_ieee[6];
+  mluoptest::float_add_batch(in_sa, in_sb, add_ieee, 6, 1,
+                             mluoptest::ROUND_MODE_NEAREST_EVEN, 0, 1);
+  mluoptest::float_add_batch(in_sa, in_sb, add_sat, 6, 1,
+                             mluoptest::ROUND_MODE_NEAREST_EVEN, 0, 0);
+  mluoptest::float_mult_batch(in_sa, in_sb, mult_ieee, 6, 1,
+                              mluoptest::ROUND_MODE_NEAREST_EVEN, 1);
+  const int expected_add_ieee[] = {0x7f800000, 0x7f800001, (int)0xff800000,
+                                   0x7f800001, 0, 0x7f800000};
+  const int expected_add_sat[] = {0x7f7fffff, 0x7f7fffff, (int)0xff7fffff,
+                                  0x7f7fffff, 0, 0x7f7fffff};
+  const int expected_mult_ieee[] = {0x7f800000, (int)0xff800000, 0x7f800001,
+                                    0x7f800001, (int)0xbf800000, 0x7f800000};
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(expected_add_ieee[i], add_ieee[i]) << i;
+    EXPECT_EQ(expected_add_sat[i], add_sat[i]) << i;
+    EXPECT_EQ(expected_mult_ieee[i], mult_ieee[i]) << i;
+  }
+}
+
+// Every pair of halves, 2^32 per round mode and ieee754 setting. It takes
+// hours on the scalar functions, so it only runs on request.
+TEST(DISABLED_FLOAT_BATCH, half_all_pairs) {
+  for (int ieee754 = 0; ieee754 < 2; ++ieee754) {
+    for (int round_mode : kFloatBatchRoundModes) {
+      size_t mismatch = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : mismatch)
+      for (int a = 0; a <= UINT16_MAX; ++a) {
+        std::vector<int> in_a(UINT16_MAX + 1, a), in_b(UINT16_MAX + 1);
+        std::vector<int> mult(in_a.size()), add(in_a.size());
+        std::iota(in_b.begin(), in_b.end(), 0);
+        mluoptest::float_mult_batch(in_a.data(), in_b.data(), mult.data(),
+                                    in_a.size(), 0, round_mode, ieee754);
+        mluoptest::float_add_batch(in_a.data(), in_b.data(), add.data(),
+                                   in_a.size(), 0, round_mode, 0, ieee754);
+        for (int b = 0; b <= UINT16_MAX; ++b) {
+          mismatch += mult[b] != mluoptest::float_mult(a, b, 0, round_mode,
+                                                       ieee754);
+          mismatch += add[b] != mluoptest::float_add(a, b, 0, round_mode, 0,
+                                                     ieee754);
+        }
+      }
+      EXPECT_EQ(0, mismatch) << "round mode " << round_mode << ", ieee754 "
+                             << ieee754;
+    }
+  }
+}
+
+TEST(DISABLED_FLOAT_BATCH, benchmark) {
+  const size_t num = 1 << 22;
+  std::mt19937 gen(2024);
+  std::vector<int> in_a(num), in_b(num), dst(num);
+  for (size_t i = 0; i < num; ++i) {
+    in_a[i] = gen() & 0x7bff;
+    in_b[i] = gen() & 0xfbff;
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = mluoptest::float_mult(in_a[i], in_b[i], 0,
+                                   mluoptest::ROUND_MODE_NEAREST_EVEN, 1);
+  }
+  auto scalar = std::chrono::steady_clock::now();
+  mluoptest::float_mult_batch(in_a.data(), in_b.data(), dst.data(), num, 0,
+                              mluoptest::ROUND_MODE_NEAREST_EVEN, 1, false);
+  auto batch = std::chrono::steady_clock::now();
+  mluoptest::float_mult_batch(in_a.data(), in_b.data(), dst.data(), num, 0,
+                              mluoptest::ROUND_MODE_NEAREST_EVEN, 1);
+  auto simd = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = mluoptest::float_add(in_a[i], in_b[i], 0,
+                                  mluoptest::ROUND_MODE_NEAREST_EVEN, 0, 1);
+  }
+  auto add_scalar = std::chrono::steady_clock::now();
+  mluoptest::float_add_batch(in_a.data(), in_b.data(), dst.data(), num, 0,
+                             mluoptest::ROUND_MODE_NEAREST_EVEN, 0, 1);
+  auto add_simd = std::chrono::steady_clock::now();
+  auto rate = [num](std::chrono::steady_clock::time_point begin,
+                    std::chrono::steady_clock::time_point end) {
+    return num / std::chrono::duration<double>(end - begin).count() / 1e6;
+  };
+  BenchmarkLine() << "half mult: float_mult " << rate(start, scalar)
+                  << " M/s, batch without simd " << rate(scalar, batch)
+                  << " M/s, batch " << rate(batch, simd) << " M/s\n"
+                  << "half add: float_add " << rate(simd, add_scalar)
+                  << " M/s, batch " << rate(add_scalar, add_simd) << " M/s";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_FLOAT_BATCH_TEST_H_
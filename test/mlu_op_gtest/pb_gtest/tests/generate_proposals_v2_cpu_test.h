@@ -0,0 +1,179 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_GENERATE_PROPOSALS_V2_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_GENERATE_PROPOSALS_V2_CPU_TEST_H_
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <limits>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "generate_proposals_v2_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+namespace gp = mluoptest::generate_proposals_v2_cpu;
+
+struct GpImage {
+  int h, w, a;
+  std::vector<float> scores;     // [h, w, a]
+  std::vector<float> deltas;     // [h, w, a, 4]
+  std::vector<float> anchors;    // [h, w, a, 4]
+  std::vector<float> variances;  // [h, w, a, 4]
+  float im_shape[2];
+};
+
+// scores are drawn from levels values, so that many of them tie.
+GpImage gpImage(int h, int w, int a, int levels, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> level(0, levels - 1);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::normal_distribution<float> delta(0.0f, 0.4f);
+  GpImage img = {h, w, a, {}, {}, {}, {}, {64.0f + 8 * (seed % 5), 80.0f}};
+  const int n = h * w * a;
+  for (int i = 0; i < n; ++i) {
+    img.scores.push_back(static_cast<float>(level(gen)) / levels);
+    const float cx = u(gen) * img.im_shape[1];
+    const float cy = u(gen) * img.im_shape[0];
+    const float bw = 2.0f + u(gen) * 30.0f, bh = 2.0f + u(gen) * 30.0f;
+    const float anchor[4] = {cx - bw / 2, cy - bh / 2, cx + bw / 2,
+                             cy + bh / 2};
+    for (int k = 0; k < 4; ++k) {
+      img.anchors.push_back(anchor[k]);
+      img.deltas.push_back(delta(gen));
+      img.variances.push_back(k < 2 ? 0.1f : 0.2f);
+    }
+  }
+  return img;
+}
+
+void gpPropose(GpImage *img, bool legacy, bool use_variances, int pre_nms,
+               int post_nms, float nms_thresh, float min_size,
+               bool pixel_offset, gp::ImageProposals<float> *out) {
+  float *variances = use_variances ? img->variances.data() : nullptr;
+  if (legacy) {
+    // ProposalForOneImage clamps pre_nms_top_n before calling it
+    const int n = img->h * img->w * img->a;
+    const int pre = pre_nms <= 0 || pre_nms > n ? n : pre_nms;
+    gp::ProposalForOneImageLegacy(
+        img->scores.data(), img->deltas.data(), img->im_shape,
+        img->anchors.data(), variances, img->h, img->w, img->a, out, pre,
+        post_nms, nms_thresh, min_size, pixel_offset);
+  } else {
+    gp::ProposalForOneImage(img->scores.data(), img->deltas.data(),
+                            img->im_shape, img->anchors.data(), variances,
+                            img->h, img->w, img->a, out, pre_nms, post_nms,
+                            nms_thresh, min_size, pixel_offset);
+  }
+}
+
+// Bitwise, so that nan probabilities compare equal too.
+void gpExpectSame(const gp::ImageProposals<float> &ref,
+                  const gp::ImageProposals<float> &out) {
+  ASSERT_EQ(ref.probs.size(), out.probs.size());
+  ASSERT_EQ(ref.rois.size(), out.rois.size());
+  ASSERT_EQ(0, memcmp(ref.probs.data(), out.probs.data(),
+                      ref.probs.size() * sizeof(float)));
+  ASSERT_EQ(0, memcmp(ref.rois.data(), out.rois.data(),
+                      ref.rois.size() * sizeof(float)));
+}
+}  // namespace
+
+TEST(GENERATE_PROPOSALS_V2_CPU, matches_legacy) {
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> pick(0, 1 << 20);
+  int fast = 0, cases = 0;
+  for (int seed = 0; seed < 40; ++seed) {
+    for (int special = 0; special < 4; ++special) {
+      GpImage img = gpImage(3 + seed % 4, 4 + seed % 3, 1 + seed % 3,
+                            seed % 2 ? 4 : 1000, seed);
+      const int n = img.h * img.w * img.a;
+      // 0: plain, 1: -inf scores, 2: nan scores after the first,
+      // 3: a nan first score
+      for (int k = 0; special != 0 && k < 1 + n / 8; ++k) {
+        const int i = pick(gen) % n;
+        if (special == 1) img.scores[i] = -inf;
+        if (special == 2 && i > 0) img.scores[i] = nan;
+      }
+      if (special == 3) img.scores[0] = nan;
+      for (bool pixel_offset : {false, true}) {
+        for (float nms_thresh : {-0.5f, 0.0f, 0.3f, 0.7f, 1.0f}) {
+          for (int pre_nms : {-1, 0, 1, n / 3, n, n + 5}) {
+            const int post_nms = seed % 3 == 0 ? n : 1 + seed % 5;
+            const bool use_variances = (seed + special) % 2 == 0;
+            const float min_size = seed % 4 == 0 ? 4.0f : 0.5f;
+            gp::ImageProposals<float> ref, out;
+            gpPropose(&img, true, use_variances, pre_nms, post_nms,
+                      nms_thresh, min_size, pixel_offset, &ref);
+            gpPropose(&img, false, use_variances, pre_nms, post_nms,
+                      nms_thresh, min_size, pixel_offset, &out);
+            gpExpectSame(ref, out);
+            std::vector<int> ids;
+            const int pre = pre_nms <= 0 || pre_nms > n ? n : pre_nms;
+            fast += gp::topKScores(img.scores.data(), n, pre, &ids);
+            cases++;
+          }
+        }
+      }
+    }
+  }
+  // the -inf and nan-first images fall back to the legacy selection, the
+  // rest must take the fast path for the comparison to mean much
+  ASSERT_GT(fast, cases / 3);
+}
+
+TEST(GENERATE_PROPOSALS_V2_CPU, ties_keep_index_order) {
+  // all the scores tie: the legacy argmax takes the lowest index first
+  GpImage img = gpImage(4, 4, 2, 1, 3);
+  for (bool pixel_offset : {false, true}) {
+    gp::ImageProposals<float> ref, out;
+    gpPropose(&img, true, true, 10, 32, 1.0f, 0.0f, pixel_offset, &ref);
+    gpPropose(&img, false, true, 10, 32, 1.0f, 0.0f, pixel_offset, &out);
+    gpExpectSame(ref, out);
+    ASSERT_FALSE(out.probs.empty());
+  }
+}
+
+TEST(DISABLED_GENERATE_PROPOSALS_V2_CPU, benchmark) {
+  // 38 x 50 x 15 anchors of one image, 2000 before and 300 after nms
+  GpImage img = gpImage(38, 50, 15, 1 << 20, 1);
+  gp::ImageProposals<float> ref, out;
+  auto start = std::chrono::steady_clock::now();
+  gpPropose(&img, true, true, 2000, 300, 0.7f, 0.0f, true, &ref);
+  const double legacy_ms = elapsedMs(start);
+  start = std::chrono::steady_clock::now();
+  gpPropose(&img, false, true, 2000, 300, 0.7f, 0.0f, true, &out);
+  const double fast_ms = elapsedMs(start);
+  gpExpectSame(ref, out);
+  BenchmarkLine() << out.probs.size() << " proposals: legacy " << legacy_ms
+                  << " ms, top-k and greedy nms " << fast_ms << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_GENERATE_PROPOSALS_V2_CPU_TEST_H_
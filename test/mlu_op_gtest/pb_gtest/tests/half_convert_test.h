@@ -0,0 +1,232 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_HALF_CONVERT_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_HALF_CONVERT_TEST_H_
+
+#include <string.h>
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "half_convert.h"
+#include "math_half.h"
+#include "tools.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+const mluoptest::ConvertIsa kConvertIsas[] = {mluoptest::ConvertIsa::SCALAR,
+                                              mluoptest::ConvertIsa::AVX2,
+                                              mluoptest::ConvertIsa::AVX512};
+const mluoptest::HalfRounding kHalfRoundings[] = {
+    mluoptest::HalfRounding::NEAREST_EVEN,
+    mluoptest::HalfRounding::NEAREST_AWAY};
+
+uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+std::vector<uint16_t> allHalfBits() {
+  std::vector<uint16_t> all(UINT16_MAX + 1);
+  for (size_t i = 0; i < all.size(); ++i) all[i] = static_cast<uint16_t>(i);
+  return all;
+}
+
+// Every half, the midpoints between neighbouring halves, values around the
+// overflow threshold, tiny values and random bit patterns. The length is
+// not a multiple of the vector width so that the tails are covered.
+std::vector<float> floatToHalfInputs() {
+  std::vector<float> inputs;
+  for (uint32_t h = 0; h <= UINT16_MAX; ++h) {
+    const float value = mluoptest::halfToFloatScalar(h);
+    inputs.push_back(value);
+    if ((h & 0x7c00) != 0x7c00 && (h & 0x7fff) != 0x7bff) {
+      const float next = mluoptest::halfToFloatScalar(h + 1);
+      inputs.push_back((value + next) / 2);
+    }
+  }
+  for (float v : {65504.0f, 65519.996f, 65520.0f, 65536.0f, 1e10f,
+                   2.9802322e-8f, 2.9802326e-8f, 1e-30f, 1e-45f}) {
+    inputs.push_back(v);
+    inputs.push_back(-v);
+  }
+  std::mt19937 gen(32);
+  for (int i = 0; i < 100003; ++i) inputs.push_back(bitsFloat(gen()));
+  return inputs;
+}
+}  // namespace
+
+TEST(HALF_CONVERT, half_to_float_matches_f16c) {
+  using mluoptest::AlgoHalfToFloat;
+  const std::vector<uint16_t> all = allHalfBits();
+  for (uint16_t h : all) {
+    const float expected =
+        mluoptest::cvtHalfToFloatImpl<AlgoHalfToFloat::CPU_INTRINSIC>(h);
+    ASSERT_EQ(floatBits(expected),
+              floatBits(mluoptest::halfToFloatScalar(h)))
+        << std::hex << h;
+  }
+  for (auto isa : kConvertIsas) {
+    std::vector<float> dst(all.size());
+    mluoptest::convertHalfToFloat(dst.data(), all.data(), all.size() - 3,
+                                  isa);
+    for (size_t i = 0; i + 3 < all.size(); ++i) {
+      ASSERT_EQ(floatBits(mluoptest::halfToFloatScalar(all[i])),
+                floatBits(dst[i]))
+          << "isa " << static_cast<int>(isa) << ", half " << std::hex << i;
+    }
+  }
+}
+
+TEST(HALF_CONVERT, float_to_half_round_trip) {
+  for (uint32_t h = 0; h <= UINT16_MAX; ++h) {
+    const float value = mluoptest::halfToFloatScalar(h);
+    // NaN payloads are not kept by cvtFloatToHalf either.
+    const uint16_t expected =
+        (h & 0x7fff) > 0x7c00 ? ((h & 0x8000) | 0x7e00) : h;
+    EXPECT_EQ(expected,
+              static_cast<uint16_t>(mluoptest::cvtFloatToHalf(value)));
+    for (auto rounding : kHalfRoundings) {
+      EXPECT_EQ(expected, mluoptest::floatToHalfScalar(value, rounding))
+          << std::hex << h;
+    }
+  }
+}
+
+TEST(HALF_CONVERT, float_to_half_rounding) {
+  using mluoptest::HalfRounding;
+  using mluoptest::floatToHalfScalar;
+  // 1 + 2^-11 is halfway between 1 and 1 + 2^-10.
+  EXPECT_EQ(0x3c00, floatToHalfScalar(1.00048828125f,
+                                      HalfRounding::NEAREST_EVEN));
+  EXPECT_EQ(0x3c01, floatToHalfScalar(1.00048828125f,
+                                      HalfRounding::NEAREST_AWAY));
+  EXPECT_EQ(0xbc01, floatToHalfScalar(-1.00048828125f,
+                                      HalfRounding::NEAREST_AWAY));
+  // 1.5 * 2^-24 is halfway between the two smallest subnormals.
+  EXPECT_EQ(0x0002, floatToHalfScalar(bitsFloat(0x33c00000),
+                                      HalfRounding::NEAREST_EVEN));
+  EXPECT_EQ(0x0002, floatToHalfScalar(bitsFloat(0x33c00000),
+                                      HalfRounding::NEAREST_AWAY));
+  // 2^-25 is halfway between 0 and the smallest subnormal.
+  EXPECT_EQ(0x0000, floatToHalfScalar(bitsFloat(0x33000000),
+                                      HalfRounding::NEAREST_EVEN));
+  EXPECT_EQ(0x0001, floatToHalfScalar(bitsFloat(0x33000000),
+                                      HalfRounding::NEAREST_AWAY));
+  for (auto rounding : kHalfRoundings) {
+    EXPECT_EQ(0x7bff, floatToHalfScalar(65519.996f, rounding));
+    EXPECT_EQ(0x7c00, floatToHalfScalar(65520.0f, rounding));
+    EXPECT_EQ(0xfc00, floatToHalfScalar(-1e10f, rounding));
+  }
+
+  const std::vector<float> inputs = floatToHalfInputs();
+  for (float value : inputs) {
+    // cvtFloatToHalf also rounds to nearest even in the normal range.
+    const uint32_t abs = floatBits(value) & 0x7fffffff;
+    if (abs >= 0x38800000 && abs < 0x477fe000) {
+      ASSERT_EQ(static_cast<uint16_t>(mluoptest::cvtFloatToHalf(value)),
+                floatToHalfScalar(value, HalfRounding::NEAREST_EVEN))
+          << value;
+    }
+  }
+  for (auto rounding : kHalfRoundings) {
+    std::vector<uint16_t> expected(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      expected[i] = floatToHalfScalar(inputs[i], rounding);
+    }
+    for (auto isa : kConvertIsas) {
+      std::vector<uint16_t> dst(inputs.size());
+      mluoptest::convertFloatToHalf(dst.data(), inputs.data(), inputs.size(),
+                                    rounding, isa);
+      for (size_t i = 0; i < inputs.size(); ++i) {
+        ASSERT_EQ(expected[i], dst[i])
+            << "isa " << static_cast<int>(isa) << ", input " << inputs[i];
+      }
+    }
+  }
+}
+
+TEST(HALF_CONVERT, bfloat16) {
+  const std::vector<uint16_t> all = allHalfBits();
+  std::vector<float> inputs;
+  for (uint16_t b : all) {
+    EXPECT_EQ(floatBits(mluoptest::cvtBF16ToFloat(b)),
+              floatBits(mluoptest::bf16ToFloatScalar(b)));
+    inputs.push_back(mluoptest::bf16ToFloatScalar(b));
+  }
+  std::mt19937 gen(16);
+  for (int i = 0; i < 100003; ++i) inputs.push_back(bitsFloat(gen()));
+  // ties to even, in both directions.
+  EXPECT_EQ(0x3f80, mluoptest::floatToBF16Scalar(bitsFloat(0x3f808000)));
+  EXPECT_EQ(0x3f82, mluoptest::floatToBF16Scalar(bitsFloat(0x3f818000)));
+  EXPECT_EQ(0x7fc0, mluoptest::floatToBF16Scalar(bitsFloat(0xffc00001)));
+
+  for (auto isa : kConvertIsas) {
+    std::vector<float> floats(all.size());
+    mluoptest::convertBF16ToFloat(floats.data(), all.data(), all.size() - 5,
+                                  isa);
+    for (size_t i = 0; i + 5 < all.size(); ++i) {
+      ASSERT_EQ(floatBits(mluoptest::bf16ToFloatScalar(all[i])),
+                floatBits(floats[i]));
+    }
+    std::vector<uint16_t> dst(inputs.size());
+    mluoptest::convertFloatToBF16(dst.data(), inputs.data(), inputs.size(),
+                                  isa);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      ASSERT_EQ(mluoptest::floatToBF16Scalar(inputs[i]), dst[i])
+          << "isa " << static_cast<int>(isa) << ", input " << inputs[i];
+    }
+  }
+}
+
+TEST(DISABLED_HALF_CONVERT, benchmark) {
+  const size_t num = 1 << 26;
+  std::vector<float> floats(num);
+  std::vector<uint16_t> halves(num);
+  std::mt19937 gen(2024);
+  std::normal_distribution<float> dist(0.0f, 100.0f);
+  for (auto &v : floats) v = dist(gen);
+  for (auto isa : kConvertIsas) {
+    auto start = std::chrono::steady_clock::now();
+    mluoptest::convertFloatToHalf(halves.data(), floats.data(), num,
+                                  mluoptest::HalfRounding::NEAREST_AWAY, isa);
+    auto mid = std::chrono::steady_clock::now();
+    mluoptest::convertHalfToFloat(floats.data(), halves.data(), num, isa);
+    auto end = std::chrono::steady_clock::now();
+    const double to_half = std::chrono::duration<double>(mid - start).count();
+    const double to_float = std::chrono::duration<double>(end - mid).count();
+    BenchmarkLine() << "isa " << static_cast<int>(isa) << ": float to half "
+                    << num / to_half / 1e9 << " G/s, half to float "
+                    << num / to_float / 1e9 << " G/s";
+  }
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_HALF_CONVERT_TEST_H_
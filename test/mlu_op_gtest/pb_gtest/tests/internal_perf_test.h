@@ -0,0 +1,153 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_INTERNAL_PERF_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_INTERNAL_PERF_TEST_H_
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "internal_perf.h"
+
+namespace {
+mluoptest::GtestInternal internalPerfCase(const std::string &op_name,
+                                          double parse_ms, double wall_ms) {
+  mluoptest::GtestInternal gtest;
+  gtest.op_name = op_name;
+  gtest.peak_rss_bytes = 3 << 20;
+  gtest.spans_ms = {std::make_tuple("parse", 0., parse_ms),
+                    std::make_tuple("host_malloc", parse_ms, parse_ms + 1),
+                    std::make_tuple("host_malloc", wall_ms - 2, wall_ms)};
+  gtest.time_costs_ms = {std::make_tuple("before_parse", 0.),
+                         std::make_tuple("after_compute_diff", wall_ms)};
+  return gtest;
+}
+}  // namespace
+
+TEST(INTERNAL_PERF, span_durations) {
+  auto durations =
+      mluoptest::span_durations(internalPerfCase("abs", 4., 10.).spans_ms);
+  ASSERT_EQ(2, durations.size());
+  EXPECT_EQ("parse", std::get<0>(durations[0]));
+  EXPECT_DOUBLE_EQ(4., std::get<1>(durations[0]));
+  EXPECT_EQ("host_malloc", std::get<0>(durations[1]));
+  EXPECT_DOUBLE_EQ(3., std::get<1>(durations[1]));
+}
+
+TEST(INTERNAL_PERF, summary_per_op) {
+  mluoptest::TestInternalInfo info;
+  for (int i = 1; i <= 100; ++i) {
+    info.record_case("abs/case_" + std::to_string(i),
+                     internalPerfCase("abs", i, 1000. + i));
+  }
+  info.record_case("div/case_0", internalPerfCase("div", 7., 20.));
+  info.clear_cases();  // the summary is kept
+  auto summary = info.summarize();
+  ASSERT_EQ(2, summary.size());
+  const auto &parse = summary["abs"]["parse"];
+  EXPECT_EQ(100, parse.count);
+  EXPECT_DOUBLE_EQ(50., parse.p50);
+  EXPECT_DOUBLE_EQ(95., parse.p95);
+  EXPECT_DOUBLE_EQ(100., parse.max);
+  EXPECT_DOUBLE_EQ(5050., parse.total);
+  EXPECT_DOUBLE_EQ(1100., summary["abs"]["wall"].max);
+  EXPECT_DOUBLE_EQ(3., summary["abs"]["peak_rss_mb"].p95);
+  EXPECT_DOUBLE_EQ(7., summary["div"]["parse"].p95);
+  EXPECT_EQ(1, summary["div"]["host_malloc"].count);
+
+  const std::string json =
+      mluoptest::TestInternalInfo::summary_to_json(summary);
+  EXPECT_NE(std::string::npos,
+            json.find("\"div\": {\"host_malloc\": {\"count\": 1, \"p50\": "
+                      "3.000000"));
+  EXPECT_NE(std::string::npos,
+            mluoptest::TestInternalInfo::summary_to_table(summary).find(
+                "parse"));
+
+  info.clear_summary();
+  EXPECT_TRUE(info.summarize().empty());
+}
+
+TEST(INTERNAL_PERF, case_json) {
+  mluoptest::GtestInternalMsg msg;
+  msg.case_path_ = "zoo/abs/\"quoted\"\\case.pb";
+  msg.gtest_internal_ = internalPerfCase("abs", 4., 10.);
+  EXPECT_EQ(
+      "{\"case_path\": \"zoo/abs/\\\"quoted\\\"\\\\case.pb\", \"op_name\": "
+      "\"abs\", \"file_size_bytes\": 0, \"parse_time_s\": 0.000000, "
+      "\"peak_rss_bytes\": 3145728, \"spans_ms\": {\"parse\": 4.000000, "
+      "\"host_malloc\": 3.000000}, \"time_points_ms\": [[\"before_parse\", "
+      "0.000000], [\"after_compute_diff\", 10.000000]]}",
+      msg.serialize_to_json());
+}
+
+TEST(INTERNAL_PERF, record_from_threads_in_case_order) {
+  mluoptest::TestInternalInfo info;
+  const size_t thread_num = 8, case_num = 4000;
+  for (int round = 0; round < 2; ++round) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_num; ++t) {
+      threads.emplace_back([&info, t, thread_num, case_num]() {
+        for (size_t i = t; i < case_num; i += thread_num) {
+          // the later cases first, as the completion order is arbitrary.
+          const size_t idx = case_num - 1 - i;
+          auto gtest = internalPerfCase("abs", 1., 10. + idx);
+          gtest.case_index = idx;
+          info.record_case("abs/case_" + std::to_string(idx), gtest);
+        }
+      });
+    }
+    for (auto &thread : threads) thread.join();
+
+    size_t next = 0;
+    info.iterate_invoke([&next, &info](const mluoptest::GtestInternalMsg &m) {
+      EXPECT_EQ(next, m.gtest_internal_.case_index);
+      EXPECT_EQ("abs/case_" + std::to_string(next), m.case_path_);
+      ++next;
+      // the functor runs without the lock.
+      info.record_case("late", mluoptest::GtestInternal());
+    });
+    EXPECT_EQ(case_num, next);
+    info.clear_cases();
+  }
+  auto summary = info.summarize();
+  EXPECT_EQ(2 * case_num, summary["abs"]["wall"].count);
+  double seconds = 0.;
+  ASSERT_TRUE(info.case_wall_seconds("abs/case_7", &seconds));
+  EXPECT_DOUBLE_EQ(0.017, seconds);
+
+  // cases without index keep the order of recording.
+  for (int i = 0; i < 3; ++i) {
+    info.record_case("no_index_" + std::to_string(i),
+                     mluoptest::GtestInternal());
+  }
+  std::vector<std::string> paths;
+  info.iterate_invoke([&paths](const mluoptest::GtestInternalMsg &m) {
+    paths.push_back(m.case_path_);
+  });
+  EXPECT_EQ(std::vector<std::string>({"no_index_0", "no_index_1",
+                                      "no_index_2"}),
+            paths);
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_INTERNAL_PERF_TEST_H_
@@ -0,0 +1,186 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_MUTUAL_INFORMATION_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_MUTUAL_INFORMATION_CPU_TEST_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "mutual_information_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+using mluoptest::uniformFloats;
+namespace mi = mluoptest::mutual_information_cpu;
+
+// The row by row forward recursion the executor had.
+int64_t miForwardSerial(const mi::Lattice &l, const float *px,
+                        const float *py, float *p) {
+  int64_t ops = 1;
+  p[l.p(l.s_begin, l.t_begin)] = 0;
+  for (int s = l.s_begin + 1; s <= l.s_end; ++s) {
+    p[l.p(s, l.t_begin)] = mi::logAdd(
+        p[l.p(s - 1, l.t_begin)] + px[l.px(s - 1, l.t_begin)], -INFINITY,
+        &ops);
+    ops++;
+  }
+  for (int t = l.t_begin + 1; t <= l.t_end; ++t) {
+    p[l.p(l.s_begin, t)] = mi::logAdd(
+        -INFINITY, p[l.p(l.s_begin, t - 1)] + py[l.py(l.s_begin, t - 1)],
+        &ops);
+    ops++;
+  }
+  for (int s = l.s_begin + 1; s <= l.s_end; ++s) {
+    for (int t = l.t_begin + 1; t <= l.t_end; ++t) {
+      p[l.p(s, t)] = mi::logAdd(p[l.p(s - 1, t)] + px[l.px(s - 1, t)],
+                                p[l.p(s, t - 1)] + py[l.py(s, t - 1)], &ops);
+      ops += 2;
+    }
+  }
+  return ops;
+}
+
+// The row by row backward recursion the executor had.
+int64_t miPGradSerial(const mi::Lattice &l, const float *term1,
+                      const float *term2, float ans_grad, float *p) {
+  int64_t ops = 1;
+  p[l.p(l.s_end, l.t_end)] = ans_grad;
+  for (int t = l.t_end - 1; t >= l.t_begin; --t) {
+    p[l.p(l.s_end, t)] = term2[l.py(l.s_end, t)] * p[l.p(l.s_end, t + 1)];
+    ops++;
+  }
+  for (int s = l.s_end - 1; s >= l.s_begin; --s) {
+    p[l.p(s, l.t_end)] = term1[l.px(s, l.t_end)] * p[l.p(s + 1, l.t_end)];
+    ops++;
+  }
+  for (int s = l.s_end - 1; s >= l.s_begin; --s) {
+    for (int t = l.t_end - 1; t >= l.t_begin; --t) {
+      p[l.p(s, t)] = term1[l.px(s, t)] * p[l.p(s + 1, t)] +
+                     term2[l.py(s, t)] * p[l.p(s, t + 1)];
+      ops += 3;
+    }
+  }
+  return ops;
+}
+
+mi::Lattice miRandomBox(int S, int T, std::mt19937 *gen) {
+  std::uniform_int_distribution<int> s_dist(0, S), t_dist(0, T);
+  int s0 = s_dist(*gen), s1 = s_dist(*gen);
+  int t0 = t_dist(*gen), t1 = t_dist(*gen);
+  return {S, T, std::min(s0, s1), std::max(s0, s1), std::min(t0, t1),
+          std::max(t0, t1)};
+}
+}  // namespace
+
+TEST(MUTUAL_INFORMATION_CPU, forward_matches_serial) {
+  std::mt19937 gen(7);
+  for (int shape = 0; shape < 20; ++shape) {
+    const int S = 1 + gen() % 40, T = 1 + gen() % 300;
+    const mi::Lattice l = shape == 0 ? mi::Lattice{S, T, 0, S, 0, T}
+                                     : miRandomBox(S, T, &gen);
+    const auto px = uniformFloats(S * (T + 1), -30, 5, shape);
+    const auto py = uniformFloats((S + 1) * T, -30, 5, shape + 100);
+    std::vector<float> serial((S + 1) * (T + 1), 0.0f), wave(serial);
+    const int64_t serial_ops =
+        miForwardSerial(l, px.data(), py.data(), serial.data());
+    const int64_t wave_ops =
+        mi::forward(l, px.data(), py.data(), wave.data(), 0);
+    ASSERT_EQ(serial_ops, wave_ops);
+    ASSERT_EQ(0, memcmp(serial.data(), wave.data(),
+                        serial.size() * sizeof(float)));
+  }
+}
+
+TEST(MUTUAL_INFORMATION_CPU, p_grad_matches_serial) {
+  std::mt19937 gen(11);
+  for (int shape = 0; shape < 20; ++shape) {
+    const int S = 1 + gen() % 300, T = 1 + gen() % 40;
+    const mi::Lattice l = shape == 0 ? mi::Lattice{S, T, 0, S, 0, T}
+                                     : miRandomBox(S, T, &gen);
+    const auto term1 = uniformFloats(S * (T + 1), 0, 1, shape);
+    const auto term2 = uniformFloats((S + 1) * T, 0, 1, shape + 100);
+    std::vector<float> serial((S + 1) * (T + 1), 0.0f), wave(serial);
+    const int64_t serial_ops = miPGradSerial(l, term1.data(), term2.data(),
+                                             0.5f, serial.data());
+    const int64_t wave_ops =
+        mi::pGrad(l, term1.data(), term2.data(), 0.5f, wave.data(), 0);
+    ASSERT_EQ(serial_ops, wave_ops);
+    ASSERT_EQ(0, memcmp(serial.data(), wave.data(),
+                        serial.size() * sizeof(float)));
+  }
+}
+
+TEST(DISABLED_MUTUAL_INFORMATION_CPU, benchmark) {
+  // RNN-T sized lattices: forward and p_grad recursions of a batch of 32
+  const int B = 32, S = 500, T = 1000;
+  const mi::Lattice l = {S, T, 0, S, 0, T};
+  const int64_t px_size = S * (T + 1), py_size = (S + 1) * T;
+  const int64_t p_size = (S + 1) * (T + 1);
+  const auto px = uniformFloats(B * px_size, -5, 0, 1);
+  const auto py = uniformFloats(B * py_size, -5, 0, 2);
+  std::vector<float> serial(B * p_size, 0.0f), batch(serial), diagonal(serial);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < B; ++b) {
+    miForwardSerial(l, px.data() + b * px_size, py.data() + b * py_size,
+                    serial.data() + b * p_size);
+    miPGradSerial(l, px.data() + b * px_size, py.data() + b * py_size, 1.0f,
+                  serial.data() + b * p_size);
+  }
+  const double serial_ms = elapsedMs(start);
+
+  // parallel over the batch, each lattice row by row
+  start = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic)
+  for (int b = 0; b < B; ++b) {
+    mi::forward(l, px.data() + b * px_size, py.data() + b * py_size,
+                batch.data() + b * p_size);
+    mi::pGrad(l, px.data() + b * px_size, py.data() + b * py_size, 1.0f,
+              batch.data() + b * p_size);
+  }
+  const double batch_ms = elapsedMs(start);
+
+  // one lattice at a time, parallel over its anti-diagonals
+  start = std::chrono::steady_clock::now();
+  for (int b = 0; b < B; ++b) {
+    mi::forward(l, px.data() + b * px_size, py.data() + b * py_size,
+                diagonal.data() + b * p_size, 0);
+    mi::pGrad(l, px.data() + b * px_size, py.data() + b * py_size, 1.0f,
+              diagonal.data() + b * p_size, 0);
+  }
+  const double diagonal_ms = elapsedMs(start);
+  ASSERT_EQ(0, memcmp(serial.data(), batch.data(),
+                      serial.size() * sizeof(float)));
+  ASSERT_EQ(0, memcmp(serial.data(), diagonal.data(),
+                      serial.size() * sizeof(float)));
+  BenchmarkLine() << "row by row " << serial_ms << " ms, batch parallel "
+                  << batch_ms << " ms, anti-diagonals " << diagonal_ms << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_MUTUAL_INFORMATION_CPU_TEST_H_
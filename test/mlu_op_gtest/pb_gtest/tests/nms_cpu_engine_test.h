@@ -0,0 +1,142 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_NMS_CPU_ENGINE_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_NMS_CPU_ENGINE_TEST_H_
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "nms_cpu_engine.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+struct NmsEngineCase {
+  std::vector<float> boxes;  // x1, y1, x2, y2
+  std::vector<float> scores;
+  std::vector<mluoptest::nms_cpu::Bound> bounds;
+};
+
+NmsEngineCase makeNmsEngineCase(int num, float range, float max_size,
+                                uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> pos(0.0f, range);
+  std::uniform_real_distribution<float> size(0.0f, max_size);
+  // a few repeated scores so that the tie order is exercised too.
+  std::uniform_int_distribution<int> score(0, num / 4 + 1);
+  NmsEngineCase c;
+  for (int i = 0; i < num; ++i) {
+    float x1 = pos(gen), y1 = pos(gen);
+    float x2 = x1 + size(gen), y2 = y1 + size(gen);
+    c.boxes.insert(c.boxes.end(), {x1, y1, x2, y2});
+    c.scores.push_back(static_cast<float>(score(gen)));
+    c.bounds.push_back({x1, y1, x2, y2});
+  }
+  return c;
+}
+
+float nmsEngineIou(const float *a, const float *b) {
+  float w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+  float h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+  if (w < 0) w = 0;
+  if (h < 0) h = 0;
+  float inter = w * h;
+  float area_a = (a[2] - a[0]) * (a[3] - a[1]);
+  float area_b = (b[2] - b[0]) * (b[3] - b[1]);
+  return inter / (area_a + area_b - inter);
+}
+
+std::vector<int> nmsEngineBruteForce(const NmsEngineCase &c,
+                                     const std::vector<int> &order,
+                                     float thresh) {
+  std::vector<int> keep;
+  std::vector<uint8_t> suppressed(c.scores.size(), 0);
+  for (size_t r = 0; r < order.size(); ++r) {
+    int i = order[r];
+    if (suppressed[i]) continue;
+    keep.push_back(i);
+    for (size_t s = r + 1; s < order.size(); ++s) {
+      int j = order[s];
+      if (!suppressed[j] &&
+          nmsEngineIou(&c.boxes[4 * i], &c.boxes[4 * j]) > thresh) {
+        suppressed[j] = 1;
+      }
+    }
+  }
+  return keep;
+}
+}  // namespace
+
+TEST(NMS_CPU_ENGINE, same_keep_as_greedy) {
+  const float thresholds[] = {0.0f, 0.3f, 0.7f};
+  for (uint32_t seed = 0; seed < 8; ++seed) {
+    // dense, sparse and very large boxes.
+    NmsEngineCase c = makeNmsEngineCase(
+        600, seed % 2 ? 1000.0f : 100.0f, seed % 4 == 3 ? 900.0f : 30.0f,
+        seed);
+    std::vector<int> order(c.scores.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    mluoptest::nms_cpu::sortByScoreStable(c.scores.data(), &order);
+    auto overlap = [&c](int i, int j) {
+      return nmsEngineIou(&c.boxes[4 * i], &c.boxes[4 * j]);
+    };
+    for (float thresh : thresholds) {
+      auto expected = nmsEngineBruteForce(c, order, thresh);
+      EXPECT_EQ(expected,
+                mluoptest::nms_cpu::greedyNms(order, c.scores.size(), overlap,
+                                              thresh, c.bounds.data()));
+      EXPECT_EQ(expected, mluoptest::nms_cpu::greedyNms(
+                              order, c.scores.size(), overlap, thresh,
+                              nullptr));
+      auto limited = mluoptest::nms_cpu::greedyNms(
+          order, c.scores.size(), overlap, thresh, c.bounds.data(), 5);
+      expected.resize(std::min<size_t>(expected.size(), 5));
+      EXPECT_EQ(expected, limited);
+    }
+  }
+}
+
+TEST(DISABLED_NMS_CPU_ENGINE, benchmark) {
+  NmsEngineCase c = makeNmsEngineCase(20000, 4000.0f, 40.0f, 2024);
+  std::vector<int> order(c.scores.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  mluoptest::nms_cpu::sortByScoreStable(c.scores.data(), &order);
+  auto overlap = [&c](int i, int j) {
+    return nmsEngineIou(&c.boxes[4 * i], &c.boxes[4 * j]);
+  };
+  auto start = std::chrono::steady_clock::now();
+  auto expected = nmsEngineBruteForce(c, order, 0.5f);
+  auto mid = std::chrono::steady_clock::now();
+  auto binned = mluoptest::nms_cpu::greedyNms(order, c.scores.size(), overlap,
+                                              0.5f, c.bounds.data());
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_EQ(expected, binned);
+  using Ms = std::chrono::duration<double, std::milli>;
+  BenchmarkLine() << "greedy: " << Ms(mid - start).count() << " ms, binned: "
+                  << Ms(end - mid).count() << " ms, kept " << binned.size()
+                  << " boxes";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_NMS_CPU_ENGINE_TEST_H_
@@ -0,0 +1,278 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_PHILOX_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_PHILOX_TEST_H_
+
+#include <math.h>
+#include <string.h>
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "philox.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+uint64_t join(uint32_t hi, uint32_t lo) {
+  return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+
+// genUniform() before cvtUniform(), as written in philox_generator.h.
+void deviceReference(uint32_t key0, uint32_t key1, uint32_t *dst, int calls,
+                     uint32_t &offset_low, uint32_t &offset_high,
+                     int32_t thread_begin, int32_t &thread_acc,
+                     int32_t thread_cur_core) {
+  for (int call = 0; call < calls; ++call) {
+    for (int i = 0; i < 128; ++i) {
+      uint32_t ctr[4] = {offset_low, offset_high,
+                         static_cast<uint32_t>(thread_acc + thread_begin + i),
+                         0};
+      mluoptest::philox4x32(ctr, key0, key1);
+      memcpy(dst + call * 512 + 4 * i, ctr, sizeof(ctr));
+    }
+    uint32_t offset_tmp =
+        offset_low + (thread_acc == (thread_cur_core - 128) ? 1 : 0);
+    if (offset_low > offset_tmp) {
+      ++offset_high;
+    }
+    offset_low = offset_tmp;
+    thread_acc += 128;
+    thread_acc %= thread_cur_core;
+  }
+}
+
+std::vector<uint32_t> randomWords(size_t num, int seed) {
+  std::mt19937 gen(seed);
+  std::vector<uint32_t> words(num);
+  for (auto &w : words) w = gen();
+  // the ends of the ranges of u1 and u2.
+  const uint32_t ends[] = {0, 0xff, 0x100, 0xffffff00, 0xffffffff, 0x80000000,
+                           0x40000000, 0xc0000000, 0x20000000, 0x3fffffff};
+  for (size_t i = 0; i < 10; ++i) {
+    for (size_t j = 0; j < 10; ++j) {
+      words[2 * (10 * i + j)] = ends[i];
+      words[2 * (10 * i + j) + 1] = ends[j];
+    }
+  }
+  return words;
+}
+}  // namespace
+
+TEST(PHILOX, known_answers) {
+  // the Philox4x32-10 vectors of Random123.
+  const uint32_t ctrs[3][4] = {{0, 0, 0, 0},
+                               {0xffffffff, 0xffffffff, 0xffffffff,
+                                0xffffffff},
+                               {0x243f6a88, 0x85a308d3, 0x13198a2e,
+                                0x03707344}};
+  const uint32_t keys[3][2] = {
+      {0, 0}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+  const uint32_t expected[3][4] = {
+      {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+      {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+      {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  for (int t = 0; t < 3; ++t) {
+    uint32_t ctr[4];
+    memcpy(ctr, ctrs[t], sizeof(ctr));
+    mluoptest::philox4x32(ctr, keys[t][0], keys[t][1]);
+    for (bool use_simd : {false, true}) {
+      // 17 blocks so that the SIMD path has a full step and a tail.
+      uint32_t words[68];
+      mluoptest::philoxGenerate(words, 17, join(keys[t][1], keys[t][0]),
+                                join(ctrs[t][1], ctrs[t][0]),
+                                join(ctrs[t][3], ctrs[t][2]), false, use_simd);
+      for (int k = 0; k < 4; ++k) {
+        EXPECT_EQ(expected[t][k], ctr[k]) << t;
+        EXPECT_EQ(expected[t][k], words[k]) << t;
+      }
+      mluoptest::PhiloxEngine engine(join(keys[t][1], keys[t][0]),
+                                     join(ctrs[t][3], ctrs[t][2]),
+                                     join(ctrs[t][1], ctrs[t][0]));
+      uint32_t first[4];
+      engine.generate(first, 4, use_simd);
+      EXPECT_EQ(0, memcmp(expected[t], first, sizeof(first)));
+    }
+  }
+}
+
+TEST(PHILOX, simd_same_as_scalar) {
+  // offsets and subsequences crossing 2^32 and 2^64 within a SIMD step.
+  const uint64_t starts[] = {0, 0xfffffff5, 0xffffffffffffffc3};
+  for (uint64_t start : starts) {
+    for (bool step_subsequence : {false, true}) {
+      const size_t blocks = 1003;
+      std::vector<uint32_t> scalar(4 * blocks), simd(4 * blocks);
+      mluoptest::philoxGenerate(scalar.data(), blocks, 0x123456789ull, start,
+                                start + 5, step_subsequence, false);
+      mluoptest::philoxGenerate(simd.data(), blocks, 0x123456789ull, start,
+                                start + 5, step_subsequence, true);
+      ASSERT_EQ(scalar, simd);
+      // and the same as block by block.
+      for (size_t j = 0; j < blocks; j += 97) {
+        uint32_t ctr[4];
+        const uint64_t offset = step_subsequence ? start : start + j;
+        const uint64_t subsequence = start + 5 + (step_subsequence ? j : 0);
+        ctr[0] = static_cast<uint32_t>(offset);
+        ctr[1] = static_cast<uint32_t>(offset >> 32);
+        ctr[2] = static_cast<uint32_t>(subsequence);
+        ctr[3] = static_cast<uint32_t>(subsequence >> 32);
+        mluoptest::philox4x32(ctr, 0x23456789, 0x1);
+        ASSERT_EQ(0, memcmp(ctr, &scalar[4 * j], sizeof(ctr))) << j;
+      }
+    }
+  }
+
+  const std::vector<uint32_t> words = randomWords(100007 - 1, 35);
+  std::vector<float> scalar(words.size()), simd(words.size());
+  mluoptest::philoxWordsToUniform(scalar.data(), words.data(), words.size(),
+                                  -3.0f, 7.0f, false);
+  mluoptest::philoxWordsToUniform(simd.data(), words.data(), words.size(),
+                                  -3.0f, 7.0f, true);
+  ASSERT_EQ(0, memcmp(scalar.data(), simd.data(), 4 * words.size()));
+  mluoptest::philoxWordsToNormal(scalar.data(), words.data(), words.size(),
+                                 1.0f, 2.0f, false);
+  mluoptest::philoxWordsToNormal(simd.data(), words.data(), words.size(),
+                                 1.0f, 2.0f, true);
+  ASSERT_EQ(0, memcmp(scalar.data(), simd.data(), 4 * words.size()));
+}
+
+TEST(PHILOX, blocks_same_as_generate) {
+  // philoxBlock and philoxBlocks walk the offsets of subsequence 0.
+  const uint64_t seed = 0x123456789ull, start = 0xfffffffb;
+  const int num = 3 * mluoptest::kPhiloxLanes;
+  std::vector<uint32_t> words(4 * num);
+  mluoptest::philoxGenerate(words.data(), num, seed, start, 0, false);
+  for (int group = 0; group < num; group += mluoptest::kPhiloxLanes) {
+    uint32_t lanes[4][mluoptest::kPhiloxLanes];
+    mluoptest::philoxBlocks(seed, start + group, lanes);
+    for (int j = 0; j < mluoptest::kPhiloxLanes; ++j) {
+      uint32_t block[4];
+      mluoptest::philoxBlock(seed, start + group + j, block);
+      for (int k = 0; k < 4; ++k) {
+        ASSERT_EQ(words[4 * (group + j) + k], block[k]);
+        ASSERT_EQ(words[4 * (group + j) + k], lanes[k][j]);
+      }
+    }
+  }
+}
+
+TEST(PHILOX, skip_ahead) {
+  mluoptest::PhiloxEngine whole(7, 3), skipped(7, 3);
+  std::vector<uint32_t> all(4000), tail(1000);
+  whole.generate(all.data(), all.size());
+  skipped.skip(750);
+  skipped.generate(tail.data(), tail.size());
+  EXPECT_EQ(1000u, skipped.offset());
+  EXPECT_EQ(0, memcmp(&all[3000], tail.data(), 4 * tail.size()));
+
+  // a word count that is not a multiple of 4 drops the rest of the block.
+  mluoptest::PhiloxEngine partial(7, 3);
+  uint32_t first[6];
+  partial.generate(first, 6);
+  EXPECT_EQ(2u, partial.offset());
+  EXPECT_EQ(0, memcmp(all.data(), first, sizeof(first)));
+}
+
+TEST(PHILOX, device_stream) {
+  const int calls = 21;
+  for (int32_t thread_cur_core : {128, 512, 1024}) {
+    for (bool use_simd : {false, true}) {
+      uint32_t offset_low = 0xfffffffe, offset_high = 5;
+      int32_t thread_acc = 256 % thread_cur_core;
+      std::vector<uint32_t> expected(calls * 512), words(calls * 512);
+      mluoptest::PhiloxDeviceState state = {
+          0x9abc, 0xdef0, join(offset_high, offset_low), 1024, thread_acc,
+          thread_cur_core};
+      deviceReference(0x9abc, 0xdef0, expected.data(), calls, offset_low,
+                      offset_high, 1024, thread_acc, thread_cur_core);
+      mluoptest::philoxDeviceGenerate(&state, words.data(), words.size(),
+                                      use_simd);
+      ASSERT_EQ(expected, words) << thread_cur_core;
+      EXPECT_EQ(join(offset_high, offset_low), state.offset);
+      EXPECT_EQ(thread_acc, state.thread_acc);
+    }
+  }
+
+  // cvtUniform: the low 23 bits scaled by 2^-23, then range * u + min.
+  mluoptest::PhiloxDeviceState state = {1, 2, 0, 0, 0, 256};
+  std::vector<uint32_t> words(1024);
+  std::vector<float> values(1024);
+  mluoptest::PhiloxDeviceState copy = state;
+  mluoptest::philoxDeviceGenerate(&copy, words.data(), words.size());
+  mluoptest::philoxDeviceUniform(&state, values.data(), values.size(), -2.0f,
+                                 3.0f);
+  for (size_t i = 0; i < words.size(); ++i) {
+    const float unit = (words[i] & 0x7fffff) / 8388608.0f;
+    ASSERT_EQ(fmaf(unit, 5.0f, -2.0f), values[i]);
+    ASSERT_TRUE(values[i] >= -2.0f && values[i] < 3.0f);
+  }
+}
+
+TEST(PHILOX, normal) {
+  const std::vector<uint32_t> words = randomWords(1 << 20, 36);
+  std::vector<float> values(words.size());
+  mluoptest::philoxWordsToNormal(values.data(), words.data(), words.size(),
+                                 0.0f, 1.0f);
+  double sum = 0, sum2 = 0;
+  for (size_t i = 0; i < words.size(); i += 2) {
+    // Box-Muller in double on the same words.
+    const double u1 = ((words[i] >> 8) + 1) / 16777216.0;
+    const double u2 = (words[i + 1] >> 8) / 16777216.0;
+    const double radius = sqrt(-2.0 * log(u1));
+    const double c = radius * cos(2 * M_PI * u2);
+    const double s = radius * sin(2 * M_PI * u2);
+    ASSERT_NEAR(c, values[i], 2e-6 * (1 + radius)) << i;
+    ASSERT_NEAR(s, values[i + 1], 2e-6 * (1 + radius)) << i;
+    sum += values[i] + values[i + 1];
+    sum2 += values[i] * values[i] + values[i + 1] * values[i + 1];
+  }
+  EXPECT_NEAR(0.0, sum / words.size(), 0.005);
+  EXPECT_NEAR(1.0, sum2 / words.size(), 0.01);
+}
+
+TEST(DISABLED_PHILOX, benchmark) {
+  const size_t num = 1 << 26;
+  std::vector<uint32_t> words(num);
+  std::vector<float> values(num);
+  for (bool use_simd : {false, true}) {
+    mluoptest::PhiloxEngine engine(2024);
+    auto start = std::chrono::steady_clock::now();
+    engine.generate(words.data(), num, use_simd);
+    auto generated = std::chrono::steady_clock::now();
+    engine.uniform(values.data(), num, 0.0f, 1.0f, use_simd);
+    auto uniform = std::chrono::steady_clock::now();
+    engine.normal(values.data(), num, 0.0f, 1.0f, use_simd);
+    auto normal = std::chrono::steady_clock::now();
+    auto rate = [num](std::chrono::steady_clock::time_point begin,
+                      std::chrono::steady_clock::time_point end) {
+      return num / std::chrono::duration<double>(end - begin).count() / 1e6;
+    };
+    BenchmarkLine() << (use_simd ? "simd" : "scalar") << ": uint32 "
+                    << rate(start, generated) << " M/s, uniform "
+                    << rate(generated, uniform) << " M/s, normal "
+                    << rate(uniform, normal) << " M/s";
+  }
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_PHILOX_TEST_H_
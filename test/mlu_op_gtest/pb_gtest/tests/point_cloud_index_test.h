@@ -0,0 +1,291 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_POINT_CLOUD_INDEX_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_POINT_CLOUD_INDEX_TEST_H_
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "point_cloud_index.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+// clustered points on a coarse lattice, so that equal distances (ties)
+// show up, plus a few duplicates and non-finite points.
+std::vector<float> makePointCloud(int n, float range, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> pos(0.0f, range);
+  std::uniform_int_distribution<int> lattice(0, 20);
+  std::normal_distribution<float> cluster(0.0f, range / 50);
+  std::vector<float> xyz;
+  for (int i = 0; i < n; ++i) {
+    if (i % 5 == 0) {
+      for (int a = 0; a < 3; ++a) xyz.push_back(lattice(gen) * range / 20);
+    } else if (i % 5 == 1 && i > 10) {
+      xyz.insert(xyz.end(), xyz.begin() + 3 * (i - 7),
+                 xyz.begin() + 3 * (i - 6));
+    } else {
+      const float c = pos(gen);
+      for (int a = 0; a < 3; ++a) xyz.push_back(c + cluster(gen));
+    }
+  }
+  xyz[3 * (n / 2)] = NAN;
+  xyz[3 * (n / 3) + 1] = INFINITY;
+  return xyz;
+}
+
+// ball_query, as the plain loop over every point.
+std::vector<int> ballQueryBruteForce(const std::vector<float> &xyz,
+                                     const float *q, float min_radius,
+                                     float max_radius, int nsample) {
+  const float min_radius2 = min_radius * min_radius;
+  const float max_radius2 = max_radius * max_radius;
+  std::vector<int> idx(nsample, 0);
+  int record_idx = 0;
+  for (int col = 0; col < static_cast<int>(xyz.size() / 3); ++col) {
+    float sub_x = q[0] - xyz[col * 3 + 0];
+    float sub_y = q[1] - xyz[col * 3 + 1];
+    float sub_z = q[2] - xyz[col * 3 + 2];
+    float distance2 = sub_x * sub_x + sub_y * sub_y + sub_z * sub_z;
+    if (distance2 == 0 ||
+        (distance2 >= min_radius2 && distance2 < max_radius2)) {
+      if (record_idx == 0) std::fill(idx.begin(), idx.end(), col);
+      idx[record_idx++] = col;
+      if (record_idx >= nsample) break;
+    }
+  }
+  return idx;
+}
+
+std::vector<int> ballQueryGrid(const mluoptest::point_cloud::PointGrid &grid,
+                               const float *q, float min_radius,
+                               float max_radius, int nsample) {
+  const float min_radius2 = min_radius * min_radius;
+  const float max_radius2 = max_radius * max_radius;
+  std::vector<int> in_ball;
+  grid.forEachNear(q, max_radius, [&](int col, float x, float y, float z) {
+    float d = mluoptest::point_cloud::distance2(q[0], q[1], q[2], x, y, z);
+    if (d == 0 || (d >= min_radius2 && d < max_radius2)) {
+      in_ball.push_back(col);
+    }
+  });
+  std::sort(in_ball.begin(), in_ball.end());
+  std::vector<int> idx(nsample, in_ball.empty() ? 0 : in_ball[0]);
+  for (int i = 0; i < nsample && i < static_cast<int>(in_ball.size()); ++i) {
+    idx[i] = in_ball[i];
+  }
+  return idx;
+}
+
+// three_nn_forward, as the plain loop over every point.
+void threeNnBruteForce(const std::vector<float> &known, const float *q,
+                       int *besti, float *best) {
+  double best1 = 1e40, best2 = 1e40, best3 = 1e40;
+  int besti1 = 0, besti2 = 0, besti3 = 0;
+  for (int k = 0; k < static_cast<int>(known.size() / 3); ++k) {
+    float x = known[k * 3 + 0], y = known[k * 3 + 1], z = known[k * 3 + 2];
+    double d = (q[0] - x) * (q[0] - x) + (q[1] - y) * (q[1] - y) +
+               (q[2] - z) * (q[2] - z);
+    if (d < best1) {
+      best3 = best2, besti3 = besti2;
+      best2 = best1, besti2 = besti1;
+      best1 = d, besti1 = k;
+    } else if (d < best2) {
+      best3 = best2, besti3 = besti2;
+      best2 = d, besti2 = k;
+    } else if (d < best3) {
+      best3 = d, besti3 = k;
+    }
+  }
+  best[0] = float(best1), best[1] = float(best2), best[2] = float(best3);
+  besti[0] = besti1, besti[1] = besti2, besti[2] = besti3;
+}
+
+void threeNnGrid(const mluoptest::point_cloud::PointGrid &grid,
+                 const float *q, int *besti, float *best) {
+  std::fill(besti, besti + 3, 0);
+  std::fill(best, best + 3, INFINITY);
+  grid.nearest(q, 3, besti, best);
+}
+
+bool pointInBox(const float *pt, const float *box) {
+  if (fabsf(pt[2] - box[2]) > box[5] / 2.0) return false;
+  float cosa = cos(-box[6]), sina = sin(-box[6]);
+  float sx = pt[0] - box[0], sy = pt[1] - box[1];
+  float local_x = sx * cosa + sy * (-sina);
+  float local_y = sx * sina + sy * cosa;
+  return fabs(local_x) < box[3] / 2.0 + 1e-5 &&
+         fabs(local_y) < box[4] / 2.0 + 1e-5;
+}
+
+std::vector<float> makeBoxes(int num, float range, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> pos(0.0f, range);
+  std::uniform_real_distribution<float> size(0.1f, range / 10);
+  std::uniform_real_distribution<float> heading(-3.2f, 3.2f);
+  std::vector<float> boxes;
+  for (int i = 0; i < num; ++i) {
+    boxes.insert(boxes.end(), {pos(gen), pos(gen), pos(gen), size(gen),
+                               size(gen), size(gen), heading(gen)});
+  }
+  boxes[7 * 3 + 3] = NAN;
+  boxes[7 * 5 + 4] = INFINITY;  // holds every point at its height
+  return boxes;
+}
+}  // namespace
+
+TEST(POINT_CLOUD_INDEX, ball_query_same_as_brute_force) {
+  const std::vector<float> xyz = makePointCloud(3000, 10.0f, 41);
+  const std::vector<float> queries = makePointCloud(400, 12.0f, 42);
+  mluoptest::point_cloud::PointGrid grid;
+  grid.build(xyz.data(), xyz.size() / 3);
+  EXPECT_EQ(2998, grid.size());
+  const float radii[][2] = {{0.0f, 0.3f}, {0.2f, 1.0f}, {0.0f, 0.0f},
+                            {0.5f, -0.7f}, {0.0f, 100.0f}, {0.0f, INFINITY}};
+  for (const auto &r : radii) {
+    for (int nsample : {1, 5, 32}) {
+      for (size_t i = 0; i < queries.size() / 3; ++i) {
+        const float *q = &queries[3 * i];
+        ASSERT_EQ(ballQueryBruteForce(xyz, q, r[0], r[1], nsample),
+                  ballQueryGrid(grid, q, r[0], r[1], nsample))
+            << "query " << i << ", radius " << r[0] << " " << r[1];
+      }
+    }
+  }
+}
+
+TEST(POINT_CLOUD_INDEX, three_nn_same_as_brute_force) {
+  for (int n : {0, 1, 2, 3, 50, 5000}) {
+    const std::vector<float> known =
+        n > 5 ? makePointCloud(n, 10.0f, n) : std::vector<float>(n * 3, 1.5f);
+    const std::vector<float> queries = makePointCloud(500, 14.0f, 43);
+    mluoptest::point_cloud::PointGrid grid;
+    grid.build(known.data(), n);
+    for (size_t i = 0; i < queries.size() / 3; ++i) {
+      int expected_idx[3], idx[3];
+      float expected[3], dist[3];
+      threeNnBruteForce(known, &queries[3 * i], expected_idx, expected);
+      threeNnGrid(grid, &queries[3 * i], idx, dist);
+      for (int k = 0; k < 3; ++k) {
+        ASSERT_EQ(expected_idx[k], idx[k]) << "n " << n << ", query " << i;
+        ASSERT_EQ(expected[k], dist[k]) << "n " << n << ", query " << i;
+      }
+    }
+  }
+}
+
+TEST(POINT_CLOUD_INDEX, first_box_same_as_brute_force) {
+  const std::vector<float> boxes = makeBoxes(300, 50.0f, 44);
+  const std::vector<float> points = makePointCloud(4000, 50.0f, 45);
+  mluoptest::point_cloud::RotatedBoxIndex index;
+  index.build(boxes.data(), boxes.size() / 7, 1e-5f);
+  int inside = 0;
+  for (size_t p = 0; p < points.size() / 3; ++p) {
+    const float *pt = &points[3 * p];
+    int expected = -1;
+    for (int m = 0; m < static_cast<int>(boxes.size() / 7); ++m) {
+      if (pointInBox(pt, &boxes[7 * m])) {
+        expected = m;
+        break;
+      }
+    }
+    const int m = index.first(pt[0], pt[1], [&](int box) {
+      return pointInBox(pt, &boxes[7 * box]);
+    });
+    ASSERT_EQ(expected, m) << "point " << p;
+    inside += m >= 0;
+  }
+  EXPECT_GT(inside, 50);
+}
+
+TEST(DISABLED_POINT_CLOUD_INDEX, benchmark) {
+  const int n = 100000, queries = 10000;
+  const std::vector<float> xyz = makePointCloud(n, 50.0f, 2024);
+  const std::vector<float> q = makePointCloud(queries, 50.0f, 2025);
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+  };
+
+  auto start = Clock::now();
+  for (int i = 0; i < queries; ++i) {
+    ballQueryBruteForce(xyz, &q[3 * i], 0.0f, 0.8f, 32);
+  }
+  auto brute = Clock::now();
+  mluoptest::point_cloud::PointGrid grid;
+  grid.build(xyz.data(), n);
+  auto built = Clock::now();
+  for (int i = 0; i < queries; ++i) {
+    ballQueryGrid(grid, &q[3 * i], 0.0f, 0.8f, 32);
+  }
+  auto indexed = Clock::now();
+  BenchmarkLine() << "ball_query " << n << " points, " << queries
+                  << " queries: brute force " << ms(start, brute)
+                  << " ms, grid " << ms(brute, built) << " + "
+                  << ms(built, indexed) << " ms";
+
+  int idx[3];
+  float dist[3];
+  start = Clock::now();
+  for (int i = 0; i < queries; ++i) {
+    threeNnBruteForce(xyz, &q[3 * i], idx, dist);
+  }
+  brute = Clock::now();
+  for (int i = 0; i < queries; ++i) threeNnGrid(grid, &q[3 * i], idx, dist);
+  indexed = Clock::now();
+  BenchmarkLine() << "three_nn: brute force " << ms(start, brute)
+                  << " ms, grid " << ms(brute, indexed) << " ms";
+
+  const std::vector<float> boxes = makeBoxes(5000, 50.0f, 2026);
+  start = Clock::now();
+  int inside = 0;
+  for (int p = 0; p < n; ++p) {
+    for (int m = 0; m < 5000; ++m) {
+      if (pointInBox(&xyz[3 * p], &boxes[7 * m])) {
+        inside++;
+        break;
+      }
+    }
+  }
+  brute = Clock::now();
+  mluoptest::point_cloud::RotatedBoxIndex index;
+  index.build(boxes.data(), 5000, 1e-5f);
+  int indexed_inside = 0;
+  for (int p = 0; p < n; ++p) {
+    indexed_inside += index.first(xyz[3 * p], xyz[3 * p + 1], [&](int box) {
+      return pointInBox(&xyz[3 * p], &boxes[7 * box]);
+    }) >= 0;
+  }
+  indexed = Clock::now();
+  EXPECT_EQ(inside, indexed_inside);
+  BenchmarkLine() << "points_in_boxes " << n
+                  << " points, 5000 boxes: brute force " << ms(start, brute)
+                  << " ms, grid " << ms(brute, indexed) << " ms (" << inside
+                  << " inside)";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_POINT_CLOUD_INDEX_TEST_H_
@@ -0,0 +1,222 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_RANDOM_DATA_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_RANDOM_DATA_TEST_H_
+
+#include <string.h>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "random_data.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+using mluoptest::BenchmarkLine;
+mluoptest::RandomData uniformParam(double lower, double upper, int seed) {
+  mluoptest::RandomData param;
+  param.set_distribution(mluoptest::UNIFORM);
+  param.set_lower_bound_double(lower);
+  param.set_upper_bound_double(upper);
+  param.set_seed(seed);
+  return param;
+}
+
+mluoptest::RandomData gaussianParam(float mu, float sigma, int seed) {
+  mluoptest::RandomData param;
+  param.set_distribution(mluoptest::GAUSSIAN);
+  param.set_mu(mu);
+  param.set_sigma(sigma);
+  param.set_seed(seed);
+  return param;
+}
+
+// Generate [0, count) in pieces of `chunk` elements, last piece first.
+template <typename T>
+std::vector<T> generateInChunks(const mluoptest::RandomData &param,
+                                mluoptest::DataType dtype, size_t count,
+                                size_t chunk) {
+  mluoptest::RandomDataStream<T> stream(&param, dtype);
+  std::vector<T> data(count);
+  for (size_t end = count; end > 0;) {
+    const size_t begin = end > chunk ? end - chunk : 0;
+    stream.fill(data.data() + begin, begin, end - begin);
+    end = begin;
+  }
+  return data;
+}
+
+template <typename T>
+void expectSameBits(const std::vector<T> &a, const std::vector<T> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  ASSERT_EQ(0, memcmp(a.data(), b.data(), a.size() * sizeof(T)));
+}
+
+template <typename T>
+void expectMoments(const std::vector<T> &data, double mean, double stddev) {
+  double sum = 0, sum2 = 0;
+  for (T v : data) {
+    sum += v;
+    sum2 += (double)v * v;
+  }
+  const double m = sum / data.size();
+  const double s = std::sqrt(sum2 / data.size() - m * m);
+  EXPECT_NEAR(mean, m, 5 * stddev / std::sqrt((double)data.size()));
+  EXPECT_NEAR(stddev, s, 0.01 * stddev);
+}
+}  // namespace
+
+TEST(RANDOM_DATA, same_data_for_any_chunking) {
+  const size_t count = 300007;
+  const mluoptest::RandomData params[] = {uniformParam(-3.0, 5.0, 7),
+                                          gaussianParam(1.0f, 2.0f, 11)};
+  for (const auto &param : params) {
+    const auto whole_f =
+        generateInChunks<float>(param, mluoptest::DTYPE_FLOAT, count, count);
+    const auto whole_d =
+        generateInChunks<double>(param, mluoptest::DTYPE_FLOAT, count, count);
+    for (size_t chunk : {1, 3, 4, 5, 4099, 65536}) {
+      expectSameBits(whole_f, generateInChunks<float>(
+                                  param, mluoptest::DTYPE_FLOAT, count, chunk));
+      expectSameBits(whole_d, generateInChunks<double>(
+                                  param, mluoptest::DTYPE_FLOAT, count, chunk));
+    }
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+    for (int num : {1, 2, 3, 8}) {
+      omp_set_num_threads(num);
+      std::vector<float> data(count);
+      mluoptest::RandomDataStream<float>(&param, mluoptest::DTYPE_FLOAT)
+          .fillParallel(data.data(), count);
+      expectSameBits(whole_f, data);
+    }
+    omp_set_num_threads(threads);
+#endif
+  }
+}
+
+TEST(RANDOM_DATA, uniform) {
+  const size_t count = 1 << 20;
+  const auto param = uniformParam(-2.0, 6.0, 34);
+  const auto f = generateInChunks<float>(param, mluoptest::DTYPE_FLOAT, count,
+                                         count);
+  const auto d = generateInChunks<double>(param, mluoptest::DTYPE_FLOAT, count,
+                                          count);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(f[i] >= -2.0f && f[i] < 6.0f) << f[i];
+    ASSERT_TRUE(d[i] >= -2.0 && d[i] < 6.0) << d[i];
+  }
+  expectMoments(f, 2.0, 8.0 / std::sqrt(12.0));
+  expectMoments(d, 2.0, 8.0 / std::sqrt(12.0));
+
+  // another seed gives another stream.
+  const auto other = generateInChunks<float>(
+      uniformParam(-2.0, 6.0, 35), mluoptest::DTYPE_FLOAT, count, count);
+  EXPECT_NE(0, memcmp(f.data(), other.data(), count * sizeof(float)));
+
+  // the bounds hold for a range of a few ulps too.
+  const float lower = 1.0f, upper = std::nextafter(lower, 2.0f);
+  const auto narrow = generateInChunks<float>(
+      uniformParam(lower, upper, 1), mluoptest::DTYPE_FLOAT, 4096, 4096);
+  for (float v : narrow) ASSERT_EQ(lower, v);
+}
+
+TEST(RANDOM_DATA, constant_and_int) {
+  const auto constant = generateInChunks<float>(
+      uniformParam(3.5, 3.5, 1), mluoptest::DTYPE_FLOAT, 1000, 7);
+  for (float v : constant) ASSERT_EQ(3.5f, v);
+
+  const auto ints = generateInChunks<float>(
+      uniformParam(-10.0, 10.0, 2), mluoptest::DTYPE_INT32, 100000, 100000);
+  std::vector<int> seen(20);
+  for (float v : ints) {
+    ASSERT_EQ(std::floor(v), v);
+    ASSERT_TRUE(v >= -10 && v < 10) << v;
+    seen[(int)v + 10]++;
+  }
+  for (int n : seen) EXPECT_GT(n, 4000);
+
+  const auto uints = generateInChunks<double>(
+      gaussianParam(0.0f, 100.0f, 3), mluoptest::DTYPE_UINT64, 1000, 1000);
+  for (double v : uints) ASSERT_TRUE(v >= 0 && std::floor(v) == v) << v;
+}
+
+TEST(RANDOM_DATA, gaussian) {
+  const size_t count = 1 << 20;
+  const auto param = gaussianParam(-1.0f, 3.0f, 34);
+  const auto f = generateInChunks<float>(param, mluoptest::DTYPE_FLOAT, count,
+                                         count);
+  const auto d = generateInChunks<double>(param, mluoptest::DTYPE_FLOAT, count,
+                                          count);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(std::isfinite(f[i]) && std::isfinite(d[i]));
+  }
+  expectMoments(f, -1.0, 3.0);
+  expectMoments(d, -1.0, 3.0);
+  // the (cos, sin) pairs are not correlated.
+  double cross = 0;
+  for (size_t i = 0; i < count; i += 2) cross += (f[i] + 1) * (f[i + 1] + 1);
+  EXPECT_NEAR(0.0, cross / (count / 2) / 9.0, 0.01);
+}
+
+TEST(DISABLED_RANDOM_DATA, benchmark) {
+  const size_t count = size_t(1) << 30;
+  std::vector<float> data(count);
+  const auto uniform = uniformParam(-1.0, 1.0, 23);
+  const auto gaussian = gaussianParam(0.0f, 1.0f, 23);
+  auto rate = [count](std::chrono::steady_clock::time_point begin) {
+    const auto end = std::chrono::steady_clock::now();
+    return count / std::chrono::duration<double>(end - begin).count() / 1e6;
+  };
+
+  // the serial std::default_random_engine generation this replaces.
+  auto start = std::chrono::steady_clock::now();
+  std::default_random_engine re(23);
+  std::uniform_real_distribution<float> uniform_dis(-1.0f, 1.0f);
+  for (size_t i = 0; i < count; ++i) data[i] = uniform_dis(re);
+  const double serial_uniform = rate(start);
+  start = std::chrono::steady_clock::now();
+  std::normal_distribution<float> normal_dis(0.0f, 1.0f);
+  for (size_t i = 0; i < count; ++i) data[i] = normal_dis(re);
+  const double serial_gaussian = rate(start);
+
+  start = std::chrono::steady_clock::now();
+  mluoptest::RandomDataStream<float>(&uniform, mluoptest::DTYPE_FLOAT)
+      .fillParallel(data.data(), count);
+  const double philox_uniform = rate(start);
+  start = std::chrono::steady_clock::now();
+  mluoptest::RandomDataStream<float>(&gaussian, mluoptest::DTYPE_FLOAT)
+      .fillParallel(data.data(), count);
+  const double philox_gaussian = rate(start);
+  BenchmarkLine() << "1G float, uniform: serial " << serial_uniform
+                  << " M/s, philox " << philox_uniform
+                  << " M/s; gaussian: serial " << serial_gaussian
+                  << " M/s, philox " << philox_gaussian << " M/s";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_RANDOM_DATA_TEST_H_
@@ -0,0 +1,134 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_ROTATED_IOU_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_ROTATED_IOU_CPU_TEST_H_
+
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "rotated_iou_cpu.h"
+
+TEST(ROTATED_IOU_CPU, known_values) {
+  using mluoptest::rotated_iou::kBoxIouRotatedFlavor;
+  // unit square, the same square moved by half, a square rotated by 45
+  // degrees, a far away box and a degenerate box.
+  const float raw[] = {0, 0, 2, 2, 0,         1, 0, 2, 2, 0,
+                       0, 0, 2, 2, 0.7853982f, 100, 100, 2, 2, 0.3f,
+                       0, 0, 0, 2, 0};
+  mluoptest::rotated_iou::RotatedBoxes boxes;
+  boxes.assign(raw, 5, 5, kBoxIouRotatedFlavor);
+  auto iou = [&](int i, int j, int mode) {
+    return mluoptest::rotated_iou::overlap(boxes, i, boxes, j, mode,
+                                           kBoxIouRotatedFlavor);
+  };
+  EXPECT_NEAR(1.0f, iou(0, 0, 0), 1e-6);
+  EXPECT_NEAR(1.0f / 3, iou(0, 1, 0), 1e-6);
+  EXPECT_NEAR(0.5f, iou(0, 1, 1), 1e-6);
+  // the intersection is a regular octagon of area 8 * (sqrt(2) - 1).
+  const float octagon = 8 * (sqrtf(2.0f) - 1);
+  EXPECT_NEAR(octagon / (8 - octagon), iou(0, 2, 0), 1e-5);
+  EXPECT_EQ(0.0f, iou(0, 3, 0));
+  EXPECT_EQ(0.0f, iou(0, 4, 0));
+
+  std::vector<float> pairwise(25), aligned(5);
+  mluoptest::rotated_iou::pairwiseOverlaps(boxes, boxes, 0,
+                                           kBoxIouRotatedFlavor,
+                                           pairwise.data());
+  mluoptest::rotated_iou::alignedOverlaps(boxes, boxes, 0,
+                                          kBoxIouRotatedFlavor,
+                                          aligned.data());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(aligned[i], pairwise[i * 5 + i]);
+    for (int j = 0; j < 5; ++j) {
+      EXPECT_EQ(iou(i, j, 0), pairwise[i * 5 + j]);
+    }
+  }
+}
+
+TEST(ROTATED_IOU_CPU, sort_vertices) {
+  // a square given as 4 corners of each box, the intersection is the
+  // square itself and the corners are duplicated.
+  std::vector<float> vertices(24 * 2, 0.0f), mask(24, 0.0f);
+  const float corners[] = {1, 1, -1, 1, -1, -1, 1, -1};
+  for (int k = 0; k < 8; ++k) {
+    vertices[k * 2] = corners[(k % 4) * 2];
+    vertices[k * 2 + 1] = corners[(k % 4) * 2 + 1];
+    mask[k] = 1;
+  }
+  float idx[mluoptest::rotated_iou::kMaxVertIdx];
+  mluoptest::rotated_iou::sortVertices(vertices.data(), mask.data(), 8, 24,
+                                       idx);
+  // counter-clockwise starting next to the positive x axis, the first
+  // index again, then the first invalid intersection point as padding.
+  const float expected[] = {0, 1, 2, 3, 0, 8, 8, 8, 8};
+  for (int j = 0; j < mluoptest::rotated_iou::kMaxVertIdx; ++j) {
+    EXPECT_EQ(expected[j], idx[j]);
+  }
+}
+
+TEST(DISABLED_ROTATED_IOU_CPU, benchmark) {
+  using mluoptest::rotated_iou::kBoxIouRotatedFlavor;
+  const int num = 2000;
+  std::mt19937 gen(2024);
+  std::uniform_real_distribution<float> pos(0.0f, 1000.0f);
+  std::uniform_real_distribution<float> size(1.0f, 60.0f);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+  std::vector<float> raw(num * 5);
+  for (int i = 0; i < num; ++i) {
+    raw[i * 5 + 0] = pos(gen);
+    raw[i * 5 + 1] = pos(gen);
+    raw[i * 5 + 2] = size(gen);
+    raw[i * 5 + 3] = size(gen);
+    raw[i * 5 + 4] = angle(gen);
+  }
+  mluoptest::rotated_iou::RotatedBoxes boxes;
+  boxes.assign(raw.data(), num, 5, kBoxIouRotatedFlavor);
+  std::vector<float> ious(num * num), ref(num * num);
+
+  // one pair at a time without the far-apart test, as the per-executor
+  // scalar copies did.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num; ++i) {
+    for (int j = 0; j < num; ++j) {
+      float inter = mluoptest::rotated_iou::intersection(boxes, i, boxes, j,
+                                                         kBoxIouRotatedFlavor);
+      float area1 = boxes.w[i] * boxes.h[i], area2 = boxes.w[j] * boxes.h[j];
+      ref[i * num + j] = inter / (area1 + area2 - inter);
+    }
+  }
+  auto mid = std::chrono::steady_clock::now();
+  mluoptest::rotated_iou::pairwiseOverlaps(boxes, boxes, 0,
+                                           kBoxIouRotatedFlavor, ious.data());
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_EQ(ref, ious);
+  const double pairs = static_cast<double>(num) * num;
+  const double scalar_s = std::chrono::duration<double>(mid - start).count();
+  const double pairwise_s = std::chrono::duration<double>(end - mid).count();
+  mluoptest::BenchmarkLine() << "scalar: " << pairs / scalar_s
+                             << " pairs/s, pairwise: " << pairs / pairwise_s
+                             << " pairs/s";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_ROTATED_IOU_CPU_TEST_H_
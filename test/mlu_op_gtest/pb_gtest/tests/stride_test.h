@@ -0,0 +1,237 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_STRIDE_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_STRIDE_TEST_H_
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "stride.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+// The recursive element by element copy tensor_stride_in/tensor_stride_out
+// were built on before the rows were merged and split across threads, kept
+// as is as the reference they must match.
+void originalStrideMap(void *dst,                              // dst ptr
+                       void *src,                              // src ptr
+                       const std::vector<size_t> &shape,       // shape
+                       const std::vector<size_t> &dst_stride,  // stride
+                       const std::vector<size_t> &src_stride,  // stride
+                       size_t dst_offset, size_t src_offset, size_t d,
+                       size_t sizeof_dtype, const size_t dst_max,
+                       const size_t src_max) {
+  if (d == shape.size() - 1) {  // the last dim
+    for (size_t i = 0; i < shape[d]; ++i) {
+      size_t dst_idx = src_offset + i * src_stride[d];
+      size_t src_idx = dst_offset + i * dst_stride[d];
+      memcpy((char *)dst + dst_idx * sizeof_dtype,
+             (char *)src + src_idx * sizeof_dtype, sizeof_dtype);
+    }
+  } else {
+    for (size_t i = 0; i < shape[d]; ++i) {
+      originalStrideMap(dst, src, shape, dst_stride, src_stride,
+                        dst_offset + i * dst_stride[d],
+                        src_offset + i * src_stride[d], d + 1, sizeof_dtype,
+                        dst_max, src_max);
+    }
+  }
+}
+
+// src(strided) -> dst(shape)
+void originalStrideIn(void *dst, void *src, const std::vector<size_t> &shape,
+                      const std::vector<size_t> &dst_stride,  // dst_stride
+                      size_t sizeof_dtype) {
+  size_t shape_total = std::accumulate(shape.begin(), shape.end(), (size_t)1,
+                                       std::multiplies<size_t>());
+  size_t stride_total = 1;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    stride_total += (shape[i] - 1) * dst_stride[i];
+  }
+
+  std::vector<size_t> src_stride(shape.size());
+  size_t stride_base = 1;
+  for (ssize_t i = shape.size() - 1; i >= 0; --i) {
+    src_stride[i] = stride_base;
+    stride_base *= shape[i];
+  }
+  originalStrideMap(dst, src, shape, dst_stride, src_stride, 0, 0, 0,
+                    sizeof_dtype, stride_total, shape_total);
+}
+
+// src(shape) -> dst(strided)
+void originalStrideOut(void *dst, void *src, const std::vector<size_t> &shape,
+                       const std::vector<size_t> &src_stride,  // src_stride
+                       size_t sizeof_dtype) {
+  size_t shape_total = std::accumulate(shape.begin(), shape.end(), (size_t)1,
+                                       std::multiplies<size_t>());
+  size_t stride_total = 1;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    stride_total += (shape[i] - 1) * src_stride[i];
+  }
+
+  std::vector<size_t> dst_stride(shape.size());
+  size_t stride_base = 1;
+  for (ssize_t i = shape.size() - 1; i >= 0; --i) {
+    dst_stride[i] = stride_base;
+    stride_base *= shape[i];
+  }
+  originalStrideMap(dst, src, shape, dst_stride, src_stride, 0, 0, 0,
+                    sizeof_dtype, shape_total, stride_total);
+}
+
+std::vector<size_t> shapeStride(const std::vector<size_t> &shape) {
+  std::vector<size_t> stride(shape.size());
+  size_t base = 1;
+  for (size_t i = shape.size(); i-- > 0;) {
+    stride[i] = base;
+    base *= shape[i];
+  }
+  return stride;
+}
+
+size_t strideCount(const std::vector<size_t> &shape,
+                   const std::vector<size_t> &stride) {
+  size_t count = 1;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    count += (shape[i] - 1) * stride[i];
+  }
+  return count;
+}
+
+// Random strides: dense, padded, permuted, broadcast (0) and overlapping.
+std::vector<size_t> randomStride(const std::vector<size_t> &shape,
+                                 std::mt19937 *gen) {
+  std::vector<size_t> stride = shapeStride(shape);
+  const int kind = (*gen)() % 5;
+  if (kind == 1) {
+    size_t base = 1;
+    for (size_t i = shape.size(); i-- > 0;) {
+      stride[i] = base;
+      base *= shape[i] + (*gen)() % 3;
+    }
+  } else if (kind == 2) {
+    std::vector<size_t> perm(shape.size());
+    for (size_t i = 0; i < perm.size(); ++i) perm[i] = i;
+    std::shuffle(perm.begin(), perm.end(), *gen);
+    size_t base = 1;
+    for (size_t i : perm) {
+      stride[i] = base;
+      base *= shape[i];
+    }
+  } else if (kind == 3) {
+    stride[(*gen)() % shape.size()] = 0;
+  } else if (kind == 4) {
+    for (auto &s : stride) s = (*gen)() % 4;
+  }
+  return stride;
+}
+}  // namespace
+
+TEST(STRIDE, same_as_original_copy) {
+  std::mt19937 gen(31);
+  const size_t dtype_sizes[] = {1, 2, 3, 4, 8};
+  for (int iter = 0; iter < 400; ++iter) {
+    // large enough cases go through the multithreaded path.
+    const size_t rank = 1 + gen() % 5;
+    const size_t max_dim = iter % 10 != 0 ? 6 : rank <= 3 ? 96 : 12;
+    std::vector<size_t> shape(rank);
+    for (auto &dim : shape) dim = 1 + gen() % max_dim;
+    if (iter % 50 == 7) shape[gen() % rank] = 0;
+    const std::vector<size_t> stride = randomStride(shape, &gen);
+    const size_t sizeof_dtype = dtype_sizes[gen() % 5];
+    const size_t shape_count = std::accumulate(
+        shape.begin(), shape.end(), (size_t)1, std::multiplies<size_t>());
+    const size_t stride_count =
+        shape_count == 0 ? 0 : strideCount(shape, stride);
+
+    std::vector<char> strided(stride_count * sizeof_dtype);
+    std::vector<char> dense(shape_count * sizeof_dtype);
+    for (auto &c : strided) c = static_cast<char>(gen());
+    for (auto &c : dense) c = static_cast<char>(gen());
+
+    std::vector<char> expected_in(dense.size(), 0), actual_in(dense.size(), 0);
+    originalStrideIn(expected_in.data(), strided.data(), shape, stride,
+                     sizeof_dtype);
+    mluoptest::tensor_stride_in(actual_in.data(), strided.data(), shape,
+                                stride, sizeof_dtype);
+    EXPECT_TRUE(expected_in == actual_in) << "stride_in, iter " << iter;
+
+    // overlapping outputs must keep the last write of the row-major order.
+    std::vector<char> expected_out = strided, actual_out = strided;
+    originalStrideOut(expected_out.data(), dense.data(), shape, stride,
+                      sizeof_dtype);
+    mluoptest::tensor_stride_out(actual_out.data(), dense.data(), shape,
+                                 stride, sizeof_dtype);
+    EXPECT_TRUE(expected_out == actual_out) << "stride_out, iter " << iter;
+  }
+}
+
+TEST(DISABLED_STRIDE, benchmark) {
+  struct Case {
+    const char *name;
+    std::vector<size_t> shape;
+    std::vector<size_t> stride;
+  };
+  const std::vector<Case> cases = {
+      {"padded rows", {64, 256, 1000}, {256 * 1024, 1024, 1}},
+      {"transposed", {256, 256, 256}, {1, 256, 65536}},
+      {"every other", {64, 512, 512}, {512 * 1024, 1024, 2}},
+  };
+  const size_t sizeof_dtype = 4;
+  for (const auto &c : cases) {
+    const size_t shape_count =
+        std::accumulate(c.shape.begin(), c.shape.end(), (size_t)1,
+                        std::multiplies<size_t>());
+    std::vector<char> strided(strideCount(c.shape, c.stride) * sizeof_dtype,
+                              1);
+    std::vector<char> dense(shape_count * sizeof_dtype, 0);
+    const double gb = 2.0 * shape_count * sizeof_dtype / 1e9;
+
+    auto start = std::chrono::steady_clock::now();
+    originalStrideIn(dense.data(), strided.data(), c.shape, c.stride,
+                     sizeof_dtype);
+    auto mid = std::chrono::steady_clock::now();
+    mluoptest::tensor_stride_in(dense.data(), strided.data(), c.shape,
+                                c.stride, sizeof_dtype);
+    auto mid2 = std::chrono::steady_clock::now();
+    mluoptest::tensor_stride_out(strided.data(), dense.data(), c.shape,
+                                 c.stride, sizeof_dtype);
+    auto end = std::chrono::steady_clock::now();
+    BenchmarkLine() << c.name << ": original "
+                    << gb / std::chrono::duration<double>(mid - start).count()
+                    << " GB/s, stride_in "
+                    << gb / std::chrono::duration<double>(mid2 - mid).count()
+                    << " GB/s, stride_out "
+                    << gb / std::chrono::duration<double>(end - mid2).count()
+                    << " GB/s";
+  }
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_STRIDE_TEST_H_
@@ -0,0 +1,201 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_TENSOR_SIGNATURE_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_TENSOR_SIGNATURE_TEST_H_
+
+#include <chrono>  // NOLINT
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "mlu_op.h"
+#include "core/tensor.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+mluOpTensorDescriptor_t createSignatureTestDesc(
+    mluOpDataType_t dtype, const std::vector<int64_t> &dims,
+    const std::vector<int64_t> &strides = {}) {
+  mluOpTensorDescriptor_t desc = nullptr;
+  mluOpCreateTensorDescriptor(&desc);
+  if (strides.empty()) {
+    mluOpSetTensorDescriptor_v2(desc, MLUOP_LAYOUT_ARRAY, dtype, dims.size(),
+                                dims.data());
+  } else {
+    mluOpSetTensorDescriptorEx_v2(desc, MLUOP_LAYOUT_ARRAY, dtype, dims.size(),
+                                  dims.data(), strides.data());
+  }
+  return desc;
+}
+}  // namespace
+
+TEST(TENSOR_SIGNATURE, update_on_set) {
+  auto a = createSignatureTestDesc(MLUOP_DTYPE_FLOAT, {2, 3, 4});
+  auto b = createSignatureTestDesc(MLUOP_DTYPE_FLOAT, {2, 3, 4});
+  EXPECT_EQ(a->signature(), b->signature());
+  EXPECT_TRUE(a->isSameDescriptor(*b));
+
+  // every setter must update the signature.
+  mluOpSetTensorDescriptorOnchipDataType(b, MLUOP_DTYPE_HALF);
+  EXPECT_NE(a->signature(), b->signature());
+  EXPECT_FALSE(a->isSameDescriptor(*b));
+  EXPECT_TRUE(a->isSameShapeAndStrides(*b));
+
+  int64_t dims[3] = {2, 3, 4};
+  int64_t strides[3] = {24, 8, 2};
+  mluOpSetTensorDescriptorEx_v2(b, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT, 3,
+                                dims, strides);
+  EXPECT_FALSE(a->isSameShapeAndStrides(*b));
+  EXPECT_TRUE(a->isSameDims(*b));
+
+  mluOpResetTensorDescriptor(b);
+  mluOpSetTensorDescriptor_v2(b, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT, 3,
+                              dims);
+  EXPECT_TRUE(a->isSameDescriptor(*b));
+  mluOpSetTensorDescriptorPositionAndScale(b, 1, 0.5f);
+  EXPECT_FALSE(a->isSameDescriptor(*b));
+
+  // copies carry the cache.
+  mluOpTensorStruct c(*b);
+  EXPECT_EQ(b->signature(), c.signature());
+  EXPECT_TRUE(c.isSameDescriptor(*b));
+
+  mluOpDestroyTensorDescriptor(a);
+  mluOpDestroyTensorDescriptor(b);
+}
+
+TEST(TENSOR_SIGNATURE, computed_by_setters) {
+  // the signature is up to date as soon as a descriptor exists, reading it
+  // never has to fill it in.
+  mluOpTensorDescriptor_t a = nullptr;
+  mluOpCreateTensorDescriptor(&a);
+  mluOpTensorStruct fresh;
+  EXPECT_TRUE(a->isSameDescriptor(fresh));
+  mluOpTensorStruct expected(*a);
+  expected.updateSignature();
+  EXPECT_EQ(expected.signature(), a->signature());
+  EXPECT_EQ(expected.shapeSignature(), a->shapeSignature());
+
+  auto b = createSignatureTestDesc(MLUOP_DTYPE_HALF, {5, 7});
+  mluOpResetTensorDescriptor(b);
+  EXPECT_EQ(a->signature(), b->signature());
+
+  // a rejected zero-dim set still leaves dtype and layout behind.
+  EXPECT_EQ(MLUOP_STATUS_BAD_PARAM,
+            mluOpSetTensorDescriptor(b, MLUOP_LAYOUT_NHWC, MLUOP_DTYPE_INT8,
+                                     0, nullptr));
+  expected = *b;
+  expected.updateSignature();
+  EXPECT_EQ(expected.signature(), b->signature());
+
+  mluOpDestroyTensorDescriptor(a);
+  mluOpDestroyTensorDescriptor(b);
+}
+
+// Compares the field-by-field shape comparison and a descriptor-keyed map
+// against the cached signatures.
+TEST(DISABLED_TENSOR_SIGNATURE, benchmark) {
+  const int desc_num = 256;
+  const int repeat = 2000;
+  std::vector<mluOpTensorDescriptor_t> descs;
+  for (int i = 0; i < desc_num; ++i) {
+    descs.push_back(createSignatureTestDesc(
+        MLUOP_DTYPE_FLOAT, {1 + i % 4, 64, 56 + i % 3, 56, 1 + i % 8}));
+  }
+  auto elapsed_us = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  auto field_equal = [](const mluOpTensorStruct *a,
+                        const mluOpTensorStruct *b) {
+    if (a->dim != b->dim || a->dtype != b->dtype || a->layout != b->layout ||
+        a->onchip_dtype != b->onchip_dtype) {
+      return false;
+    }
+    for (int i = 0; i < a->dim; ++i) {
+      if (a->dims[i] != b->dims[i] || a->strides[i] != b->strides[i]) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  size_t same_field = 0, same_signature = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    for (int i = 0; i < desc_num; ++i) {
+      same_field += field_equal(descs[i], descs[(i + r) % desc_num]);
+    }
+  }
+  auto field_us = elapsed_us(start);
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    for (int i = 0; i < desc_num; ++i) {
+      same_signature += descs[i]->isSameDescriptor(*descs[(i + r) % desc_num]);
+    }
+  }
+  auto signature_us = elapsed_us(start);
+  EXPECT_EQ(same_field, same_signature);
+  BenchmarkLine() << "compare: field-by-field " << field_us << " us, signature "
+                  << signature_us << " us";
+
+  // map keyed by the descriptor fields vs. by the signature.
+  auto field_key = [](const mluOpTensorStruct *desc) {
+    std::vector<int64_t> key = {desc->dim, desc->dtype, desc->layout,
+                                desc->onchip_dtype};
+    key.insert(key.end(), desc->dims, desc->dims + desc->dim);
+    key.insert(key.end(), desc->strides, desc->strides + desc->dim);
+    return key;
+  };
+  std::map<std::vector<int64_t>, int> field_map;
+  std::unordered_map<uint64_t, int> signature_map;
+  for (int i = 0; i < desc_num; ++i) {
+    field_map[field_key(descs[i])] = i;
+    signature_map[descs[i]->signature()] = i;
+  }
+  size_t hit_field = 0, hit_signature = 0;
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    for (int i = 0; i < desc_num; ++i) {
+      hit_field += field_map.count(field_key(descs[i]));
+    }
+  }
+  field_us = elapsed_us(start);
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    for (int i = 0; i < desc_num; ++i) {
+      hit_signature += signature_map.count(descs[i]->signature());
+    }
+  }
+  signature_us = elapsed_us(start);
+  EXPECT_EQ(hit_field, hit_signature);
+  BenchmarkLine() << "map lookup: field key " << field_us
+                  << " us, signature key " << signature_us << " us";
+  for (auto desc : descs) {
+    mluOpDestroyTensorDescriptor(desc);
+  }
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_TENSOR_SIGNATURE_TEST_H_
@@ -0,0 +1,90 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_TEST_UTIL_H_
+#define TEST_MLU_OP_GTEST_TESTS_TEST_UTIL_H_
+
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Helpers shared by the host unit tests of tests/.
+namespace mluoptest {
+
+// n floats drawn uniformly from [lo, hi), the same for the same seed.
+inline std::vector<float> uniformFloats(size_t n, float lo, float hi,
+                                        int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<float> v(n);
+  for (auto &x : v) x = dist(gen);
+  return v;
+}
+
+// n floats drawn from N(mean, stddev^2), the same for the same seed.
+inline std::vector<float> normalFloats(size_t n, float mean, float stddev,
+                                       int seed) {
+  std::mt19937 gen(seed);
+  std::normal_distribution<float> dist(mean, stddev);
+  std::vector<float> v(n);
+  for (auto &x : v) x = dist(gen);
+  return v;
+}
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// A result of a DISABLED_ benchmark, printed at the end of the statement
+// with every line tagged like the gtest output:
+//   BenchmarkLine() << "scalar " << scalar_ms << " ms";
+class BenchmarkLine {
+ public:
+  BenchmarkLine() = default;
+  BenchmarkLine(const BenchmarkLine &) = delete;
+  BenchmarkLine &operator=(const BenchmarkLine &) = delete;
+  ~BenchmarkLine() {
+    std::istringstream lines(text_.str());
+    for (std::string line; std::getline(lines, line);) {
+      std::cout << "[ BENCHMARK] " << line << "\n";
+    }
+    std::cout << std::flush;
+  }
+
+  template <typename T>
+  BenchmarkLine &operator<<(const T &value) {
+    text_ << value;
+    return *this;
+  }
+
+ private:
+  std::ostringstream text_;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_TEST_UTIL_H_
@@ -0,0 +1,155 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_TRANSPOSE_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_TRANSPOSE_CPU_TEST_H_
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <numeric>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "internal_kernel/transpose_cpu/transpose_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+// one element at a time, the index arithmetic of the original loop nest.
+std::vector<float> transposeReference(const std::vector<float> &x,
+                                      const std::vector<int> &dims,
+                                      const std::vector<int> &permute) {
+  const int rank = dims.size();
+  std::vector<uint64_t> out_stride(rank, 1);
+  for (int k = rank - 2; k >= 0; --k) {
+    out_stride[k] = out_stride[k + 1] * dims[permute[k + 1]];
+  }
+  std::vector<uint64_t> in_to_out(rank);
+  for (int k = 0; k < rank; ++k) in_to_out[permute[k]] = out_stride[k];
+  std::vector<float> y(x.size());
+  std::vector<int> idx(rank, 0);
+  for (size_t i = 0; i < x.size(); ++i) {
+    uint64_t out = 0;
+    for (int d = 0; d < rank; ++d) out += idx[d] * in_to_out[d];
+    y[out] = x[i];
+    for (int d = rank - 1; d >= 0 && ++idx[d] == dims[d]; --d) idx[d] = 0;
+  }
+  return y;
+}
+
+mluOpStatus_t transposeWithCpu(const std::vector<int> &dims,
+                               const std::vector<int> &permute,
+                               const std::vector<float> &x,
+                               std::vector<float> *y) {
+  std::vector<int> y_dims(dims.size());
+  for (size_t k = 0; k < dims.size(); ++k) y_dims[k] = dims[permute[k]];
+  mluOpTensorDescriptor_t x_desc = nullptr, y_desc = nullptr;
+  mluOpCreateTensorDescriptor(&x_desc);
+  mluOpCreateTensorDescriptor(&y_desc);
+  mluOpSetTensorDescriptor(x_desc, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT,
+                           dims.size(), dims.data());
+  mluOpSetTensorDescriptor(y_desc, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT,
+                           y_dims.size(), y_dims.data());
+  y->resize(x.size());
+  auto status = mluOpTransposeCpu(dims.size(), permute, x_desc, x.data(),
+                                  y_desc, y->data());
+  mluOpDestroyTensorDescriptor(x_desc);
+  mluOpDestroyTensorDescriptor(y_desc);
+  return status;
+}
+}  // namespace
+
+TEST(TRANSPOSE_CPU, matches_reference) {
+  std::mt19937 gen(2024);
+  for (int iter = 0; iter < 500; ++iter) {
+    const int rank = 1 + gen() % TRANSPOSE_MAX_DIM;
+    std::vector<int> dims(rank);
+    size_t total = 1;
+    for (auto &d : dims) {
+      // small dims at high rank, and some dims of 1 to fold away.
+      d = gen() % 4 == 0 ? 1 : 1 + gen() % (rank > 4 ? 3 : 40);
+      total *= d;
+    }
+    std::vector<int> permute(rank);
+    std::iota(permute.begin(), permute.end(), 0);
+    std::shuffle(permute.begin(), permute.end(), gen);
+    std::vector<float> x(total), y;
+    std::iota(x.begin(), x.end(), 0.0f);
+    ASSERT_EQ(MLUOP_STATUS_SUCCESS, transposeWithCpu(dims, permute, x, &y));
+    ASSERT_EQ(transposeReference(x, dims, permute), y) << "iter " << iter;
+  }
+}
+
+TEST(TRANSPOSE_CPU, folds_adjacent_dims) {
+  // NCHW -> NHWC is a 2D transpose of C and HW for every N.
+  const std::vector<int> dims = {2, 3, 4, 5};
+  const std::vector<int> permute = {0, 2, 3, 1};
+  std::vector<float> x(120), y;
+  std::iota(x.begin(), x.end(), 0.0f);
+  ASSERT_EQ(MLUOP_STATUS_SUCCESS, transposeWithCpu(dims, permute, x, &y));
+  for (int n = 0; n < 2; ++n) {
+    for (int hw = 0; hw < 20; ++hw) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_EQ(x[n * 60 + c * 20 + hw], y[n * 60 + hw * 3 + c]);
+      }
+    }
+  }
+  // the identity permute is a copy.
+  ASSERT_EQ(MLUOP_STATUS_SUCCESS,
+            transposeWithCpu(dims, {0, 1, 2, 3}, x, &y));
+  EXPECT_EQ(x, y);
+}
+
+TEST(DISABLED_TRANSPOSE_CPU, benchmark) {
+  using Clock = std::chrono::steady_clock;
+  auto gbps = [](size_t elements, Clock::time_point begin,
+                 Clock::time_point end) {
+    const double s = std::chrono::duration<double>(end - begin).count();
+    return 2.0 * elements * sizeof(float) / s / 1e9;  // read + write
+  };
+  const std::vector<std::pair<std::vector<int>, std::vector<int>>> cases = {
+      {{32, 256, 56, 56}, {0, 2, 3, 1}},        // NCHW -> NHWC
+      {{32, 56, 56, 256}, {0, 3, 1, 2}},        // NHWC -> NCHW
+      {{8, 64, 16, 32, 32}, {0, 2, 3, 4, 1}},   // NCDHW -> NDHWC
+      {{8, 64, 16, 32, 32}, {0, 2, 4, 3, 1}}};  // 5D, no dims folded
+  for (const auto &c : cases) {
+    size_t total = 1;
+    for (int d : c.first) total *= d;
+    std::vector<float> x(total, 1.0f), y(total);
+    auto start = Clock::now();
+    auto reference = transposeReference(x, c.first, c.second);
+    auto naive = Clock::now();
+    ASSERT_EQ(MLUOP_STATUS_SUCCESS,
+              transposeWithCpu(c.first, c.second, x, &y));
+    auto tiled = Clock::now();
+    EXPECT_EQ(reference, y);
+    BenchmarkLine line;
+    line << "transpose";
+    for (int d : c.first) line << " " << d;
+    line << " permute";
+    for (int p : c.second) line << " " << p;
+    line << ": per element " << gbps(total, start, naive) << " GB/s, tiled "
+         << gbps(total, naive, tiled) << " GB/s";
+  }
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_TRANSPOSE_CPU_TEST_H_
@@ -0,0 +1,211 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_VOXEL_GROUP_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_VOXEL_GROUP_CPU_TEST_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <numeric>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "voxel_group_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+using mluoptest::uniformFloats;
+namespace vg = mluoptest::voxel_group_cpu;
+
+// n points around clusters of a [depth, side, side] grid, like the
+// returns of a lidar frame, a share of them with a negative coordinate.
+std::vector<int32_t> vgCoors(int64_t n, int32_t depth, int32_t side,
+                             int clusters, float dropped, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int32_t> z(0, depth - 1), yx(0, side - 1);
+  std::uniform_int_distribution<int> pick(0, clusters - 1);
+  std::normal_distribution<float> spread(0.0f, 2.0f);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<int32_t> centers(clusters * 3);
+  for (int k = 0; k < clusters; ++k) {
+    centers[k * 3] = z(gen), centers[k * 3 + 1] = yx(gen);
+    centers[k * 3 + 2] = yx(gen);
+  }
+  const int32_t size[3] = {depth, side, side};
+  std::vector<int32_t> coors(n * 3);
+  for (int64_t i = 0; i < n; ++i) {
+    const int32_t *center = &centers[pick(gen) * 3];
+    for (int d = 0; d < 3; ++d) {
+      const int32_t c = center[d] + lroundf(spread(gen));
+      coors[i * 3 + d] = std::min(std::max(c, 0), size[d] - 1);
+    }
+    if (u(gen) < dropped) coors[i * 3 + 1 + i % 2] = -1 - i % 3;
+  }
+  return coors;
+}
+
+// The sort and unique over all the points the executor had.
+void vgSortUnique(const int32_t *coors, int64_t n, vg::Groups *out) {
+  std::vector<int32_t> c(coors, coors + n * 3);
+  for (int64_t i = 0; i < n; ++i) {
+    if (c[i * 3] < 0 || c[i * 3 + 1] < 0 || c[i * 3 + 2] < 0) {
+      c[i * 3] = c[i * 3 + 1] = c[i * 3 + 2] = -1;
+    }
+  }
+  auto less = [&](int64_t i, int64_t j) {
+    return std::lexicographical_compare(&c[i * 3], &c[i * 3 + 3], &c[j * 3],
+                                        &c[j * 3 + 3]);
+  };
+  auto same = [&](int64_t i, int64_t j) {
+    return std::equal(&c[i * 3], &c[i * 3 + 3], &c[j * 3]);
+  };
+  std::vector<int64_t> index(n);
+  std::iota(index.begin(), index.end(), 0);
+  std::sort(index.begin(), index.end(), less);
+  out->coors.clear(), out->counts.clear();
+  out->point2voxel.assign(n, -1);
+  int32_t v = -1;
+  for (int64_t k = 0; k < n; ++k) {
+    const int64_t i = index[k];
+    if (c[i * 3] < 0) continue;
+    if (v < 0 || !same(index[k - 1], i)) {
+      out->coors.insert(out->coors.end(), &c[i * 3], &c[i * 3 + 3]);
+      out->counts.push_back(0);
+      v++;
+    }
+    out->counts[v]++;
+    out->point2voxel[i] = v;
+  }
+  out->voxel_num = v + 1;
+}
+}  // namespace
+
+TEST(VOXEL_GROUP_CPU, matches_sort_unique) {
+  const int64_t n = 5000;
+  const int channels = 5;
+  const auto coors = vgCoors(n, 3, 12, 4, 0.1f, 1);
+  const auto feats = uniformFloats(n * channels, -10.0f, 10.0f, 2);
+  vg::Groups ref;
+  vgSortUnique(coors.data(), n, &ref);
+  for (int64_t block : {int64_t(7), int64_t(1000), vg::kPointBlock}) {
+    for (vg::Reduce reduce : {vg::Reduce::kMax, vg::Reduce::kMean}) {
+      vg::Groups out;
+      const float init = reduce == vg::Reduce::kMax ? -1e38f : 0.0f;
+      vg::group(coors.data(), feats.data(), n, channels, reduce, init, &out,
+                block);
+      ASSERT_EQ(ref.voxel_num, out.voxel_num);
+      ASSERT_EQ(ref.coors, out.coors);
+      ASSERT_EQ(ref.counts, out.counts);
+      ASSERT_EQ(ref.point2voxel, out.point2voxel);
+      // the reduction in point order
+      std::vector<float> acc(out.voxel_num * channels, init);
+      for (int64_t i = 0; i < n; ++i) {
+        const int32_t v = ref.point2voxel[i];
+        if (v < 0) continue;
+        for (int k = 0; k < channels; ++k) {
+          const float f = feats[i * channels + k];
+          float &a = acc[v * channels + k];
+          a = reduce == vg::Reduce::kMax ? (f >= a ? f : a) : a + f;
+        }
+      }
+      for (int32_t v = 0; v < out.voxel_num; ++v) {
+        for (int k = 0; k < channels; ++k) {
+          const float a = acc[v * channels + k];
+          const float o = out.feats[v * channels + k];
+          if (reduce == vg::Reduce::kMax) {
+            ASSERT_EQ(a, o);
+          } else {
+            ASSERT_NEAR(a / ref.counts[v], o, 1e-5f * (1 + fabsf(o)));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(VOXEL_GROUP_CPU, wide_coordinates) {
+  // too wide for 64-bit keys, the voxels are keyed by the coordinates
+  const int64_t n = 3000;
+  auto coors = vgCoors(n, 4, 9, 3, 0.1f, 3);
+  for (int32_t &c : coors) {
+    if (c >= 0) c += 1 << 29;
+  }
+  const auto feats = uniformFloats(n * 2, -10.0f, 10.0f, 4);
+  vg::Groups ref, out;
+  vgSortUnique(coors.data(), n, &ref);
+  vg::group(coors.data(), feats.data(), n, 2, vg::Reduce::kMax, -1e38f, &out,
+            100);
+  ASSERT_EQ(ref.voxel_num, out.voxel_num);
+  ASSERT_EQ(ref.coors, out.coors);
+  ASSERT_EQ(ref.counts, out.counts);
+  ASSERT_EQ(ref.point2voxel, out.point2voxel);
+}
+
+TEST(VOXEL_GROUP_CPU, dropped_and_empty) {
+  vg::Groups out;
+  const std::vector<int32_t> coors = {-1, 0, 0, 0, -2, 0, 3, 4, -1};
+  const std::vector<float> feats = {1.0f, 2.0f, 3.0f};
+  vg::group(coors.data(), feats.data(), 3, 1, vg::Reduce::kMean, 0.0f, &out);
+  ASSERT_EQ(0, out.voxel_num);
+  ASSERT_EQ(std::vector<int32_t>(3, -1), out.point2voxel);
+  vg::group(nullptr, nullptr, 0, 1, vg::Reduce::kMax, 0.0f, &out);
+  ASSERT_EQ(0, out.voxel_num);
+  ASSERT_TRUE(out.point2voxel.empty());
+}
+
+TEST(DISABLED_VOXEL_GROUP_CPU, benchmark) {
+  // a 200k-point frame over a 40 x 1408 x 1408 grid, 4 features
+  const int64_t n = 200000;
+  const int channels = 4;
+  const auto coors = vgCoors(n, 40, 1408, 300, 0.05f, 1);
+  const auto feats = uniformFloats(n * channels, -10.0f, 10.0f, 2);
+
+  // sort and unique, then the mean point by point, as the executor had it
+  auto start = std::chrono::steady_clock::now();
+  vg::Groups ref;
+  vgSortUnique(coors.data(), n, &ref);
+  ref.feats.assign(ref.voxel_num * channels, 0.0f);
+  for (int64_t i = 0; i < n; ++i) {
+    const int32_t v = ref.point2voxel[i];
+    if (v < 0) continue;
+    for (int k = 0; k < channels; ++k) {
+      ref.feats[v * channels + k] += feats[i * channels + k] / ref.counts[v];
+    }
+  }
+  const double sort_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  vg::Groups out;
+  vg::group(coors.data(), feats.data(), n, channels, vg::Reduce::kMean, 0.0f,
+            &out);
+  const double hash_ms = elapsedMs(start);
+
+  ASSERT_EQ(ref.point2voxel, out.point2voxel);
+  BenchmarkLine() << out.voxel_num << " voxels: sort unique " << sort_ms
+                  << " ms, hash " << hash_ms << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_VOXEL_GROUP_CPU_TEST_H_
@@ -0,0 +1,255 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_VOXEL_MAP_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_VOXEL_MAP_TEST_H_
+
+#include <array>
+#include <chrono>  // NOLINT
+#include <deque>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "kernels/voxelization/voxel_map.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+const int kVoxelMapFeatures = 4;
+
+// A static scene seen by every sweep with a small jitter, plus a few points
+// which are only in one sweep, so that most voxels persist across frames.
+class SweepGenerator {
+ public:
+  SweepGenerator(int num_points, uint32_t seed) : gen_(seed) {
+    std::uniform_real_distribution<float> xy(-5.0f, 75.0f);
+    std::uniform_real_distribution<float> z(-4.0f, 2.0f);
+    for (int i = 0; i < num_points; ++i) {
+      scene_.push_back({xy(gen_), xy(gen_) - 40.0f, z(gen_)});
+    }
+  }
+
+  std::vector<float> next(float moving_ratio) {
+    std::normal_distribution<float> jitter(0.0f, 0.05f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> xy(-5.0f, 75.0f);
+    std::vector<float> points;
+    points.reserve(scene_.size() * kVoxelMapFeatures);
+    for (const auto &p : scene_) {
+      if (unit(gen_) < moving_ratio) {
+        points.insert(points.end(),
+                      {xy(gen_), xy(gen_) - 40.0f, p[2], unit(gen_)});
+      } else {
+        points.insert(points.end(), {p[0] + jitter(gen_), p[1] + jitter(gen_),
+                                     p[2] + jitter(gen_), unit(gen_)});
+      }
+    }
+    return points;
+  }
+
+ private:
+  std::mt19937 gen_;
+  std::vector<std::array<float, 3>> scene_;
+};
+
+mluop::VoxelGrid makeVoxelMapGrid(float voxel) {
+  const float voxel_size[3] = {voxel, voxel, 0.5f};
+  const float coors_range[6] = {0.0f, -40.0f, -3.0f, 70.4f, 40.0f, 1.0f};
+  mluop::VoxelGrid grid;
+  grid.set(voxel_size, coors_range);
+  return grid;
+}
+
+typedef std::map<std::array<int32_t, 3>, std::vector<float>> VoxelContent;
+
+// Voxels of a full hard voxelization, keyed by coordinate.
+VoxelContent rebuildVoxels(const mluop::VoxelGrid &grid,
+                           const std::vector<float> &points, int max_points,
+                           int max_voxels) {
+  std::vector<float> voxels((size_t)max_voxels * max_points *
+                            kVoxelMapFeatures);
+  std::vector<int32_t> coors(max_voxels * 3);
+  std::vector<int32_t> num(max_voxels);
+  int32_t voxel_num = 0;
+  mluop::hardVoxelize(grid, points.data(), points.size() / kVoxelMapFeatures,
+                      kVoxelMapFeatures, max_points, max_voxels, voxels.data(),
+                      coors.data(), num.data(), &voxel_num);
+  VoxelContent content;
+  for (int32_t v = 0; v < voxel_num; ++v) {
+    const float *begin = voxels.data() + (size_t)v * max_points *
+                                             kVoxelMapFeatures;
+    content[{coors[v * 3], coors[v * 3 + 1], coors[v * 3 + 2]}].assign(
+        begin, begin + num[v] * kVoxelMapFeatures);
+  }
+  return content;
+}
+
+VoxelContent slotVoxels(const std::vector<std::array<int32_t, 3>> &coors,
+                        const std::vector<std::vector<float>> &points) {
+  VoxelContent content;
+  for (size_t s = 0; s < coors.size(); ++s) {
+    if (!points[s].empty()) content[coors[s]] = points[s];
+  }
+  return content;
+}
+}  // namespace
+
+TEST(VOXEL_MAP, same_voxels_as_full_rebuild) {
+  const int max_points = 5, max_voxels = 200000, window = 3;
+  const mluop::VoxelGrid grid = makeVoxelMapGrid(0.8f);
+  SweepGenerator sweeps(20000, 7);
+  mluop::VoxelMap map;
+  map.reset(grid, max_points, max_voxels, kVoxelMapFeatures);
+
+  // slots mirrored from the reported changes only.
+  std::vector<std::array<int32_t, 3>> mirror_coors(max_voxels);
+  std::vector<std::vector<float>> mirror_points(max_voxels);
+  std::deque<std::pair<int64_t, std::vector<float>>> retained;
+  std::vector<float> buffer(max_points * kVoxelMapFeatures);
+  for (int frame = 0; frame < 8; ++frame) {
+    std::vector<float> sweep = sweeps.next(0.2f);
+    // frames 1 and 2 share a timestamp.
+    const int64_t timestamp = frame < 2 ? frame : frame - 1;
+    ASSERT_TRUE(map.append(sweep.data(), sweep.size() / kVoxelMapFeatures,
+                           timestamp));
+    map.evict(timestamp - window + 1);
+    retained.push_back({timestamp, sweep});
+    while (retained.front().first < timestamp - window + 1) {
+      retained.pop_front();
+    }
+    std::vector<float> all;
+    for (const auto &s : retained) {
+      all.insert(all.end(), s.second.begin(), s.second.end());
+    }
+
+    for (int32_t slot : map.changedSlots()) {
+      int32_t coor[3] = {-1, -1, -1};
+      const int32_t num = map.readSlot(slot, coor, buffer.data());
+      mirror_coors[slot] = {coor[0], coor[1], coor[2]};
+      mirror_points[slot].assign(buffer.begin(),
+                                 buffer.begin() + num * kVoxelMapFeatures);
+    }
+    map.clearChanges();
+    const VoxelContent expected =
+        rebuildVoxels(grid, all, max_points, max_voxels);
+    EXPECT_EQ(expected.size(), static_cast<size_t>(map.voxelNum()));
+    EXPECT_TRUE(expected == slotVoxels(mirror_coors, mirror_points))
+        << "frame " << frame;
+  }
+  EXPECT_FALSE(map.append(nullptr, 0, 0));
+}
+
+TEST(VOXEL_MAP, waiting_voxels_take_released_slots) {
+  const mluop::VoxelGrid grid = makeVoxelMapGrid(1.0f);
+  mluop::VoxelMap map;
+  map.reset(grid, 2, 2, kVoxelMapFeatures);
+  const float first[] = {0.5f, 0.5f, 0.0f, 0.0f, 1.5f, 0.5f, 0.0f, 0.0f};
+  const float second[] = {2.5f, 0.5f, 0.0f, 1.0f, 1.5f, 0.5f, 0.0f, 1.0f,
+                          100.0f, 0.5f, 0.0f, 1.0f};
+  ASSERT_TRUE(map.append(first, 2, 0));
+  ASSERT_TRUE(map.append(second, 3, 1));
+  EXPECT_EQ(2, map.voxelNum());
+  // the point out of the grid is dropped.
+  EXPECT_EQ(4u, map.pointNum());
+  map.clearChanges();
+
+  // the voxel x = 0 is released, x = 2 takes its slot, x = 1 keeps one
+  // point of the second sweep.
+  map.evict(1);
+  EXPECT_EQ(2, map.voxelNum());
+  EXPECT_EQ(2u, map.changedSlots().size());
+  int32_t coor[3] = {0, 0, 0};
+  float points[2 * kVoxelMapFeatures];
+  int found = 0;
+  for (int32_t slot = 0; slot < 2; ++slot) {
+    const int32_t num = map.readSlot(slot, coor, points);
+    EXPECT_EQ(1, num);
+    EXPECT_EQ(1.0f, points[3]);
+    found |= 1 << coor[2];
+  }
+  EXPECT_EQ(6, found);
+
+  map.evict(2);
+  EXPECT_EQ(0, map.voxelNum());
+  EXPECT_EQ(0u, map.pointNum());
+  for (int32_t slot : map.changedSlots()) {
+    EXPECT_EQ(0, map.slotPointNum(slot));
+  }
+}
+
+TEST(DISABLED_VOXEL_MAP, benchmark) {
+  const int max_points = 10, max_voxels = 400000, window = 10;
+  const int num_points = 100000, frames = 30;
+  const mluop::VoxelGrid grid = makeVoxelMapGrid(0.2f);
+  SweepGenerator sweeps(num_points, 2024);
+  mluop::VoxelMap map;
+  map.reset(grid, max_points, max_voxels, kVoxelMapFeatures);
+  std::deque<std::vector<float>> retained;
+  std::vector<float> voxels((size_t)max_voxels * max_points *
+                            kVoxelMapFeatures);
+  std::vector<int32_t> coors(max_voxels * 3), num(max_voxels);
+  double incremental_ms = 0, rebuild_ms = 0;
+  size_t changed = 0;
+  for (int frame = 0; frame < frames; ++frame) {
+    std::vector<float> sweep = sweeps.next(0.05f);
+    auto start = std::chrono::steady_clock::now();
+    map.append(sweep.data(), num_points, frame);
+    map.evict(frame - window + 1);
+    for (int32_t slot : map.changedSlots()) {
+      map.readSlot(slot, &coors[slot * 3],
+                   &voxels[(size_t)slot * max_points * kVoxelMapFeatures]);
+    }
+    const size_t frame_changed = map.changedSlots().size();
+    map.clearChanges();
+    auto mid = std::chrono::steady_clock::now();
+
+    retained.push_back(std::move(sweep));
+    if (static_cast<int>(retained.size()) > window) retained.pop_front();
+    std::vector<float> all;
+    for (const auto &s : retained) all.insert(all.end(), s.begin(), s.end());
+    auto rebuild_start = std::chrono::steady_clock::now();
+    int32_t voxel_num = 0;
+    mluop::hardVoxelize(grid, all.data(), all.size() / kVoxelMapFeatures,
+                        kVoxelMapFeatures, max_points, max_voxels,
+                        voxels.data(), coors.data(), num.data(), &voxel_num);
+    auto end = std::chrono::steady_clock::now();
+    // the first window only fills the map.
+    if (frame >= window) {
+      incremental_ms +=
+          std::chrono::duration<double, std::milli>(mid - start).count();
+      rebuild_ms +=
+          std::chrono::duration<double, std::milli>(end - rebuild_start)
+              .count();
+      changed += frame_changed;
+    }
+  }
+  const int measured = frames - window;
+  BenchmarkLine() << "per frame of " << num_points << " points, window "
+                  << window << ": incremental " << incremental_ms / measured
+                  << " ms, full rebuild " << rebuild_ms / measured << " ms, "
+                  << changed / measured << " changed of " << map.voxelNum()
+                  << " voxels";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_VOXEL_MAP_TEST_H_
@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_WORKSPACE_ARENA_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_WORKSPACE_ARENA_TEST_H_
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "gtest/gtest.h"
+#include "core/workspace_arena.h"
+
+namespace {
+// Host allocator recording the calls made by the arena.
+class FakeWorkspaceAllocator : public mluop::WorkspaceAllocator {
+ public:
+  struct Record {
+    int allocate_num = 0;
+    int deallocate_num = 0;
+    int synchronize_num = 0;
+    size_t live_bytes = 0;
+    bool fail_next = false;
+  };
+  explicit FakeWorkspaceAllocator(Record *record) : record_(record) {}
+  void *allocate(size_t size) override {
+    if (record_->fail_next) {
+      record_->fail_next = false;
+      return nullptr;
+    }
+    record_->allocate_num++;
+    record_->live_bytes += size;
+    sizes_.push_back(size);
+    return malloc(size);
+  }
+  void deallocate(void *ptr) override {
+    record_->deallocate_num++;
+    record_->live_bytes -= sizes_.back();
+    sizes_.pop_back();
+    free(ptr);
+  }
+  void synchronize() override { record_->synchronize_num++; }
+
+ private:
+  Record *record_;
+  std::vector<size_t> sizes_;
+};
+}  // namespace
+
+TEST(WORKSPACE_ARENA, grow_and_reuse) {
+  FakeWorkspaceAllocator::Record record;
+  mluop::WorkspaceArena arena(std::unique_ptr<mluop::WorkspaceAllocator>(
+      new FakeWorkspaceAllocator(&record)));
+  const size_t granularity = mluop::WorkspaceArena::kGranularity;
+
+  EXPECT_EQ(nullptr, arena.acquire(0));
+  EXPECT_EQ(0, record.allocate_num);
+
+  void *first = arena.acquire(100);
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(granularity, arena.capacity());
+  // smaller and equal requests reuse the buffer without synchronization.
+  EXPECT_EQ(first, arena.acquire(10));
+  EXPECT_EQ(first, arena.acquire(granularity));
+  EXPECT_EQ(1, record.allocate_num);
+  EXPECT_EQ(0, record.synchronize_num);
+
+  ASSERT_NE(nullptr, arena.acquire(granularity + 1));
+  EXPECT_EQ(2 * granularity, arena.capacity());
+  EXPECT_EQ(2, record.allocate_num);
+  EXPECT_EQ(1, record.deallocate_num);
+  EXPECT_EQ(1, record.synchronize_num);
+  EXPECT_EQ(2 * granularity, record.live_bytes);
+
+  mluOpWorkspaceArenaStats_t stats = arena.stats();
+  EXPECT_EQ(2 * granularity, stats.capacity);
+  EXPECT_EQ(granularity + 1, stats.high_water_mark);
+  EXPECT_EQ(5, stats.request_count);
+  EXPECT_EQ(2, stats.growth_count);
+  EXPECT_EQ(0, stats.trim_count);
+}
+
+TEST(WORKSPACE_ARENA, trim) {
+  FakeWorkspaceAllocator::Record record;
+  {
+    mluop::WorkspaceArena arena(std::unique_ptr<mluop::WorkspaceAllocator>(
+        new FakeWorkspaceAllocator(&record)));
+    const size_t granularity = mluop::WorkspaceArena::kGranularity;
+    ASSERT_NE(nullptr, arena.acquire(3 * granularity));
+
+    // retaining more than the capacity keeps the buffer.
+    arena.trim(4 * granularity);
+    EXPECT_EQ(3 * granularity, arena.capacity());
+    EXPECT_EQ(1, record.allocate_num);
+
+    arena.trim(granularity);
+    EXPECT_EQ(granularity, arena.capacity());
+    // trimming frees memory, the largest request is still reported.
+    EXPECT_EQ(3 * granularity, arena.stats().high_water_mark);
+    EXPECT_EQ(granularity, record.live_bytes);
+
+    arena.trim(0);
+    EXPECT_EQ(0, arena.capacity());
+    EXPECT_EQ(0, record.live_bytes);
+    EXPECT_EQ(3, arena.stats().trim_count);
+
+    ASSERT_NE(nullptr, arena.acquire(1));
+    EXPECT_EQ(granularity, record.live_bytes);
+  }
+  // the destructor synchronizes and releases the buffer.
+  EXPECT_EQ(0, record.live_bytes);
+  EXPECT_EQ(record.allocate_num, record.deallocate_num);
+  EXPECT_EQ(record.deallocate_num, record.synchronize_num);
+}
+
+TEST(WORKSPACE_ARENA, allocation_failure) {
+  FakeWorkspaceAllocator::Record record;
+  mluop::WorkspaceArena arena(std::unique_ptr<mluop::WorkspaceAllocator>(
+      new FakeWorkspaceAllocator(&record)));
+  ASSERT_NE(nullptr, arena.acquire(1));
+  record.fail_next = true;
+  EXPECT_EQ(nullptr, arena.acquire(2 * mluop::WorkspaceArena::kGranularity));
+  EXPECT_EQ(0, arena.capacity());
+  EXPECT_EQ(1, arena.stats().growth_count);
+  // the next request allocates again.
+  EXPECT_NE(nullptr, arena.acquire(1));
+  EXPECT_EQ(2, arena.stats().growth_count);
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_WORKSPACE_ARENA_TEST_H_
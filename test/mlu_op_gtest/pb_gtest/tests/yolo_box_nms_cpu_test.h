@@ -0,0 +1,284 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_TESTS_YOLO_BOX_NMS_CPU_TEST_H_
+#define TEST_MLU_OP_GTEST_TESTS_YOLO_BOX_NMS_CPU_TEST_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <numeric>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_util.h"
+#include "yolo_box_nms_cpu.h"
+
+namespace {
+using mluoptest::BenchmarkLine;
+using mluoptest::elapsedMs;
+namespace yn = mluoptest::yolo_box_nms_cpu;
+
+struct YnCase {
+  yn::Shape shape;
+  yn::Param param;
+  std::vector<float> x;
+  std::vector<float> img_size;
+  std::vector<float> anchors;
+};
+
+// Logits of a detection head: a few objects stand out of the background.
+YnCase ynCase(const yn::Shape &shape, const yn::Param &param, int seed) {
+  std::mt19937 gen(seed);
+  std::normal_distribution<float> obj(-6.0f, 2.0f), logit(-3.0f, 2.0f);
+  std::uniform_real_distribution<float> box(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> img(200, 800), anchor(10, 120);
+  YnCase c = {shape, param, {}, {}, {}};
+  const int64_t hw = (int64_t)shape.h * shape.w;
+  const int entries = param.class_num + 5;
+  c.x.resize((size_t)shape.n * shape.anchor_s *
+             (entries + (param.iou_aware ? 1 : 0)) * hw);
+  for (int i = 0; i < shape.n; ++i) {
+    for (int an = 0; an < shape.anchor_s; ++an) {
+      float *t = c.x.data() + yn::entryOffset(shape, param, i, an, 0);
+      for (int64_t k = 0; k < 4 * hw; ++k) t[k] = box(gen);
+      for (int64_t k = 4 * hw; k < 5 * hw; ++k) t[k] = obj(gen);
+      for (int64_t k = 5 * hw; k < entries * hw; ++k) t[k] = logit(gen);
+      if (param.iou_aware) {
+        // the iou channels come before the anchors
+        float *iou = c.x.data() + ((int64_t)i * shape.anchor_s *
+                                       (entries + 1) +
+                                   an) *
+                                      hw;
+        for (int64_t k = 0; k < hw; ++k) iou[k] = logit(gen) + 3.0f;
+      }
+    }
+  }
+  for (int i = 0; i < shape.n; ++i) {
+    c.img_size.push_back(img(gen));
+    c.img_size.push_back(img(gen));
+  }
+  for (int k = 0; k < 2 * shape.anchor_s; ++k) c.anchors.push_back(anchor(gen));
+  return c;
+}
+
+struct YnOutput {
+  std::vector<float> boxes;
+  std::vector<float> scores;
+  std::vector<int32_t> num;
+  int64_t materialized = 0;  // floats written between the stages
+};
+
+// mluOpYoloBox followed by a sort and NMS of every class: all the boxes
+// and scores are decoded, then sorted.
+void ynUnfused(const YnCase &c, YnOutput *out) {
+  const yn::Shape &s = c.shape;
+  const yn::Param &p = c.param;
+  const int64_t hw = (int64_t)s.h * s.w;
+  const int64_t boxes_num = s.anchor_s * hw;
+  std::vector<float> conf(boxes_num), boxes(boxes_num * 4);
+  std::vector<float> scores(p.class_num * boxes_num);
+  const int64_t pairs = (int64_t)s.n * p.class_num;
+  out->boxes.assign(pairs * p.max_output * 4, 0.0f);
+  out->scores.assign(pairs * p.max_output, 0.0f);
+  out->num.assign(pairs, 0);
+  out->materialized = 0;
+  for (int i = 0; i < s.n; ++i) {
+    yn::confidence(c.x.data(), s, p, i, conf.data());
+    for (int64_t b = 0; b < boxes_num; ++b) {
+      yn::decode(c.x.data(), c.img_size.data(), c.anchors.data(), s, p, i,
+                 b, &boxes[b * 4]);
+      const int an = b / hw;
+      const int64_t k = b % hw;
+      for (int cls = 0; cls < p.class_num; ++cls) {
+        const float logit =
+            c.x[yn::entryOffset(s, p, i, an, 5 + cls) + k];
+        scores[cls * boxes_num + b] =
+            conf[b] < p.conf_thresh ? 0.0f : conf[b] * yn::sigmoid(logit);
+      }
+    }
+    out->materialized += boxes.size() + scores.size();
+    for (int cls = 0; cls < p.class_num; ++cls) {
+      const float *score = &scores[cls * boxes_num];
+      std::vector<yn::Candidate> sorted;
+      for (int64_t b = 0; b < boxes_num; ++b) {
+        if (score[b] > p.score_thresh) {
+          sorted.push_back({score[b], static_cast<int32_t>(b)});
+        }
+      }
+      std::stable_sort(sorted.begin(), sorted.end(),
+                       [](const yn::Candidate &a, const yn::Candidate &b) {
+                         return a.score > b.score;
+                       });
+      if ((int)sorted.size() > p.top_k) sorted.resize(p.top_k);
+      const int64_t t = (int64_t)i * p.class_num + cls;
+      out->num[t] = yn::nms(
+          sorted, p,
+          [&](int index, float *box) {
+            std::copy(&boxes[index * 4], &boxes[index * 4 + 4], box);
+          },
+          &out->boxes[t * p.max_output * 4], &out->scores[t * p.max_output]);
+    }
+  }
+}
+
+void ynFused(const YnCase &c, YnOutput *out) {
+  const int64_t pairs = (int64_t)c.shape.n * c.param.class_num;
+  out->boxes.resize(pairs * c.param.max_output * 4);
+  out->scores.resize(pairs * c.param.max_output);
+  out->num.resize(pairs);
+  yn::yoloBoxNms(c.x.data(), c.img_size.data(), c.anchors.data(), c.shape,
+                 c.param, out->boxes.data(), out->scores.data(),
+                 out->num.data());
+  out->materialized = 0;
+}
+
+yn::Param ynParam(int class_num, bool iou_aware) {
+  yn::Param p;
+  p.class_num = class_num;
+  p.conf_thresh = 0.01f;
+  p.downsample_ratio = 32;
+  p.clip_bbox = true;
+  p.scale = 1.05f;
+  p.iou_aware = iou_aware;
+  p.iou_aware_factor = 0.4f;
+  p.score_thresh = 0.05f;
+  p.top_k = 400;
+  p.iou_threshold = 0.45f;
+  p.max_output = 50;
+  return p;
+}
+}  // namespace
+
+TEST(YOLO_BOX_NMS_CPU, plan) {
+  const size_t nram = 768 * 1024;
+  mluop::YoloBoxNmsPlan plan;
+  // the heap fits next to the kept boxes
+  ASSERT_TRUE(mluop::planYoloBoxNms(nram, 48, 3, 1000, 100, &plan));
+  ASSERT_TRUE(plan.heap_in_nram);
+  ASSERT_EQ(0u, plan.workspace_size);
+  ASSERT_EQ(0u, plan.heap_offset % mluop::kYoloBoxNmsNramAlign);
+  ASSERT_EQ(0u, plan.chunk_offset % mluop::kYoloBoxNmsNramAlign);
+  ASSERT_GE(plan.heap_offset, plan.kept_offset + 100 * 5 * sizeof(float));
+  ASSERT_GE(plan.chunk_offset,
+            plan.heap_offset + 1000 * sizeof(mluop::YoloBoxNmsCandidate));
+  ASSERT_EQ(mluop::kYoloBoxNmsMaxDeal, plan.deal_num);
+  ASSERT_LE(plan.chunk_offset + (size_t)plan.deal_num *
+                                    mluop::kYoloBoxNmsChunkArrays *
+                                    sizeof(float),
+            nram);
+
+  // every task spills its heap to its own workspace slot
+  ASSERT_TRUE(mluop::planYoloBoxNms(nram, 48, 3, 100000, 100, &plan));
+  ASSERT_FALSE(plan.heap_in_nram);
+  ASSERT_EQ(plan.heap_offset, plan.chunk_offset);
+  ASSERT_GE(plan.heap_bytes, 100000 * sizeof(mluop::YoloBoxNmsCandidate));
+  ASSERT_EQ(48 * plan.heap_bytes, plan.workspace_size);
+  ASSERT_EQ(0, plan.deal_num % mluop::kYoloBoxNmsDealAlign);
+  ASSERT_LE(plan.chunk_offset + (size_t)plan.deal_num *
+                                    mluop::kYoloBoxNmsChunkArrays *
+                                    sizeof(float),
+            nram);
+
+  // the kept boxes alone do not fit
+  ASSERT_FALSE(mluop::planYoloBoxNms(nram, 48, 3, 100, 60000, &plan));
+}
+
+TEST(YOLO_BOX_NMS_CPU, matches_unfused) {
+  for (bool iou_aware : {false, true}) {
+    for (int top_k : {1, 7, 400, 100000}) {
+      yn::Param param = ynParam(6, iou_aware);
+      param.top_k = top_k;
+      param.clip_bbox = top_k % 2 == 0;
+      const YnCase c = ynCase({3, 3, 13, 11}, param, top_k);
+      YnOutput ref, out;
+      ynUnfused(c, &ref);
+      ynFused(c, &out);
+      ASSERT_EQ(ref.num, out.num) << "iou_aware " << iou_aware << " top_k "
+                                  << top_k;
+      ASSERT_EQ(ref.scores, out.scores);
+      ASSERT_EQ(ref.boxes, out.boxes);
+      for (int32_t n : out.num) ASSERT_LE(n, std::min(top_k, 50));
+    }
+  }
+}
+
+TEST(YOLO_BOX_NMS_CPU, ties_and_limits) {
+  // constant logits: every box of a class has the same score, so the
+  // lowest indices win, and no threshold or limit lets anything through
+  yn::Param param = ynParam(2, false);
+  param.top_k = 5;
+  param.iou_threshold = 1.0f;
+  param.max_output = 3;
+  YnCase c = ynCase({1, 2, 4, 4}, param, 9);
+  std::fill(c.x.begin(), c.x.end(), 0.0f);
+  YnOutput ref, out;
+  ynUnfused(c, &ref);
+  ynFused(c, &out);
+  ASSERT_EQ(ref.boxes, out.boxes);
+  ASSERT_EQ(std::vector<int32_t>(2, 3), out.num);
+  ASSERT_EQ(0.25f, out.scores[0]);
+
+  param.iou_threshold = 0.0f;  // the grid boxes overlap their neighbours
+  c.param = param;
+  ynUnfused(c, &ref);
+  ynFused(c, &out);
+  ASSERT_EQ(ref.num, out.num);
+  ASSERT_EQ(ref.boxes, out.boxes);
+
+  for (int variant = 0; variant < 3; ++variant) {
+    c.param = ynParam(2, false);
+    if (variant == 0) c.param.score_thresh = 0.25f;
+    if (variant == 1) c.param.top_k = 0;
+    if (variant == 2) c.param.max_output = 0;
+    ynFused(c, &out);
+    ASSERT_EQ(std::vector<int32_t>(2, 0), out.num);
+    ASSERT_TRUE(std::all_of(out.scores.begin(), out.scores.end(),
+                            [](float v) { return v == 0.0f; }));
+  }
+}
+
+TEST(DISABLED_YOLO_BOX_NMS_CPU, benchmark) {
+  // the 76 x 76 head of YOLOv3 over COCO, 8 images
+  yn::Param param = ynParam(80, false);
+  param.top_k = 1000;
+  param.max_output = 100;
+  const YnCase c = ynCase({8, 3, 76, 76}, param, 1);
+
+  auto start = std::chrono::steady_clock::now();
+  YnOutput ref;
+  ynUnfused(c, &ref);
+  const double unfused_ms = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  YnOutput out;
+  ynFused(c, &out);
+  const double fused_ms = elapsedMs(start);
+
+  ASSERT_EQ(ref.num, out.num);
+  const int64_t kept = std::accumulate(out.num.begin(), out.num.end(), 0);
+  BenchmarkLine() << kept << " boxes kept: unfused " << unfused_ms << " ms, "
+                  << ref.materialized * sizeof(float) / (1 << 20)
+                  << " MB decoded, fused " << fused_ms << " ms";
+}
+
+#endif  // TEST_MLU_OP_GTEST_TESTS_YOLO_BOX_NMS_CPU_TEST_H_